@@ -30,6 +30,9 @@ namespace Light
 		bool onMouseButtonPressed(MouseButtonPressedEvent& e);
 		bool onKeyPressed(KeyPressedEvent& e);
 
+		// Start running physics in the scene, or stop and put its bodies back where they were
+		void toggleSimulation();
+
 		void addDefaultMeshes();
 
 		std::shared_ptr<MeshLibrary> m_meshes;
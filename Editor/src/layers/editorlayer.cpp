@@ -109,6 +109,9 @@ namespace Light
 		}
 		m_camera.onUpdate(ts);
 
+		// Physics only runs while the scene is played, see toggleSimulation()
+		m_scene->update(ts);
+
 		m_sceneRenderer.renderEditor(m_scene, m_camera);
 		m_sceneRenderer.renderOutline(m_scene, selectedEntity);
 	}
@@ -131,6 +134,9 @@ namespace Light
 		case LIGHT_KEY_O:
 			if (Input::isKeyPressed(LIGHT_KEY_LEFT_CONTROL)) { m_projectNamePopup.openPopup(); }
 			break;
+		case LIGHT_KEY_P:
+			if (Input::isKeyPressed(LIGHT_KEY_LEFT_CONTROL)) { toggleSimulation(); }
+			break;
 		default:
 			break;
 		}
@@ -165,6 +171,11 @@ namespace Light
 				if(ImGui::MenuItem("Open Project", "Ctrl+O")) m_projectNamePopup.openPopup();
 				ImGui::EndMenu();
 			}
+			if(ImGui::BeginMenu("Scene"))
+			{
+				if(ImGui::MenuItem(m_scene->isSimulating() ? "Stop" : "Play", "Ctrl+P")) toggleSimulation();
+				ImGui::EndMenu();
+			}
 			ImGui::EndMainMenuBar();
 		}
 
@@ -193,6 +204,18 @@ namespace Light
 		m_assetBrowser.onImguiRender();
 	}
 
+	void EditorLayer::toggleSimulation()
+	{
+		if (m_scene->isSimulating())
+		{
+			m_scene->stopSimulation();
+		}
+		else
+		{
+			m_scene->startSimulation();
+		}
+	}
+
 	void EditorLayer::addDefaultMeshes()
 	{
 		m_meshes->add("None", std::vector<glm::vec3>(), std::vector<glm::vec4>(), std::vector<glm::vec3>(), std::vector<unsigned int>());
@@ -17,6 +17,8 @@ namespace Light
 		~Mesh() = default;
 
 		inline std::shared_ptr<VertexArray> getVao() const { return m_vao; }
+		inline const std::vector<glm::vec3>& getVertices() const { return m_vertices; }
+		inline const std::vector<unsigned int>& getIndices() const { return m_indices; }
 
 	private:
 		std::vector<glm::vec3> m_vertices;
@@ -80,6 +80,15 @@ namespace Light
 		float m_range  = 10.0;
 	};
 
+	struct RigidBodyComponent : public Component
+	{
+		RigidBodyComponent(std::size_t bodyIndex, const glm::vec3& position)
+			: bodyIndex(bodyIndex), syncedPosition(position) {}
+
+		std::size_t bodyIndex; // Index of the body in the scene's Physicc::PhysicsWorld
+		glm::vec3 syncedPosition; // Position last exchanged with the world, to tell when the transform was edited
+	};
+
 	struct CameraComponent : public Component
 	{
 		CameraComponent() = default;
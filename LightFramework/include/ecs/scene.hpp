@@ -6,6 +6,7 @@
 #include "light/rendering/texture.hpp"
 #include "light/rendering/shader.hpp"
 #include "light/rendering/vertexarray.hpp"
+#include "physicsworld.hpp"
 
 namespace Light
 {
@@ -20,9 +21,44 @@ namespace Light
 		void removeEntity(Entity entity);
 		void update(Light::Timestep dt);
 
+		/*
+		 * @brief Start running physics in update()
+		 *
+		 * Until then the scene is being edited, and update() leaves the bodies and transforms alone. The positions of
+		 * the entities with a rigid body are saved, to be put back by stopSimulation().
+		 */
+		void startSimulation();
+
+		/*
+		 * @brief Stop running physics, and put the entities with a rigid body back where they were when the
+		 * simulation started, at rest
+		 */
+		void stopSimulation();
+
+		inline bool isSimulating() const { return m_simulating; }
+
+		/*
+		 * @brief Add a rigid body to the scene's physics world and attach it to an entity
+		 *
+		 * While the scene is simulating, update() moves the entity's TransformComponent along with the body, and
+		 * edits to the transform's position move the body. Removing the entity removes the body from the world.
+		 */
+		void addRigidBody(Entity entity, const Physicc::RigidBody& body);
+
+		/*
+		 * @brief Get the scene's physics world, creating it if the scene has none yet
+		 */
+		Physicc::PhysicsWorld& getPhysicsWorld();
+
 	private:
 		entt::registry m_registry;
 
+		// Created along with the first rigid body, so that scenes without any do not start the world's threads
+		std::unique_ptr<Physicc::PhysicsWorld> m_physicsWorld;
+
+		bool m_simulating = false;
+		std::vector<std::pair<entt::entity, glm::vec3>> m_savedPositions;
+
 		std::shared_ptr<Light::Cubemap> m_skybox;
 
 		friend class Entity;
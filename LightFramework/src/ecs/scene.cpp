@@ -26,13 +26,110 @@ namespace Light
 
 	void Scene::removeEntity(Entity entity) 
 	{
+		if (entity.hasComponent<RigidBodyComponent>())
+		{
+			m_physicsWorld->removeRigidBody(entity.getComponent<RigidBodyComponent>().bodyIndex);
+		}
+
 		m_registry.destroy((entt::entity)(uint32_t)entity);
 	}
 	
 
-	void Scene::update(Timestep)
+	void Scene::addRigidBody(Entity entity, const Physicc::RigidBody& body)
+	{
+		const glm::vec3& position = entity.getComponent<TransformComponent>().position;
+
+		Physicc::RigidBody placedBody = body;
+		placedBody.setPosition(position);
+
+		entity.addComponent<RigidBodyComponent>(getPhysicsWorld().addRigidBody(placedBody), position);
+	}
+
+	Physicc::PhysicsWorld& Scene::getPhysicsWorld()
+	{
+		if (!m_physicsWorld)
+		{
+			m_physicsWorld = std::make_unique<Physicc::PhysicsWorld>(glm::vec3(0, -9.81f, 0));
+		}
+
+		return *m_physicsWorld;
+	}
+
+	void Scene::startSimulation()
+	{
+		if (m_simulating)
+		{
+			return;
+		}
+
+		m_savedPositions.clear();
+
+		auto view = m_registry.view<RigidBodyComponent, TransformComponent>();
+		for(auto entity : view)
+		{
+			m_savedPositions.emplace_back(entity, view.get<TransformComponent>(entity).position);
+		}
+
+		m_simulating = true;
+	}
+
+	void Scene::stopSimulation()
 	{
-		
+		if (!m_simulating)
+		{
+			return;
+		}
+
+		for(auto [entity, position] : m_savedPositions)
+		{
+			// Entities removed during the simulation stay removed
+			if (!m_registry.valid(entity))
+			{
+				continue;
+			}
+
+			auto& body = m_registry.get<RigidBodyComponent>(entity);
+			m_registry.get<TransformComponent>(entity).position = position;
+			m_physicsWorld->setPosition(body.bodyIndex, position);
+			m_physicsWorld->setVelocity(body.bodyIndex, glm::vec3(0.0f));
+			body.syncedPosition = position;
+		}
+
+		m_savedPositions.clear();
+		m_simulating = false;
+	}
+
+	void Scene::update(Timestep dt)
+	{
+		// While the scene is edited, transforms belong to the user
+		if (!m_simulating || !m_physicsWorld)
+		{
+			return;
+		}
+
+		auto view = m_registry.view<RigidBodyComponent, TransformComponent>();
+
+		// Transforms edited since the last update (in the inspector or with the gizmo) move their bodies,
+		// which start again from rest there
+		for(auto entity : view)
+		{
+			auto [body, transform] = view.get(entity);
+			if(transform.position != body.syncedPosition)
+			{
+				m_physicsWorld->setPosition(body.bodyIndex, transform.position);
+				m_physicsWorld->setVelocity(body.bodyIndex, glm::vec3(0.0f));
+			}
+		}
+
+		// The physics world runs at a fixed rate of its own, independent of the frame rate
+		m_physicsWorld->update(static_cast<float>(dt.getSeconds()));
+
+		for(auto entity : view)
+		{
+			auto [body, transform] = view.get(entity);
+			transform.position = m_physicsWorld->getInterpolatedPosition(body.bodyIndex);
+			body.syncedPosition = transform.position;
+		}
 	}
 
 }
\ No newline at end of file
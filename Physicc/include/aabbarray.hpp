@@ -0,0 +1,107 @@
+#ifndef __AABBARRAY_H__
+#define __AABBARRAY_H__
+
+#include "boundingvolume.hpp"
+#include "bodypair.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace Physicc
+{
+	/**
+	 * @brief A list of AABBs stored as a structure of arrays
+	 *
+	 * Every bound has an array of its own (all the lower x bounds, then all
+	 * the lower y bounds, ...), which lets the overlap tests below check a
+	 * box against 4 (SSE) or 8 (AVX) others per instruction, instead of one
+	 * pair of boxes at a time like BoxBV::overlapsWith.
+	 *
+	 * The arrays are padded to a multiple of s_blockSize with boxes that
+	 * never overlap anything, so the tests never need to deal with a partial
+	 * block at the end.
+	 */
+	class AABBArray
+	{
+		public:
+			static constexpr std::size_t s_blockSize = 8;
+
+			AABBArray() = default;
+			AABBArray(const std::vector<BoundingVolume::AABB>& boxes);
+
+			[[nodiscard]] inline std::size_t size() const
+			{
+				return m_size;
+			}
+
+			[[nodiscard]] inline bool empty() const
+			{
+				return m_size == 0;
+			}
+
+			void clear();
+			void reserve(std::size_t capacity);
+			void resize(std::size_t size);
+			void push_back(const BoundingVolume::AABB& box);
+			void set(std::size_t index, const BoundingVolume::AABB& box);
+
+			[[nodiscard]] BoundingVolume::AABB operator[](std::size_t index) const;
+
+			/**
+			 * @brief Find the boxes in a range that overlap a given box
+			 *
+			 * @param box The box to test against
+			 * @param indices Indices of the overlapping boxes are appended to
+			 * this list
+			 * @param start First index of the range to test
+			 * @param end One past the last index of the range. Defaults to
+			 * the end of the list.
+			 */
+			void queryOverlaps(const BoundingVolume::AABB& box,
+			                   std::vector<std::uint32_t>& indices,
+			                   std::size_t start = 0,
+			                   std::size_t end = std::numeric_limits<std::size_t>::max()) const;
+
+			/**
+			 * @brief Find all overlapping pairs of boxes in this list, by
+			 * testing every box against all of the ones after it
+			 *
+			 * @param pairs Output list. Cleared first, but keeps its capacity.
+			 */
+			void queryPairs(std::vector<BodyPair>& pairs) const;
+
+			/**
+			 * @brief Find all overlapping pairs with one box from this list
+			 * and one from another
+			 *
+			 * @param other The other list
+			 * @param pairs Output list, holding the index into this list
+			 * first and the index into `other` second. Cleared first, but
+			 * keeps its capacity.
+			 */
+			void queryPairs(const AABBArray& other, std::vector<BodyPair>& pairs) const;
+
+		private:
+			std::vector<float> m_minX;
+			std::vector<float> m_minY;
+			std::vector<float> m_minZ;
+			std::vector<float> m_maxX;
+			std::vector<float> m_maxY;
+			std::vector<float> m_maxZ;
+			std::size_t m_size = 0;
+
+			unsigned int overlapMask(std::size_t block,
+			                         const glm::vec3& lowerBound,
+			                         const glm::vec3& upperBound) const;
+			//bit i is set if box (block + i) overlaps the given bounds
+
+			template <typename Callback>
+			void forEachOverlap(const BoundingVolume::AABB& box,
+			                    std::size_t start,
+			                    std::size_t end,
+			                    Callback&& callback) const;
+	};
+}
+
+#endif //__AABBARRAY_H__
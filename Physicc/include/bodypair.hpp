@@ -0,0 +1,27 @@
+#ifndef __BODYPAIR_H__
+#define __BODYPAIR_H__
+
+#include <cstdint>
+
+namespace Physicc
+{
+	/**
+	 * @brief A pair of bodies whose bounding volumes overlap
+	 *
+	 * Holds indices into the body list the pair was found in, with
+	 * first < second. Pairs found between two different lists hold an index
+	 * into each instead.
+	 */
+	struct BodyPair
+	{
+		std::uint32_t first;
+		std::uint32_t second;
+
+		[[nodiscard]] inline bool operator==(const BodyPair& other) const
+		{
+			return first == other.first && second == other.second;
+		}
+	};
+}
+
+#endif //__BODYPAIR_H__
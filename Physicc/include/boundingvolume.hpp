@@ -1,11 +1,14 @@
 #ifndef __BOUNDINGVOLUME_H__
 #define __BOUNDINGVOLUME_H__
 
-#include "tools/Tracy.hpp"
+#include "profiling.hpp"
 
 #include "glm/glm.hpp"
+#include "glm/gtc/constants.hpp"
 #include "glm/gtc/epsilon.hpp"
 
+#include <array>
+
 namespace Physicc
 {
 	//Named namespace, to keep the implementation hidden from users (or at least
@@ -61,14 +64,14 @@ namespace Physicc
 				 */
 				BaseBV(const BoundingObject& volume)
 				{
-					ZoneScoped;
+					PHYSICC_ZONE_FINE;
 
 					typeCast()->setVolume(volume);
 				}
 
 				BaseBV(const glm::vec3& lowerBound, const glm::vec3& upperBound)
 				{
-					ZoneScoped;
+					PHYSICC_ZONE_FINE;
 
 					typeCast()->setVolume(lowerBound, upperBound);
 				}
@@ -82,7 +85,7 @@ namespace Physicc
  				 */
 				[[nodiscard]] inline bool overlapsWith(const BaseBV& bv) const
 				{
-					ZoneScoped;
+					PHYSICC_ZONE_FINE;
 
 					return constTypeCast()->overlapsWith(static_cast<const Derived&>(bv));
 				}
@@ -91,7 +94,7 @@ namespace Physicc
 
 				[[nodiscard]] inline float getVolume() const
 				{
-					ZoneScoped;
+					PHYSICC_ZONE_FINE;
 
 					return constTypeCast()->getVolume();
 				}
@@ -101,9 +104,18 @@ namespace Physicc
 				//to use this function will likely result in 5 pages of opaque
 				//errors.
 
+				[[nodiscard]] inline float getSurfaceArea() const
+				{
+					PHYSICC_ZONE_FINE;
+
+					return constTypeCast()->getSurfaceArea();
+				}
+				//Same deal as getVolume(). This is the quantity the Surface
+				//Area Heuristic in the BVH builder works with.
+
 				[[nodiscard]] Derived enclosingBV(const BaseBV& bv) const
 				{
-					ZoneScoped;
+					PHYSICC_ZONE_FINE;
 
 					return constTypeCast()->enclosingBV(static_cast<const Derived&>(bv));
 				}
@@ -154,14 +166,14 @@ namespace Physicc
 
 				BoxBV(const glm::vec3& lowerBound, const glm::vec3& upperBound)
 				{
-					ZoneScoped;
+					PHYSICC_ZONE_FINE;
 
 					this->m_volume = {lowerBound, upperBound};
 				}
 
 				inline void setVolume(const T& volume)
 				{
-					ZoneScoped;
+					PHYSICC_ZONE_FINE;
 
 					this->m_volume = volume;
 				}
@@ -169,7 +181,7 @@ namespace Physicc
 				inline void setVolume(const glm::vec3& lowerBound,
 				                      const glm::vec3& upperBound)
 				{
-					ZoneScoped;
+					PHYSICC_ZONE_FINE;
 
 					this->m_volume = {lowerBound, upperBound};
 					//implicit contract: any BoxBV will have a struct that has
@@ -178,7 +190,7 @@ namespace Physicc
 
 				inline float getVolume() const
 				{
-					ZoneScoped;
+					PHYSICC_ZONE_FINE;
 
 					//[[nodiscard]] is not needed here because this function is
 					//never called by the end user. It is simply called by BV
@@ -189,9 +201,57 @@ namespace Physicc
 						* (this->m_volume.upperBound.z - this->m_volume.lowerBound.z);
 				}
 
+				inline float getSurfaceArea() const
+				{
+					PHYSICC_ZONE_FINE;
+
+					glm::vec3 extent = this->m_volume.upperBound - this->m_volume.lowerBound;
+
+					return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+				}
+
+				[[nodiscard]] inline const glm::vec3& getLowerBound() const
+				{
+					return this->m_volume.lowerBound;
+				}
+
+				[[nodiscard]] inline const glm::vec3& getUpperBound() const
+				{
+					return this->m_volume.upperBound;
+				}
+
+				[[nodiscard]] inline glm::vec3 getCenter() const
+				{
+					return 0.5f * (this->m_volume.lowerBound + this->m_volume.upperBound);
+				}
+
+				/**
+				 * @brief Get the smallest AABB around the volume, which for a
+				 * box is the box itself
+				 *
+				 * Every kind of BV has this, so that queries that only work
+				 * on AABBs (rays, regions) can run against any of them.
+				 */
+				[[nodiscard]] inline const BoxBV& getBounds() const
+				{
+					return *this;
+				}
+
+				/**
+				 * @brief Fit a box around a shape
+				 *
+				 * Every kind of BV has this, for the BVH to build volumes
+				 * around colliders with.
+				 */
+				template <typename Shape>
+				[[nodiscard]] static inline BoxBV fromShape(const Shape& shape)
+				{
+					return shape.getAABB();
+				}
+
 				inline bool overlapsWith(const BoxBV& bv) const
 				{
-					ZoneScoped;
+					PHYSICC_ZONE_FINE;
 
 					return (this->m_volume.lowerBound.x <= bv.m_volume.upperBound.x
 							&& this->m_volume.upperBound.x >= bv.m_volume.lowerBound.x)
@@ -201,9 +261,15 @@ namespace Physicc
 							&& this->m_volume.upperBound.z >= bv.m_volume.lowerBound.z);
 				}
 
+				[[nodiscard]] inline bool contains(const BoxBV& bv) const
+				{
+					return glm::all(glm::lessThanEqual(this->m_volume.lowerBound, bv.m_volume.lowerBound))
+						&& glm::all(glm::greaterThanEqual(this->m_volume.upperBound, bv.m_volume.upperBound));
+				}
+
 				inline BoxBV enclosingBV(const BoxBV& bv) const
 				{
-					ZoneScoped;
+					PHYSICC_ZONE_FINE;
 
 					return {glm::min(this->m_volume.lowerBound, bv.m_volume.lowerBound),
 						glm::max(this->m_volume.upperBound, bv.m_volume.upperBound)};
@@ -211,17 +277,518 @@ namespace Physicc
 				//As per our previous implicit contract, these `glm::vec3`s are
 				//guaranteed to exist, so this is legal.
 		};
+
+		/**
+		 * @brief Bounding sphere
+		 */
+		struct Sphere
+		{
+			glm::vec3 center;
+			float radius;
+		};
+
+		/**
+		 * @brief A sphere shaped BV
+		 *
+		 * Does not change as its shape rotates, so it never needs to be
+		 * refit for rotation, but it is a loose fit for anything long or
+		 * flat.
+		 */
+		class SphereBV : public BaseBV<SphereBV, Sphere>
+		{
+			private:
+				friend BaseBV<SphereBV, Sphere>;
+
+			public:
+				SphereBV() = default;
+
+				SphereBV(const glm::vec3& center, float radius)
+				{
+					this->m_volume = {center, radius};
+				}
+
+				inline void setVolume(const Sphere& volume)
+				{
+					this->m_volume = volume;
+				}
+
+				inline float getVolume() const
+				{
+					float radius = this->m_volume.radius;
+
+					return 4.0f / 3.0f * glm::pi<float>() * radius * radius * radius;
+				}
+
+				inline float getSurfaceArea() const
+				{
+					return 4.0f * glm::pi<float>() * this->m_volume.radius * this->m_volume.radius;
+				}
+
+				[[nodiscard]] inline const glm::vec3& getCenter() const
+				{
+					return this->m_volume.center;
+				}
+
+				[[nodiscard]] inline float getRadius() const
+				{
+					return this->m_volume.radius;
+				}
+
+				[[nodiscard]] inline BoxBV<AABB> getBounds() const
+				{
+					return {this->m_volume.center - this->m_volume.radius,
+						this->m_volume.center + this->m_volume.radius};
+				}
+
+				inline bool overlapsWith(const SphereBV& bv) const
+				{
+					PHYSICC_ZONE_FINE;
+
+					glm::vec3 offset = bv.m_volume.center - this->m_volume.center;
+					float radii = this->m_volume.radius + bv.m_volume.radius;
+
+					return glm::dot(offset, offset) <= radii * radii;
+				}
+
+				[[nodiscard]] inline bool contains(const SphereBV& bv) const
+				{
+					return glm::distance(this->m_volume.center, bv.m_volume.center) + bv.m_volume.radius
+						<= this->m_volume.radius;
+				}
+
+				inline SphereBV enclosingBV(const SphereBV& bv) const
+				{
+					PHYSICC_ZONE_FINE;
+
+					glm::vec3 offset = bv.m_volume.center - this->m_volume.center;
+					float distance = glm::length(offset);
+
+					if (distance + bv.m_volume.radius <= this->m_volume.radius)
+					{
+						return *this;
+					}
+
+					if (distance + this->m_volume.radius <= bv.m_volume.radius)
+					{
+						return bv;
+					}
+
+					//The new sphere spans from the far side of one sphere to
+					//the far side of the other
+					float radius = 0.5f * (distance + this->m_volume.radius + bv.m_volume.radius);
+
+					return {this->m_volume.center + offset * ((radius - this->m_volume.radius) / distance),
+						radius};
+				}
+
+				template <typename Shape>
+				[[nodiscard]] static inline SphereBV fromShape(const Shape& shape)
+				{
+					return {shape.getCentroid(), shape.getBoundingRadius()};
+				}
+		};
+
+		/**
+		 * @brief Oriented Bounding Box
+		 */
+		struct OBB
+		{
+			glm::vec3 center;
+			glm::mat3 axes;
+			//columns are the box's local axes, of unit length
+
+			glm::vec3 halfExtents;
+			//along each of the axes
+		};
+
+		/**
+		 * @brief An oriented box shaped BV
+		 *
+		 * Fits rotated boxes exactly, where an AABB can be up to about 5
+		 * times bigger. Overlap is tested on the 15 separating axes of two
+		 * boxes.
+		 */
+		class OBBBV : public BaseBV<OBBBV, OBB>
+		{
+			private:
+				friend BaseBV<OBBBV, OBB>;
+
+			public:
+				OBBBV() = default;
+
+				OBBBV(const glm::vec3& center, const glm::mat3& axes, const glm::vec3& halfExtents)
+				{
+					this->m_volume = {center, axes, halfExtents};
+				}
+
+				inline void setVolume(const OBB& volume)
+				{
+					this->m_volume = volume;
+				}
+
+				inline float getVolume() const
+				{
+					const glm::vec3& halfExtents = this->m_volume.halfExtents;
+
+					return 8.0f * halfExtents.x * halfExtents.y * halfExtents.z;
+				}
+
+				inline float getSurfaceArea() const
+				{
+					const glm::vec3& halfExtents = this->m_volume.halfExtents;
+
+					return 8.0f * (halfExtents.x * halfExtents.y
+						+ halfExtents.y * halfExtents.z
+						+ halfExtents.z * halfExtents.x);
+				}
+
+				[[nodiscard]] inline const glm::vec3& getCenter() const
+				{
+					return this->m_volume.center;
+				}
+
+				[[nodiscard]] inline const glm::mat3& getAxes() const
+				{
+					return this->m_volume.axes;
+				}
+
+				[[nodiscard]] inline const glm::vec3& getHalfExtents() const
+				{
+					return this->m_volume.halfExtents;
+				}
+
+				[[nodiscard]] inline BoxBV<AABB> getBounds() const
+				{
+					glm::vec3 extent = project(glm::mat3(1.0f));
+
+					return {this->m_volume.center - extent, this->m_volume.center + extent};
+				}
+
+				inline bool overlapsWith(const OBBBV& bv) const
+				{
+					PHYSICC_ZONE_FINE;
+
+					const glm::vec3& a = this->m_volume.halfExtents;
+					const glm::vec3& b = bv.m_volume.halfExtents;
+
+					//The other box's axes and center in this box's frame
+					glm::mat3 rotation = glm::transpose(this->m_volume.axes) * bv.m_volume.axes;
+					glm::vec3 t = glm::transpose(this->m_volume.axes) * (bv.m_volume.center - this->m_volume.center);
+
+					//The epsilon keeps the edge axes from letting boxes with
+					//(nearly) parallel edges through on rounding errors
+					glm::mat3 absRotation;
+
+					for (int i = 0; i < 3; i++)
+					{
+						absRotation[i] = glm::abs(rotation[i]) + glm::vec3(1e-6f);
+					}
+
+					//rotation[j][i] is this box's axis i dotted with the other
+					//box's axis j, glm matrices being indexed by column
+					for (int i = 0; i < 3; i++)
+					{
+						float rb = b.x * absRotation[0][i] + b.y * absRotation[1][i] + b.z * absRotation[2][i];
+
+						if (glm::abs(t[i]) > a[i] + rb)
+						{
+							return false;
+						}
+					}
+
+					for (int j = 0; j < 3; j++)
+					{
+						float ra = glm::dot(a, absRotation[j]);
+
+						if (glm::abs(glm::dot(t, rotation[j])) > ra + b[j])
+						{
+							return false;
+						}
+					}
+
+					for (int i = 0; i < 3; i++)
+					{
+						int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+
+						for (int j = 0; j < 3; j++)
+						{
+							int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+
+							float ra = a[i1] * absRotation[j][i2] + a[i2] * absRotation[j][i1];
+							float rb = b[j1] * absRotation[j2][i] + b[j2] * absRotation[j1][i];
+							float distance = t[i2] * rotation[j][i1] - t[i1] * rotation[j][i2];
+
+							if (glm::abs(distance) > ra + rb)
+							{
+								return false;
+							}
+						}
+					}
+
+					return true;
+				}
+
+				/**
+				 * @brief Fit a box around both boxes
+				 *
+				 * The new box keeps the axes of the bigger of the two, which
+				 * gives looser boxes than an optimal fit, but is cheap enough
+				 * to refit a tree with.
+				 */
+				inline OBBBV enclosingBV(const OBBBV& bv) const
+				{
+					PHYSICC_ZONE_FINE;
+
+					const OBB& bigger = getVolume() >= bv.getVolume() ? this->m_volume : bv.m_volume;
+
+					glm::mat3 toLocal = glm::transpose(bigger.axes);
+					glm::vec3 firstCenter = toLocal * this->m_volume.center;
+					glm::vec3 firstExtent = project(bigger.axes);
+					glm::vec3 secondCenter = toLocal * bv.m_volume.center;
+					glm::vec3 secondExtent = bv.project(bigger.axes);
+
+					glm::vec3 lowerBound = glm::min(firstCenter - firstExtent, secondCenter - secondExtent);
+					glm::vec3 upperBound = glm::max(firstCenter + firstExtent, secondCenter + secondExtent);
+
+					return {bigger.axes * (0.5f * (lowerBound + upperBound)),
+						bigger.axes,
+						0.5f * (upperBound - lowerBound)};
+				}
+
+				template <typename Shape>
+				[[nodiscard]] static inline OBBBV fromShape(const Shape& shape)
+				{
+					return {shape.getCentroid(), shape.getRotationMatrix(), shape.getOrientedHalfExtents()};
+				}
+
+			private:
+				/**
+				 * @brief How far the box reaches from its center along each
+				 * of the columns of `axes`, which have to be of unit length
+				 */
+				[[nodiscard]] inline glm::vec3 project(const glm::mat3& axes) const
+				{
+					glm::mat3 absRotation = glm::transpose(axes) * this->m_volume.axes;
+
+					for (int i = 0; i < 3; i++)
+					{
+						absRotation[i] = glm::abs(absRotation[i]);
+					}
+
+					return absRotation * this->m_volume.halfExtents;
+				}
+		};
+
+		/**
+		 * @brief Directions of the slabs of the standard k-DOPs
+		 *
+		 * The 26-DOP uses all 13: the 3 axes, the 4 diagonals through the
+		 * corners of a cube and the 6 through the middles of its edges. The
+		 * smaller ones use a subset. The directions are not normalized,
+		 * slabs are kept in whatever units dotting with them gives.
+		 */
+		constexpr float s_kDopDirections[13][3] = {
+			{1, 0, 0}, {0, 1, 0}, {0, 0, 1},
+			{1, 1, 1}, {1, 1, -1}, {1, -1, 1}, {-1, 1, 1},
+			{1, 1, 0}, {1, -1, 0}, {1, 0, 1}, {1, 0, -1}, {0, 1, 1}, {0, 1, -1}
+		};
+
+		template <unsigned int K>
+		struct KDopDirections;
+
+		template <>
+		struct KDopDirections<8>
+		{
+			static constexpr int indices[4] = {3, 4, 5, 6};
+		};
+
+		template <>
+		struct KDopDirections<14>
+		{
+			static constexpr int indices[7] = {0, 1, 2, 3, 4, 5, 6};
+		};
+
+		template <>
+		struct KDopDirections<18>
+		{
+			static constexpr int indices[9] = {0, 1, 2, 7, 8, 9, 10, 11, 12};
+		};
+
+		template <>
+		struct KDopDirections<26>
+		{
+			static constexpr int indices[13] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+		};
+
+		/**
+		 * @brief Discrete Oriented Polytope: the intersection of K / 2 slabs
+		 * along fixed directions
+		 */
+		template <unsigned int K>
+		struct KDop
+		{
+			std::array<float, K / 2> min;
+			std::array<float, K / 2> max;
+		};
+
+		/**
+		 * @brief A k-DOP shaped BV
+		 *
+		 * Tighter than an AABB around rotated and rounded shapes, and almost
+		 * as cheap to test and merge: both work slab by slab. Supported for
+		 * K = 8, 14, 18 and 26.
+		 *
+		 * Areas and volumes are those of getBounds(), which is all the SAH
+		 * needs to compare candidate splits.
+		 */
+		template <unsigned int K>
+		class KDopBV : public BaseBV<KDopBV<K>, KDop<K>>
+		{
+			private:
+				friend BaseBV<KDopBV<K>, KDop<K>>;
+
+				static constexpr unsigned int s_slabCount = K / 2;
+
+			public:
+				KDopBV() = default;
+
+				inline void setVolume(const KDop<K>& volume)
+				{
+					this->m_volume = volume;
+				}
+
+				/**
+				 * @brief Get the direction of one of the slabs
+				 */
+				[[nodiscard]] static inline glm::vec3 getDirection(unsigned int slab)
+				{
+					const float* direction = s_kDopDirections[KDopDirections<K>::indices[slab]];
+
+					return {direction[0], direction[1], direction[2]};
+				}
+
+				[[nodiscard]] inline float getMin(unsigned int slab) const
+				{
+					return this->m_volume.min[slab];
+				}
+
+				[[nodiscard]] inline float getMax(unsigned int slab) const
+				{
+					return this->m_volume.max[slab];
+				}
+
+				inline float getVolume() const
+				{
+					return getBounds().getVolume();
+				}
+
+				inline float getSurfaceArea() const
+				{
+					return getBounds().getSurfaceArea();
+				}
+
+				[[nodiscard]] inline glm::vec3 getCenter() const
+				{
+					return getBounds().getCenter();
+				}
+
+				[[nodiscard]] inline BoxBV<AABB> getBounds() const
+				{
+					const auto& min = this->m_volume.min;
+					const auto& max = this->m_volume.max;
+
+					if constexpr (K == 8)
+					{
+						//The 8-DOP has no axis slabs. Summing two diagonals
+						//that only differ in the sign of the other two axes
+						//isolates an axis, e.g. x = ((x+y-z) + (x-y+z)) / 2.
+						return {0.5f * glm::vec3(min[1] + min[2], min[1] + min[3], min[2] + min[3]),
+							0.5f * glm::vec3(max[1] + max[2], max[1] + max[3], max[2] + max[3])};
+					} else
+					{
+						return {glm::vec3(min[0], min[1], min[2]), glm::vec3(max[0], max[1], max[2])};
+					}
+				}
+
+				inline bool overlapsWith(const KDopBV& bv) const
+				{
+					PHYSICC_ZONE_FINE;
+
+					for (unsigned int i = 0; i < s_slabCount; i++)
+					{
+						if (this->m_volume.min[i] > bv.m_volume.max[i] || this->m_volume.max[i] < bv.m_volume.min[i])
+						{
+							return false;
+						}
+					}
+
+					return true;
+				}
+
+				[[nodiscard]] inline bool contains(const KDopBV& bv) const
+				{
+					for (unsigned int i = 0; i < s_slabCount; i++)
+					{
+						if (this->m_volume.min[i] > bv.m_volume.min[i] || this->m_volume.max[i] < bv.m_volume.max[i])
+						{
+							return false;
+						}
+					}
+
+					return true;
+				}
+
+				inline KDopBV enclosingBV(const KDopBV& bv) const
+				{
+					PHYSICC_ZONE_FINE;
+
+					KDopBV result;
+
+					for (unsigned int i = 0; i < s_slabCount; i++)
+					{
+						result.m_volume.min[i] = glm::min(this->m_volume.min[i], bv.m_volume.min[i]);
+						result.m_volume.max[i] = glm::max(this->m_volume.max[i], bv.m_volume.max[i]);
+					}
+
+					return result;
+				}
+
+				/**
+				 * @brief Fit the tightest k-DOP around a convex shape, using
+				 * its support function
+				 */
+				template <typename Shape>
+				[[nodiscard]] static inline KDopBV fromShape(const Shape& shape)
+				{
+					KDopBV result;
+
+					for (unsigned int i = 0; i < s_slabCount; i++)
+					{
+						glm::vec3 direction = getDirection(i);
+
+						result.m_volume.min[i] = glm::dot(shape.getSupport(-direction), direction);
+						result.m_volume.max[i] = glm::dot(shape.getSupport(direction), direction);
+					}
+
+					return result;
+				}
+		};
 	}
 
 	namespace BoundingVolume
 	{
 		typedef BVImpl::BoxBV<BVImpl::AABB> AABB;
+		typedef BVImpl::SphereBV Sphere;
+		typedef BVImpl::OBBBV OBB;
+
+		template <unsigned int K>
+		using KDop = BVImpl::KDopBV<K>;
 
 		template <typename Derived, typename BoundingObject>
 		auto inline enclosingBV(const BVImpl::BaseBV<Derived, BoundingObject>& volume1,
 								const BVImpl::BaseBV<Derived, BoundingObject>& volume2)
 		{
-			ZoneScoped;
+			PHYSICC_ZONE_FINE;
 
 			return volume1.enclosingBV(volume2);
 		}
@@ -0,0 +1,148 @@
+#ifndef __BROADPHASE_H__
+#define __BROADPHASE_H__
+
+#include "bodypair.hpp"
+#include "boundingvolume.hpp"
+#include "bvh.hpp"
+#include "dynamicbvh.hpp"
+#include "jobsystem.hpp"
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace Physicc
+{
+	/**
+	 * @brief Finds the pairs of bodies whose AABBs overlap
+	 *
+	 * The world owns the bodies' AABBs and hands the whole list to every
+	 * call. Bodies are numbered in the order they were added, starting at 0.
+	 * Implementations differ in how they cope with motion, so that each world
+	 * can pick whichever suits its scene best:
+	 *
+	 * - DynamicBVHBroadphase: a good default for any scene
+	 * - BVHBroadphase: many bodies that all move a lot
+	 * - SweepAndPrune: mostly static or slowly moving scenes
+	 * - SpatialHashGrid: lots of bodies of about the same size
+	 */
+	class Broadphase
+	{
+		public:
+			virtual ~Broadphase() = default;
+
+			/**
+			 * @brief Add a body, which gets the next index
+			 *
+			 * @param volume The body's AABB
+			 * @param isStatic Whether the body is static. Pairs of two
+			 * static bodies are never reported.
+			 */
+			virtual void addBody(const BoundingVolume::AABB& volume, bool isStatic) = 0;
+
+			/**
+			 * @brief Catch up with the bodies after they moved
+			 *
+			 * @param volumes Every body's AABB
+			 * @param velocities Every body's velocity, which some
+			 * implementations use to predict where bodies go next
+			 * @param timestep Time the bodies moved for
+			 */
+			virtual void update(const std::vector<BoundingVolume::AABB>& volumes,
+			                    const std::vector<glm::vec3>& velocities,
+			                    float timestep,
+			                    JobSystem& jobSystem) = 0;
+
+			/**
+			 * @brief Find all pairs of overlapping AABBs
+			 *
+			 * @param volumes Every body's AABB, as passed to the last update()
+			 * @param pairs Output list, cleared first. Every pair has
+			 * first < second. The order of the pairs is up to the
+			 * implementation, but the same for the same input, no matter how
+			 * many threads the job system has.
+			 */
+			virtual void findPairs(const std::vector<BoundingVolume::AABB>& volumes,
+			                       std::vector<BodyPair>& pairs,
+			                       JobSystem& jobSystem) = 0;
+	};
+
+	/**
+	 * @brief Broadphase backed by a DynamicBVH
+	 *
+	 * Bodies that stay inside their fat AABB cost next to nothing to update,
+	 * and the tree adapts to bodies moving around without ever being rebuilt.
+	 */
+	class DynamicBVHBroadphase : public Broadphase
+	{
+		public:
+			/**
+			 * @param margin See DynamicBVH::DynamicBVH()
+			 */
+			DynamicBVHBroadphase(float margin = 0.1f);
+
+			void addBody(const BoundingVolume::AABB& volume, bool isStatic) override;
+			void update(const std::vector<BoundingVolume::AABB>& volumes,
+			            const std::vector<glm::vec3>& velocities,
+			            float timestep,
+			            JobSystem& jobSystem) override;
+			void findPairs(const std::vector<BoundingVolume::AABB>& volumes,
+			               std::vector<BodyPair>& pairs,
+			               JobSystem& jobSystem) override;
+
+		private:
+			static constexpr std::size_t s_grainSize = 256;
+			//bodies per chunk of the pair query
+
+			DynamicBVH m_tree;
+			std::vector<std::uint32_t> m_proxies;
+			std::vector<bool> m_isStatic;
+			std::vector<std::vector<BodyPair>> m_chunkPairs;
+	};
+
+	/**
+	 * @brief Broadphase backed by a BVH that is refit every step and rebuilt
+	 * every now and then
+	 *
+	 * Refitting is a single pass over the tree no matter how far bodies
+	 * moved, which suits scenes where most bodies move every step.
+	 */
+	class BVHBroadphase : public Broadphase
+	{
+		public:
+			/**
+			 * @param splitMethod How the tree is built
+			 * @param rebuildInterval Number of steps the tree is refit for
+			 * before it is rebuilt from scratch
+			 */
+			BVHBroadphase(BVH::SplitMethod splitMethod = BVH::SplitMethod::Morton,
+			              unsigned int rebuildInterval = 30);
+
+			void addBody(const BoundingVolume::AABB& volume, bool isStatic) override;
+			void update(const std::vector<BoundingVolume::AABB>& volumes,
+			            const std::vector<glm::vec3>& velocities,
+			            float timestep,
+			            JobSystem& jobSystem) override;
+			void findPairs(const std::vector<BoundingVolume::AABB>& volumes,
+			               std::vector<BodyPair>& pairs,
+			               JobSystem& jobSystem) override;
+
+		private:
+			static constexpr std::size_t s_grainSize = 4096;
+			//volumes per chunk of the update
+
+			BVH::SplitMethod m_splitMethod;
+			unsigned int m_rebuildInterval;
+			unsigned int m_stepsSinceBuild;
+
+			std::optional<BVH> m_tree;
+			//empty until the first update, and whenever bodies were added
+			//since the last one
+
+			std::vector<bool> m_isStatic;
+	};
+}
+
+#endif //__BROADPHASE_H__
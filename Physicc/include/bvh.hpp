@@ -2,38 +2,489 @@
 #define __BVH_H__
 
 #include "boundingvolume.hpp"
+#include "bodypair.hpp"
+#include "jobsystem.hpp"
 #include "rigidbody.hpp"
+#include "ray.hpp"
+#include "traversalstack.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
 
 namespace Physicc
 {
-	struct BVHNode
+	/**
+	 * @brief A node of the linearized BVH
+	 *
+	 * Nodes are stored contiguously in depth-first order, so the first child of
+	 * an interior node is always the node right after it, and only the index of
+	 * the second child needs to be stored. Leaves store a range into the BVH's
+	 * body index list instead.
+	 *
+	 * @tparam Volume The kind of bounding volume, see BasicBVH
+	 */
+	template <typename Volume>
+	struct alignas(32) BasicBVHNode
 	{
-		BoundingVolume::AABB volume;
-		RigidBody* body = nullptr;
+		Volume volume;
+
+		std::uint32_t offset = 0;
+		//leaf: index of the first body in the body index list
+		//interior node: index of the second child in the node list
+
+		std::uint16_t count = 0;
+		//number of bodies in a leaf, 0 for interior nodes
+
+		std::uint8_t axis = 0;
+		//axis along which the children of an interior node were split
 
-		BVHNode* parent = nullptr;
-		BVHNode* left = nullptr;
-		BVHNode* right = nullptr;
+		std::uint8_t padding = 0;
+
+		[[nodiscard]] inline bool isLeaf() const
+		{
+			return count != 0;
+		}
 	};
 
-	class BVH
+	typedef BasicBVHNode<BoundingVolume::AABB> BVHNode;
+
+	static_assert(sizeof(BVHNode) == 32, "BVHNode should be exactly half a cache line");
+
+	/**
+	 * @brief How the BVH builder decides where to split a node
+	 */
+	enum class BVHSplitMethod
+	{
+		Median,
+		//split at the median centroid along the widest axis.
+		//Cheap to build, but produces poor trees for clustered
+		//scenes.
+
+		SAH,
+		//binned Surface Area Heuristic: pick the split that
+		//minimizes the expected cost of querying the tree
+
+		Morton
+		//Linear BVH: sort the bodies along a Morton (Z-order) curve
+		//through their centroids and split where the codes differ
+		//in their highest bit. Much faster to build than the other
+		//two, at the cost of tree quality, which makes it the
+		//method of choice for very large body counts.
+	};
+
+	/**
+	 * @brief Bounding Volume Hierarchy over a list of RigidBody objects
+	 *
+	 * The tree is built directly into a flat array of nodes (see BasicBVHNode
+	 * for the layout), which is what all the traversals walk.
+	 *
+	 * @tparam Volume The kind of bounding volume the nodes and bodies get:
+	 * BoundingVolume::AABB (the BVH typedef), Sphere, OBB or KDop<K>. Tighter
+	 * volumes cost more to test but let fewer pairs of bodies through the
+	 * pair query, e.g. for rotated boxes. Rays and regions are tested against
+	 * the AABBs around the volumes (their getBounds()), so for those queries
+	 * anything but an AABB tree only adds work.
+	 */
+	template <typename Volume>
+	class BasicBVH
 	{
 		public:
-			BVH(std::vector<RigidBody> rigidBodyList);
+			typedef BVHSplitMethod SplitMethod;
+			typedef BasicBVHNode<Volume> Node;
+
+			/**
+			 * @brief Construct a new BVH
+			 *
+			 * @param rigidBodyList Bodies the tree is built over
+			 * @param splitMethod How nodes are split while building
+			 * @param maxLeafSize Maximum number of bodies in a leaf. With
+			 * SplitMethod::SAH, a node holding at most this many bodies is
+			 * only split if that is cheaper than keeping it as a leaf.
+			 */
+			BasicBVH(std::vector<RigidBody> rigidBodyList,
+			         SplitMethod splitMethod = SplitMethod::Median,
+			         std::size_t maxLeafSize = 1);
+
+			/**
+			 * @brief Construct a new BVH over a list of bounding volumes
+			 *
+			 * Same as above, for callers that keep their bodies' bounding
+			 * volumes themselves. Use updateVolume() rather than updateBody() to move
+			 * things around in such a tree.
+			 */
+			BasicBVH(const std::vector<Volume>& volumes,
+			         SplitMethod splitMethod = SplitMethod::Median,
+			         std::size_t maxLeafSize = 1);
+
+			void buildTree();
+			//build a tree of the bounding volumes, on threads started for
+			//the purpose if there are enough of them to be worth it
+
+			/**
+			 * @brief Build a tree of the bounding volumes, running the
+			 * parallel parts of the build on a job system
+			 *
+			 * For callers that already keep every core busy with a job
+			 * system, like the broadphases, where threads of the build's own
+			 * would only compete with its workers.
+			 */
+			void buildTree(JobSystem& jobSystem);
+
+			/**
+			 * @brief Replace one of the bodies the tree was built over
+			 *
+			 * The tree itself is left untouched until the next call to
+			 * refit() (or buildTree()).
+			 *
+			 * @param index Index of the body in the list the BVH was
+			 * constructed with
+			 * @param body The body's new state
+			 */
+			void updateBody(std::size_t index, const RigidBody& body);
+
+			/**
+			 * @brief Replace one of the volumes the tree was built over
+			 *
+			 * Like updateBody(), for trees built over bounding volumes.
+			 */
+			void updateVolume(std::size_t index, const Volume& volume);
+
+			/**
+			 * @brief Recompute every node's volume bottom-up, keeping the
+			 * structure of the tree as is
+			 *
+			 * Much cheaper than rebuilding, and good enough as long as bodies
+			 * only move a little relative to each other. Queries get slower
+			 * as the tree drifts away from what a fresh build would produce,
+			 * at which point rebuilding pays off again.
+			 */
+			void refit();
+
+			/**
+			 * @brief Get the linearized tree
+			 *
+			 * @return Nodes in depth-first order, the root being the first one.
+			 * Empty if the tree has not been built (or there are no bodies).
+			 */
+			[[nodiscard]] inline const std::vector<Node>& getNodes() const
+			{
+				return m_nodes;
+			}
+
+			/**
+			 * @brief Get the list that the leaves' body ranges index into
+			 *
+			 * @return Indices into the RigidBody list the BVH was constructed
+			 * with, ordered so that each leaf owns a contiguous range.
+			 */
+			[[nodiscard]] inline const std::vector<std::uint32_t>& getBodyIndices() const
+			{
+				return m_bodyIndices;
+			}
+
+			/**
+			 * @brief Get the bounding volume of a body, as of the last build or
+			 * updateBody()
+			 *
+			 * @param bodyIndex Index into the list the BVH was constructed
+			 * with
+			 */
+			[[nodiscard]] inline const Volume& getBodyVolume(std::size_t bodyIndex) const
+			{
+				return m_primitives[bodyIndex].volume;
+			}
+
+			/**
+			 * @brief Find all pairs of bodies whose bounding volumes overlap
+			 *
+			 * Descends both subtrees of every node simultaneously, so every
+			 * pair is visited exactly once and no duplicates are produced.
+			 *
+			 * @param pairs Output list. It is cleared first, but keeps its
+			 * capacity, so reusing the same list across steps avoids
+			 * allocating once it has grown large enough.
+			 */
+			void queryPairs(std::vector<BodyPair>& pairs) const;
+
+			/**
+			 * @brief Parallel version of queryPairs()
+			 *
+			 * The top of the tree is split into independent pieces of work,
+			 * which the job system's threads pick up one at a time. The
+			 * pieces are those that queryPairs() works through one after the
+			 * other, and their results are merged in that order, so the
+			 * output is exactly that of queryPairs(), pairs and order alike,
+			 * on any number of threads.
+			 *
+			 * @param pairs Output list, see queryPairs()
+			 */
+			void queryPairsParallel(std::vector<BodyPair>& pairs, JobSystem& jobSystem);
+
+			/**
+			 * @brief Find the first body (AABB) hit by a ray
+			 *
+			 * @param ray The ray to cast
+			 * @param tMax Hits beyond ray.at(tMax) are ignored
+			 * @return The nearest hit, if any
+			 */
+			[[nodiscard]] std::optional<RaycastHit> raycast(const Ray& ray,
+				float tMax = std::numeric_limits<float>::infinity()) const;
+
+			/**
+			 * @brief Check whether a ray hits any body (AABB) at all
+			 *
+			 * Cheaper than raycast(), since the traversal stops at the first
+			 * hit it finds. Meant for line of sight checks and the like.
+			 */
+			[[nodiscard]] bool raycastAny(const Ray& ray,
+				float tMax = std::numeric_limits<float>::infinity()) const;
+
+			/**
+			 * @brief Sweep a box along a segment and find the first body
+			 * (AABB) it hits
+			 *
+			 * @param box The box at the start of the sweep. Pass a box
+			 * without volume to sweep a point, i.e. cast a segment.
+			 * @param displacement Where the box moves to
+			 * @return The first hit, with t in [0, 1] being the fraction of
+			 * the displacement covered when the box touches the body
+			 */
+			[[nodiscard]] std::optional<RaycastHit> sweep(const BoundingVolume::AABB& box,
+			                                              const glm::vec3& displacement) const;
+
+			/**
+			 * @brief Find all bodies whose AABB overlaps a region
+			 *
+			 * @param region The region to test against
+			 * @param bodies Output list of body indices. Cleared first, see
+			 * queryPairs() regarding reuse.
+			 */
+			void queryRegion(const BoundingVolume::AABB& region,
+			                 std::vector<std::uint32_t>& bodies) const;
+
+			/**
+			 * @brief Cast a ray (or sweep a box) and report every body hit
+			 *
+			 * All of the queries above are built on this. It does not
+			 * allocate unless the tree is unusually deep, and visits the
+			 * nearer child of every node first, so clipping tMax as hits come
+			 * in culls as much of the tree as possible.
+			 *
+			 * @param ray The ray to cast
+			 * @param tMax Hits beyond ray.at(tMax) are ignored
+			 * @param extent Half extents of the box being swept. Zero for a
+			 * plain ray.
+			 * @param callback Called as callback(bodyIndex, t) for every body
+			 * whose AABB is hit at a t no greater than the current tMax. It
+			 * returns the new tMax: return t to only look for closer hits
+			 * from then on, infinity to ignore the hit and go on, or a
+			 * negative number to end the query.
+			 */
+			template <typename Callback>
+			void raycast(const Ray& ray, float tMax, const glm::vec3& extent, Callback&& callback) const
+			{
+				PHYSICC_ZONE_FINE;
+
+				if (m_nodes.empty())
+				{
+					return;
+				}
 
-			inline void buildTree();
-			//build a tree of the bounding volumes
+				TraversalStack<std::uint32_t> stack;
+				stack.push(0);
 
-			//convert the tree into a linear data structure
-			std::vector<RigidBody>& convert();
+				while (!stack.empty())
+				{
+					std::uint32_t index = stack.pop();
+					const Node& node = m_nodes[index];
+					float t;
+
+					if (!ray.intersects(node.volume.getBounds(), tMax, t, extent))
+					{
+						continue;
+					}
+
+					if (node.isLeaf())
+					{
+						for (std::uint32_t i = node.offset; i != node.offset + node.count; i++)
+						{
+							std::uint32_t body = m_bodyIndices[i];
+
+							if (ray.intersects(m_primitives[body].volume.getBounds(), tMax, t, extent))
+							{
+								tMax = std::min(tMax, callback(body, t));
+
+								if (tMax < 0.0f)
+								{
+									return;
+								}
+							}
+						}
+					} else if (ray.direction[node.axis] < 0.0f)
+					{
+						//the second child lies on the near side of the split
+						stack.push(index + 1);
+						stack.push(node.offset);
+					} else
+					{
+						stack.push(node.offset);
+						stack.push(index + 1);
+					}
+				}
+			}
+
+			/**
+			 * @brief Report every body whose AABB overlaps a region
+			 *
+			 * @param region The region to test against
+			 * @param callback Called as callback(bodyIndex) for every body
+			 * found. Returning false from it ends the query.
+			 */
+			template <typename Callback>
+			void queryRegion(const BoundingVolume::AABB& region, Callback&& callback) const
+			{
+				PHYSICC_ZONE_FINE;
+
+				if (m_nodes.empty())
+				{
+					return;
+				}
+
+				TraversalStack<std::uint32_t> stack;
+				stack.push(0);
+
+				while (!stack.empty())
+				{
+					std::uint32_t index = stack.pop();
+					const Node& node = m_nodes[index];
+
+					if (!node.volume.getBounds().overlapsWith(region))
+					{
+						continue;
+					}
+
+					if (node.isLeaf())
+					{
+						for (std::uint32_t i = node.offset; i != node.offset + node.count; i++)
+						{
+							std::uint32_t body = m_bodyIndices[i];
+
+							if (m_primitives[body].volume.getBounds().overlapsWith(region) && !callback(body))
+							{
+								return;
+							}
+						}
+					} else
+					{
+						stack.push(node.offset);
+						stack.push(index + 1);
+					}
+				}
+			}
 
 		private:
-			BVHNode* m_head;
+			/**
+			 * @brief Per-body data needed while building the tree
+			 *
+			 * Cached once per build, since computing a body's volume is not
+			 * cheap and the builder needs it (and the centroid) repeatedly.
+			 */
+			struct Primitive
+			{
+				Volume volume;
+				glm::vec3 centroid;
+			};
+
+			static constexpr std::size_t s_binCount = 16;
+			//number of buckets per axis the SAH builder sorts centroids into
+
+			static constexpr float s_traversalCost = 1.0f;
+			static constexpr float s_intersectionCost = 1.0f;
+			//relative costs of visiting a node and of testing a body
+			//against a query, used by the SAH. Both boil down to an AABB
+			//overlap test for the broadphase, hence the same value.
+
 			std::vector<RigidBody> m_rigidBodyList;
+			SplitMethod m_splitMethod;
+			std::size_t m_maxLeafSize;
+			std::vector<Primitive> m_primitives;
+			std::vector<std::uint32_t> m_bodyIndices;
+			std::vector<Node> m_nodes;
 
-			BoundingVolume::AABB computeBV(std::size_t start, std::size_t end);
+			struct NodePair
+			{
+				std::uint32_t first;
+				std::uint32_t second;
+			};
+			//a piece of work for the pair query: find all overlapping
+			//bodies between two subtrees, or within one if both are the same
+
+			static constexpr unsigned int s_pairSplitDepth = 5;
+			//queryPairsParallel() splits the tree this many levels down,
+			//into up to 63 pieces of work, enough to keep a few per thread
+			//busy on most machines
+
+			std::vector<NodePair> m_pairTasks;
+			std::vector<std::vector<BodyPair>> m_pairTaskResults;
+			//kept around between calls to queryPairsParallel(), so that
+			//their memory can be reused
+
+			void addPairTasks(std::uint32_t node, unsigned int depth);
+			//splits the pairs within the subtree at node into pieces of
+			//work, appended to m_pairTasks
+
+			void queryPairs(NodePair nodes, std::vector<BodyPair>& pairs) const;
+			void addLeafPairs(const Node& leaf1,
+			                  const Node& leaf2,
+			                  std::vector<BodyPair>& pairs) const;
+
+			Volume computeBV(std::size_t start, std::size_t end);
+
+			static constexpr std::size_t s_parallelThreshold = 4096;
+			//subtrees over at least this many bodies are built as separate
+			//tasks. Below that, spawning a task costs more than it saves.
+
+			static constexpr std::size_t s_wideMortonThreshold = 1 << 16;
+			//Above this many bodies, the Morton builder uses 63-bit codes
+			//(21 bits per axis) instead of 30-bit ones (10 bits per axis),
+			//as bodies increasingly end up sharing a code otherwise
 
-			void buildTree(BVHNode* node, std::size_t start, std::size_t end);
+			JobSystem* m_buildJobSystem = nullptr;
+			//the job system the build in progress runs on, null if it
+			//starts threads of its own
+
+			void build(unsigned int threadCount);
+			void computePrimitives();
+
+			template <typename BuildFunction>
+			std::uint32_t buildChildren(std::vector<Node>& nodes,
+			                            std::size_t start,
+			                            std::size_t mid,
+			                            std::size_t end,
+			                            unsigned int taskDepth,
+			                            BuildFunction&& build);
+			//builds the subtrees over [start, mid) and [mid, end) with
+			//`build`, possibly in parallel, and returns the index of the
+			//second one
+
+			template <typename Code>
+			void buildMortonTree(unsigned int taskDepth);
+
+			template <typename Code>
+			std::uint32_t buildMortonTree(std::vector<Node>& nodes,
+			                              const std::vector<Code>& codes,
+			                              std::size_t start,
+			                              std::size_t end,
+			                              unsigned int taskDepth);
+
+			std::uint32_t buildTree(std::vector<Node>& nodes,
+			                        std::size_t start,
+			                        std::size_t end,
+			                        unsigned int taskDepth);
+			//taskDepth is how many more levels down subtrees may still be
+			//handed off to other threads
 
 			enum Axis {
 				X,
@@ -41,9 +492,19 @@ namespace Physicc
 				Z,
 			};
 
-			void sort(Axis axis, std::size_t start, std::size_t end);
 			Axis getMedianCuttingAxis(std::size_t start, std::size_t end);
+
+			//The partition functions reorder [start, end) and return the
+			//index the second child starts at, or `end` if the node should
+			//be a leaf instead
+			std::size_t partitionMedian(std::size_t start, std::size_t end, Axis& axis);
+			std::size_t partitionSAH(std::size_t start,
+			                         std::size_t end,
+			                         const Volume& volume,
+			                         Axis& axis);
 	};
+
+	typedef BasicBVH<BoundingVolume::AABB> BVH;
 }
 
 #endif //__BVH_H__
@@ -1,11 +1,18 @@
 #ifndef __COLLIDER_H__
 #define __COLLIDER_H__
 
-#include "tools/Tracy.hpp"
+#include "profiling.hpp"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
 #include "boundingvolume.hpp"
+#include "traversalstack.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <variant>
 #include <vector>
 
 namespace Physicc
@@ -13,11 +20,29 @@ namespace Physicc
 	/**
 	 * @brief Collider class
 	 *  
-	 * This is a virtual class which acts as the base for all the shape specific classes
+	 * This is the base for all the shape specific classes. It has no virtual
+	 * functions: the few calls that depend on the shape look at getType() and
+	 * forward to the shape's class, so a collider can be stored by value in
+	 * an array of its shape.
+	 *
+	 * The transform, the rotation matrix and the AABB are cached, and only
+	 * brought up to date by updateTransform(). The setters just mark what has
+	 * changed, so moving a collider does not touch the rotation at all, and
+	 * updateTransform() does nothing for colliders that have not changed.
 	 */
 	class Collider
 	{
 		public:
+			enum Type
+			{
+				e_box = 0,
+				e_sphere = 1,
+				e_convexHull = 2,
+				e_compound = 3,
+				e_triangleMesh = 4,
+				e_typecount = 5
+			};
+
 			Collider(glm::vec3 position = glm::vec3(0),
 			         glm::vec3 rotation = glm::vec3(0),
 			         glm::vec3 scale = glm::vec3(1));
@@ -29,7 +54,7 @@ namespace Physicc
 	 		 */
 			[[nodiscard]] inline glm::vec3 getPosition()
 			{
-				ZoneScoped;
+				PHYSICC_ZONE_FINE;
 
 				return m_position;
 			}
@@ -41,7 +66,7 @@ namespace Physicc
 			 */
 			[[nodiscard]] inline glm::vec3 getRotate()
 			{
-				ZoneScoped;
+				PHYSICC_ZONE_FINE;
 
 				return m_rotate;
 			}
@@ -53,7 +78,7 @@ namespace Physicc
 			 */
 			[[nodiscard]] inline glm::vec3 getScale()
 			{
-				ZoneScoped;
+				PHYSICC_ZONE_FINE;
 
 				return m_scale;
 			}
@@ -65,7 +90,7 @@ namespace Physicc
 			 */
 			[[nodiscard]] inline glm::mat4 getTransform()
 			{
-				ZoneScoped;
+				PHYSICC_ZONE_FINE;
 
 				return m_transform;
 			}
@@ -77,9 +102,13 @@ namespace Physicc
 			 */
 			inline void setPosition(glm::vec3 position)
 			{
-				ZoneScoped;
+				PHYSICC_ZONE_FINE;
 
-				m_position = position;
+				if (position != m_position)
+				{
+					m_position = position;
+					m_dirty |= e_positionDirty;
+				}
 			}
 
 			/**
@@ -89,9 +118,13 @@ namespace Physicc
 			 */
 			inline void setRotate(glm::vec3 rotate)
 			{
-				ZoneScoped;
+				PHYSICC_ZONE_FINE;
 
-				m_rotate = rotate;
+				if (rotate != m_rotate)
+				{
+					m_rotate = rotate;
+					m_dirty |= e_rotationDirty;
+				}
 			}
 
 			/**
@@ -101,31 +134,161 @@ namespace Physicc
 			 */
 			inline void setScale(glm::vec3 scale)
 			{
-				ZoneScoped;
+				PHYSICC_ZONE_FINE;
+
+				if (scale != m_scale)
+				{
+					m_scale = scale;
+					m_dirty |= e_rotationDirty;
+					//the extents depend on the scale as much as on the
+					//rotation
+				}
+			}
+
+			/**
+			 * @brief get the rotation part of the Transform matrix
+			 *
+			 * @return glm::mat3 whose columns are the object's local axes
+			 */
+			[[nodiscard]] inline const glm::mat3& getRotationMatrix() const
+			{
+				return m_rotation;
+			}
+
+			/**
+			 * @brief get the rotation of the object as a quaternion
+			 */
+			[[nodiscard]] inline const glm::quat& getOrientation() const
+			{
+				return m_orientation;
+			}
+
+			[[nodiscard]] inline Type getType() const
+			{
+				return m_objectType;
+			}
+
+			/**
+			 * @brief Bring the transform, rotation matrix and AABB up to date
+			 * with the position, rotation and scale
+			 *
+			 * Only what depends on something that changed since the last call
+			 * is recomputed: a change of position costs two vector additions,
+			 * and the trigonometry is only redone when the rotation changes.
+			 */
+			inline void updateTransform()
+			{
+				PHYSICC_ZONE_FINE;
+
+				if (m_dirty == 0)
+				{
+					return;
+				}
+
+				if (m_dirty & e_rotationDirty)
+				{
+					updateRotation();
+				}
+
+				m_transform[3] = glm::vec4(m_position, 1.0f);
+
+				glm::vec3 center = m_position + m_aabbOffset;
+				m_aabb = {center - m_extents, center + m_extents};
 
-				m_scale = scale;
+				m_dirty = 0;
 			}
 
-			void updateTransform();
+			/**
+			 * @brief get the object's Axis Aligned Bounding Box, as of the
+			 * last updateTransform()
+			 */
+			[[nodiscard]] inline const BoundingVolume::AABB& getAABB() const
+			{
+				PHYSICC_ZONE_FINE;
 
-			virtual BoundingVolume::AABB getAABB() const = 0;
-			//Each child will calculate its AABB according to its own shape
+				return m_aabb;
+			}
 
-			virtual glm::vec3 getCentroid() const = 0;
+			[[nodiscard]] inline glm::vec3 getCentroid() const
+			{
+				return m_position;
+			}
+
+			/**
+			 * @brief Find the point of the shape furthest along a direction
+			 *
+			 * This is all the GJK and EPA algorithms need to know about a
+			 * (convex) shape.
+			 *
+			 * @param direction Direction in world space, need not be
+			 * normalized
+			 * @return The furthest point, in world space
+			 */
+			[[nodiscard]] glm::vec3 getSupport(const glm::vec3& direction) const;
+
+			/**
+			 * @brief get the radius of the smallest sphere around the
+			 * centroid that holds the whole shape
+			 */
+			[[nodiscard]] float getBoundingRadius() const;
+
+			/**
+			 * @brief get half the size of the smallest box holding the
+			 * shape, along the axes of getRotationMatrix()
+			 */
+			[[nodiscard]] glm::vec3 getOrientedHalfExtents() const;
 
 		protected:
-			enum Type
+			enum DirtyFlags : std::uint8_t
 			{
-				e_box = 0,
-				e_sphere = 1,
-				e_typecount = 2
+				e_positionDirty = 1,
+				e_rotationDirty = 2
 			};
 
+			/**
+			 * @brief Compute half the size of the shape's AABB around its
+			 * centroid, from the current rotation matrix and scale
+			 *
+			 * Only called when the rotation or the scale have changed.
+			 */
+			[[nodiscard]] glm::vec3 computeExtents() const;
+
+			/**
+			 * @brief Compute where the centre of the shape's AABB is,
+			 * relative to its centroid, from the current rotation matrix
+			 *
+			 * Zero for the shapes that are symmetric about their centroid.
+			 * Compounds and meshes need not be, and an AABB kept centred on
+			 * them would have to grow by the offset on both sides.
+			 */
+			[[nodiscard]] glm::vec3 computeAABBOffset() const;
+
+			void updateRotation();
+			void updateOrientation();
+
+			/**
+			 * @brief Place the collider directly, as a part of a bigger
+			 * shape
+			 *
+			 * Used by CompoundCollider to move its children into world
+			 * space. The rotation is given as a quaternion, so getRotate()
+			 * is left as it was.
+			 */
+			void setPose(const glm::vec3& position, const glm::quat& orientation);
+
 			glm::vec3 m_position;
 			glm::vec3 m_rotate;
 			glm::vec3 m_scale;
+			glm::quat m_orientation;
+			glm::mat3 m_rotation;
 			glm::mat4 m_transform;
+			glm::vec3 m_extents;
+			glm::vec3 m_aabbOffset = glm::vec3(0.0f);
+			BoundingVolume::AABB m_aabb;
+			std::uint8_t m_dirty = e_positionDirty | e_rotationDirty;
 			Type m_objectType;
+
+			friend class CompoundCollider;
 	};
 
 	/** 
@@ -140,11 +303,20 @@ namespace Physicc
 			            glm::vec3 rotation = glm::vec3(0),
 			            glm::vec3 scale = glm::vec3(1));
 
-			[[nodiscard]] BoundingVolume::AABB getAABB() const override;
-			glm::vec3 getCentroid() const override;
+			[[nodiscard]] glm::vec3 getSupport(const glm::vec3& direction) const;
+
+			/**
+			 * @brief get half the box's size along each of its local axes
+			 */
+			[[nodiscard]] inline glm::vec3 getHalfExtents() const
+			{
+				return 0.5f * m_scale;
+			}
 
 		private:
-			std::vector<glm::vec4> m_vertices;
+			[[nodiscard]] glm::vec3 computeExtents() const;
+
+			friend class Collider;
 	};
 
 	/** 
@@ -160,12 +332,266 @@ namespace Physicc
 			               glm::vec3 rotation = glm::vec3(0),
 			               glm::vec3 scale = glm::vec3(1));
 
-			[[nodiscard]] BoundingVolume::AABB getAABB() const override;
+			[[nodiscard]] glm::vec3 getSupport(const glm::vec3& direction) const;
 
-			glm::vec3 getCentroid() const override;
+			[[nodiscard]] inline float getRadius() const
+			{
+				return m_radius;
+			}
 
 		private:
 			float m_radius;
+
+			[[nodiscard]] glm::vec3 computeExtents() const;
+
+			friend class Collider;
+	};
+
+	/**
+	 * @brief ConvexHullCollider class
+	 *
+	 * Convex hull of a cloud of points, given in local space around the
+	 * collider's position and scaled along its local axes. The hull is
+	 * computed on construction and shared by all the copies of the
+	 * collider, so any number of bodies can use the same one. As the AABB is
+	 * centred on the position, the points should be roughly centred on the
+	 * origin.
+	 *
+	 * The support function starts at the vertex furthest along one of the
+	 * axes and moves along the hull's edges to a neighbor further along the
+	 * direction for as long as there is one (hill climbing). On a convex
+	 * polytope the vertex this ends at is the furthest one, and getting
+	 * there only takes a handful of steps even for large hulls.
+	 */
+	class ConvexHullCollider : public Collider
+	{
+		public:
+			/**
+			 * @param points At least one point. Points inside the hull are
+			 * dropped. If the points do not span a volume (all of them lie
+			 * in a plane), they are all kept and the support function tries
+			 * every one.
+			 */
+			ConvexHullCollider(const std::vector<glm::vec3>& points,
+			                   glm::vec3 position = glm::vec3(0),
+			                   glm::vec3 rotation = glm::vec3(0),
+			                   glm::vec3 scale = glm::vec3(1));
+
+			[[nodiscard]] glm::vec3 getSupport(const glm::vec3& direction) const;
+
+			/**
+			 * @brief get the vertices of the hull, in local space and
+			 * before scaling
+			 */
+			[[nodiscard]] inline const std::vector<glm::vec3>& getVertices() const
+			{
+				return m_hull->vertices;
+			}
+
+		private:
+			/**
+			 * @brief The part of a ConvexHullCollider that does not depend on
+			 * where it is
+			 */
+			struct Hull
+			{
+				std::vector<glm::vec3> vertices;
+
+				std::vector<std::uint32_t> neighborOffsets;
+				std::vector<std::uint32_t> neighbors;
+				//the vertices sharing an edge with vertex i are
+				//neighbors[neighborOffsets[i]] up to
+				//neighbors[neighborOffsets[i + 1]]. Empty if the points do
+				//not span a volume.
+
+				std::array<std::uint32_t, 6> extremes;
+				//vertices furthest along +x, -x, +y, -y, +z and -z, where
+				//hill climbing starts from
+			};
+
+			static constexpr std::size_t s_hillClimbingThreshold = 16;
+			//hulls with at most this many vertices are searched linearly,
+			//which is faster than following the edges for so few
+
+			std::shared_ptr<const Hull> m_hull;
+
+			/**
+			 * @brief Find the hull's vertex furthest along a direction
+			 *
+			 * @param direction Direction in the hull's (unscaled) local space
+			 * @return Index of the vertex
+			 */
+			[[nodiscard]] std::uint32_t findSupportVertex(const glm::vec3& direction) const;
+
+			[[nodiscard]] glm::vec3 computeExtents() const;
+			[[nodiscard]] float computeBoundingRadius() const;
+			[[nodiscard]] glm::vec3 computeOrientedHalfExtents() const;
+
+			/**
+			 * @brief Compute the convex hull of a cloud of points, and the
+			 * adjacency of its vertices
+			 *
+			 * Defined in convexhull.cpp.
+			 */
+			static std::shared_ptr<const Hull> buildHull(const std::vector<glm::vec3>& points);
+
+			friend class Collider;
+	};
+
+	/**
+	 * @brief CompoundCollider class
+	 *
+	 * A shape made of several boxes, spheres and convex hulls, each with its
+	 * own position and rotation relative to the compound. Collisions are
+	 * found child by child, so a multi-part object gets contacts where its
+	 * parts actually are, instead of on a box around all of them.
+	 *
+	 * The children are kept in a small BVH of their own, in the compound's
+	 * local space, so that only the children near another collider are
+	 * tested against it. Children and tree are shared by all the copies of
+	 * the collider, like a ConvexHullCollider's hull.
+	 *
+	 * The compound's scale is not applied to its children, which keep the
+	 * size they were given.
+	 */
+	class CompoundCollider : public Collider
+	{
+		public:
+			typedef std::variant<BoxCollider, SphereCollider, ConvexHullCollider> Child;
+
+			/**
+			 * @param children At least one child, placed relative to the
+			 * compound
+			 */
+			CompoundCollider(const std::vector<Child>& children,
+			                 glm::vec3 position = glm::vec3(0),
+			                 glm::vec3 rotation = glm::vec3(0),
+			                 glm::vec3 scale = glm::vec3(1));
+
+			/**
+			 * @brief get the children, placed relative to the compound
+			 */
+			[[nodiscard]] inline const std::vector<Child>& getChildren() const
+			{
+				return m_shape->children;
+			}
+
+			/**
+			 * @brief get a copy of a child, placed in world space as of the
+			 * compound's last updateTransform()
+			 */
+			[[nodiscard]] Child getWorldChild(std::size_t index) const;
+
+			[[nodiscard]] glm::vec3 getSupport(const glm::vec3& direction) const;
+
+			/**
+			 * @brief Report every child whose AABB overlaps a region
+			 *
+			 * The region is moved into the compound's local space, where the
+			 * children's tree is, and grows to fit its rotated self there.
+			 *
+			 * @param region The region to test against, in world space
+			 * @param callback Called as callback(childIndex) for every
+			 * child found. Returning false from it ends the query.
+			 */
+			template <typename Callback>
+			void queryChildren(const BoundingVolume::AABB& region, Callback&& callback) const
+			{
+				PHYSICC_ZONE_FINE;
+
+				glm::mat3 inverseRotation = glm::transpose(m_rotation);
+				glm::mat3 absInverseRotation(glm::abs(inverseRotation[0]),
+				                             glm::abs(inverseRotation[1]),
+				                             glm::abs(inverseRotation[2]));
+
+				glm::vec3 center = inverseRotation * (region.getCenter() - m_position);
+				glm::vec3 extents = absInverseRotation
+					* (0.5f * (region.getUpperBound() - region.getLowerBound()));
+				BoundingVolume::AABB localRegion(center - extents, center + extents);
+
+				const std::vector<Node>& nodes = m_shape->nodes;
+
+				if (nodes.empty())
+				{
+					return;
+				}
+
+				TraversalStack<std::uint32_t> stack;
+				stack.push(0);
+
+				while (!stack.empty())
+				{
+					std::uint32_t index = stack.pop();
+					const Node& node = nodes[index];
+
+					if (!node.bounds.overlapsWith(localRegion))
+					{
+						continue;
+					}
+
+					if (node.leaf)
+					{
+						if (!callback(node.offset))
+						{
+							return;
+						}
+					} else
+					{
+						stack.push(node.offset);
+						stack.push(index + 1);
+					}
+				}
+			}
+
+		private:
+			/**
+			 * @brief A node of the children's tree
+			 *
+			 * Laid out like a BVHNode: depth-first, with the first child of
+			 * an interior node right after it. Every leaf holds one child.
+			 */
+			struct Node
+			{
+				BoundingVolume::AABB bounds;
+				//in the compound's local space
+
+				std::uint32_t offset;
+				//leaf: index of the child
+				//interior node: index of the second child node
+
+				bool leaf;
+			};
+
+			/**
+			 * @brief The part of a CompoundCollider that does not depend on
+			 * where it is
+			 */
+			struct Shape
+			{
+				std::vector<Child> children;
+				std::vector<Node> nodes;
+			};
+
+			std::shared_ptr<const Shape> m_shape;
+
+			[[nodiscard]] glm::vec3 computeExtents() const;
+			[[nodiscard]] glm::vec3 computeAABBOffset() const;
+			[[nodiscard]] float computeBoundingRadius() const;
+			[[nodiscard]] glm::vec3 computeOrientedHalfExtents() const;
+
+			/**
+			 * @brief Build the tree over children[start, end), splitting at
+			 * the median centroid along the widest axis
+			 *
+			 * @param order Indices of the children, reordered in place
+			 */
+			static void buildNode(Shape& shape,
+			                      const std::vector<BoundingVolume::AABB>& bounds,
+			                      std::vector<std::uint32_t>& order,
+			                      std::size_t start,
+			                      std::size_t end);
+
+			friend class Collider;
 	};
 }
 
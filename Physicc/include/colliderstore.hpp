@@ -0,0 +1,150 @@
+#ifndef __COLLIDERSTORE_H__
+#define __COLLIDERSTORE_H__
+
+#include "collider.hpp"
+#include "trianglemesh.hpp"
+#include "jobsystem.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace Physicc
+{
+	/**
+	 * @brief Refers to a collider in a ColliderStore
+	 *
+	 * Packs the collider's shape into the top bits and its index in the
+	 * store's array of that shape into the rest, so a body only needs 4 bytes
+	 * to point at its shape.
+	 */
+	class ColliderHandle
+	{
+		public:
+			ColliderHandle() = default;
+
+			ColliderHandle(Collider::Type type, std::uint32_t index)
+				: m_value((static_cast<std::uint32_t>(type) << s_indexBits) | index)
+			{
+			}
+
+			[[nodiscard]] inline Collider::Type getType() const
+			{
+				return static_cast<Collider::Type>(m_value >> s_indexBits);
+			}
+
+			[[nodiscard]] inline std::uint32_t getIndex() const
+			{
+				return m_value & s_indexMask;
+			}
+
+			[[nodiscard]] inline bool operator==(const ColliderHandle& other) const
+			{
+				return m_value == other.m_value;
+			}
+
+		private:
+			static constexpr std::uint32_t s_indexBits = 28;
+			static constexpr std::uint32_t s_indexMask = (1u << s_indexBits) - 1;
+
+			std::uint32_t m_value = 0;
+	};
+
+	/**
+	 * @brief Keeps colliders in one contiguous array per shape
+	 *
+	 * Every collider belongs to a body, whose index is stored next to it.
+	 * Updating the colliders' AABBs is then one loop per shape over an array
+	 * of that shape, with no dispatch on the shape inside the loop, writing
+	 * each AABB out at its body's index.
+	 */
+	class ColliderStore
+	{
+		public:
+			/**
+			 * @brief Add a collider for a body
+			 *
+			 * @param collider The collider, placed where the body is
+			 * @param body Index of the body the collider belongs to
+			 * @return Handle of the collider, only invalidated by clear()
+			 */
+			ColliderHandle add(const BoxCollider& collider, std::uint32_t body);
+			ColliderHandle add(const SphereCollider& collider, std::uint32_t body);
+			ColliderHandle add(const ConvexHullCollider& collider, std::uint32_t body);
+			ColliderHandle add(const CompoundCollider& collider, std::uint32_t body);
+			ColliderHandle add(const TriangleMeshCollider& collider, std::uint32_t body);
+
+			void clear();
+
+			[[nodiscard]] const Collider& get(ColliderHandle handle) const;
+			[[nodiscard]] Collider& get(ColliderHandle handle);
+
+			[[nodiscard]] inline const std::vector<BoxCollider>& getBoxes() const
+			{
+				return m_boxes;
+			}
+
+			[[nodiscard]] inline const std::vector<SphereCollider>& getSpheres() const
+			{
+				return m_spheres;
+			}
+
+			[[nodiscard]] inline const std::vector<ConvexHullCollider>& getConvexHulls() const
+			{
+				return m_convexHulls;
+			}
+
+			[[nodiscard]] inline const std::vector<CompoundCollider>& getCompounds() const
+			{
+				return m_compounds;
+			}
+
+			[[nodiscard]] inline const std::vector<TriangleMeshCollider>& getTriangleMeshes() const
+			{
+				return m_triangleMeshes;
+			}
+
+			/**
+			 * @brief Move the colliders of awake bodies to their bodies'
+			 * positions and write out their AABBs
+			 *
+			 * @param positions Position of every body
+			 * @param awake Whether every body is awake. Colliders of
+			 * sleeping bodies are left alone.
+			 * @param volumes AABB of every body, overwritten for the awake
+			 * ones
+			 */
+			void updateBounds(const std::vector<glm::vec3>& positions,
+			                  const std::vector<std::uint8_t>& awake,
+			                  std::vector<BoundingVolume::AABB>& volumes,
+			                  JobSystem& jobSystem);
+
+		private:
+			static constexpr std::size_t s_boundsGrainSize = 512;
+
+			std::vector<BoxCollider> m_boxes;
+			std::vector<std::uint32_t> m_boxBodies;
+
+			std::vector<SphereCollider> m_spheres;
+			std::vector<std::uint32_t> m_sphereBodies;
+
+			std::vector<ConvexHullCollider> m_convexHulls;
+			std::vector<std::uint32_t> m_convexHullBodies;
+
+			std::vector<CompoundCollider> m_compounds;
+			std::vector<std::uint32_t> m_compoundBodies;
+
+			std::vector<TriangleMeshCollider> m_triangleMeshes;
+			std::vector<std::uint32_t> m_triangleMeshBodies;
+			//body of every collider of the array above
+
+			template <typename Shape>
+			static void updatePoolBounds(std::vector<Shape>& shapes,
+			                             const std::vector<std::uint32_t>& bodies,
+			                             const std::vector<glm::vec3>& positions,
+			                             const std::vector<std::uint8_t>& awake,
+			                             std::vector<BoundingVolume::AABB>& volumes,
+			                             JobSystem& jobSystem);
+	};
+}
+
+#endif //__COLLIDERSTORE_H__
@@ -0,0 +1,50 @@
+#ifndef __CONTACT_H__
+#define __CONTACT_H__
+
+#include "glm/glm.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace Physicc
+{
+	/**
+	 * @brief A point where two shapes touch
+	 */
+	struct ContactPoint
+	{
+		glm::vec3 position;
+		//in world space, halfway between the two shapes' surfaces
+
+		float penetration;
+		//how far the shapes overlap along the manifold's normal
+	};
+
+	/**
+	 * @brief Everything the narrowphase found out about two touching shapes
+	 *
+	 * A single normal is shared by up to four points, enough to describe a
+	 * face resting on another face.
+	 */
+	struct ContactManifold
+	{
+		static constexpr std::uint32_t s_maxPoints = 4;
+
+		std::uint32_t first;
+		std::uint32_t second;
+		//indices of the two bodies
+
+		glm::vec3 normal;
+		//unit length, pointing from the first shape towards the second
+
+		std::array<ContactPoint, s_maxPoints> points;
+		std::uint32_t pointCount = 0;
+
+		inline void addPoint(const glm::vec3& position, float penetration)
+		{
+			points[pointCount++] = {position, penetration};
+		}
+	};
+}
+
+#endif //__CONTACT_H__
@@ -0,0 +1,268 @@
+#ifndef __CONTACTSOLVER_H__
+#define __CONTACTSOLVER_H__
+
+#include "glm/glm.hpp"
+#include "contact.hpp"
+#include "islandbuilder.hpp"
+#include "jobsystem.hpp"
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Physicc
+{
+	/**
+	 * @brief Resolves contacts by applying impulses to the bodies' velocities
+	 *
+	 * Every contact point is a constraint that keeps the bodies from moving
+	 * into each other, plus two friction constraints along the contact
+	 * plane. The solver goes over the constraints one at a time, applying
+	 * whatever impulse fixes the relative velocity at each (sequential
+	 * impulses), and repeats this for a number of iterations so the fixes
+	 * propagate through stacks of bodies. The impulse accumulated by each
+	 * constraint is clamped rather than each individual impulse, so that
+	 * later iterations can take back too strong a push.
+	 *
+	 * The accumulated impulses are kept between steps, for every contact
+	 * point that persists, and applied right away at the start of the next
+	 * step (warm starting). Bodies resting on each other then start out
+	 * close to the solution, which takes far fewer iterations to reach.
+	 *
+	 * Islands share no dynamic bodies, so they are solved in parallel.
+	 * Small islands are batched into jobs of a useful size. The constraints
+	 * of large islands are colored so that no two constraints of a color
+	 * share a dynamic body, and each color is solved in parallel in turn.
+	 * Neither depends on the number of threads, so neither do the results.
+	 *
+	 * Bodies only carry linear velocity, so the points of a manifold differ
+	 * in how deep they are but not in how an impulse moves the bodies.
+	 */
+	class ContactSolver
+	{
+		public:
+			/**
+			 * @brief Set how many times every step goes over all the
+			 * constraints
+			 */
+			inline void setIterations(unsigned int iterations)
+			{
+				m_iterations = iterations;
+			}
+
+			[[nodiscard]] inline unsigned int getIterations() const
+			{
+				return m_iterations;
+			}
+
+			/**
+			 * @brief Turn carrying impulses over from the last step on or off
+			 */
+			inline void setWarmStarting(bool warmStarting)
+			{
+				m_warmStarting = warmStarting;
+			}
+
+			[[nodiscard]] inline bool isWarmStarting() const
+			{
+				return m_warmStarting;
+			}
+
+			/**
+			 * @brief Set how many constraints an island needs to have to be
+			 * colored and solved across threads, rather than on one thread
+			 * as a whole
+			 *
+			 * The order constraints are solved in differs between the two,
+			 * so the results differ slightly too, but never with the number
+			 * of threads.
+			 */
+			inline void setLargeIslandSize(std::uint32_t constraintCount)
+			{
+				m_largeIslandSize = constraintCount;
+			}
+
+			[[nodiscard]] inline std::uint32_t getLargeIslandSize() const
+			{
+				return m_largeIslandSize;
+			}
+
+			/**
+			 * @brief Set up a constraint per contact point, and look up the
+			 * impulses cached for the points that persisted since the last
+			 * step
+			 *
+			 * @param positions Position of every body, contact points are
+			 * matched up with last step's relative to the first body
+			 * @param velocities Velocity of every body before the step's
+			 * forces are applied. Bodies bounce off the speed they approach
+			 * each other with here, which every iteration of solve() then
+			 * aims for, rather than adds to.
+			 */
+			void prepare(const std::vector<ContactManifold>& manifolds,
+			             const std::vector<glm::vec3>& positions,
+			             const std::vector<glm::vec3>& velocities,
+			             const std::vector<float>& inverseMasses,
+			             const std::vector<float>& frictions,
+			             const std::vector<float>& restitutions,
+			             float timestep,
+			             JobSystem& jobSystem);
+
+			/**
+			 * @brief Apply the cached impulses and run the solver iterations
+			 * over the prepared constraints, island by island
+			 *
+			 * @param islands Islands built over the manifolds given to
+			 * prepare()
+			 */
+			void solve(const IslandBuilder& islands,
+			           std::vector<glm::vec3>& velocities,
+			           JobSystem& jobSystem);
+
+			/**
+			 * @brief Remember the accumulated impulses for the next step
+			 *
+			 * Contacts that did not come up this step are forgotten.
+			 */
+			void storeImpulses();
+
+		private:
+			struct ConstraintPoint
+			{
+				glm::vec3 offset;
+				//position relative to the first body
+
+				float bias;
+				//separating velocity the constraint aims for, to push the
+				//bodies apart or make them bounce
+
+				float normalImpulse;
+				float tangentImpulses[2];
+			};
+
+			struct ContactConstraint
+			{
+				std::uint32_t first;
+				std::uint32_t second;
+
+				glm::vec3 normal;
+				glm::vec3 tangents[2];
+
+				float inverseMassFirst;
+				float inverseMassSecond;
+				float effectiveMass;
+				//1 / (inverseMassFirst + inverseMassSecond)
+
+				float friction;
+
+				std::array<ConstraintPoint, ContactManifold::s_maxPoints> points;
+				std::uint32_t pointCount;
+			};
+
+			struct CachedPoint
+			{
+				glm::vec3 offset;
+				float normalImpulse;
+				glm::vec3 tangentImpulse;
+				//in world space, the contact's tangents change from step to
+				//step
+			};
+
+			struct CachedManifold
+			{
+				std::array<CachedPoint, ContactManifold::s_maxPoints> points;
+				std::uint32_t pointCount;
+			};
+
+			static constexpr float s_baumgarte = 0.2f;
+			//fraction of the penetration pushed out every step
+
+			static constexpr float s_penetrationSlop = 0.01f;
+			//penetration left alone, so that resting contacts stay in
+			//contact instead of jittering in and out of it
+
+			static constexpr float s_restitutionThreshold = 1.0f;
+			//slower impacts do not bounce, or bodies would never come to
+			//rest
+
+			static constexpr float s_matchDistance = 0.05f;
+			//how far a contact point can move in a step and still be
+			//considered the same point
+
+			static constexpr std::size_t s_prepareGrainSize = 256;
+			static constexpr std::size_t s_colorGrainSize = 64;
+			//constraints per chunk
+
+			static constexpr std::uint32_t s_batchSize = 128;
+			//small islands are batched until they have this many
+			//constraints
+
+			static constexpr std::uint32_t s_maxColors = 64;
+			//one bit per color in m_bodyColors
+
+			struct SolveTask
+			{
+				std::uint32_t islandStart;
+				std::uint32_t islandCount;
+				//a batch of small islands, or a single large one
+
+				bool isColored;
+			};
+
+			struct ColoredIsland
+			{
+				std::vector<std::uint32_t> colorStarts;
+				//color c covers [colorStarts[c], colorStarts[c + 1]) of
+				//m_coloredConstraints, the last range holds what did not fit
+				//in s_maxColors colors and is solved serially
+			};
+
+			unsigned int m_iterations = 10;
+			bool m_warmStarting = true;
+
+			std::uint32_t m_largeIslandSize = 512;
+			//islands with more constraints than this are colored
+
+			std::vector<ContactConstraint> m_constraints;
+			std::vector<SolveTask> m_tasks;
+
+			std::vector<std::uint64_t> m_bodyColors;
+			//colors already used by each body's constraints, while coloring
+			//an island
+
+			std::vector<std::uint32_t> m_coloredConstraints;
+			//the constraints of every large island, sorted by color, where
+			//the island keeps them in IslandBuilder::getContacts()
+			std::vector<ColoredIsland> m_coloredIslands;
+			//one per task
+
+			std::unordered_map<std::uint64_t, CachedManifold> m_cache;
+			//keyed by the pair of bodies, see getKey()
+
+			[[nodiscard]] static inline std::uint64_t getKey(std::uint32_t first, std::uint32_t second)
+			{
+				return (static_cast<std::uint64_t>(first) << 32) | second;
+			}
+
+			static void applyImpulse(const ContactConstraint& constraint,
+			                         const glm::vec3& impulse,
+			                         std::vector<glm::vec3>& velocities);
+			static void warmStart(const ContactConstraint& constraint, std::vector<glm::vec3>& velocities);
+			static void solveConstraint(ContactConstraint& constraint, std::vector<glm::vec3>& velocities);
+
+			void solveSerial(const std::uint32_t* constraints,
+			                 std::size_t count,
+			                 std::vector<glm::vec3>& velocities);
+			void colorIsland(const std::uint32_t* constraints,
+			                 std::size_t count,
+			                 std::uint32_t* coloredConstraints,
+			                 ColoredIsland& coloredIsland);
+			void solveColored(const std::uint32_t* coloredConstraints,
+			                  const ColoredIsland& coloredIsland,
+			                  std::vector<glm::vec3>& velocities,
+			                  JobSystem& jobSystem);
+	};
+}
+
+#endif //__CONTACTSOLVER_H__
@@ -0,0 +1,176 @@
+#ifndef __DYNAMICBVH_H__
+#define __DYNAMICBVH_H__
+
+#include "boundingvolume.hpp"
+#include "traversalstack.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace Physicc
+{
+	/**
+	 * @brief A BVH that supports inserting, removing and moving bodies
+	 *
+	 * Unlike BVH, which is built once over a fixed list of bodies, this tree
+	 * is maintained incrementally. Leaves store a "fat" AABB, i.e. the body's
+	 * AABB grown by a margin, so that a body which moves a little stays inside
+	 * its leaf's volume and the tree does not have to change at all. A body
+	 * that leaves its fat AABB is removed and reinserted, and the tree is
+	 * rebalanced with rotations on the way back up.
+	 *
+	 * Bodies are referred to by proxy IDs handed out by insert(), which stay
+	 * valid until the body is removed.
+	 */
+	class DynamicBVH
+	{
+		public:
+			static constexpr std::uint32_t s_nullNode = std::numeric_limits<std::uint32_t>::max();
+
+			/**
+			 * @brief Construct a new, empty DynamicBVH
+			 *
+			 * @param margin How far a leaf's AABB extends beyond the body's
+			 * AABB on every side
+			 */
+			DynamicBVH(float margin = 0.1f);
+
+			/**
+			 * @brief Insert a body into the tree
+			 *
+			 * @param volume The body's (tight) AABB
+			 * @param bodyIndex Index of the body, reported back by queries
+			 * @return The proxy ID of the new leaf
+			 */
+			std::uint32_t insert(const BoundingVolume::AABB& volume, std::uint32_t bodyIndex);
+
+			/**
+			 * @brief Remove a body from the tree
+			 *
+			 * @param proxy ID returned by insert(). It is invalid afterwards.
+			 */
+			void remove(std::uint32_t proxy);
+
+			/**
+			 * @brief Update a body's AABB after it moved
+			 *
+			 * @param proxy ID returned by insert()
+			 * @param volume The body's new (tight) AABB
+			 * @param displacement How far the body moved since the last
+			 * update. The fat AABB is stretched along it, to anticipate the
+			 * body moving on in the same direction.
+			 * @return true if the body left its fat AABB and was reinserted,
+			 * false if the tree did not need to change
+			 */
+			bool update(std::uint32_t proxy,
+			            const BoundingVolume::AABB& volume,
+			            const glm::vec3& displacement = glm::vec3(0));
+
+			[[nodiscard]] inline const BoundingVolume::AABB& getFatVolume(std::uint32_t proxy) const
+			{
+				return m_nodes[proxy].volume;
+			}
+
+			[[nodiscard]] inline std::uint32_t getBodyIndex(std::uint32_t proxy) const
+			{
+				return m_nodes[proxy].bodyIndex;
+			}
+
+			/**
+			 * @brief Get the height of the tree
+			 *
+			 * @return 0 for a tree with a single leaf, -1 for an empty tree
+			 */
+			[[nodiscard]] inline int getHeight() const
+			{
+				return m_root == s_nullNode ? -1 : m_nodes[m_root].height;
+			}
+
+			/**
+			 * @brief Find all leaves whose fat AABB overlaps a volume
+			 *
+			 * @param volume The AABB to test against
+			 * @param callback Called with the proxy ID of every overlapping
+			 * leaf. Returning false from it ends the query early.
+			 */
+			template <typename Callback>
+			void query(const BoundingVolume::AABB& volume, Callback&& callback) const
+			{
+				PHYSICC_ZONE_FINE;
+
+				if (m_root == s_nullNode)
+				{
+					return;
+				}
+
+				TraversalStack<std::uint32_t> stack;
+				stack.push(m_root);
+
+				while (!stack.empty())
+				{
+					std::uint32_t index = stack.pop();
+					const Node& node = m_nodes[index];
+
+					if (!node.volume.overlapsWith(volume))
+					{
+						continue;
+					}
+
+					if (node.isLeaf())
+					{
+						if (!callback(index))
+						{
+							return;
+						}
+					} else
+					{
+						stack.push(node.child1);
+						stack.push(node.child2);
+					}
+				}
+			}
+
+		private:
+			struct Node
+			{
+				BoundingVolume::AABB volume;
+
+				std::uint32_t parent = s_nullNode;
+				//doubles as the next free node for nodes in the free list
+
+				std::uint32_t child1 = s_nullNode;
+				std::uint32_t child2 = s_nullNode;
+				std::uint32_t bodyIndex = s_nullNode;
+
+				std::int32_t height = 0;
+				//0 for leaves, -1 for free nodes
+
+				[[nodiscard]] inline bool isLeaf() const
+				{
+					return child1 == s_nullNode;
+				}
+			};
+
+			static constexpr float s_displacementMultiplier = 2.0f;
+			//how many steps' worth of displacement a fat AABB is stretched by
+
+			std::vector<Node> m_nodes;
+			std::uint32_t m_root;
+			std::uint32_t m_freeList;
+			float m_margin;
+
+			std::uint32_t allocateNode();
+			void freeNode(std::uint32_t index);
+
+			void insertLeaf(std::uint32_t leaf);
+			void removeLeaf(std::uint32_t leaf);
+
+			std::uint32_t balance(std::uint32_t index);
+			void refitAncestors(std::uint32_t index);
+			//walks from `index` up to the root, rebalancing and refitting
+			//every node on the way
+	};
+}
+
+#endif //__DYNAMICBVH_H__
@@ -0,0 +1,94 @@
+#ifndef __ISLANDBUILDER_H__
+#define __ISLANDBUILDER_H__
+
+#include "contact.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace Physicc
+{
+	/**
+	 * @brief Splits bodies into islands: groups that touch each other,
+	 * directly or through other bodies of the group
+	 *
+	 * Bodies in different islands cannot affect each other during a step, so
+	 * islands can fall asleep, wake up and be solved independently.
+	 *
+	 * Islands are found with a union-find over the contact graph. Static
+	 * bodies do not join islands, since they pass nothing on: two boxes
+	 * lying on the same floor are in separate islands. A static body only
+	 * ever makes up an island of its own, if it is given as a body.
+	 */
+	class IslandBuilder
+	{
+		public:
+			struct Island
+			{
+				std::uint32_t bodyStart;
+				std::uint32_t bodyCount;
+				//range of getBodies()
+
+				std::uint32_t contactStart;
+				std::uint32_t contactCount;
+				//range of getContacts()
+			};
+
+			/**
+			 * @brief Find the islands among a set of bodies
+			 *
+			 * @param bodies The bodies to sort into islands, in increasing
+			 * order. Every dynamic body in a contact has to be one of them.
+			 * @param bodyCount Number of bodies in the world
+			 * @param contacts Contacts between the bodies
+			 * @param inverseMasses Inverse mass of every body in the world,
+			 * bodies with an inverse mass of 0 are static
+			 */
+			void build(const std::vector<std::uint32_t>& bodies,
+			           std::size_t bodyCount,
+			           const std::vector<ContactManifold>& contacts,
+			           const std::vector<float>& inverseMasses);
+
+			/**
+			 * @brief Get the islands, ordered by their lowest numbered body
+			 */
+			[[nodiscard]] inline const std::vector<Island>& getIslands() const
+			{
+				return m_islands;
+			}
+
+			/**
+			 * @brief Get the bodies, grouped island after island and in
+			 * increasing order within each island
+			 */
+			[[nodiscard]] inline const std::vector<std::uint32_t>& getBodies() const
+			{
+				return m_bodies;
+			}
+
+			/**
+			 * @brief Get the indices of the contacts, grouped island after
+			 * island and in increasing order within each island
+			 */
+			[[nodiscard]] inline const std::vector<std::uint32_t>& getContacts() const
+			{
+				return m_contacts;
+			}
+
+		private:
+			std::vector<std::uint32_t> m_parents;
+			//union-find forest over all the bodies of the world, only the
+			//entries of the bodies given to build() are used
+
+			std::vector<std::uint32_t> m_islandIndices;
+			//of every root, while the islands are laid out
+
+			std::vector<Island> m_islands;
+			std::vector<std::uint32_t> m_bodies;
+			std::vector<std::uint32_t> m_contacts;
+
+			std::uint32_t findRoot(std::uint32_t body);
+	};
+}
+
+#endif //__ISLANDBUILDER_H__
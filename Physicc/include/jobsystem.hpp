@@ -0,0 +1,144 @@
+#ifndef __JOBSYSTEM_H__
+#define __JOBSYSTEM_H__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Physicc
+{
+	/**
+	 * @brief A pool of worker threads that run chunks of parallel loops
+	 *
+	 * Every thread (the workers, plus one slot shared by all other threads)
+	 * has its own deque of jobs. A thread pushes the jobs it creates onto its
+	 * own deque and takes work back from the same end, so it mostly runs
+	 * jobs whose data is still in its cache. Threads that run out of work
+	 * steal from the other end of somebody else's deque.
+	 *
+	 * A thread waiting for its jobs to finish runs jobs itself in the
+	 * meantime, so parallel loops can be nested without deadlocking.
+	 */
+	class JobSystem
+	{
+		public:
+			/**
+			 * @brief Start the worker threads
+			 *
+			 * @param workerCount Number of threads to start, on top of the
+			 * threads calling parallelFor(). Defaults to one less than the
+			 * number of hardware threads.
+			 */
+			JobSystem(unsigned int workerCount = defaultWorkerCount());
+			~JobSystem();
+
+			JobSystem(const JobSystem&) = delete;
+			JobSystem& operator=(const JobSystem&) = delete;
+
+			/**
+			 * @brief Get the number of threads that run jobs, including the
+			 * calling thread
+			 */
+			[[nodiscard]] inline unsigned int getThreadCount() const
+			{
+				return static_cast<unsigned int>(m_workers.size()) + 1;
+			}
+
+			/**
+			 * @brief Split [0, count) into chunks and run `function(start,
+			 * end)` on all of them in parallel
+			 *
+			 * Returns once every chunk has finished. Chunks are fixed by
+			 * count and grainSize alone, never by which thread runs them, so
+			 * anything computed per chunk can be merged in chunk order to get
+			 * the same result on every run.
+			 *
+			 * @param grainSize Number of elements per chunk (the last one may
+			 * be smaller)
+			 */
+			template <typename Function>
+			void parallelFor(std::size_t count, std::size_t grainSize, Function&& function)
+			{
+				grainSize = std::max(grainSize, std::size_t(1));
+				std::size_t chunkCount = (count + grainSize - 1) / grainSize;
+
+				if (chunkCount <= 1 || m_workers.empty())
+				{
+					for (std::size_t start = 0; start < count; start += grainSize)
+					{
+						function(start, std::min(start + grainSize, count));
+					}
+
+					return;
+				}
+
+				std::atomic<std::size_t> remaining(chunkCount - 1);
+
+				//Push the chunks in reverse, so that the owner works through
+				//them from the front and thieves take them from the back
+				for (std::size_t chunk = chunkCount - 1; chunk > 0; chunk--)
+				{
+					std::size_t start = chunk * grainSize;
+					std::size_t end = std::min(start + grainSize, count);
+
+					push([&function, &remaining, start, end]() {
+						function(start, end);
+						remaining.fetch_sub(1, std::memory_order_release);
+					});
+				}
+
+				wake(chunkCount - 1);
+
+				function(std::size_t(0), std::min(grainSize, count));
+
+				wait(remaining);
+			}
+
+			/**
+			 * @brief Number of chunks parallelFor() splits count elements into
+			 */
+			[[nodiscard]] static inline std::size_t chunkCount(std::size_t count, std::size_t grainSize)
+			{
+				grainSize = std::max(grainSize, std::size_t(1));
+
+				return (count + grainSize - 1) / grainSize;
+			}
+
+			[[nodiscard]] static unsigned int defaultWorkerCount();
+
+		private:
+			typedef std::function<void()> Job;
+
+			struct Queue
+			{
+				std::mutex mutex;
+				std::deque<Job> jobs;
+			};
+
+			std::vector<std::thread> m_workers;
+			std::vector<std::unique_ptr<Queue>> m_queues;
+			//m_queues[0] is shared by all threads that are not workers,
+			//worker i owns m_queues[i + 1]
+
+			std::atomic<std::size_t> m_pendingJobs;
+			std::mutex m_sleepMutex;
+			std::condition_variable m_wakeCondition;
+			bool m_stop;
+
+			std::size_t getQueueIndex() const;
+			void push(Job&& job);
+			void wake(std::size_t jobCount);
+			bool runJob(std::size_t queueIndex);
+			void wait(const std::atomic<std::size_t>& remaining);
+			void workerLoop(std::size_t queueIndex);
+	};
+}
+
+#endif //__JOBSYSTEM_H__
@@ -0,0 +1,165 @@
+#ifndef __NARROWPHASE_H__
+#define __NARROWPHASE_H__
+
+#include "collider.hpp"
+#include "contact.hpp"
+#include "trianglemesh.hpp"
+
+#include <array>
+
+namespace Physicc
+{
+	/**
+	 * @brief Exact collision tests between pairs of shapes
+	 *
+	 * Every test fills in the normal and points of a ContactManifold (but not
+	 * the body indices, which the shapes know nothing about) and returns
+	 * whether the shapes overlap. The manifold is left in an unspecified
+	 * state if they do not.
+	 */
+	namespace Narrowphase
+	{
+		/**
+		 * @brief Test any two colliders against each other
+		 *
+		 * Picks an analytic test for the common pairs of shapes, tests
+		 * compounds child by child and meshes triangle by triangle, and falls
+		 * back to GJK and EPA for the rest. Two meshes never collide.
+		 */
+		bool collide(const Collider& first, const Collider& second, ContactManifold& manifold);
+
+		bool collideSpheres(const SphereCollider& first,
+		                    const SphereCollider& second,
+		                    ContactManifold& manifold);
+
+		bool collideSphereBox(const SphereCollider& sphere,
+		                      const BoxCollider& box,
+		                      ContactManifold& manifold);
+		//the normal points from the sphere towards the box
+
+		/**
+		 * @brief Separating axis test between two oriented boxes
+		 *
+		 * Tries the 3 face normals of either box and the 9 cross products of
+		 * their edges. If the axis of least penetration is a face normal,
+		 * the face of the other box that faces it the most is clipped against
+		 * it, which gives up to four points; for an edge axis, the closest
+		 * points of the two edges give one.
+		 */
+		bool collideBoxes(const BoxCollider& first,
+		                  const BoxCollider& second,
+		                  ContactManifold& manifold);
+
+		/**
+		 * @brief Test two convex shapes using nothing but their support
+		 * functions
+		 *
+		 * GJK finds out whether the shapes overlap, and EPA then expands the
+		 * simplex GJK ended with into the face of the Minkowski difference
+		 * closest to the origin, which gives the normal and depth of the
+		 * single contact point this test reports. Shapes that merely touch
+		 * are reported as not overlapping.
+		 */
+		bool collideConvex(const Collider& first, const Collider& second, ContactManifold& manifold);
+
+		bool collideConvexTriangle(const Triangle& triangle, const Collider& other, ContactManifold& manifold);
+		//the same, with a triangle of a mesh as the first shape
+
+		/**
+		 * @brief Merges the contacts between the parts of one shape and
+		 * another shape into the single manifold a pair of bodies gets
+		 *
+		 * The normal is that of the deepest contact, and the points of the
+		 * contacts whose normal roughly agrees with it are kept, reduced to
+		 * four spread as far apart as possible. Contacts along other normals
+		 * are left for the following steps.
+		 */
+		class ContactMerger
+		{
+			public:
+				/**
+				 * @brief Add the contact of one part
+				 *
+				 * Once s_maxContacts contacts have been added, a new one
+				 * replaces the shallowest, or is dropped if it is shallower
+				 * still.
+				 */
+				void add(const ContactManifold& contact);
+
+				/**
+				 * @brief Merge the contacts added so far
+				 *
+				 * @return false if none were added
+				 */
+				bool merge(ContactManifold& manifold) const;
+
+			private:
+				static constexpr std::size_t s_maxContacts = 16;
+
+				std::array<ContactManifold, s_maxContacts> m_contacts;
+				std::array<float, s_maxContacts> m_depths;
+				std::size_t m_count = 0;
+		};
+
+		/**
+		 * @brief Test a compound against any other collider, one child at a
+		 * time
+		 *
+		 * Only the children whose AABB overlaps the other collider's are
+		 * tested, found with the compound's tree, and their contacts are
+		 * merged by a ContactMerger.
+		 *
+		 * The normal points from the compound towards the other collider.
+		 */
+		bool collideCompound(const CompoundCollider& compound,
+		                     const Collider& other,
+		                     ContactManifold& manifold);
+
+		/**
+		 * @brief Test a static mesh against any other collider, one triangle
+		 * at a time
+		 *
+		 * The triangles near the other collider are found with the mesh's
+		 * tree. Spheres and boxes are tested against a triangle directly,
+		 * anything else with GJK and EPA, and the contacts of the triangles
+		 * are merged by a ContactMerger. Compounds and other meshes are not
+		 * handled here.
+		 *
+		 * The normal points from the mesh towards the other collider.
+		 */
+		bool collideTriangleMesh(const TriangleMeshCollider& mesh,
+		                         const Collider& other,
+		                         ContactManifold& manifold);
+
+		/**
+		 * @brief Find when a shape moving in a straight line first touches
+		 * another one
+		 *
+		 * Casts a ray along the relative motion against the Minkowski
+		 * difference of the shapes, with GJK telling how far the ray can
+		 * safely advance at every iteration (conservative advancement).
+		 * Shapes only translate, so this is exact up to a small tolerance,
+		 * and never reports a time after the shapes have started to
+		 * overlap. Two spheres are solved analytically, compounds child by
+		 * child, and meshes triangle by triangle.
+		 *
+		 * @param first The moving shape
+		 * @param second The shape it moves towards, which stands still
+		 * @param motion How far the first shape moves relative to the
+		 * second
+		 * @param time Set to the fraction of the motion after which the
+		 * shapes touch, 0 if they already do
+		 * @param normal Set to the unit normal of the contact, pointing from
+		 * the first shape towards the second. Left alone if the shapes
+		 * touch from the start.
+		 * @return true if the shapes touch before the end of the motion
+		 */
+		bool timeOfImpact(const Collider& first,
+		                  const Collider& second,
+		                  const glm::vec3& motion,
+		                  float& time,
+		                  glm::vec3& normal);
+	}
+}
+
+#endif //__NARROWPHASE_H__
@@ -1,10 +1,20 @@
 #ifndef __PHYSICC_H__
 #define __PHYSICC_H__
 
-#include "tools/Tracy.hpp"
+#include "profiling.hpp"
 
 #include "glm/glm.hpp"
+#include "bodypair.hpp"
+#include "broadphase.hpp"
+#include "colliderstore.hpp"
+#include "contact.hpp"
+#include "contactsolver.hpp"
+#include "islandbuilder.hpp"
+#include "jobsystem.hpp"
 #include "rigidbody.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace Physicc
@@ -14,32 +24,473 @@ namespace Physicc
 	 *
 	 * This class describes and propagates the properties of each object using the
 	 * Physics Model.
+	 *
+	 * The state that the integrator touches every step is kept as a structure
+	 * of arrays, one contiguous array per quantity, so that the integration
+	 * loop streams through memory and can be vectorized. Bodies are referred
+	 * to by the index addRigidBody() returns.
+	 *
+	 * A step runs as a pipeline of stages. Collision detection (bounding
+	 * volume update, broadphase, narrowphase) finds the contacts at the
+	 * bodies' current positions, then velocities are integrated, the contact
+	 * solver corrects them, and positions are integrated with the corrected
+	 * velocities. Most stages are split into fixed chunks of bodies that the
+	 * world's JobSystem runs in parallel. Results produced per chunk are
+	 * merged in chunk order, so a step gives the same results no matter how
+	 * many threads run it.
+	 *
+	 * Islands of bodies that have been resting for a while fall asleep. A
+	 * sleeping body is not integrated, its bounding volume is not updated,
+	 * and its contacts with other sleeping or static bodies are neither
+	 * tested nor solved, until something touches or moves it.
+	 *
+	 * Bodies that move further in a step than a fraction of their size are
+	 * swept: their AABB covers the whole step's motion when it goes to the
+	 * broadphase, and once their velocity is known, they are stopped at the
+	 * first body they would hit along the way instead of tunnelling through
+	 * it. See setContinuousCollision().
 	 */
 	class PhysicsWorld
 	{
 		public:
-			PhysicsWorld(const glm::vec3& gravity);
+			enum class Integrator
+			{
+				SemiImplicitEuler,
+				//v += a * dt, then x += v * dt. Cheap and stable, the
+				//default.
+
+				VelocityVerlet
+				//x += v * dt + a * dt^2 / 2, then v += a * dt. Exact for
+				//the constant accelerations the world applies, so bodies
+				//follow their ballistic arcs regardless of the timestep.
+			};
+
+			/**
+			 * @brief Construct a new, empty PhysicsWorld
+			 *
+			 * @param gravity Acceleration due to gravity
+			 * @param workerCount Number of threads the world starts to run
+			 * steps on, on top of the thread that calls stepSimulation()
+			 */
+			PhysicsWorld(const glm::vec3& gravity,
+			             unsigned int workerCount = JobSystem::defaultWorkerCount());
 
 			inline void setGravity(const glm::vec3& gravity)
 			{
-				ZoneScoped;
+				PHYSICC_ZONE_FINE;
 
 				m_gravity = gravity;
 			}
 
 			[[nodiscard]] inline glm::vec3 getGravity() const
 			{
-				ZoneScoped;
+				PHYSICC_ZONE_FINE;
 
 				return m_gravity;
 			}
 
-			void addRigidBody(const RigidBody& object);
+			inline void setIntegrator(Integrator integrator)
+			{
+				m_integrator = integrator;
+			}
+
+			[[nodiscard]] inline Integrator getIntegrator() const
+			{
+				return m_integrator;
+			}
+
+			/**
+			 * @brief Add a new body to the world
+			 *
+			 * @return Index of the body, used to refer to it from then on
+			 */
+			std::size_t addRigidBody(const RigidBody& object);
+
+			/**
+			 * @brief Take a body out of the simulation for good
+			 *
+			 * The body stops moving and touching anything, and whatever was
+			 * resting on it wakes up. Indices are never reused, so every
+			 * other body keeps its index, and the removed one keeps its
+			 * place in the arrays.
+			 */
+			void removeRigidBody(std::size_t index);
+
+			[[nodiscard]] inline bool isRemoved(std::size_t index) const
+			{
+				return m_removed[index] != 0;
+			}
+
+			[[nodiscard]] inline std::size_t getBodyCount() const
+			{
+				return m_positions.size();
+			}
+
+			[[nodiscard]] inline glm::vec3 getPosition(std::size_t index) const
+			{
+				return m_positions[index];
+			}
+
+			/**
+			 * @brief Move a body to a new position
+			 *
+			 * The body is not interpolated between its old and new position,
+			 * see getInterpolatedPosition().
+			 */
+			inline void setPosition(std::size_t index, const glm::vec3& position)
+			{
+				m_positions[index] = position;
+				m_previousPositions[index] = position;
+				wakeBody(index);
+			}
+
+			/**
+			 * @brief Get a body's position a fraction of a step behind the
+			 * simulation, for rendering
+			 *
+			 * update() leaves the simulation up to one fixed step ahead of
+			 * the time it was given. Blending the positions before and after
+			 * the last step by how far into that step the given time falls
+			 * makes bodies move smoothly at any frame rate.
+			 */
+			[[nodiscard]] inline glm::vec3 getInterpolatedPosition(std::size_t index) const
+			{
+				return glm::mix(m_previousPositions[index], m_positions[index], m_interpolationFactor);
+			}
+
+			[[nodiscard]] inline glm::vec3 getVelocity(std::size_t index) const
+			{
+				return m_velocities[index];
+			}
+
+			inline void setVelocity(std::size_t index, const glm::vec3& velocity)
+			{
+				m_velocities[index] = velocity;
+				wakeBody(index);
+			}
+
+			/**
+			 * @brief Set the force that acts on a body every step, on top of
+			 * gravity
+			 */
+			inline void setForce(std::size_t index, const glm::vec3& force)
+			{
+				m_forces[index] = force;
+				wakeBody(index);
+			}
+
+			[[nodiscard]] inline bool isAwake(std::size_t index) const
+			{
+				return m_awake[index] != 0;
+			}
+
+			/**
+			 * @brief Wake a body up, along with the rest of the island it fell
+			 * asleep with
+			 */
+			void wakeBody(std::size_t index);
+
+			/**
+			 * @brief Turn putting resting bodies to sleep on or off
+			 *
+			 * Turning it off wakes every body up.
+			 */
+			void setSleepingEnabled(bool enabled);
+
+			[[nodiscard]] inline bool isSleepingEnabled() const
+			{
+				return m_sleepingEnabled;
+			}
+
+			/**
+			 * @brief Set when islands fall asleep, for every body in the
+			 * world and every body added from then on
+			 *
+			 * @param velocity Speed below which a body counts as resting
+			 * @param time How long every body of an island has to rest for
+			 * the island to fall asleep, in seconds
+			 */
+			void setSleepThresholds(float velocity, float time);
+
+			/**
+			 * @brief Set when a single body counts as resting
+			 *
+			 * An island only falls asleep once each of its bodies has
+			 * rested for as long as its own thresholds ask, so the strictest
+			 * body of an island decides for all of it. A body that must
+			 * never sleep can be given a time of infinity.
+			 */
+			inline void setSleepThresholds(std::size_t index, float velocity, float time)
+			{
+				m_sleepVelocities[index] = velocity;
+				m_timesToSleep[index] = time;
+			}
+
+			/**
+			 * @brief Turn continuous collision detection on or off
+			 *
+			 * @param enabled Whether fast bodies are swept
+			 * @param motionThreshold A body is swept in a step if it moves
+			 * further than this fraction of the smallest side of its AABB
+			 */
+			inline void setContinuousCollision(bool enabled, float motionThreshold = 0.5f)
+			{
+				m_continuousCollision = enabled;
+				m_sweepThreshold = motionThreshold;
+			}
+
+			[[nodiscard]] inline bool isContinuousCollisionEnabled() const
+			{
+				return m_continuousCollision;
+			}
+
+			[[nodiscard]] inline float getInverseMass(std::size_t index) const
+			{
+				return m_inverseMasses[index];
+			}
+
+			inline void setFriction(std::size_t index, float friction)
+			{
+				m_frictions[index] = friction;
+			}
+
+			inline void setRestitution(std::size_t index, float restitution)
+			{
+				m_restitutions[index] = restitution;
+			}
+
+			/**
+			 * @brief Get a body's collider, placed at the body's position as
+			 * of the last step
+			 */
+			[[nodiscard]] inline const Collider& getCollider(std::size_t index) const
+			{
+				return m_colliders.get(m_colliderHandles[index]);
+			}
+
+			/**
+			 * @brief Get where a body's collider is kept in getColliders()
+			 */
+			[[nodiscard]] inline ColliderHandle getColliderHandle(std::size_t index) const
+			{
+				return m_colliderHandles[index];
+			}
+
+			[[nodiscard]] inline const ColliderStore& getColliders() const
+			{
+				return m_colliders;
+			}
+
+			/**
+			 * @brief Set how many fixed steps update() takes per second of
+			 * simulated time
+			 */
+			inline void setStepFrequency(float frequency)
+			{
+				m_fixedTimestep = 1.0f / frequency;
+			}
+
+			[[nodiscard]] inline float getFixedTimestep() const
+			{
+				return m_fixedTimestep;
+			}
+
+			/**
+			 * @brief Set the maximum number of fixed steps one call to update()
+			 * takes
+			 *
+			 * If a frame takes longer than this many steps can simulate,
+			 * the simulation falls behind rather than taking ever more steps
+			 * per frame (which would make the frames longer still).
+			 */
+			inline void setMaxSubsteps(unsigned int maxSubsteps)
+			{
+				m_maxSubsteps = maxSubsteps;
+			}
+
+			[[nodiscard]] inline float getInterpolationFactor() const
+			{
+				return m_interpolationFactor;
+			}
+
+			/**
+			 * @brief Advance the simulation by a frame's worth of time in
+			 * fixed steps
+			 *
+			 * Time is accumulated across calls and consumed in steps of
+			 * getFixedTimestep(), so the cost of the simulation per second
+			 * and its results do not depend on the frame rate. Whatever is
+			 * left over is carried to the next call and used to interpolate
+			 * render positions.
+			 *
+			 * @param frameTime Time since the last call, in seconds
+			 * @return The number of steps taken
+			 */
+			unsigned int update(float frameTime);
+
 			void stepSimulation(float timestep);
 
+			/**
+			 * @brief Replace the broadphase, which finds the pairs of bodies
+			 * that might touch
+			 *
+			 * The world starts out with a DynamicBVHBroadphase. Bodies
+			 * already in the world are handed over to the new broadphase.
+			 */
+			void setBroadphase(std::unique_ptr<Broadphase> broadphase);
+
+			/**
+			 * @brief Get the pairs of bodies whose AABBs overlapped in the
+			 * last step
+			 *
+			 * Pairs of two static bodies, and pairs with a removed body, are
+			 * left out.
+			 */
+			[[nodiscard]] inline const std::vector<BodyPair>& getPairs() const
+			{
+				return m_pairs;
+			}
+
+			/**
+			 * @brief Get the contacts between the bodies that touched in the
+			 * last step
+			 *
+			 * There is one manifold per pair of touching bodies, in the order
+			 * of getPairs(). Pairs without an awake body are not tested.
+			 */
+			[[nodiscard]] inline const std::vector<ContactManifold>& getContacts() const
+			{
+				return m_contacts;
+			}
+
+			/**
+			 * @brief Get the solver that resolves contacts, to tune its
+			 * iterations and warm starting
+			 */
+			[[nodiscard]] inline ContactSolver& getContactSolver()
+			{
+				return m_contactSolver;
+			}
+
 		private:
+			static constexpr std::size_t s_integrateGrainSize = 2048;
+			static constexpr std::size_t s_narrowphaseGrainSize = 128;
+			//bodies (or pairs) per chunk in each stage, roughly in inverse
+			//proportion to how much work a stage does per body
+
+			static constexpr float s_impactOverlap = 0.005f;
+			//a swept body stops this far into what it hits, so that the
+			//narrowphase sees the contact in the next step. Below the
+			//solver's penetration slop, so it is not pushed back out.
+
+			static constexpr std::uint32_t s_notSwept = ~std::uint32_t(0);
+			//marks the bodies in m_sweptBodySlots that are not swept
+
 			glm::vec3 m_gravity;
-			std::vector<RigidBody> m_objects;
+			Integrator m_integrator = Integrator::SemiImplicitEuler;
+
+			float m_fixedTimestep = 1.0f / 60.0f;
+			unsigned int m_maxSubsteps = 8;
+			double m_accumulator = 0.0;
+			//in double, so that adding up many frames does not drift
+			float m_interpolationFactor = 1.0f;
+
+			static constexpr double s_stepTolerance = 1e-4;
+			//fraction of a step the accumulated time can fall short of one
+			//and still take it. Frame times that add up to a whole number
+			//of steps rarely do so exactly once rounded.
+
+			std::unique_ptr<JobSystem> m_jobSystem;
+			//behind a pointer so the world stays movable
+
+			std::vector<glm::vec3> m_positions;
+			std::vector<glm::vec3> m_previousPositions;
+			//positions before the last step taken by update()
+			std::vector<glm::vec3> m_velocities;
+			std::vector<glm::vec3> m_forces;
+			std::vector<float> m_inverseMasses;
+			//0 for static bodies
+
+			std::vector<float> m_gravityScales;
+			//0 for static bodies as well, so that the integrator does not
+			//have to check for them
+
+			std::vector<float> m_frictions;
+			std::vector<float> m_restitutions;
+
+			std::vector<ColliderHandle> m_colliderHandles;
+			ColliderStore m_colliders;
+			//only needed to find AABBs and contacts, kept out of the
+			//integrator's way
+
+			std::vector<BoundingVolume::AABB> m_volumes;
+			std::unique_ptr<Broadphase> m_broadphase;
+			std::vector<BodyPair> m_pairs;
+
+			std::vector<ContactManifold> m_contacts;
+			std::vector<std::vector<ContactManifold>> m_chunkContacts;
+
+			ContactSolver m_contactSolver;
+
+			bool m_sleepingEnabled = true;
+			float m_sleepVelocity = 0.05f;
+			float m_timeToSleep = 0.5f;
+			//given to the bodies as they are added
+
+			std::vector<float> m_sleepVelocities;
+			std::vector<float> m_timesToSleep;
+
+			std::vector<std::uint8_t> m_awake;
+			//removed bodies are never awake
+
+			std::vector<std::uint8_t> m_removed;
+			std::size_t m_removedCount = 0;
+
+			std::vector<float> m_sleepTimes;
+			//how long each body has been resting for
+
+			std::vector<std::uint32_t> m_awakeBodies;
+			//in increasing order, the stages that skip sleeping bodies run
+			//over this
+			bool m_awakeBodiesChanged = false;
+
+			struct SweptBody
+			{
+				std::uint32_t body;
+				float time;
+				//fraction of the step the body moves for before it hits
+				//something, 1 if it does not
+
+				glm::vec3 start;
+				//position at the start of the step
+			};
+
+			bool m_continuousCollision = true;
+			float m_sweepThreshold = 0.5f;
+			std::vector<SweptBody> m_sweptBodies;
+			std::vector<std::uint32_t> m_sweptBodySlots;
+			//index into m_sweptBodies of every body, s_notSwept for bodies
+			//that are not swept this step
+
+			IslandBuilder m_islandBuilder;
+			std::vector<std::vector<std::uint32_t>> m_sleepingIslands;
+			std::vector<std::uint32_t> m_freeIslandSlots;
+			std::vector<std::uint32_t> m_islandSlots;
+			//index into m_sleepingIslands of every sleeping body's island
+
+			void integrateVelocities(std::size_t start, std::size_t end, float timestep);
+			void integratePositions(std::size_t start, std::size_t end, float timestep);
+			void updateBounds();
+			void sweepFastBodies(float timestep);
+			void findImpacts(float timestep);
+			void stopAtImpacts();
+			void findPairs(float timestep);
+			void findContacts();
+			void prepareContacts(float timestep);
+			void solveContacts();
+			void wakeTouchedIslands();
+			void updateSleep(float timestep);
+			void collectAwakeBodies();
 	};
 }
 
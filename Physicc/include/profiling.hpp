@@ -0,0 +1,27 @@
+#ifndef __PROFILING_H__
+#define __PROFILING_H__
+
+#include "tools/Tracy.hpp"
+
+/**
+ * Profiling zones come in two tiers.
+ *
+ * PHYSICC_ZONE_COARSE marks whole phases of work (building a tree, a
+ * broadphase pass, a simulation step) and is on whenever Tracy is.
+ *
+ * PHYSICC_ZONE_FINE marks small functions that run many times per phase:
+ * accessors, per body updates, the recursive steps of a build. Opening a zone
+ * costs far more than most of these functions do, so fine zones are compiled
+ * out unless PHYSICC_PROFILE_FINE is defined, see the PHYSICC_FINE_ZONE_CONFIGS
+ * CMake option.
+ */
+
+#define PHYSICC_ZONE_COARSE ZoneScoped
+
+#ifdef PHYSICC_PROFILE_FINE
+	#define PHYSICC_ZONE_FINE ZoneScoped
+#else
+	#define PHYSICC_ZONE_FINE
+#endif
+
+#endif //__PROFILING_H__
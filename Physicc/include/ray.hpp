@@ -0,0 +1,107 @@
+#ifndef __RAY_H__
+#define __RAY_H__
+
+#include "boundingvolume.hpp"
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <limits>
+
+namespace Physicc
+{
+	/**
+	 * @brief A ray (or segment) for scene queries
+	 *
+	 * The points on the ray are origin + t * direction for t >= 0. The
+	 * direction does not have to be normalized: a segment from a to b is just
+	 * Ray(a, b - a) with t limited to [0, 1].
+	 */
+	struct Ray
+	{
+		Ray(const glm::vec3& origin, const glm::vec3& direction)
+			: origin(origin), direction(direction), inverseDirection(1.0f / direction)
+		{
+		}
+		//Components of inverseDirection are infinite for axis parallel
+		//rays. The slab test below checks those axes on their own, as a
+		//ray starting on a slab's plane would get 0 * inf = NaN.
+
+		[[nodiscard]] inline bool isAxisParallel() const
+		{
+			return direction.x == 0.0f || direction.y == 0.0f || direction.z == 0.0f;
+		}
+
+		[[nodiscard]] inline glm::vec3 at(float t) const
+		{
+			return origin + t * direction;
+		}
+
+		/**
+		 * @brief Slab test against an AABB
+		 *
+		 * @param box The AABB to test against
+		 * @param tMax Hits beyond this parameter are ignored
+		 * @param tEntry Set to the parameter at which the ray enters the
+		 * box (0 if the origin is inside the box) if there is a hit
+		 * @param extent The box is grown by this much on every side first.
+		 * Testing a grown box against the ray is the same as sweeping a box
+		 * with these half extents along the ray against the original one.
+		 * @return true if the ray hits the box between 0 and tMax
+		 */
+		[[nodiscard]] inline bool intersects(const BoundingVolume::AABB& box,
+		                                     float tMax,
+		                                     float& tEntry,
+		                                     const glm::vec3& extent = glm::vec3(0)) const
+		{
+			glm::vec3 lowerBound = box.getLowerBound() - extent;
+			glm::vec3 upperBound = box.getUpperBound() + extent;
+
+			glm::vec3 t1 = (lowerBound - origin) * inverseDirection;
+			glm::vec3 t2 = (upperBound - origin) * inverseDirection;
+
+			glm::vec3 tNear = glm::min(t1, t2);
+			glm::vec3 tFar = glm::max(t1, t2);
+
+			if (isAxisParallel())
+			{
+				//Along an axis the ray does not move along, it is either
+				//always inside the slab (touching counts, like for
+				//overlapsWith()) or never
+				glm::bvec3 parallel = glm::equal(direction, glm::vec3(0.0f));
+				glm::bvec3 outside = glm::greaterThan(glm::max(lowerBound - origin, origin - upperBound), glm::vec3(0.0f));
+
+				if (glm::any(parallel && outside))
+				{
+					return false;
+				}
+
+				tNear = glm::mix(tNear, glm::vec3(-std::numeric_limits<float>::infinity()), parallel);
+				tFar = glm::mix(tFar, glm::vec3(std::numeric_limits<float>::infinity()), parallel);
+			}
+
+			float entry = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+			float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, tMax));
+
+			tEntry = entry;
+
+			return entry <= exit;
+		}
+
+		glm::vec3 origin;
+		glm::vec3 direction;
+		glm::vec3 inverseDirection;
+	};
+
+	/**
+	 * @brief Result of a raycast
+	 */
+	struct RaycastHit
+	{
+		std::uint32_t bodyIndex;
+		float t;
+		//the hit point is ray.at(t)
+	};
+}
+
+#endif //__RAY_H__
@@ -1,10 +1,13 @@
 #ifndef __RIGIDBODY_H__
 #define __RIGIDBODY_H__
 
-#include "tools/Tracy.hpp"
+#include "profiling.hpp"
 
 #include "glm/glm.hpp"
 #include "collider.hpp"
+#include "trianglemesh.hpp"
+
+#include <variant>
 
 namespace Physicc
 {
@@ -12,15 +15,27 @@ namespace Physicc
 	 * @brief Rigid Body Class
 	 *
 	 * This class describes and propagates the properties of each Rigid Body.
+	 *
+	 * The body's collider is kept by value, as whichever shape it is. Once
+	 * the body is added to a PhysicsWorld, the world moves the collider into
+	 * its array of colliders of that shape.
 	 */
 	class RigidBody
 	{
 		public:
-			RigidBody(float mass, const glm::vec3& velocity, float gravityScale);
+			/**
+			 * @brief Construct a new RigidBody
+			 *
+			 * @param mass Mass of the body. A mass of 0 makes the body
+			 * static: forces and gravity do not move it.
+			 * @param velocity Initial velocity
+			 * @param gravityScale How strongly gravity acts on the body
+			 */
+			RigidBody(float mass, const glm::vec3& velocity, float gravityScale = 1.0f);
 
 			[[nodiscard]] inline glm::vec3 getVelocity() const
 			{
-				ZoneScoped;
+				PHYSICC_ZONE_FINE;
 
 				return m_velocity;
 			}
@@ -28,39 +43,164 @@ namespace Physicc
 			
             inline void setVelocity(const glm::vec3& velocity)
 			{
-				ZoneScoped;
+				PHYSICC_ZONE_FINE;
 
 				m_velocity = velocity;
 			}
 
+			[[nodiscard]] inline float getGravityScale() const
+			{
+				return m_gravityScale;
+			}
+
 			inline void setGravityScale(const float gravityScale)
 			{
-				ZoneScoped;
+				PHYSICC_ZONE_FINE;
 
 				m_gravityScale = gravityScale;
 
 			}
 
-			void setForce();
+			[[nodiscard]] inline glm::vec3 getForce() const
+			{
+				return m_force;
+			}
+
+			/**
+			 * @brief Set the force that acts on the body every step, on top
+			 * of gravity
+			 */
+			inline void setForce(const glm::vec3& force)
+			{
+				m_force = force;
+			}
+
+			[[nodiscard]] inline float getMass() const
+			{
+				return m_mass;
+			}
+
+			[[nodiscard]] inline float getInverseMass() const
+			{
+				return m_mass > 0.0f ? 1.0f / m_mass : 0.0f;
+			}
+
+			[[nodiscard]] inline float getFriction() const
+			{
+				return m_friction;
+			}
+
+			/**
+			 * @brief Set the body's coefficient of friction
+			 *
+			 * The friction between two bodies is the geometric mean of
+			 * theirs.
+			 */
+			inline void setFriction(float friction)
+			{
+				m_friction = friction;
+			}
+
+			[[nodiscard]] inline float getRestitution() const
+			{
+				return m_restitution;
+			}
+
+			/**
+			 * @brief Set how bouncy the body is, from 0 (not at all) to 1
+			 * (perfectly elastic)
+			 *
+			 * The bouncier of two colliding bodies decides how much they
+			 * bounce off each other.
+			 */
+			inline void setRestitution(float restitution)
+			{
+				m_restitution = restitution;
+			}
+
+			[[nodiscard]] inline glm::vec3 getPosition() const
+			{
+				return getCollider().getCentroid();
+			}
+
+			inline void setPosition(const glm::vec3& position)
+			{
+				Collider& collider = getMutableCollider();
+
+				collider.setPosition(position);
+				collider.updateTransform();
+			}
+
+			/**
+			 * @brief Set the shape of the body
+			 *
+			 * The body starts out as a unit box at the origin.
+			 */
+			inline void setCollider(const BoxCollider& collider)
+			{
+				m_collider = collider;
+			}
+
+			inline void setCollider(const SphereCollider& collider)
+			{
+				m_collider = collider;
+			}
+
+			inline void setCollider(const ConvexHullCollider& collider)
+			{
+				m_collider = collider;
+			}
+
+			inline void setCollider(const CompoundCollider& collider)
+			{
+				m_collider = collider;
+			}
+
+			inline void setCollider(const TriangleMeshCollider& collider)
+			{
+				m_collider = collider;
+			}
+
+			[[nodiscard]] inline const Collider& getCollider() const
+			{
+				return std::visit([](const auto& collider) -> const Collider& {
+					return collider;
+				}, m_collider);
+			}
 
 			[[nodiscard]] inline BoundingVolume::AABB getAABB() const
 			{
-				ZoneScoped;
+				PHYSICC_ZONE_FINE;
 
-				return m_collider.getAABB();
+				return getCollider().getAABB();
 			}
 
 			[[nodiscard]] inline glm::vec3 getCentroid() const
 			{
-				return m_collider.getCentroid();
+				return getCollider().getCentroid();
 			}
 
 		private:
+			typedef std::variant<BoxCollider,
+			                     SphereCollider,
+			                     ConvexHullCollider,
+			                     CompoundCollider,
+			                     TriangleMeshCollider> ColliderVariant;
+
 			glm::vec3 m_force;
-			BoxCollider m_collider;
+			ColliderVariant m_collider;
 			float m_mass;
 			glm::vec3 m_velocity;
 			float m_gravityScale;
+			float m_friction = 0.5f;
+			float m_restitution = 0.0f;
+
+			[[nodiscard]] inline Collider& getMutableCollider()
+			{
+				return std::visit([](auto& collider) -> Collider& {
+					return collider;
+				}, m_collider);
+			}
 
 			friend class PhysicsWorld;
 			//PhysicsWorld needs to have access to all of RigidBody's private
@@ -0,0 +1,46 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+//Detects which SIMD instruction sets the compiler targets, for the few hot
+//loops that are written with intrinsics. Everything using these macros must
+//also have a plain C++ path for when neither is defined.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define PHYSICC_SSE2
+#endif
+
+#if defined(__AVX__)
+	#define PHYSICC_AVX
+#endif
+
+#if defined(PHYSICC_SSE2) || defined(PHYSICC_AVX)
+	#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+namespace Physicc
+{
+	/**
+	 * @brief Index of the lowest set bit
+	 *
+	 * Used to walk over the lanes set in a SIMD comparison mask.
+	 *
+	 * @param mask Must not be 0
+	 */
+	inline unsigned int countTrailingZeros(unsigned int mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+
+		return static_cast<unsigned int>(index);
+#else
+		return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+	}
+}
+
+#endif //__SIMD_H__
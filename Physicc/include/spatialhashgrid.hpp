@@ -0,0 +1,102 @@
+#ifndef __SPATIALHASHGRID_H__
+#define __SPATIALHASHGRID_H__
+
+#include "broadphase.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace Physicc
+{
+	/**
+	 * @brief Broadphase that buckets bodies into the cells of a uniform grid
+	 *
+	 * Space is divided into cubic cells, and every body is put into each
+	 * cell its AABB touches. Only bodies sharing a cell can overlap. The
+	 * (unbounded) grid is stored as a hash table from cell coordinates to
+	 * the list of bodies in the cell, rebuilt from scratch every step.
+	 *
+	 * Works best when bodies are about the same size, like the particles of
+	 * a granular or fluid simulation, and are spread out evenly. Bodies much
+	 * bigger than a cell (a floor, say) would land in too many cells, and
+	 * are tested against every other body instead.
+	 */
+	class SpatialHashGrid : public Broadphase
+	{
+		public:
+			/**
+			 * @param cellSize Edge length of the cells. If it is not
+			 * positive, the grid picks one every step, based on the size of
+			 * the bodies.
+			 */
+			SpatialHashGrid(float cellSize = 0.0f);
+
+			void addBody(const BoundingVolume::AABB& volume, bool isStatic) override;
+			void update(const std::vector<BoundingVolume::AABB>& volumes,
+			            const std::vector<glm::vec3>& velocities,
+			            float timestep,
+			            JobSystem& jobSystem) override;
+			void findPairs(const std::vector<BoundingVolume::AABB>& volumes,
+			               std::vector<BodyPair>& pairs,
+			               JobSystem& jobSystem) override;
+
+		private:
+			struct CellRange
+			{
+				glm::ivec3 min;
+				glm::ivec3 max;
+			};
+			//the cells a body touches, inclusive
+
+			struct Slot
+			{
+				glm::ivec3 cell;
+				std::uint32_t start;
+				//index of the cell's first body in m_cellBodies
+
+				std::uint32_t count;
+				//number of bodies in the cell, 0 for empty slots
+			};
+
+			struct Entry
+			{
+				std::uint32_t slot;
+				std::uint32_t body;
+			};
+			//a body in a cell
+
+			static constexpr int s_maxCellsPerBody = 64;
+			//bodies touching more cells than this are oversized
+
+			static constexpr float s_autoCellSizeFactor = 2.0f;
+			//automatic cell size, relative to the average body size
+
+			static constexpr std::size_t s_grainSize = 1024;
+			//slots per chunk of the pair search
+
+			float m_cellSize;
+			float m_currentCellSize;
+
+			std::vector<bool> m_isStatic;
+			std::vector<CellRange> m_ranges;
+			std::vector<std::uint32_t> m_oversized;
+
+			std::vector<Slot> m_slots;
+			//open addressing hash table with linear probing, its size is a
+			//power of two
+
+			std::vector<Entry> m_entries;
+			std::vector<std::uint32_t> m_cellBodies;
+			//the bodies in every cell, in body order, cell after cell
+
+			std::vector<std::vector<BodyPair>> m_chunkPairs;
+
+			[[nodiscard]] glm::ivec3 getCell(const glm::vec3& point) const;
+			[[nodiscard]] std::uint32_t findSlot(const glm::ivec3& cell) const;
+
+			template <typename Function>
+			static void forEachCell(const CellRange& range, Function&& function);
+	};
+}
+
+#endif //__SPATIALHASHGRID_H__
@@ -0,0 +1,88 @@
+#ifndef __SWEEPANDPRUNE_H__
+#define __SWEEPANDPRUNE_H__
+
+#include "broadphase.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Physicc
+{
+	/**
+	 * @brief Sort and sweep broadphase
+	 *
+	 * Keeps the lower and upper ends of every body's AABB along each axis in
+	 * a sorted list of endpoints. Between steps, bodies only move a little
+	 * relative to each other, so the lists are nearly sorted already, and
+	 * insertion sort puts them back in order in close to linear time.
+	 *
+	 * Pairs are found by sweeping along the axis over which the bodies are
+	 * spread out the most, keeping a list of the bodies whose interval along
+	 * it is open: a body whose interval opens overlaps the open ones along
+	 * the sweep axis, and only those need testing along the other two.
+	 *
+	 * Scenes where many bodies move a long way every step make the sort
+	 * expensive, use another Broadphase for those.
+	 */
+	class SweepAndPrune : public Broadphase
+	{
+		public:
+			void addBody(const BoundingVolume::AABB& volume, bool isStatic) override;
+			void update(const std::vector<BoundingVolume::AABB>& volumes,
+			            const std::vector<glm::vec3>& velocities,
+			            float timestep,
+			            JobSystem& jobSystem) override;
+			void findPairs(const std::vector<BoundingVolume::AABB>& volumes,
+			               std::vector<BodyPair>& pairs,
+			               JobSystem& jobSystem) override;
+
+		private:
+			struct Endpoint
+			{
+				float value;
+				std::uint32_t data;
+				//body index in the lower 31 bits, the top bit is set for
+				//upper ends
+
+				[[nodiscard]] inline std::uint32_t getBody() const
+				{
+					return data & ~s_upperBit;
+				}
+
+				[[nodiscard]] inline bool isUpper() const
+				{
+					return data & s_upperBit;
+				}
+
+				[[nodiscard]] inline bool operator<(const Endpoint& other) const
+				{
+					//Lower ends go first on ties, so that AABBs that only
+					//touch count as overlapping, like in overlapsWith()
+					return value < other.value
+						|| (value == other.value && !isUpper() && other.isUpper());
+				}
+			};
+
+			static constexpr std::uint32_t s_upperBit = 1u << 31;
+
+			std::array<std::vector<Endpoint>, 3> m_endpoints;
+			//one sorted list per axis
+
+			std::vector<bool> m_isStatic;
+			int m_sweepAxis = 0;
+
+			bool m_needsFullSort = false;
+			//set when bodies are added, whose endpoints may have to move
+			//far from the end of the lists where they start out
+
+			std::vector<std::uint32_t> m_open;
+			std::vector<std::uint32_t> m_openSlot;
+			//bodies whose interval is open during the sweep, and where in
+			//m_open each of them is
+
+			static void insertionSort(std::vector<Endpoint>& endpoints);
+	};
+}
+
+#endif //__SWEEPANDPRUNE_H__
@@ -0,0 +1,63 @@
+#ifndef __TRAVERSALSTACK_H__
+#define __TRAVERSALSTACK_H__
+
+#include <cstddef>
+#include <vector>
+
+namespace Physicc
+{
+	/**
+	 * @brief Stack used by the tree traversals
+	 *
+	 * Lives on the (call) stack for the first N elements, and only falls back
+	 * to the heap if a tree turns out to be deeper than that, so a query does
+	 * not allocate in the common case.
+	 *
+	 * @tparam T Type of the elements (usually node indices)
+	 * @tparam N Number of elements stored without allocating
+	 */
+	template <typename T, std::size_t N = 64>
+	class TraversalStack
+	{
+		public:
+			inline void push(const T& element)
+			{
+				if (m_size < N)
+				{
+					m_array[m_size] = element;
+				} else
+				{
+					m_overflow.push_back(element);
+				}
+
+				m_size++;
+			}
+
+			inline T pop()
+			{
+				m_size--;
+
+				if (m_size < N)
+				{
+					return m_array[m_size];
+				}
+
+				T element = m_overflow.back();
+				m_overflow.pop_back();
+
+				return element;
+			}
+
+			[[nodiscard]] inline bool empty() const
+			{
+				return m_size == 0;
+			}
+
+		private:
+			T m_array[N];
+			std::vector<T> m_overflow;
+			std::size_t m_size = 0;
+	};
+}
+
+#endif //__TRAVERSALSTACK_H__
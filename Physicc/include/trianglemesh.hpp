@@ -0,0 +1,409 @@
+#ifndef __TRIANGLEMESH_H__
+#define __TRIANGLEMESH_H__
+
+#include "collider.hpp"
+#include "ray.hpp"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace Physicc
+{
+	/**
+	 * @brief A single triangle of a TriangleMeshCollider, in world space
+	 *
+	 * Has just enough of a collider's interface (getSupport() and
+	 * getCentroid()) for the GJK based tests to treat it as a convex shape.
+	 */
+	struct Triangle
+	{
+		std::array<glm::vec3, 3> vertices;
+
+		[[nodiscard]] inline glm::vec3 getCentroid() const
+		{
+			return (vertices[0] + vertices[1] + vertices[2]) / 3.0f;
+		}
+
+		/**
+		 * @brief get the normal of the triangle, as given by the winding of
+		 * its vertices, not normalized
+		 */
+		[[nodiscard]] inline glm::vec3 getNormal() const
+		{
+			return glm::cross(vertices[1] - vertices[0], vertices[2] - vertices[0]);
+		}
+
+		[[nodiscard]] inline glm::vec3 getSupport(const glm::vec3& direction) const
+		{
+			float distances[3] = {glm::dot(vertices[0], direction),
+			                      glm::dot(vertices[1], direction),
+			                      glm::dot(vertices[2], direction)};
+			int best = distances[1] > distances[0] ? 1 : 0;
+
+			return vertices[distances[2] > distances[best] ? 2 : best];
+		}
+
+		/**
+		 * @brief Find the point of the triangle closest to a point
+		 */
+		[[nodiscard]] glm::vec3 getClosestPoint(const glm::vec3& point) const;
+
+		/**
+		 * @brief Intersect a ray with the triangle, from either side
+		 *
+		 * @param ray The ray to cast
+		 * @param tMax Hits beyond ray.at(tMax) are ignored
+		 * @param t Set to where the ray hits the triangle, if it does
+		 * @return true if the ray hits the triangle between 0 and tMax
+		 */
+		[[nodiscard]] bool intersects(const Ray& ray, float tMax, float& t) const;
+
+		/**
+		 * @brief Separating axis test against an oriented box
+		 *
+		 * Tries the triangle's normal, the box's 3 face normals and the 9
+		 * cross products of their edges.
+		 *
+		 * @param center Center of the box
+		 * @param axes Columns are the box's local axes
+		 * @param halfExtents Half the box's size along its axes
+		 * @param normal Set to the axis along which the two overlap the
+		 * least, pointing from the triangle towards the box. The triangle's
+		 * normal is preferred unless another axis is noticeably better.
+		 * @param depth Set to how far they overlap along it
+		 * @return true if they overlap
+		 */
+		[[nodiscard]] bool findBoxPenetration(const glm::vec3& center,
+		                                      const glm::mat3& axes,
+		                                      const glm::vec3& halfExtents,
+		                                      glm::vec3& normal,
+		                                      float& depth) const;
+	};
+
+	/**
+	 * @brief Where a ray hit a TriangleMeshCollider
+	 */
+	struct TriangleHit
+	{
+		std::uint32_t triangle;
+		float t;
+		//the hit point is ray.at(t)
+
+		glm::vec3 normal;
+		//unit normal of the triangle, facing the ray's origin
+	};
+
+	/**
+	 * @brief TriangleMeshCollider class
+	 *
+	 * Collider for static level geometry: any triangle soup, not
+	 * necessarily closed or convex, taking the same vertex and index lists
+	 * that a Light::Mesh is made from (see Light::Mesh::getVertices() and
+	 * getIndices()). Meant for bodies with a mass of 0, as the mesh has no
+	 * volume to speak of.
+	 *
+	 * The triangles are kept in a BVH whose node bounds are quantized to 16
+	 * bits per coordinate, relative to the bounds of the whole mesh, which
+	 * makes a node 16 bytes. Bounds are rounded outwards, so the tree is
+	 * conservative. A built mesh never changes, is shared by all the copies
+	 * of the collider, and can be saved to a buffer with save() and loaded
+	 * back with load() without rebuilding the tree, e.g. by an offline
+	 * build step.
+	 *
+	 * Triangles are in local space around the collider's position. The
+	 * collider can be rotated, but not scaled: bake the scale into the
+	 * vertices instead.
+	 */
+	class TriangleMeshCollider : public Collider
+	{
+		public:
+			/**
+			 * @brief Build a mesh collider
+			 *
+			 * Takes as long as a BVH build over the triangles, which is
+			 * worth doing offline for large meshes (see save()).
+			 *
+			 * @param vertices Vertex positions in local space
+			 * @param indices Three indices into vertices per triangle. At
+			 * most 2^28 triangles.
+			 */
+			TriangleMeshCollider(const std::vector<glm::vec3>& vertices,
+			                     const std::vector<unsigned int>& indices,
+			                     glm::vec3 position = glm::vec3(0),
+			                     glm::vec3 rotation = glm::vec3(0));
+
+			/**
+			 * @brief Write out the mesh and its tree
+			 *
+			 * The layout is a small header followed by the vertex, index and
+			 * node arrays as they are in memory, so loading it is a few
+			 * copies. Numbers are written in the byte order of the machine
+			 * that saves the mesh.
+			 *
+			 * @param data Output buffer, cleared first
+			 */
+			void save(std::vector<std::uint8_t>& data) const;
+
+			/**
+			 * @brief Load a mesh written by save()
+			 *
+			 * @param data The saved bytes
+			 * @param size Number of bytes
+			 * @return The collider, or nothing if the data is not a saved
+			 * mesh (of this version)
+			 */
+			[[nodiscard]] static std::optional<TriangleMeshCollider> load(const std::uint8_t* data,
+			                                                              std::size_t size,
+			                                                              glm::vec3 position = glm::vec3(0),
+			                                                              glm::vec3 rotation = glm::vec3(0));
+
+			[[nodiscard]] inline std::size_t getTriangleCount() const
+			{
+				return m_mesh->indices.size() / 3;
+			}
+
+			/**
+			 * @brief get a triangle, in world space as of the last
+			 * updateTransform()
+			 *
+			 * @param index Index of the triangle. Triangles are reordered
+			 * while building the tree, so this is not its index in the list
+			 * the collider was built from.
+			 */
+			[[nodiscard]] inline Triangle getTriangle(std::size_t index) const
+			{
+				const std::uint32_t* indices = &m_mesh->indices[3 * index];
+				const std::vector<glm::vec3>& vertices = m_mesh->vertices;
+
+				return {{m_position + m_rotation * vertices[indices[0]],
+				         m_position + m_rotation * vertices[indices[1]],
+				         m_position + m_rotation * vertices[indices[2]]}};
+			}
+
+			[[nodiscard]] glm::vec3 getSupport(const glm::vec3& direction) const;
+
+			/**
+			 * @brief Report every triangle whose AABB overlaps a region
+			 *
+			 * The region is moved into the mesh's local space, where the tree
+			 * is, and grows to fit its rotated self there.
+			 *
+			 * @param region The region to test against, in world space
+			 * @param callback Called as callback(triangleIndex) for every
+			 * triangle found. Returning false from it ends the query.
+			 */
+			template <typename Callback>
+			void queryTriangles(const BoundingVolume::AABB& region, Callback&& callback) const
+			{
+				PHYSICC_ZONE_FINE;
+
+				const Mesh& mesh = *m_mesh;
+
+				glm::mat3 inverseRotation = glm::transpose(m_rotation);
+				glm::mat3 absInverseRotation(glm::abs(inverseRotation[0]),
+				                             glm::abs(inverseRotation[1]),
+				                             glm::abs(inverseRotation[2]));
+
+				glm::vec3 center = inverseRotation * (region.getCenter() - m_position);
+				glm::vec3 extents = absInverseRotation
+					* (0.5f * (region.getUpperBound() - region.getLowerBound()));
+				BoundingVolume::AABB localRegion(center - extents, center + extents);
+
+				if (mesh.nodes.empty() || !localRegion.overlapsWith(mesh.bounds))
+				{
+					return;
+				}
+
+				QuantizedBounds quantized = quantize(mesh, localRegion);
+				TraversalStack<std::uint32_t> stack;
+				stack.push(0);
+
+				while (!stack.empty())
+				{
+					std::uint32_t index = stack.pop();
+					const Node& node = mesh.nodes[index];
+
+					if (!node.overlapsWith(quantized))
+					{
+						continue;
+					}
+
+					if (!node.isLeaf())
+					{
+						stack.push(node.getSecondChild());
+						stack.push(index + 1);
+
+						continue;
+					}
+
+					for (std::uint32_t i = node.getFirstTriangle(); i != node.getFirstTriangle() + node.getTriangleCount(); i++)
+					{
+						const std::uint32_t* indices = &mesh.indices[3 * i];
+						const glm::vec3& a = mesh.vertices[indices[0]];
+						const glm::vec3& b = mesh.vertices[indices[1]];
+						const glm::vec3& c = mesh.vertices[indices[2]];
+						BoundingVolume::AABB bounds(glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c)));
+
+						if (bounds.overlapsWith(localRegion) && !callback(i))
+						{
+							return;
+						}
+					}
+				}
+			}
+
+			/**
+			 * @brief Find all triangles touching a sphere
+			 *
+			 * @param center Center of the sphere, in world space
+			 * @param radius Radius of the sphere
+			 * @param triangles Output list of triangle indices. Cleared
+			 * first, but keeps its capacity.
+			 */
+			void querySphere(const glm::vec3& center,
+			                 float radius,
+			                 std::vector<std::uint32_t>& triangles) const;
+
+			/**
+			 * @brief Find all triangles touching an oriented box
+			 *
+			 * @param center Center of the box, in world space
+			 * @param axes Columns are the box's local axes
+			 * @param halfExtents Half the box's size along its axes
+			 * @param triangles Output list of triangle indices. Cleared
+			 * first, but keeps its capacity.
+			 */
+			void queryBox(const glm::vec3& center,
+			              const glm::mat3& axes,
+			              const glm::vec3& halfExtents,
+			              std::vector<std::uint32_t>& triangles) const;
+
+			/**
+			 * @brief Find the first triangle hit by a ray
+			 *
+			 * Visits the nearer child of every node first, and skips nodes
+			 * further away than the closest hit so far.
+			 *
+			 * @param ray The ray to cast, in world space
+			 * @param tMax Hits beyond ray.at(tMax) are ignored
+			 * @return The nearest hit, if any
+			 */
+			[[nodiscard]] std::optional<TriangleHit> raycast(const Ray& ray,
+				float tMax = std::numeric_limits<float>::infinity()) const;
+
+		private:
+			/**
+			 * @brief A node's bounds, in steps of the mesh's quantization grid
+			 */
+			struct QuantizedBounds
+			{
+				std::array<std::uint16_t, 3> lowerBound;
+				std::array<std::uint16_t, 3> upperBound;
+			};
+
+			/**
+			 * @brief A node of the quantized BVH
+			 *
+			 * Stored depth-first like a BVHNode, so the first child of an
+			 * interior node is the one right after it. The rest is packed
+			 * into one word: leaves hold a range of up to 8 triangles,
+			 * interior nodes the index of their second child.
+			 */
+			struct Node
+			{
+				QuantizedBounds bounds;
+				std::uint32_t data;
+
+				static constexpr std::uint32_t s_leafFlag = 1u << 31;
+				static constexpr std::uint32_t s_countShift = 28;
+				static constexpr std::uint32_t s_firstMask = (1u << s_countShift) - 1;
+
+				[[nodiscard]] inline bool isLeaf() const
+				{
+					return data & s_leafFlag;
+				}
+
+				[[nodiscard]] inline std::uint32_t getSecondChild() const
+				{
+					return data;
+				}
+
+				[[nodiscard]] inline std::uint32_t getFirstTriangle() const
+				{
+					return data & s_firstMask;
+				}
+
+				[[nodiscard]] inline std::uint32_t getTriangleCount() const
+				{
+					return ((data & ~s_leafFlag) >> s_countShift) + 1;
+				}
+
+				[[nodiscard]] inline bool overlapsWith(const QuantizedBounds& other) const
+				{
+					return bounds.lowerBound[0] <= other.upperBound[0] && bounds.upperBound[0] >= other.lowerBound[0]
+						&& bounds.lowerBound[1] <= other.upperBound[1] && bounds.upperBound[1] >= other.lowerBound[1]
+						&& bounds.lowerBound[2] <= other.upperBound[2] && bounds.upperBound[2] >= other.lowerBound[2];
+				}
+			};
+
+			static_assert(sizeof(Node) == 16, "TriangleMeshCollider::Node should be 16 bytes");
+
+			/**
+			 * @brief The part of a TriangleMeshCollider that does not depend
+			 * on where it is
+			 */
+			struct Mesh
+			{
+				std::vector<glm::vec3> vertices;
+
+				std::vector<std::uint32_t> indices;
+				//three per triangle, ordered so that each leaf owns a
+				//contiguous range of triangles
+
+				std::vector<Node> nodes;
+
+				BoundingVolume::AABB bounds;
+				//of all the vertices, in local space. The quantization grid
+				//spans it.
+
+				glm::vec3 quantizationScale;
+				//grid steps per unit of length, along each axis
+			};
+
+			static constexpr std::uint32_t s_maxLeafSize = 4;
+			static constexpr std::size_t s_binCount = 16;
+
+			std::shared_ptr<const Mesh> m_mesh;
+
+			TriangleMeshCollider(std::shared_ptr<const Mesh> mesh, glm::vec3 position, glm::vec3 rotation);
+
+			static std::shared_ptr<const Mesh> buildMesh(const std::vector<glm::vec3>& vertices,
+			                                             const std::vector<unsigned int>& indices);
+
+			/**
+			 * @brief Round bounds in local space outwards onto the mesh's
+			 * grid
+			 */
+			[[nodiscard]] static QuantizedBounds quantize(const Mesh& mesh, const BoundingVolume::AABB& bounds);
+			[[nodiscard]] static BoundingVolume::AABB dequantize(const Mesh& mesh, const QuantizedBounds& bounds);
+
+			static void buildNode(Mesh& mesh,
+			                      const std::vector<BoundingVolume::AABB>& triangleBounds,
+			                      std::vector<std::uint32_t>& order,
+			                      std::size_t start,
+			                      std::size_t end);
+
+			[[nodiscard]] glm::vec3 computeExtents() const;
+			[[nodiscard]] glm::vec3 computeAABBOffset() const;
+			[[nodiscard]] float computeBoundingRadius() const;
+			[[nodiscard]] glm::vec3 computeOrientedHalfExtents() const;
+
+			friend class Collider;
+	};
+}
+
+#endif //__TRIANGLEMESH_H__
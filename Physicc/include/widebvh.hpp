@@ -0,0 +1,114 @@
+#ifndef __WIDEBVH_H__
+#define __WIDEBVH_H__
+
+#include "aabbarray.hpp"
+#include "bvh.hpp"
+#include "ray.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+namespace Physicc
+{
+	/**
+	 * @brief A node of a WideBVH
+	 *
+	 * Holds the AABBs of up to Width children in structure of arrays form, so
+	 * that all of them can be tested against a query with one set of SIMD
+	 * instructions.
+	 *
+	 * @tparam Width Maximum number of children
+	 */
+	template <std::size_t Width>
+	struct alignas(32) WideBVHNode
+	{
+		float minX[Width];
+		float minY[Width];
+		float minZ[Width];
+		float maxX[Width];
+		float maxY[Width];
+		float maxZ[Width];
+
+		std::uint32_t child[Width];
+		//leaf: index of the first body in the body index list
+		//interior node: index of the child node
+
+		std::uint16_t count[Width];
+		//number of bodies in a leaf, 0 for interior nodes
+
+		std::uint32_t childCount;
+		//number of slots in use. Slots are filled from the front.
+	};
+
+	/**
+	 * @brief A BVH with Width children per node
+	 *
+	 * Made by collapsing a (binary) BVH: every node takes over the children
+	 * of its biggest interior children until it has Width of them. The tree
+	 * is about log2(Width) times shallower, which means fewer nodes to visit
+	 * and fewer hard to predict branches in a traversal, and a node's
+	 * children are tested against a query all at once (with SSE for 4
+	 * children, and AVX for 8 if the compiler targets it).
+	 *
+	 * The tree does not follow its source when that is refit or rebuilt, it
+	 * has to be collapsed again.
+	 *
+	 * @tparam Width Number of children per node, 4 or 8
+	 */
+	template <std::size_t Width>
+	class WideBVH
+	{
+		static_assert(Width == 4 || Width == 8, "WideBVH supports 4 and 8 wide nodes");
+
+		public:
+			/**
+			 * @brief Collapse a BVH into a wide one
+			 *
+			 * @param bvh A built BVH. Body indices reported by queries refer
+			 * to the same list as the ones in this BVH do.
+			 */
+			WideBVH(const BVH& bvh);
+
+			[[nodiscard]] inline const std::vector<WideBVHNode<Width>>& getNodes() const
+			{
+				return m_nodes;
+			}
+
+			/**
+			 * @brief See BVH::raycast()
+			 */
+			[[nodiscard]] std::optional<RaycastHit> raycast(const Ray& ray,
+				float tMax = std::numeric_limits<float>::infinity()) const;
+
+			/**
+			 * @brief See BVH::raycastAny()
+			 */
+			[[nodiscard]] bool raycastAny(const Ray& ray,
+				float tMax = std::numeric_limits<float>::infinity()) const;
+
+			/**
+			 * @brief See BVH::queryRegion()
+			 */
+			void queryRegion(const BoundingVolume::AABB& region,
+			                 std::vector<std::uint32_t>& bodies) const;
+
+		private:
+			std::vector<WideBVHNode<Width>> m_nodes;
+			std::vector<std::uint32_t> m_bodyIndices;
+			AABBArray m_bodyVolumes;
+			//body AABBs in the same order as m_bodyIndices, so that the
+			//bodies of a leaf are next to each other in memory
+
+			std::uint32_t collapse(const std::vector<BVHNode>& nodes, std::uint32_t root);
+
+			template <typename Callback>
+			void raycast(const Ray& ray, float tMax, Callback&& callback) const;
+	};
+
+	typedef WideBVH<4> QBVH;
+	typedef WideBVH<8> OBVH;
+}
+
+#endif //__WIDEBVH_H__
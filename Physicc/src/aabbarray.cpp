@@ -0,0 +1,221 @@
+#include "profiling.hpp"
+/**
+ * @file aabbarray.cpp
+ * @brief Structure of arrays AABB storage with batched overlap tests.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* aabbarray header */
+
+#include "aabbarray.hpp"
+
+#include "simd.hpp"
+
+#include <algorithm>
+
+namespace Physicc
+{
+	AABBArray::AABBArray(const std::vector<BoundingVolume::AABB>& boxes)
+	{
+		resize(boxes.size());
+
+		for (std::size_t i = 0; i != boxes.size(); i++)
+		{
+			set(i, boxes[i]);
+		}
+	}
+
+	void AABBArray::clear()
+	{
+		resize(0);
+	}
+
+	void AABBArray::reserve(std::size_t capacity)
+	{
+		std::size_t padded = (capacity + s_blockSize - 1) / s_blockSize * s_blockSize;
+
+		for (auto array : {&m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY, &m_maxZ})
+		{
+			array->reserve(padded);
+		}
+	}
+
+	void AABBArray::resize(std::size_t size)
+	{
+		std::size_t padded = (size + s_blockSize - 1) / s_blockSize * s_blockSize;
+
+		//Boxes past the end (new ones, and those left behind by shrinking)
+		//are inverted, so that they never overlap anything
+		constexpr float infinity = std::numeric_limits<float>::infinity();
+
+		for (auto array : {&m_minX, &m_minY, &m_minZ})
+		{
+			array->resize(padded, infinity);
+			std::fill(std::next(array->begin(), static_cast<std::ptrdiff_t>(std::min(size, m_size))),
+			          array->end(),
+			          infinity);
+		}
+
+		for (auto array : {&m_maxX, &m_maxY, &m_maxZ})
+		{
+			array->resize(padded, -infinity);
+			std::fill(std::next(array->begin(), static_cast<std::ptrdiff_t>(std::min(size, m_size))),
+			          array->end(),
+			          -infinity);
+		}
+
+		m_size = size;
+	}
+
+	void AABBArray::push_back(const BoundingVolume::AABB& box)
+	{
+		resize(m_size + 1);
+		set(m_size - 1, box);
+	}
+
+	void AABBArray::set(std::size_t index, const BoundingVolume::AABB& box)
+	{
+		m_minX[index] = box.getLowerBound().x;
+		m_minY[index] = box.getLowerBound().y;
+		m_minZ[index] = box.getLowerBound().z;
+		m_maxX[index] = box.getUpperBound().x;
+		m_maxY[index] = box.getUpperBound().y;
+		m_maxZ[index] = box.getUpperBound().z;
+	}
+
+	BoundingVolume::AABB AABBArray::operator[](std::size_t index) const
+	{
+		return {{m_minX[index], m_minY[index], m_minZ[index]},
+		        {m_maxX[index], m_maxY[index], m_maxZ[index]}};
+	}
+
+	unsigned int AABBArray::overlapMask(std::size_t block,
+	                                    const glm::vec3& lowerBound,
+	                                    const glm::vec3& upperBound) const
+	{
+#if defined(PHYSICC_AVX)
+		__m256 x = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&m_minX[block]), _mm256_set1_ps(upperBound.x), _CMP_LE_OQ),
+		                         _mm256_cmp_ps(_mm256_loadu_ps(&m_maxX[block]), _mm256_set1_ps(lowerBound.x), _CMP_GE_OQ));
+		__m256 y = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&m_minY[block]), _mm256_set1_ps(upperBound.y), _CMP_LE_OQ),
+		                         _mm256_cmp_ps(_mm256_loadu_ps(&m_maxY[block]), _mm256_set1_ps(lowerBound.y), _CMP_GE_OQ));
+		__m256 z = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&m_minZ[block]), _mm256_set1_ps(upperBound.z), _CMP_LE_OQ),
+		                         _mm256_cmp_ps(_mm256_loadu_ps(&m_maxZ[block]), _mm256_set1_ps(lowerBound.z), _CMP_GE_OQ));
+
+		return static_cast<unsigned int>(_mm256_movemask_ps(_mm256_and_ps(_mm256_and_ps(x, y), z)));
+#elif defined(PHYSICC_SSE2)
+		unsigned int mask = 0;
+
+		for (std::size_t half = 0; half != s_blockSize; half += 4)
+		{
+			std::size_t i = block + half;
+
+			__m128 x = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&m_minX[i]), _mm_set1_ps(upperBound.x)),
+			                      _mm_cmpge_ps(_mm_loadu_ps(&m_maxX[i]), _mm_set1_ps(lowerBound.x)));
+			__m128 y = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&m_minY[i]), _mm_set1_ps(upperBound.y)),
+			                      _mm_cmpge_ps(_mm_loadu_ps(&m_maxY[i]), _mm_set1_ps(lowerBound.y)));
+			__m128 z = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&m_minZ[i]), _mm_set1_ps(upperBound.z)),
+			                      _mm_cmpge_ps(_mm_loadu_ps(&m_maxZ[i]), _mm_set1_ps(lowerBound.z)));
+
+			mask |= static_cast<unsigned int>(_mm_movemask_ps(_mm_and_ps(_mm_and_ps(x, y), z))) << half;
+		}
+
+		return mask;
+#else
+		unsigned int mask = 0;
+
+		for (std::size_t lane = 0; lane != s_blockSize; lane++)
+		{
+			std::size_t i = block + lane;
+
+			bool overlaps = m_minX[i] <= upperBound.x && m_maxX[i] >= lowerBound.x
+				&& m_minY[i] <= upperBound.y && m_maxY[i] >= lowerBound.y
+				&& m_minZ[i] <= upperBound.z && m_maxZ[i] >= lowerBound.z;
+
+			mask |= static_cast<unsigned int>(overlaps) << lane;
+		}
+
+		return mask;
+#endif
+	}
+
+	template <typename Callback>
+	void AABBArray::forEachOverlap(const BoundingVolume::AABB& box,
+	                               std::size_t start,
+	                               std::size_t end,
+	                               Callback&& callback) const
+	{
+		end = std::min(end, m_size);
+
+		if (start >= end)
+		{
+			return;
+		}
+
+		const glm::vec3& lowerBound = box.getLowerBound();
+		const glm::vec3& upperBound = box.getUpperBound();
+
+		for (std::size_t block = start / s_blockSize * s_blockSize; block < end; block += s_blockSize)
+		{
+			unsigned int mask = overlapMask(block, lowerBound, upperBound);
+
+			if (block < start)
+			{
+				mask &= ~0u << (start - block);
+			}
+
+			if (end - block < s_blockSize)
+			{
+				mask &= (1u << (end - block)) - 1;
+			}
+
+			for (; mask != 0; mask &= mask - 1)
+			{
+				callback(static_cast<std::uint32_t>(block + countTrailingZeros(mask)));
+			}
+		}
+	}
+
+	void AABBArray::queryOverlaps(const BoundingVolume::AABB& box,
+	                              std::vector<std::uint32_t>& indices,
+	                              std::size_t start,
+	                              std::size_t end) const
+	{
+		forEachOverlap(box, start, end, [&indices](std::uint32_t index) {
+			indices.push_back(index);
+		});
+	}
+
+	void AABBArray::queryPairs(std::vector<BodyPair>& pairs) const
+	{
+		PHYSICC_ZONE_COARSE;
+
+		pairs.clear();
+
+		for (std::size_t i = 0; i < m_size; i++)
+		{
+			auto first = static_cast<std::uint32_t>(i);
+
+			forEachOverlap((*this)[i], i + 1, m_size, [&pairs, first](std::uint32_t second) {
+				pairs.push_back({first, second});
+			});
+		}
+	}
+
+	void AABBArray::queryPairs(const AABBArray& other, std::vector<BodyPair>& pairs) const
+	{
+		PHYSICC_ZONE_COARSE;
+
+		pairs.clear();
+
+		for (std::size_t i = 0; i < m_size; i++)
+		{
+			auto first = static_cast<std::uint32_t>(i);
+
+			other.forEachOverlap((*this)[i], 0, other.m_size, [&pairs, first](std::uint32_t second) {
+				pairs.push_back({first, second});
+			});
+		}
+	}
+}
@@ -0,0 +1,154 @@
+#include "profiling.hpp"
+/**
+ * @file broadphase.cpp
+ * @brief Broadphases built on the BVHs.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* broadphase header */
+
+#include "broadphase.hpp"
+
+#include <algorithm>
+
+namespace Physicc
+{
+	DynamicBVHBroadphase::DynamicBVHBroadphase(float margin)
+		: m_tree(margin)
+	{
+	}
+
+	void DynamicBVHBroadphase::addBody(const BoundingVolume::AABB& volume, bool isStatic)
+	{
+		PHYSICC_ZONE_FINE;
+
+		m_proxies.push_back(m_tree.insert(volume, static_cast<std::uint32_t>(m_proxies.size())));
+		m_isStatic.push_back(isStatic);
+	}
+
+	void DynamicBVHBroadphase::update(const std::vector<BoundingVolume::AABB>& volumes,
+	                                  const std::vector<glm::vec3>& velocities,
+	                                  float timestep,
+	                                  JobSystem&)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		//The tree is updated on one thread, in body order, so that it ends
+		//up the same on every run. Most bodies stay inside their fat AABB,
+		//which makes this cheap.
+		for (std::size_t i = 0; i < m_proxies.size(); i++)
+		{
+			m_tree.update(m_proxies[i], volumes[i], velocities[i] * timestep);
+		}
+	}
+
+	void DynamicBVHBroadphase::findPairs(const std::vector<BoundingVolume::AABB>& volumes,
+	                                     std::vector<BodyPair>& pairs,
+	                                     JobSystem& jobSystem)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		std::size_t bodyCount = m_proxies.size();
+		m_chunkPairs.resize(JobSystem::chunkCount(bodyCount, s_grainSize));
+
+		//Every body looks for partners with a higher index, so each pair is
+		//found exactly once, by the chunk that owns its first body
+		jobSystem.parallelFor(bodyCount, s_grainSize, [&](std::size_t start, std::size_t end) {
+			std::vector<BodyPair>& chunkPairs = m_chunkPairs[start / s_grainSize];
+			chunkPairs.clear();
+
+			for (std::size_t i = start; i < end; i++)
+			{
+				const BoundingVolume::AABB& volume = volumes[i];
+				bool isStatic = m_isStatic[i];
+
+				m_tree.query(volume, [&](std::uint32_t proxy) {
+					std::uint32_t other = m_tree.getBodyIndex(proxy);
+
+					if (other > i
+					    && !(isStatic && m_isStatic[other])
+					    && volume.overlapsWith(volumes[other]))
+					{
+						chunkPairs.push_back({static_cast<std::uint32_t>(i), other});
+					}
+
+					return true;
+				});
+			}
+		});
+
+		pairs.clear();
+
+		for (const auto& chunkPairs : m_chunkPairs)
+		{
+			pairs.insert(pairs.end(), chunkPairs.begin(), chunkPairs.end());
+		}
+	}
+
+	BVHBroadphase::BVHBroadphase(BVH::SplitMethod splitMethod, unsigned int rebuildInterval)
+		:	m_splitMethod(splitMethod),
+			m_rebuildInterval(rebuildInterval),
+			m_stepsSinceBuild(0)
+	{
+	}
+
+	void BVHBroadphase::addBody(const BoundingVolume::AABB&, bool isStatic)
+	{
+		PHYSICC_ZONE_FINE;
+
+		m_isStatic.push_back(isStatic);
+		m_tree.reset();
+	}
+
+	void BVHBroadphase::update(const std::vector<BoundingVolume::AABB>& volumes,
+	                           const std::vector<glm::vec3>&,
+	                           float,
+	                           JobSystem& jobSystem)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		if (!m_tree || m_stepsSinceBuild >= m_rebuildInterval)
+		{
+			m_tree.emplace(volumes, m_splitMethod);
+			m_tree->buildTree(jobSystem);
+			m_stepsSinceBuild = 0;
+
+			return;
+		}
+
+		jobSystem.parallelFor(volumes.size(), s_grainSize, [&](std::size_t start, std::size_t end) {
+			for (std::size_t i = start; i < end; i++)
+			{
+				m_tree->updateVolume(i, volumes[i]);
+			}
+		});
+
+		m_tree->refit();
+		m_stepsSinceBuild++;
+	}
+
+	void BVHBroadphase::findPairs(const std::vector<BoundingVolume::AABB>&,
+	                              std::vector<BodyPair>& pairs,
+	                              JobSystem& jobSystem)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		pairs.clear();
+
+		if (!m_tree)
+		{
+			return;
+		}
+
+		//The BVH splits its pair query across the job system's threads,
+		//and puts the pairs in the order a single thread would find them
+		m_tree->queryPairsParallel(pairs, jobSystem);
+
+		pairs.erase(std::remove_if(pairs.begin(), pairs.end(), [this](const BodyPair& pair) {
+			            return m_isStatic[pair.first] && m_isStatic[pair.second];
+		            }),
+		            pairs.end());
+	}
+}
@@ -1,4 +1,4 @@
-#include "tools/Tracy.hpp"
+#include "profiling.hpp"
 /**
  * @file bvh.cpp
  * @brief Constructs a BVH given a list of RigidBody objects.
@@ -14,73 +14,220 @@
 
 #include <utility>
 #include <algorithm>
+#include <numeric>
+#include <limits>
+#include <future>
+#include <thread>
 
 namespace Physicc
 {
-	BVH::BVH(std::vector<RigidBody> rigidBodyList)
-		: 	m_head(nullptr),
-			m_rigidBodyList(std::move(rigidBodyList)) 
+	namespace
 	{
-	}
+		/**
+		 * @brief Split [0, count) into one chunk per thread and run
+		 * `function(start, end)` on every chunk in parallel
+		 *
+		 * The chunks run on the job system if there is one, and on threads
+		 * started for the purpose, one per hardware thread, otherwise. Runs
+		 * everything on the calling thread if count is too small for the
+		 * split to pay off.
+		 */
+		template <typename Function>
+		void parallelFor(JobSystem* jobSystem, std::size_t count, std::size_t threshold, Function&& function)
+		{
+			std::size_t threadCount = jobSystem
+				? jobSystem->getThreadCount()
+				: std::max(1u, std::thread::hardware_concurrency());
 
-	BoundingVolume::AABB BVH::computeBV(std::size_t start, std::size_t end)
-	{
-		ZoneScoped;
+			if (count < threshold || threadCount == 1)
+			{
+				function(std::size_t(0), count);
+				return;
+			}
 
-		BoundingVolume::AABB bv(m_rigidBodyList[start].getAABB());
+			std::size_t chunkSize = (count + threadCount - 1) / threadCount;
 
-		for (std::size_t i = start + 1; i != end; i++)
+			if (jobSystem)
+			{
+				jobSystem->parallelFor(count, chunkSize, function);
+				return;
+			}
+			std::vector<std::future<void>> tasks;
+			tasks.reserve(threadCount - 1);
+
+			for (std::size_t start = chunkSize; start < count; start += chunkSize)
+			{
+				tasks.push_back(std::async(std::launch::async,
+				                           function,
+				                           start,
+				                           std::min(start + chunkSize, count)));
+			}
+
+			function(std::size_t(0), std::min(chunkSize, count));
+
+			for (auto& task : tasks)
+			{
+				task.get();
+			}
+		}
+
+		//Spread the lower 10 bits of v out so that there are two zero bits
+		//between every pair of consecutive bits
+		inline std::uint32_t expandBits(std::uint32_t v)
 		{
-			bv = BoundingVolume::enclosingBV(bv, m_rigidBodyList[i].getAABB());
-			//TODO: Object slicing is might be happening here. Investigate.
+			v &= 0x000003FFu;
+			v = (v | (v << 16)) & 0x030000FFu;
+			v = (v | (v << 8)) & 0x0300F00Fu;
+			v = (v | (v << 4)) & 0x030C30C3u;
+			v = (v | (v << 2)) & 0x09249249u;
+
+			return v;
 		}
 
-		return bv;
+		//Same as above, for the lower 21 bits of v
+		inline std::uint64_t expandBits(std::uint64_t v)
+		{
+			v &= 0x00000000001FFFFFull;
+			v = (v | (v << 32)) & 0x001F00000000FFFFull;
+			v = (v | (v << 16)) & 0x001F0000FF0000FFull;
+			v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+			v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+			v = (v | (v << 2)) & 0x1249249249249249ull;
+
+			return v;
+		}
+
+		template <typename Code>
+		constexpr unsigned int s_mortonBitsPerAxis = sizeof(Code) == 4 ? 10 : 21;
+
+		/**
+		 * @brief Compute the Morton code of a point
+		 *
+		 * @param point A point in the unit cube
+		 * @return The bits of the quantized x, y and z coordinates,
+		 * interleaved as ...xyzxyz
+		 */
+		template <typename Code>
+		inline Code mortonCode(const glm::vec3& point)
+		{
+			constexpr auto cells = static_cast<float>(Code(1) << s_mortonBitsPerAxis<Code>);
+
+			glm::vec3 quantized = glm::clamp(point * cells, glm::vec3(0), glm::vec3(cells - 1));
+
+			return (expandBits(static_cast<Code>(quantized.x)) << 2)
+				| (expandBits(static_cast<Code>(quantized.y)) << 1)
+				| expandBits(static_cast<Code>(quantized.z));
+		}
+
+		template <typename Code>
+		struct MortonPrimitive
+		{
+			Code code;
+			std::uint32_t index;
+		};
+
+		/**
+		 * @brief LSD radix sort on the Morton codes, 8 bits at a time
+		 *
+		 * @param primitives The list to sort
+		 * @param buffer Scratch space, at least as big as primitives
+		 */
+		template <typename Code>
+		void radixSort(std::vector<MortonPrimitive<Code>>& primitives,
+		               std::vector<MortonPrimitive<Code>>& buffer)
+		{
+			PHYSICC_ZONE_FINE;
+
+			constexpr unsigned int codeBits = 3 * s_mortonBitsPerAxis<Code>;
+
+			for (unsigned int shift = 0; shift < codeBits; shift += 8)
+			{
+				std::size_t offsets[256] = {};
+
+				for (const auto& primitive : primitives)
+				{
+					offsets[(primitive.code >> shift) & 0xFF]++;
+				}
+
+				if (offsets[primitives.front().code >> shift & 0xFF] == primitives.size())
+				{
+					continue;
+					//every code has the same digit here, nothing would move
+				}
+
+				std::size_t total = 0;
+
+				for (auto& offset : offsets)
+				{
+					std::size_t count = offset;
+					offset = total;
+					total += count;
+				}
+
+				for (const auto& primitive : primitives)
+				{
+					buffer[offsets[(primitive.code >> shift) & 0xFF]++] = primitive;
+				}
+
+				primitives.swap(buffer);
+			}
+		}
 	}
 
-	void BVH::sort(Axis axis, std::size_t start, std::size_t end)
+	template <typename Volume>
+	BasicBVH<Volume>::BasicBVH(std::vector<RigidBody> rigidBodyList,
+	         SplitMethod splitMethod,
+	         std::size_t maxLeafSize)
+		: 	m_rigidBodyList(std::move(rigidBodyList)),
+			m_splitMethod(splitMethod),
+			m_maxLeafSize(std::clamp<std::size_t>(maxLeafSize,
+			                                      1,
+			                                      std::numeric_limits<std::uint16_t>::max()))
+			//Node::count is 16 bits wide
 	{
-		if (axis == X)
-		{
-			std::sort(std::next(m_rigidBodyList.begin(), start),
-			          std::next(m_rigidBodyList.begin(), end),
-			          [](const RigidBody& rigidBody1,
-			             const RigidBody& rigidBody2) {
-			            return rigidBody1.getCentroid().x
-				            > rigidBody2.getCentroid().x;
-			          });
-		} else if (axis == Y)
+	}
+
+	template <typename Volume>
+	BasicBVH<Volume>::BasicBVH(const std::vector<Volume>& volumes,
+	         SplitMethod splitMethod,
+	         std::size_t maxLeafSize)
+		:	BasicBVH(std::vector<RigidBody>(), splitMethod, maxLeafSize)
+	{
+		m_primitives.resize(volumes.size());
+
+		for (std::size_t i = 0; i != volumes.size(); i++)
 		{
-			std::sort(std::next(m_rigidBodyList.begin(), start),
-			          std::next(m_rigidBodyList.begin(), end),
-			          [](const RigidBody& rigidBody1,
-			             const RigidBody& rigidBody2) {
-			            return rigidBody1.getCentroid().y
-				            > rigidBody2.getCentroid().y;
-			          });
-		} else
+			updateVolume(i, volumes[i]);
+		}
+	}
+
+	template <typename Volume>
+	Volume BasicBVH<Volume>::computeBV(std::size_t start, std::size_t end)
+	{
+		PHYSICC_ZONE_FINE;
+
+		Volume bv(m_primitives[m_bodyIndices[start]].volume);
+
+		for (std::size_t i = start + 1; i != end; i++)
 		{
-			std::sort(std::next(m_rigidBodyList.begin(), start),
-			          std::next(m_rigidBodyList.begin(), end),
-			          [](const RigidBody& rigidBody1,
-			             const RigidBody& rigidBody2) {
-			            return rigidBody1.getCentroid().y
-				            > rigidBody2.getCentroid().y;
-			          });
+			bv = BoundingVolume::enclosingBV(bv, m_primitives[m_bodyIndices[i]].volume);
 		}
+
+		return bv;
 	}
 
-	BVH::Axis BVH::getMedianCuttingAxis(std::size_t start, std::size_t end)
+	template <typename Volume>
+	typename BasicBVH<Volume>::Axis BasicBVH<Volume>::getMedianCuttingAxis(std::size_t start, std::size_t end)
 	{
 		//TODO: Suggest a better name
-    
-		glm::vec3 min(m_rigidBodyList[start].getCentroid()),
-			max(m_rigidBodyList[start].getCentroid());
 
-		for (std::size_t i = start + 1; i <= end; i++)
+		glm::vec3 min(m_primitives[m_bodyIndices[start]].centroid),
+			max(m_primitives[m_bodyIndices[start]].centroid);
+
+		for (std::size_t i = start + 1; i != end; i++)
 		{
-			min = glm::min(min, m_rigidBodyList[i].getCentroid());
-			max = glm::max(max, m_rigidBodyList[i].getCentroid());
+			min = glm::min(min, m_primitives[m_bodyIndices[i]].centroid);
+			max = glm::max(max, m_primitives[m_bodyIndices[i]].centroid);
 		}
 
 		float x_spread = max.x - min.x, y_spread = max.y - min.y,
@@ -98,45 +245,773 @@ namespace Physicc
 		}
 	}
 
-	inline void BVH::buildTree()
+	template <typename Volume>
+	void BasicBVH<Volume>::computePrimitives()
+	{
+		PHYSICC_ZONE_FINE;
+
+		if (m_rigidBodyList.empty())
+		{
+			//Either there are no bodies, or the tree was built over bounding
+			//volumes, which are kept in m_primitives directly
+			return;
+		}
+
+		m_primitives.resize(m_rigidBodyList.size());
+
+		parallelFor(m_buildJobSystem,
+		            m_rigidBodyList.size(),
+		            s_parallelThreshold,
+		            [this](std::size_t start, std::size_t end) {
+		              for (std::size_t i = start; i != end; i++)
+		              {
+		                m_primitives[i] = {Volume::fromShape(m_rigidBodyList[i].getCollider()),
+		                                   m_rigidBodyList[i].getCentroid()};
+		              }
+		            });
+	}
+
+	template <typename Volume>
+	void BasicBVH<Volume>::buildTree()
 	{
-		buildTree(m_head, 0, m_rigidBodyList.size() - 1);
+		PHYSICC_ZONE_COARSE;
+
+		m_buildJobSystem = nullptr;
+		build(std::max(1u, std::thread::hardware_concurrency()));
 	}
 
-	void BVH::buildTree(BVHNode* node, std::size_t start, std::size_t end)
+	template <typename Volume>
+	void BasicBVH<Volume>::buildTree(JobSystem& jobSystem)
 	{
-		ZoneScoped;
+		PHYSICC_ZONE_COARSE;
+
+		m_buildJobSystem = &jobSystem;
+		build(jobSystem.getThreadCount());
+		m_buildJobSystem = nullptr;
+	}
+
+	template <typename Volume>
+	void BasicBVH<Volume>::build(unsigned int threadCount)
+	{
+		m_nodes.clear();
+
+		computePrimitives();
 
-		//implicit convention:
-		//no children = leaf node
-		//no parent = head node
+		std::size_t bodyCount = m_primitives.size();
+		m_bodyIndices.resize(bodyCount);
 
-		//All nodes are equal to nullptr until they are explicitly assigned
-		//non-null values
+		if (bodyCount == 0)
+		{
+			return;
+		}
+
+		std::iota(m_bodyIndices.begin(), m_bodyIndices.end(), 0);
+
+		//a binary tree with one body per leaf has exactly 2n - 1 nodes, and
+		//bigger leaves only make for fewer of them
+		m_nodes.reserve(2 * bodyCount - 1);
+
+		//Every level of tasks doubles the number of subtrees being built at
+		//once, so enough levels to have a couple of subtrees per thread
+		//(load balancing is not perfect, SAH splits can be lopsided)
+		unsigned int taskDepth = 0;
 
-		if (start == end)
+		while (threadCount > 1 && (1u << taskDepth) < 2 * threadCount)
+		{
+			taskDepth++;
+		}
+
+		if (m_splitMethod != SplitMethod::Morton)
+		{
+			buildTree(m_nodes, 0, bodyCount, taskDepth);
+		} else if (bodyCount > s_wideMortonThreshold)
 		{
-			//then the only element left in this sliced vector is the one at
-			//`start`
-			node->volume = m_rigidBodyList[start].getAABB();
-			node->body = &m_rigidBodyList[start];
+			buildMortonTree<std::uint64_t>(taskDepth);
 		} else
 		{
-			node->volume = BoundingVolume::AABB(computeBV(start, end));
+			buildMortonTree<std::uint32_t>(taskDepth);
+		}
+	}
+
+	template <typename Volume>
+	template <typename BuildFunction>
+	std::uint32_t BasicBVH<Volume>::buildChildren(std::vector<Node>& nodes,
+	                                 std::size_t start,
+	                                 std::size_t mid,
+	                                 std::size_t end,
+	                                 unsigned int taskDepth,
+	                                 BuildFunction&& build)
+	{
+		if (taskDepth == 0 || end - mid < s_parallelThreshold)
+		{
+			build(nodes, start, mid, taskDepth);
+
+			return build(nodes, mid, end, taskDepth);
+		}
+
+		//The second subtree is built on another thread into a list of its
+		//own, since its nodes' final positions depend on how big the first
+		//subtree turns out to be. Both tasks only ever touch their own slice
+		//of m_bodyIndices.
+		std::vector<Node> secondSubtree;
+		secondSubtree.reserve(2 * (end - mid) - 1);
+
+		if (m_buildJobSystem)
+		{
+			//The calling thread builds the first subtree, as the job
+			//system always runs the first chunk itself
+			m_buildJobSystem->parallelFor(2, 1, [&](std::size_t subtree, std::size_t) {
+				if (subtree == 0)
+				{
+					build(nodes, start, mid, taskDepth - 1);
+				} else
+				{
+					build(secondSubtree, mid, end, taskDepth - 1);
+				}
+			});
+		} else
+		{
+			auto task = std::async(std::launch::async, [&]() {
+				build(secondSubtree, mid, end, taskDepth - 1);
+			});
+
+			build(nodes, start, mid, taskDepth - 1);
+			task.get();
+		}
+
+		auto secondChild = static_cast<std::uint32_t>(nodes.size());
+
+		for (Node node : secondSubtree)
+		{
+			if (!node.isLeaf())
+			{
+				node.offset += secondChild;
+				//rebase the second child's index onto the merged list
+			}
+
+			nodes.push_back(node);
+		}
+
+		return secondChild;
+	}
+
+	template <typename Volume>
+	template <typename Code>
+	void BasicBVH<Volume>::buildMortonTree(unsigned int taskDepth)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		std::size_t count = m_primitives.size();
+
+		glm::vec3 min(m_primitives.front().centroid), max(m_primitives.front().centroid);
+
+		for (const auto& primitive : m_primitives)
+		{
+			min = glm::min(min, primitive.centroid);
+			max = glm::max(max, primitive.centroid);
+		}
+
+		glm::vec3 scale = 1.0f / glm::max(max - min, glm::vec3(std::numeric_limits<float>::min()));
+		//maps the centroids' bounding box onto the unit cube. Flat
+		//dimensions just map to 0.
+
+		std::vector<MortonPrimitive<Code>> sorted(count), buffer(count);
+
+		parallelFor(m_buildJobSystem,
+		            count,
+		            s_parallelThreshold,
+		            [this, &sorted, &min, &scale](std::size_t start, std::size_t end) {
+		              for (std::size_t i = start; i != end; i++)
+		              {
+		                sorted[i] = {mortonCode<Code>((m_primitives[i].centroid - min) * scale),
+		                             static_cast<std::uint32_t>(i)};
+		              }
+		            });
+
+		radixSort(sorted, buffer);
+
+		std::vector<Code> codes(count);
+
+		for (std::size_t i = 0; i != count; i++)
+		{
+			codes[i] = sorted[i].code;
+			m_bodyIndices[i] = sorted[i].index;
+		}
 
-			sort(getMedianCuttingAxis(start, end), start, end);
+		buildMortonTree(m_nodes, codes, 0, count, taskDepth);
+	}
+
+	template <typename Volume>
+	template <typename Code>
+	std::uint32_t BasicBVH<Volume>::buildMortonTree(std::vector<Node>& nodes,
+	                                   const std::vector<Code>& codes,
+	                                   std::size_t start,
+	                                   std::size_t end,
+	                                   unsigned int taskDepth)
+	{
+		auto nodeIndex = static_cast<std::uint32_t>(nodes.size());
+		nodes.emplace_back();
+
+		if (end - start <= m_maxLeafSize)
+		{
+			nodes[nodeIndex].volume = computeBV(start, end);
+			nodes[nodeIndex].offset = static_cast<std::uint32_t>(start);
+			nodes[nodeIndex].count = static_cast<std::uint16_t>(end - start);
+
+			return nodeIndex;
+		}
+
+		std::size_t mid;
+		Axis axis = X;
+
+		if (codes[start] == codes[end - 1])
+		{
+			mid = start + (end - start) / 2;
+			//no bit left to split on
+		} else
+		{
+			//All codes in the range share the bits above the highest bit in
+			//which the first and last code differ. Since the codes are
+			//sorted, the range splits into the codes with that bit unset,
+			//followed by the ones with it set.
+			Code difference = codes[start] ^ codes[end - 1];
+			unsigned int bit = 0;
+
+			while (difference >> (bit + 1) != 0)
+			{
+				bit++;
+			}
+
+			auto first = std::next(codes.begin(), start);
+			auto last = std::next(codes.begin(), end);
+
+			mid = static_cast<std::size_t>(std::distance(codes.begin(),
+				std::partition_point(first, last, [bit](Code code) {
+					return ((code >> bit) & 1) == 0;
+				})));
+
+			axis = static_cast<Axis>(2 - bit % 3);
+			//the lowest bit of a code is a z bit, see mortonCode()
+		}
+
+		std::uint32_t secondChild = buildChildren(nodes, start, mid, end, taskDepth,
+			[this, &codes](std::vector<Node>& subtree,
+			               std::size_t subtreeStart,
+			               std::size_t subtreeEnd,
+			               unsigned int subtreeTaskDepth) {
+				return buildMortonTree(subtree, codes, subtreeStart, subtreeEnd, subtreeTaskDepth);
+			});
 
-			auto leftNode = new BVHNode;
-			auto rightNode = new BVHNode;
+		//Bounds are put together bottom-up from the children here, rather
+		//than computed from all the bodies in the range, to keep the build
+		//linear in the number of bodies
+		nodes[nodeIndex].volume = BoundingVolume::enclosingBV(nodes[nodeIndex + 1].volume,
+		                                                      nodes[secondChild].volume);
+		nodes[nodeIndex].offset = secondChild;
+		nodes[nodeIndex].axis = static_cast<std::uint8_t>(axis);
 
-			node->left = leftNode;
-			node->right = rightNode;
+		return nodeIndex;
+	}
+
+	template <typename Volume>
+	void BasicBVH<Volume>::updateBody(std::size_t index, const RigidBody& body)
+	{
+		PHYSICC_ZONE_FINE;
+
+		m_rigidBodyList[index] = body;
+
+		if (!m_primitives.empty())
+		{
+			m_primitives[index] = {Volume::fromShape(body.getCollider()), body.getCentroid()};
+		}
+	}
+
+	template <typename Volume>
+	void BasicBVH<Volume>::updateVolume(std::size_t index, const Volume& volume)
+	{
+		PHYSICC_ZONE_FINE;
 
-			leftNode->parent = node;
-			rightNode->parent = node;
+		m_primitives[index] = {volume, volume.getCenter()};
+	}
 
-			buildTree(leftNode, start, start + (end - start) / 2);
-			buildTree(rightNode, start + 1 + (end - start) / 2, end);
+	template <typename Volume>
+	void BasicBVH<Volume>::refit()
+	{
+		PHYSICC_ZONE_COARSE;
+
+		//Children always come after their parent in the node list, so going
+		//through it backwards visits both children of a node before the
+		//node itself
+		for (std::size_t i = m_nodes.size(); i-- != 0;)
+		{
+			Node& node = m_nodes[i];
+
+			if (node.isLeaf())
+			{
+				node.volume = computeBV(node.offset, node.offset + node.count);
+			} else
+			{
+				node.volume = BoundingVolume::enclosingBV(m_nodes[i + 1].volume,
+				                                          m_nodes[node.offset].volume);
+			}
 		}
 	}
-}
\ No newline at end of file
+
+	template <typename Volume>
+	void BasicBVH<Volume>::queryPairs(std::vector<BodyPair>& pairs) const
+	{
+		PHYSICC_ZONE_COARSE;
+
+		pairs.clear();
+
+		if (!m_nodes.empty())
+		{
+			queryPairs({0, 0}, pairs);
+		}
+	}
+
+	template <typename Volume>
+	void BasicBVH<Volume>::queryPairsParallel(std::vector<BodyPair>& pairs, JobSystem& jobSystem)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		pairs.clear();
+
+		if (m_nodes.empty())
+		{
+			return;
+		}
+
+		//Pairs of distinct subtrees are left alone when splitting the
+		//work, they are as often as not culled right away. The pieces do
+		//not depend on the number of threads, so neither do the pairs.
+		m_pairTasks.clear();
+		addPairTasks(0, s_pairSplitDepth);
+
+		if (m_pairTaskResults.size() < m_pairTasks.size())
+		{
+			m_pairTaskResults.resize(m_pairTasks.size());
+		}
+
+		//One piece per chunk, so that the pieces go to whichever thread is
+		//free, however uneven they are
+		jobSystem.parallelFor(m_pairTasks.size(), 1, [this](std::size_t start, std::size_t end) {
+			for (std::size_t i = start; i < end; i++)
+			{
+				m_pairTaskResults[i].clear();
+				queryPairs(m_pairTasks[i], m_pairTaskResults[i]);
+			}
+		});
+
+		std::size_t total = 0;
+
+		for (std::size_t i = 0; i != m_pairTasks.size(); i++)
+		{
+			total += m_pairTaskResults[i].size();
+		}
+
+		pairs.reserve(total);
+
+		for (std::size_t i = 0; i != m_pairTasks.size(); i++)
+		{
+			pairs.insert(pairs.end(), m_pairTaskResults[i].begin(), m_pairTaskResults[i].end());
+		}
+	}
+
+	template <typename Volume>
+	void BasicBVH<Volume>::addPairTasks(std::uint32_t node, unsigned int depth)
+	{
+		const Node& current = m_nodes[node];
+
+		if (depth == 0 || current.isLeaf())
+		{
+			m_pairTasks.push_back({node, node});
+			return;
+		}
+
+		//Same order as the traversal in queryPairs(): everything within
+		//the first child, then within the second, then between the two
+		std::uint32_t child1 = node + 1, child2 = current.offset;
+
+		addPairTasks(child1, depth - 1);
+		addPairTasks(child2, depth - 1);
+		m_pairTasks.push_back({child1, child2});
+	}
+
+	template <typename Volume>
+	void BasicBVH<Volume>::queryPairs(NodePair nodes, std::vector<BodyPair>& pairs) const
+	{
+		PHYSICC_ZONE_FINE;
+
+		TraversalStack<NodePair> stack;
+		stack.push(nodes);
+
+		while (!stack.empty())
+		{
+			NodePair current = stack.pop();
+			const Node& node1 = m_nodes[current.first];
+			const Node& node2 = m_nodes[current.second];
+
+			if (current.first == current.second)
+			{
+				//Pairs within a subtree are either within one of its
+				//children, or have one body in each child
+				if (node1.isLeaf())
+				{
+					addLeafPairs(node1, node1, pairs);
+				} else
+				{
+					std::uint32_t child1 = current.first + 1, child2 = node1.offset;
+
+					stack.push({child1, child2});
+					stack.push({child2, child2});
+					stack.push({child1, child1});
+				}
+
+				continue;
+			}
+
+			if (!node1.volume.overlapsWith(node2.volume))
+			{
+				continue;
+			}
+
+			if (node1.isLeaf() && node2.isLeaf())
+			{
+				addLeafPairs(node1, node2, pairs);
+			} else if (node2.isLeaf()
+				|| (!node1.isLeaf() && node1.volume.getSurfaceArea() >= node2.volume.getSurfaceArea()))
+			{
+				//descend into the bigger of the two volumes, it is the one
+				//most likely to have children that do not overlap the other
+				stack.push({node1.offset, current.second});
+				stack.push({current.first + 1, current.second});
+			} else
+			{
+				stack.push({current.first, node2.offset});
+				stack.push({current.first, current.second + 1});
+			}
+		}
+	}
+
+	template <typename Volume>
+	void BasicBVH<Volume>::addLeafPairs(const Node& leaf1,
+	                       const Node& leaf2,
+	                       std::vector<BodyPair>& pairs) const
+	{
+		bool sameLeaf = &leaf1 == &leaf2;
+
+		for (std::uint32_t i = leaf1.offset; i != leaf1.offset + leaf1.count; i++)
+		{
+			std::uint32_t body1 = m_bodyIndices[i];
+
+			for (std::uint32_t j = sameLeaf ? i + 1 : leaf2.offset; j != leaf2.offset + leaf2.count; j++)
+			{
+				std::uint32_t body2 = m_bodyIndices[j];
+
+				if (m_primitives[body1].volume.overlapsWith(m_primitives[body2].volume))
+				{
+					pairs.push_back({std::min(body1, body2), std::max(body1, body2)});
+				}
+			}
+		}
+	}
+
+	template <typename Volume>
+	std::optional<RaycastHit> BasicBVH<Volume>::raycast(const Ray& ray, float tMax) const
+	{
+		PHYSICC_ZONE_COARSE;
+
+		std::optional<RaycastHit> hit;
+
+		raycast(ray, tMax, glm::vec3(0), [&hit](std::uint32_t body, float t) {
+			hit = RaycastHit{body, t};
+			return t;
+		});
+
+		return hit;
+	}
+
+	template <typename Volume>
+	bool BasicBVH<Volume>::raycastAny(const Ray& ray, float tMax) const
+	{
+		PHYSICC_ZONE_COARSE;
+
+		bool hit = false;
+
+		raycast(ray, tMax, glm::vec3(0), [&hit](std::uint32_t, float) {
+			hit = true;
+			return -1.0f;
+		});
+
+		return hit;
+	}
+
+	template <typename Volume>
+	std::optional<RaycastHit> BasicBVH<Volume>::sweep(const BoundingVolume::AABB& box,
+	                                     const glm::vec3& displacement) const
+	{
+		PHYSICC_ZONE_COARSE;
+
+		std::optional<RaycastHit> hit;
+
+		Ray ray(0.5f * (box.getLowerBound() + box.getUpperBound()), displacement);
+		glm::vec3 extent = 0.5f * (box.getUpperBound() - box.getLowerBound());
+
+		raycast(ray, 1.0f, extent, [&hit](std::uint32_t body, float t) {
+			hit = RaycastHit{body, t};
+			return t;
+		});
+
+		return hit;
+	}
+
+	template <typename Volume>
+	void BasicBVH<Volume>::queryRegion(const BoundingVolume::AABB& region,
+	                      std::vector<std::uint32_t>& bodies) const
+	{
+		PHYSICC_ZONE_COARSE;
+
+		bodies.clear();
+
+		queryRegion(region, [&bodies](std::uint32_t body) {
+			bodies.push_back(body);
+			return true;
+		});
+	}
+
+	template <typename Volume>
+	std::size_t BasicBVH<Volume>::partitionMedian(std::size_t start, std::size_t end, Axis& axis)
+	{
+		PHYSICC_ZONE_FINE;
+
+		if (end - start <= m_maxLeafSize)
+		{
+			return end;
+		}
+
+		axis = getMedianCuttingAxis(start, end);
+
+		//Only the median itself needs to end up in its sorted position, with
+		//smaller centroids before it and larger ones after. Fully sorting
+		//the range would be wasted work, since both halves get partitioned
+		//again anyway.
+		std::size_t mid = start + (end - start) / 2;
+
+		std::nth_element(std::next(m_bodyIndices.begin(), start),
+		                 std::next(m_bodyIndices.begin(), mid),
+		                 std::next(m_bodyIndices.begin(), end),
+		                 [this, axis](std::uint32_t index1, std::uint32_t index2) {
+		                   return m_primitives[index1].centroid[axis]
+			                   < m_primitives[index2].centroid[axis];
+		                 });
+		//Axis::X, Axis::Y and Axis::Z double as glm::vec3 component indices
+
+		return mid;
+	}
+
+	template <typename Volume>
+	std::size_t BasicBVH<Volume>::partitionSAH(std::size_t start,
+	                              std::size_t end,
+	                              const Volume& volume,
+	                              Axis& axis)
+	{
+		PHYSICC_ZONE_FINE;
+
+		std::size_t count = end - start;
+
+		if (count == 1)
+		{
+			return end;
+		}
+
+		glm::vec3 min(m_primitives[m_bodyIndices[start]].centroid),
+			max(m_primitives[m_bodyIndices[start]].centroid);
+
+		for (std::size_t i = start + 1; i != end; i++)
+		{
+			min = glm::min(min, m_primitives[m_bodyIndices[i]].centroid);
+			max = glm::max(max, m_primitives[m_bodyIndices[i]].centroid);
+		}
+
+		glm::vec3 extent = max - min;
+
+		struct Bin
+		{
+			Volume volume;
+			std::size_t count = 0;
+		};
+
+		float bestCost = std::numeric_limits<float>::infinity();
+		std::size_t bestBin = 0;
+
+		auto binIndex = [&min, &extent](const glm::vec3& centroid, int axis) {
+			auto index = static_cast<std::size_t>(s_binCount
+				* ((centroid[axis] - min[axis]) / extent[axis]));
+			return std::min(index, s_binCount - 1);
+			//the centroid(s) on the upper boundary would land one past the
+			//last bin otherwise
+		};
+
+		for (int candidateAxis = X; candidateAxis <= Z; candidateAxis++)
+		{
+			if (extent[candidateAxis] <= 0.0f)
+			{
+				continue;
+				//all centroids lie on a plane orthogonal to this axis
+			}
+
+			Bin bins[s_binCount];
+
+			for (std::size_t i = start; i != end; i++)
+			{
+				const Primitive& primitive = m_primitives[m_bodyIndices[i]];
+				Bin& bin = bins[binIndex(primitive.centroid, candidateAxis)];
+
+				bin.volume = bin.count == 0
+					? primitive.volume
+					: BoundingVolume::enclosingBV(bin.volume, primitive.volume);
+				bin.count++;
+			}
+
+			//Sweep from the right first, recording the area and count of
+			//everything to the right of each plane between two bins. The
+			//sweep from the left then has all it needs to cost each plane.
+			float rightArea[s_binCount - 1];
+			std::size_t rightCount[s_binCount - 1];
+
+			Volume accumulated;
+			std::size_t accumulatedCount = 0;
+
+			for (std::size_t i = s_binCount - 1; i != 0; i--)
+			{
+				if (bins[i].count != 0)
+				{
+					accumulated = accumulatedCount == 0
+						? bins[i].volume
+						: BoundingVolume::enclosingBV(accumulated, bins[i].volume);
+					accumulatedCount += bins[i].count;
+				}
+
+				rightCount[i - 1] = accumulatedCount;
+				rightArea[i - 1] = accumulatedCount == 0 ? 0.0f : accumulated.getSurfaceArea();
+			}
+
+			accumulatedCount = 0;
+
+			for (std::size_t i = 0; i != s_binCount - 1; i++)
+			{
+				if (bins[i].count != 0)
+				{
+					accumulated = accumulatedCount == 0
+						? bins[i].volume
+						: BoundingVolume::enclosingBV(accumulated, bins[i].volume);
+					accumulatedCount += bins[i].count;
+				}
+
+				if (accumulatedCount == 0 || rightCount[i] == 0)
+				{
+					continue;
+					//not a split at all
+				}
+
+				float cost = static_cast<float>(accumulatedCount) * accumulated.getSurfaceArea()
+					+ static_cast<float>(rightCount[i]) * rightArea[i];
+
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestBin = i;
+					axis = static_cast<Axis>(candidateAxis);
+				}
+			}
+		}
+
+		if (bestCost == std::numeric_limits<float>::infinity())
+		{
+			//All centroids coincide, so no plane can separate them. Split the
+			//range in half if it is too big for a leaf.
+			axis = X;
+
+			return count <= m_maxLeafSize ? end : start + count / 2;
+		}
+
+		float parentArea = volume.getSurfaceArea();
+
+		if (count <= m_maxLeafSize)
+		{
+			float splitCost = parentArea > 0.0f
+				? s_traversalCost + s_intersectionCost * bestCost / parentArea
+				: s_traversalCost + s_intersectionCost * static_cast<float>(count);
+			float leafCost = s_intersectionCost * static_cast<float>(count);
+
+			if (leafCost <= splitCost)
+			{
+				return end;
+			}
+		}
+
+		auto middle = std::partition(std::next(m_bodyIndices.begin(), start),
+		                             std::next(m_bodyIndices.begin(), end),
+		                             [this, &binIndex, axis, bestBin](std::uint32_t index) {
+		                               return binIndex(m_primitives[index].centroid, axis) <= bestBin;
+		                             });
+
+		return static_cast<std::size_t>(std::distance(m_bodyIndices.begin(), middle));
+	}
+
+	template <typename Volume>
+	std::uint32_t BasicBVH<Volume>::buildTree(std::vector<Node>& nodes,
+	                             std::size_t start,
+	                             std::size_t end,
+	                             unsigned int taskDepth)
+	{
+		PHYSICC_ZONE_FINE;
+
+		//Nodes are emitted in depth-first order: a node is pushed before
+		//either of its subtrees, so its first child is always the next node
+		//in the list. Only the second child's index has to be written back
+		//once the first subtree is done.
+
+		//Nodes are referred to by index rather than by reference, since
+		//`nodes` might reallocate while the subtrees are being built.
+
+		auto nodeIndex = static_cast<std::uint32_t>(nodes.size());
+		nodes.emplace_back();
+		nodes[nodeIndex].volume = computeBV(start, end);
+
+		Axis axis = X;
+		std::size_t mid = m_splitMethod == SplitMethod::SAH
+			? partitionSAH(start, end, nodes[nodeIndex].volume, axis)
+			: partitionMedian(start, end, axis);
+
+		if (mid == end)
+		{
+			nodes[nodeIndex].offset = static_cast<std::uint32_t>(start);
+			nodes[nodeIndex].count = static_cast<std::uint16_t>(end - start);
+
+			return nodeIndex;
+		}
+
+		std::uint32_t secondChild = buildChildren(nodes, start, mid, end, taskDepth,
+			[this](std::vector<Node>& subtree,
+			       std::size_t subtreeStart,
+			       std::size_t subtreeEnd,
+			       unsigned int subtreeTaskDepth) {
+				return buildTree(subtree, subtreeStart, subtreeEnd, subtreeTaskDepth);
+			});
+
+		nodes[nodeIndex].offset = secondChild;
+		nodes[nodeIndex].axis = static_cast<std::uint8_t>(axis);
+
+		return nodeIndex;
+	}
+
+	template class BasicBVH<BoundingVolume::AABB>;
+	template class BasicBVH<BoundingVolume::Sphere>;
+	template class BasicBVH<BoundingVolume::OBB>;
+	template class BasicBVH<BoundingVolume::KDop<8>>;
+	template class BasicBVH<BoundingVolume::KDop<14>>;
+	template class BasicBVH<BoundingVolume::KDop<18>>;
+	template class BasicBVH<BoundingVolume::KDop<26>>;
+}
@@ -13,9 +13,14 @@
 /* -- Includes -- */
 /* collider header */
 
-#include "tools/Tracy.hpp"
+#include "profiling.hpp"
 
 #include "collider.hpp"
+#include "trianglemesh.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
 
 namespace Physicc
 {
@@ -25,6 +30,9 @@ namespace Physicc
 	 * @param position Position of the object. Default = (0,0,0)
 	 * @param rotation Rotations about the axes. Default = (0,0,0)
 	 * @param scale Length along each of the axes. Default = (1,1,1)
+	 *
+	 * The cached state is computed by the shape's constructor, as the shape
+	 * is not known yet at this point.
 	 */
 	Collider::Collider(glm::vec3 position, glm::vec3 rotation, glm::vec3 scale)
 		: m_position(position), m_rotate(rotation), m_scale(scale)
@@ -32,29 +40,154 @@ namespace Physicc
 	}
 
 	/**
-	 * @brief Update Transform for rendering
+	 * @brief Update the parts of the transform that depend on the rotation
+	 * and scale
 	 * 
 	 */
-	void Collider::updateTransform()
+	void Collider::updateRotation()
 	{
-		ZoneScoped;
+		PHYSICC_ZONE_FINE;
+
+		//Rotate about x, then y, then z in local space, i.e. R = Rx Ry Rz
+		glm::vec3 angles = glm::radians(m_rotate);
+
+		m_orientation = glm::angleAxis(angles.x, glm::vec3(1.0f, 0.0f, 0.0f))
+			* glm::angleAxis(angles.y, glm::vec3(0.0f, 1.0f, 0.0f))
+			* glm::angleAxis(angles.z, glm::vec3(0.0f, 0.0f, 1.0f));
+		updateOrientation();
+	}
+
+	/**
+	 * @brief Update the rotation matrix, extents and transform from the
+	 * orientation quaternion
+	 */
+	void Collider::updateOrientation()
+	{
+		m_rotation = glm::mat3_cast(m_orientation);
+		m_extents = computeExtents();
+		m_aabbOffset = computeAABBOffset();
+
+		//Scale first, so that the object is scaled along its own axes. The
+		//translation is filled in by updateTransform()
+		m_transform = glm::mat4(glm::vec4(m_rotation[0] * m_scale.x, 0.0f),
+		                        glm::vec4(m_rotation[1] * m_scale.y, 0.0f),
+		                        glm::vec4(m_rotation[2] * m_scale.z, 0.0f),
+		                        glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+
+	void Collider::setPose(const glm::vec3& position, const glm::quat& orientation)
+	{
+		PHYSICC_ZONE_FINE;
+
+		m_position = position;
+		m_orientation = orientation;
+		updateOrientation();
 
-		m_transform = glm::translate(glm::mat4(1.0f), m_position);
-		m_transform = glm::scale(m_transform, m_scale);
-		m_transform = glm::rotate(m_transform,
-									glm::radians(m_rotate.x),
-									glm::vec3(1.0, 0.0, 0.0));
-		m_transform = glm::rotate(m_transform,
-									glm::radians(m_rotate.y),
-									glm::vec3(0.0, 1.0, 0.0));
-		m_transform = glm::rotate(m_transform,
-									glm::radians(m_rotate.z),
-									glm::vec3(0.0, 0.0, 1.0));
+		m_dirty = e_positionDirty;
+		updateTransform();
+	}
+
+	/**
+	 * @brief Forwards to the support function of the collider's shape
+	 */
+	glm::vec3 Collider::getSupport(const glm::vec3& direction) const
+	{
+		switch (m_objectType)
+		{
+			case e_sphere:
+				return static_cast<const SphereCollider*>(this)->getSupport(direction);
+			case e_convexHull:
+				return static_cast<const ConvexHullCollider*>(this)->getSupport(direction);
+			case e_compound:
+				return static_cast<const CompoundCollider*>(this)->getSupport(direction);
+			case e_triangleMesh:
+				return static_cast<const TriangleMeshCollider*>(this)->getSupport(direction);
+			case e_box:
+			default:
+				return static_cast<const BoxCollider*>(this)->getSupport(direction);
+		}
+	}
+
+	float Collider::getBoundingRadius() const
+	{
+		switch (m_objectType)
+		{
+			case e_sphere:
+				return static_cast<const SphereCollider*>(this)->getRadius();
+			case e_convexHull:
+				return static_cast<const ConvexHullCollider*>(this)->computeBoundingRadius();
+			case e_compound:
+				return static_cast<const CompoundCollider*>(this)->computeBoundingRadius();
+			case e_triangleMesh:
+				return static_cast<const TriangleMeshCollider*>(this)->computeBoundingRadius();
+			case e_box:
+			default:
+				return glm::length(static_cast<const BoxCollider*>(this)->getHalfExtents());
+		}
+	}
+
+	glm::vec3 Collider::getOrientedHalfExtents() const
+	{
+		switch (m_objectType)
+		{
+			case e_sphere:
+				return glm::vec3(static_cast<const SphereCollider*>(this)->getRadius());
+			case e_convexHull:
+				return static_cast<const ConvexHullCollider*>(this)->computeOrientedHalfExtents();
+			case e_compound:
+				return static_cast<const CompoundCollider*>(this)->computeOrientedHalfExtents();
+			case e_triangleMesh:
+				return static_cast<const TriangleMeshCollider*>(this)->computeOrientedHalfExtents();
+			case e_box:
+			default:
+				return static_cast<const BoxCollider*>(this)->getHalfExtents();
+		}
+	}
+
+	/**
+	 * @brief Forwards to the shape's own computeExtents()
+	 */
+	glm::vec3 Collider::computeExtents() const
+	{
+		switch (m_objectType)
+		{
+			case e_sphere:
+				return static_cast<const SphereCollider*>(this)->computeExtents();
+			case e_convexHull:
+				return static_cast<const ConvexHullCollider*>(this)->computeExtents();
+			case e_compound:
+				return static_cast<const CompoundCollider*>(this)->computeExtents();
+			case e_triangleMesh:
+				return static_cast<const TriangleMeshCollider*>(this)->computeExtents();
+			case e_box:
+			default:
+				return static_cast<const BoxCollider*>(this)->computeExtents();
+		}
+	}
+
+	/**
+	 * @brief Forwards to the shape's own computeAABBOffset(), for the shapes
+	 * that have one
+	 */
+	glm::vec3 Collider::computeAABBOffset() const
+	{
+		switch (m_objectType)
+		{
+			case e_compound:
+				return static_cast<const CompoundCollider*>(this)->computeAABBOffset();
+			case e_triangleMesh:
+				return static_cast<const TriangleMeshCollider*>(this)->computeAABBOffset();
+			default:
+				return glm::vec3(0.0f);
+		}
 	}
 
 	/**
 	 * @brief Creates a BoxCollider object
 	 * 
+	 * The box is a unit cube centred on the origin in local space, which the
+	 * transform scales, rotates and moves into place.
+	 * 
 	 * @param position Position of object in global space
 	 * @param rotation Rotation about each of the axis in local space
 	 * @param scale Scale of the object along each axis 
@@ -63,53 +196,47 @@ namespace Physicc
 	BoxCollider::BoxCollider(glm::vec3 position,
 								glm::vec3 rotation,
 								glm::vec3 scale)
-		: Collider(position, rotation, scale),
-			m_vertices(std::vector<glm::vec4>(8, glm::vec4(0, 0, 0, 1.0f)))
+		: Collider(position, rotation, scale)
 	{
-		ZoneScoped;
-
-		//Top-face vertices
-		m_vertices[0] = glm::vec4(scale * 0.5f, 0);
-		m_vertices[1] = m_vertices[0] - glm::vec4(scale.x, 0, 0, 0);
-		m_vertices[2] = m_vertices[0] - glm::vec4(0, scale.y, 0, 0);
-		m_vertices[3] = m_vertices[0] - glm::vec4(scale.x, scale.y, 0, 0);
-
-		//Bottom-face vertices
-		m_vertices[4] = glm::vec4(scale * -0.5f, 0);
-		m_vertices[5] = m_vertices[0] + glm::vec4(scale.x, 0, 0, 0);
-		m_vertices[6] = m_vertices[0] + glm::vec4(0, scale.y, 0, 0);
-		m_vertices[7] = m_vertices[0] + glm::vec4(scale.x, scale.y, 0, 0);
+		m_objectType = e_box;
+		updateTransform();
 	}
 
 	/**
-	 * @brief Computes and returns Axis Aligned Bounding Box of Box shaped object
+	 * @brief Computes the half size of the Axis Aligned Bounding Box of Box
+	 * shaped object
 	 * 
-	 * Computes location of vertices in global space and finds the 
-	 * extreme points of AABB by comparing each component of every vertex
+	 * The furthest a corner reaches along a world axis is the sum of how far
+	 * each of the box's half axes reaches along it, so the extents are
+	 * |R| * halfExtents, with the absolute value taken per element. This
+	 * gives the same box as transforming all 8 corners.
 	 * 
-	 * @return BoundingVolume::AABB
+	 * @return glm::vec3
 	 */
-	BoundingVolume::AABB BoxCollider::getAABB() const
+	glm::vec3 BoxCollider::computeExtents() const
 	{
-		ZoneScoped;
+		PHYSICC_ZONE_FINE;
 
-		glm::vec3 lowerBound(0.5f);
-		glm::vec3 upperBound(-0.5f);
+		glm::mat3 absRotation(glm::abs(m_rotation[0]),
+		                      glm::abs(m_rotation[1]),
+		                      glm::abs(m_rotation[2]));
 
-		for (int i = 0; i < 8; i++)
-		{
-			glm::vec3 temp = m_transform * m_vertices[i];
-			lowerBound = glm::min(lowerBound, temp); //Takes component-wise min
-			upperBound = glm::max(upperBound, temp);
-		}
-
-		return {lowerBound, upperBound};
-		//returning initializer list instead of an actual object
+		return absRotation * getHalfExtents();
 	}
 
-	glm::vec3 BoxCollider::getCentroid() const
+	/**
+	 * @brief Returns the corner of the box furthest along a direction
+	 */
+	glm::vec3 BoxCollider::getSupport(const glm::vec3& direction) const
 	{
-		return m_position;
+		glm::vec3 localDirection = glm::transpose(m_rotation) * direction;
+		glm::vec3 halfExtents = getHalfExtents();
+
+		glm::vec3 corner(localDirection.x < 0.0f ? -halfExtents.x : halfExtents.x,
+		                 localDirection.y < 0.0f ? -halfExtents.y : halfExtents.y,
+		                 localDirection.z < 0.0f ? -halfExtents.z : halfExtents.z);
+
+		return m_position + m_rotation * corner;
 	}
 
 	/**
@@ -127,29 +254,380 @@ namespace Physicc
 									glm::vec3 scale)
 		: Collider(position, rotation, scale), m_radius(radius)
 	{
-		ZoneScoped;
+		PHYSICC_ZONE_FINE;
 
 		m_objectType = e_sphere;
+		updateTransform();
 	}
 
 	/**
-	 * @brief Computes and returns Axis Aligned Bounding Box of Sphere shaped object
+	 * @brief Computes the half size of the Axis Aligned Bounding Box of Sphere
+	 * shaped object
 	 * 
-	 * @return BoundingVolume::AABB
+	 * @return glm::vec3
 	 */
-	BoundingVolume::AABB SphereCollider::getAABB() const
+	glm::vec3 SphereCollider::computeExtents() const
+	{
+		return glm::vec3(m_radius);
+	}
+
+	glm::vec3 SphereCollider::getSupport(const glm::vec3& direction) const
 	{
-		ZoneScoped;
+		float length = glm::length(direction);
 
-		glm::vec3 lowerBound = m_position - m_radius;;
-		glm::vec3 upperBound = m_position + m_radius;
+		if (length == 0.0f)
+		{
+			return m_position + glm::vec3(m_radius, 0, 0);
+		}
 
-		return {lowerBound, upperBound};
+		return m_position + direction * (m_radius / length);
 	}
 
-	glm::vec3 SphereCollider::getCentroid() const
+	/**
+	 * @brief Creates a ConvexHullCollider object
+	 *
+	 * @param points Points the hull is built around, in local space
+	 * @param position Position of object in global space
+	 * @param rotation Rotation about each of the axis in local space
+	 * @param scale Scale of the object along each axis
+	 *
+	 */
+	ConvexHullCollider::ConvexHullCollider(const std::vector<glm::vec3>& points,
+	                                       glm::vec3 position,
+	                                       glm::vec3 rotation,
+	                                       glm::vec3 scale)
+		: Collider(position, rotation, scale), m_hull(buildHull(points))
 	{
-		return m_position;
+		PHYSICC_ZONE_FINE;
+
+		m_objectType = e_convexHull;
+		updateTransform();
 	}
-}
 
+	std::uint32_t ConvexHullCollider::findSupportVertex(const glm::vec3& direction) const
+	{
+		const std::vector<glm::vec3>& vertices = m_hull->vertices;
+
+		if (vertices.size() <= s_hillClimbingThreshold || m_hull->neighbors.empty())
+		{
+			std::uint32_t best = 0;
+			float bestDistance = glm::dot(vertices[0], direction);
+
+			for (std::uint32_t i = 1; i < vertices.size(); i++)
+			{
+				float distance = glm::dot(vertices[i], direction);
+
+				if (distance > bestDistance)
+				{
+					best = i;
+					bestDistance = distance;
+				}
+			}
+
+			return best;
+		}
+
+		//Start from the extreme vertex along the direction's largest
+		//component, which is usually close to the answer already
+		glm::vec3 absDirection = glm::abs(direction);
+		int axis = absDirection.x > absDirection.y
+			? (absDirection.x > absDirection.z ? 0 : 2)
+			: (absDirection.y > absDirection.z ? 1 : 2);
+
+		std::uint32_t best = m_hull->extremes[2 * axis + (direction[axis] < 0.0f ? 1 : 0)];
+		float bestDistance = glm::dot(vertices[best], direction);
+		bool improved = true;
+
+		while (improved)
+		{
+			improved = false;
+
+			for (std::uint32_t i = m_hull->neighborOffsets[best]; i != m_hull->neighborOffsets[best + 1]; i++)
+			{
+				std::uint32_t neighbor = m_hull->neighbors[i];
+				float distance = glm::dot(vertices[neighbor], direction);
+
+				if (distance > bestDistance)
+				{
+					best = neighbor;
+					bestDistance = distance;
+					improved = true;
+					break;
+				}
+			}
+		}
+
+		return best;
+	}
+
+	/**
+	 * @brief Returns the vertex of the hull furthest along a direction
+	 *
+	 * Scaling the hull by S and looking along d is the same as looking along
+	 * S * d at the unscaled hull, so the search runs on the stored vertices.
+	 */
+	glm::vec3 ConvexHullCollider::getSupport(const glm::vec3& direction) const
+	{
+		glm::vec3 localDirection = glm::transpose(m_rotation) * direction;
+		std::uint32_t vertex = findSupportVertex(m_scale * localDirection);
+
+		return m_position + m_rotation * (m_scale * m_hull->vertices[vertex]);
+	}
+
+	/**
+	 * @brief Computes the half size of the Axis Aligned Bounding Box of a
+	 * convex hull
+	 *
+	 * The furthest the hull reaches along a world axis, either way, is found
+	 * with the support function.
+	 *
+	 * @return glm::vec3
+	 */
+	glm::vec3 ConvexHullCollider::computeExtents() const
+	{
+		PHYSICC_ZONE_FINE;
+
+		glm::mat3 inverseRotation = glm::transpose(m_rotation);
+		glm::vec3 extents;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			glm::vec3 localDirection = m_scale * inverseRotation[axis];
+			glm::vec3 furthest = m_rotation * (m_scale * m_hull->vertices[findSupportVertex(localDirection)]);
+			glm::vec3 nearest = m_rotation * (m_scale * m_hull->vertices[findSupportVertex(-localDirection)]);
+
+			extents[axis] = glm::max(furthest[axis], -nearest[axis]);
+		}
+
+		return extents;
+	}
+
+	float ConvexHullCollider::computeBoundingRadius() const
+	{
+		float radius = 0.0f;
+
+		for (const glm::vec3& vertex : m_hull->vertices)
+		{
+			radius = glm::max(radius, glm::length(m_scale * vertex));
+		}
+
+		return radius;
+	}
+
+	glm::vec3 ConvexHullCollider::computeOrientedHalfExtents() const
+	{
+		glm::vec3 halfExtents(0.0f);
+
+		for (const glm::vec3& vertex : m_hull->vertices)
+		{
+			halfExtents = glm::max(halfExtents, glm::abs(m_scale * vertex));
+		}
+
+		return halfExtents;
+	}
+
+	/**
+	 * @brief Creates a CompoundCollider object
+	 *
+	 * Builds the tree over the children's AABBs in the compound's local
+	 * space.
+	 *
+	 * @param children The children, placed relative to the compound
+	 * @param position Position of object in global space
+	 * @param rotation Rotation about each of the axis in local space
+	 * @param scale Scale of the object along each axis. Not applied to the
+	 * children.
+	 *
+	 */
+	CompoundCollider::CompoundCollider(const std::vector<Child>& children,
+	                                   glm::vec3 position,
+	                                   glm::vec3 rotation,
+	                                   glm::vec3 scale)
+		: Collider(position, rotation, scale)
+	{
+		PHYSICC_ZONE_FINE;
+
+		auto shape = std::make_shared<Shape>();
+		shape->children = children;
+
+		std::vector<BoundingVolume::AABB> bounds;
+		bounds.reserve(children.size());
+
+		for (const Child& child : children)
+		{
+			bounds.push_back(std::visit([](const auto& collider) {
+				return collider.getAABB();
+			}, child));
+		}
+
+		std::vector<std::uint32_t> order(children.size());
+		std::iota(order.begin(), order.end(), 0);
+
+		if (!children.empty())
+		{
+			shape->nodes.reserve(2 * children.size() - 1);
+			buildNode(*shape, bounds, order, 0, children.size());
+		}
+
+		m_shape = std::move(shape);
+		m_objectType = e_compound;
+		updateTransform();
+	}
+
+	void CompoundCollider::buildNode(Shape& shape,
+	                                 const std::vector<BoundingVolume::AABB>& bounds,
+	                                 std::vector<std::uint32_t>& order,
+	                                 std::size_t start,
+	                                 std::size_t end)
+	{
+		std::size_t index = shape.nodes.size();
+		shape.nodes.emplace_back();
+
+		BoundingVolume::AABB nodeBounds = bounds[order[start]];
+		glm::vec3 minCentroid = nodeBounds.getCenter();
+		glm::vec3 maxCentroid = minCentroid;
+
+		for (std::size_t i = start + 1; i < end; i++)
+		{
+			nodeBounds = nodeBounds.enclosingBV(bounds[order[i]]);
+			minCentroid = glm::min(minCentroid, bounds[order[i]].getCenter());
+			maxCentroid = glm::max(maxCentroid, bounds[order[i]].getCenter());
+		}
+
+		shape.nodes[index].bounds = nodeBounds;
+
+		if (end - start == 1)
+		{
+			shape.nodes[index].offset = order[start];
+			shape.nodes[index].leaf = true;
+
+			return;
+		}
+
+		glm::vec3 spread = maxCentroid - minCentroid;
+		int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+		std::size_t middle = start + (end - start) / 2;
+
+		std::nth_element(order.begin() + start, order.begin() + middle, order.begin() + end,
+		                 [&bounds, axis](std::uint32_t a, std::uint32_t b) {
+			return bounds[a].getCenter()[axis] < bounds[b].getCenter()[axis];
+		});
+
+		buildNode(shape, bounds, order, start, middle);
+		shape.nodes[index].offset = static_cast<std::uint32_t>(shape.nodes.size());
+		shape.nodes[index].leaf = false;
+		buildNode(shape, bounds, order, middle, end);
+	}
+
+	CompoundCollider::Child CompoundCollider::getWorldChild(std::size_t index) const
+	{
+		PHYSICC_ZONE_FINE;
+
+		Child child = m_shape->children[index];
+
+		std::visit([this](auto& collider) {
+			collider.setPose(m_position + m_rotation * collider.getCentroid(),
+			                 m_orientation * collider.getOrientation());
+		}, child);
+
+		return child;
+	}
+
+	/**
+	 * @brief Returns the point furthest along a direction out of all the
+	 * children's
+	 *
+	 * This is the support function of the convex hull of the children, which
+	 * is all that the shape looks like to GJK. Collisions are found child by
+	 * child instead, see Narrowphase::collideCompound().
+	 */
+	glm::vec3 CompoundCollider::getSupport(const glm::vec3& direction) const
+	{
+		glm::vec3 localDirection = glm::transpose(m_rotation) * direction;
+		glm::vec3 best(0.0f);
+		float bestDistance = -std::numeric_limits<float>::infinity();
+
+		for (const Child& child : m_shape->children)
+		{
+			glm::vec3 support = std::visit([&localDirection](const auto& collider) {
+				return collider.getSupport(localDirection);
+			}, child);
+			float distance = glm::dot(support, localDirection);
+
+			if (distance > bestDistance)
+			{
+				best = support;
+				bestDistance = distance;
+			}
+		}
+
+		return m_position + m_rotation * best;
+	}
+
+	/**
+	 * @brief Computes the half size of the Axis Aligned Bounding Box of a
+	 * compound
+	 *
+	 * Rotates the box around all the children (the root of their tree) the
+	 * same way as BoxCollider::computeExtents(). That box need not be
+	 * centred on the compound's position, see computeAABBOffset().
+	 *
+	 * @return glm::vec3
+	 */
+	glm::vec3 CompoundCollider::computeExtents() const
+	{
+		PHYSICC_ZONE_FINE;
+
+		if (m_shape->nodes.empty())
+		{
+			return glm::vec3(0.0f);
+		}
+
+		const BoundingVolume::AABB& bounds = m_shape->nodes[0].bounds;
+		glm::mat3 absRotation(glm::abs(m_rotation[0]),
+		                      glm::abs(m_rotation[1]),
+		                      glm::abs(m_rotation[2]));
+
+		return absRotation * (0.5f * (bounds.getUpperBound() - bounds.getLowerBound()));
+	}
+
+	/**
+	 * @brief Computes where the centre of the box around all the children
+	 * ends up relative to the compound's position
+	 */
+	glm::vec3 CompoundCollider::computeAABBOffset() const
+	{
+		if (m_shape->nodes.empty())
+		{
+			return glm::vec3(0.0f);
+		}
+
+		return m_rotation * m_shape->nodes[0].bounds.getCenter();
+	}
+
+	float CompoundCollider::computeBoundingRadius() const
+	{
+		float radius = 0.0f;
+
+		for (const Child& child : m_shape->children)
+		{
+			radius = glm::max(radius, std::visit([](const auto& collider) {
+				return glm::length(collider.getCentroid()) + collider.getBoundingRadius();
+			}, child));
+		}
+
+		return radius;
+	}
+
+	glm::vec3 CompoundCollider::computeOrientedHalfExtents() const
+	{
+		if (m_shape->nodes.empty())
+		{
+			return glm::vec3(0.0f);
+		}
+
+		const BoundingVolume::AABB& bounds = m_shape->nodes[0].bounds;
+
+		return glm::max(glm::abs(bounds.getLowerBound()), glm::abs(bounds.getUpperBound()));
+	}
+}
@@ -0,0 +1,151 @@
+#include "profiling.hpp"
+/**
+ * @file colliderstore.cpp
+ * @brief Stores colliders in one array per shape.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* colliderstore header */
+
+#include "colliderstore.hpp"
+
+namespace Physicc
+{
+	ColliderHandle ColliderStore::add(const BoxCollider& collider, std::uint32_t body)
+	{
+		m_boxes.push_back(collider);
+		m_boxBodies.push_back(body);
+
+		return {Collider::e_box, static_cast<std::uint32_t>(m_boxes.size() - 1)};
+	}
+
+	ColliderHandle ColliderStore::add(const SphereCollider& collider, std::uint32_t body)
+	{
+		m_spheres.push_back(collider);
+		m_sphereBodies.push_back(body);
+
+		return {Collider::e_sphere, static_cast<std::uint32_t>(m_spheres.size() - 1)};
+	}
+
+	ColliderHandle ColliderStore::add(const ConvexHullCollider& collider, std::uint32_t body)
+	{
+		m_convexHulls.push_back(collider);
+		m_convexHullBodies.push_back(body);
+
+		return {Collider::e_convexHull, static_cast<std::uint32_t>(m_convexHulls.size() - 1)};
+	}
+
+	ColliderHandle ColliderStore::add(const CompoundCollider& collider, std::uint32_t body)
+	{
+		m_compounds.push_back(collider);
+		m_compoundBodies.push_back(body);
+
+		return {Collider::e_compound, static_cast<std::uint32_t>(m_compounds.size() - 1)};
+	}
+
+	ColliderHandle ColliderStore::add(const TriangleMeshCollider& collider, std::uint32_t body)
+	{
+		m_triangleMeshes.push_back(collider);
+		m_triangleMeshBodies.push_back(body);
+
+		return {Collider::e_triangleMesh, static_cast<std::uint32_t>(m_triangleMeshes.size() - 1)};
+	}
+
+	void ColliderStore::clear()
+	{
+		m_boxes.clear();
+		m_boxBodies.clear();
+		m_spheres.clear();
+		m_sphereBodies.clear();
+		m_convexHulls.clear();
+		m_convexHullBodies.clear();
+		m_compounds.clear();
+		m_compoundBodies.clear();
+		m_triangleMeshes.clear();
+		m_triangleMeshBodies.clear();
+	}
+
+	const Collider& ColliderStore::get(ColliderHandle handle) const
+	{
+		switch (handle.getType())
+		{
+			case Collider::e_sphere:
+				return m_spheres[handle.getIndex()];
+			case Collider::e_convexHull:
+				return m_convexHulls[handle.getIndex()];
+			case Collider::e_compound:
+				return m_compounds[handle.getIndex()];
+			case Collider::e_triangleMesh:
+				return m_triangleMeshes[handle.getIndex()];
+			case Collider::e_box:
+			default:
+				return m_boxes[handle.getIndex()];
+		}
+	}
+
+	Collider& ColliderStore::get(ColliderHandle handle)
+	{
+		switch (handle.getType())
+		{
+			case Collider::e_sphere:
+				return m_spheres[handle.getIndex()];
+			case Collider::e_convexHull:
+				return m_convexHulls[handle.getIndex()];
+			case Collider::e_compound:
+				return m_compounds[handle.getIndex()];
+			case Collider::e_triangleMesh:
+				return m_triangleMeshes[handle.getIndex()];
+			case Collider::e_box:
+			default:
+				return m_boxes[handle.getIndex()];
+		}
+	}
+
+	void ColliderStore::updateBounds(const std::vector<glm::vec3>& positions,
+	                                 const std::vector<std::uint8_t>& awake,
+	                                 std::vector<BoundingVolume::AABB>& volumes,
+	                                 JobSystem& jobSystem)
+	{
+		PHYSICC_ZONE_FINE;
+
+		updatePoolBounds(m_boxes, m_boxBodies, positions, awake, volumes, jobSystem);
+		updatePoolBounds(m_spheres, m_sphereBodies, positions, awake, volumes, jobSystem);
+		updatePoolBounds(m_convexHulls, m_convexHullBodies, positions, awake, volumes, jobSystem);
+		updatePoolBounds(m_compounds, m_compoundBodies, positions, awake, volumes, jobSystem);
+		updatePoolBounds(m_triangleMeshes, m_triangleMeshBodies, positions, awake, volumes, jobSystem);
+	}
+
+	template <typename Shape>
+	void ColliderStore::updatePoolBounds(std::vector<Shape>& shapes,
+	                                     const std::vector<std::uint32_t>& bodies,
+	                                     const std::vector<glm::vec3>& positions,
+	                                     const std::vector<std::uint8_t>& awake,
+	                                     std::vector<BoundingVolume::AABB>& volumes,
+	                                     JobSystem& jobSystem)
+	{
+		jobSystem.parallelFor(shapes.size(), s_boundsGrainSize,
+		                      [&](std::size_t start, std::size_t end) {
+			Shape* shapeData = shapes.data();
+			const std::uint32_t* bodyData = bodies.data();
+			const glm::vec3* positionData = positions.data();
+			const std::uint8_t* awakeData = awake.data();
+			BoundingVolume::AABB* volumeData = volumes.data();
+
+			for (std::size_t i = start; i < end; i++)
+			{
+				std::uint32_t body = bodyData[i];
+
+				if (!awakeData[body])
+				{
+					continue;
+				}
+
+				shapeData[i].setPosition(positionData[body]);
+				shapeData[i].updateTransform();
+				volumeData[body] = shapeData[i].getAABB();
+			}
+		});
+	}
+}
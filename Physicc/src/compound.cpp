@@ -0,0 +1,202 @@
+#include "profiling.hpp"
+/**
+ * @file compound.cpp
+ * @brief Collision test between a compound and any other collider.
+ *
+ * Every child near the other collider is moved into world space and tested
+ * against it like any other shape, then the contacts the children found
+ * are merged into the single manifold a pair of bodies gets. Meshes reuse
+ * the merging, see meshcollision.cpp.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* narrowphase header */
+
+#include "narrowphase.hpp"
+
+#include <array>
+#include <limits>
+
+namespace Physicc
+{
+	namespace Narrowphase
+	{
+		namespace
+		{
+			constexpr float s_normalTolerance = 0.9f;
+			//cosine of the largest angle between the normal of a contact
+			//and the deepest one for its points to be kept
+
+			float getDepth(const ContactManifold& manifold)
+			{
+				float depth = -std::numeric_limits<float>::infinity();
+
+				for (std::uint32_t i = 0; i < manifold.pointCount; i++)
+				{
+					depth = glm::max(depth, manifold.points[i].penetration);
+				}
+
+				return depth;
+			}
+		}
+
+		void ContactMerger::add(const ContactManifold& contact)
+		{
+			if (contact.pointCount == 0)
+			{
+				return;
+			}
+
+			float depth = getDepth(contact);
+			std::size_t slot = m_count;
+
+			if (m_count < s_maxContacts)
+			{
+				m_count++;
+			} else
+			{
+				slot = 0;
+
+				for (std::size_t i = 1; i < s_maxContacts; i++)
+				{
+					if (m_depths[i] < m_depths[slot])
+					{
+						slot = i;
+					}
+				}
+
+				if (m_depths[slot] >= depth)
+				{
+					return;
+				}
+			}
+
+			m_contacts[slot] = contact;
+			m_depths[slot] = depth;
+		}
+
+		bool ContactMerger::merge(ContactManifold& manifold) const
+		{
+			manifold.pointCount = 0;
+
+			if (m_count == 0)
+			{
+				return false;
+			}
+
+			std::size_t deepest = 0;
+
+			for (std::size_t i = 1; i < m_count; i++)
+			{
+				if (m_depths[i] > m_depths[deepest])
+				{
+					deepest = i;
+				}
+			}
+
+			manifold.normal = m_contacts[deepest].normal;
+
+			//Gather the points of every contact along roughly the same
+			//normal, with their penetration measured along that normal
+			std::array<ContactPoint, s_maxContacts * ContactManifold::s_maxPoints> candidates;
+			std::size_t candidateCount = 0;
+
+			for (std::size_t i = 0; i < m_count; i++)
+			{
+				float alignment = glm::dot(m_contacts[i].normal, manifold.normal);
+
+				if (alignment < s_normalTolerance)
+				{
+					continue;
+				}
+
+				for (std::uint32_t j = 0; j < m_contacts[i].pointCount; j++)
+				{
+					const ContactPoint& point = m_contacts[i].points[j];
+					candidates[candidateCount++] = {point.position, point.penetration * alignment};
+				}
+			}
+
+			if (candidateCount <= ContactManifold::s_maxPoints)
+			{
+				for (std::size_t i = 0; i < candidateCount; i++)
+				{
+					manifold.addPoint(candidates[i].position, candidates[i].penetration);
+				}
+
+				return true;
+			}
+
+			//Keep the deepest point, then over and over the point furthest
+			//from all those kept so far, which spreads the points over the
+			//whole area of contact
+			std::size_t first = 0;
+
+			for (std::size_t i = 1; i < candidateCount; i++)
+			{
+				if (candidates[i].penetration > candidates[first].penetration)
+				{
+					first = i;
+				}
+			}
+
+			manifold.addPoint(candidates[first].position, candidates[first].penetration);
+
+			while (manifold.pointCount < ContactManifold::s_maxPoints)
+			{
+				std::size_t furthest = 0;
+				float furthestDistance = -1.0f;
+
+				for (std::size_t i = 0; i < candidateCount; i++)
+				{
+					float distance = std::numeric_limits<float>::infinity();
+
+					for (std::uint32_t j = 0; j < manifold.pointCount; j++)
+					{
+						glm::vec3 offset = candidates[i].position - manifold.points[j].position;
+						distance = glm::min(distance, glm::dot(offset, offset));
+					}
+
+					if (distance > furthestDistance)
+					{
+						furthest = i;
+						furthestDistance = distance;
+					}
+				}
+
+				manifold.addPoint(candidates[furthest].position, candidates[furthest].penetration);
+			}
+
+			return true;
+		}
+
+		bool collideCompound(const CompoundCollider& compound,
+		                     const Collider& other,
+		                     ContactManifold& manifold)
+		{
+			PHYSICC_ZONE_FINE;
+
+			ContactMerger merger;
+			ContactManifold childManifold;
+
+			compound.queryChildren(other.getAABB(), [&](std::uint32_t index) {
+				CompoundCollider::Child child = compound.getWorldChild(index);
+				const Collider& childCollider = std::visit([](const auto& collider) -> const Collider& {
+					return collider;
+				}, child);
+
+				if (childCollider.getAABB().overlapsWith(other.getAABB())
+				    && collide(childCollider, other, childManifold))
+				{
+					merger.add(childManifold);
+				}
+
+				return true;
+			});
+
+			return merger.merge(manifold);
+		}
+	}
+}
@@ -0,0 +1,444 @@
+#include "profiling.hpp"
+/**
+ * @file contactsolver.cpp
+ * @brief A sequential impulse contact solver.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* contactsolver header */
+
+#include "contactsolver.hpp"
+
+#include <cmath>
+
+namespace Physicc
+{
+	namespace
+	{
+		/**
+		 * @brief Two unit vectors perpendicular to the normal and each other
+		 */
+		void getTangents(const glm::vec3& normal, glm::vec3 (&tangents)[2])
+		{
+			//Build the first tangent from the two largest components of the
+			//normal, so it cannot end up (close to) zero
+			if (std::abs(normal.x) >= 0.57735f)
+			{
+				tangents[0] = glm::normalize(glm::vec3(normal.y, -normal.x, 0.0f));
+			} else
+			{
+				tangents[0] = glm::normalize(glm::vec3(0.0f, normal.z, -normal.y));
+			}
+
+			tangents[1] = glm::cross(normal, tangents[0]);
+		}
+	}
+
+	void ContactSolver::applyImpulse(const ContactConstraint& constraint,
+	                                 const glm::vec3& impulse,
+	                                 std::vector<glm::vec3>& velocities)
+	{
+		//Static bodies are shared between islands, and between the
+		//constraints of a color. Leaving them alone keeps threads from
+		//writing to them at the same time.
+		if (constraint.inverseMassFirst != 0.0f)
+		{
+			velocities[constraint.first] -= impulse * constraint.inverseMassFirst;
+		}
+
+		if (constraint.inverseMassSecond != 0.0f)
+		{
+			velocities[constraint.second] += impulse * constraint.inverseMassSecond;
+		}
+	}
+
+	void ContactSolver::prepare(const std::vector<ContactManifold>& manifolds,
+	                            const std::vector<glm::vec3>& positions,
+	                            const std::vector<glm::vec3>& velocities,
+	                            const std::vector<float>& inverseMasses,
+	                            const std::vector<float>& frictions,
+	                            const std::vector<float>& restitutions,
+	                            float timestep,
+	                            JobSystem& jobSystem)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		m_constraints.resize(manifolds.size());
+
+		jobSystem.parallelFor(manifolds.size(), s_prepareGrainSize, [&](std::size_t start, std::size_t end) {
+			for (std::size_t i = start; i < end; i++)
+			{
+				const ContactManifold& manifold = manifolds[i];
+				ContactConstraint& constraint = m_constraints[i];
+
+				constraint.first = manifold.first;
+				constraint.second = manifold.second;
+				constraint.normal = manifold.normal;
+				getTangents(manifold.normal, constraint.tangents);
+
+				constraint.inverseMassFirst = inverseMasses[manifold.first];
+				constraint.inverseMassSecond = inverseMasses[manifold.second];
+
+				float inverseMassSum = constraint.inverseMassFirst + constraint.inverseMassSecond;
+				constraint.effectiveMass = inverseMassSum > 0.0f ? 1.0f / inverseMassSum : 0.0f;
+
+				constraint.friction = std::sqrt(frictions[manifold.first] * frictions[manifold.second]);
+				float restitution = glm::max(restitutions[manifold.first], restitutions[manifold.second]);
+
+				//Bounce off the velocity the bodies approached each other
+				//with before any impulses were applied
+				float normalVelocity = glm::dot(velocities[manifold.second] - velocities[manifold.first],
+				                                manifold.normal);
+				float bounce = normalVelocity < -s_restitutionThreshold ? -restitution * normalVelocity : 0.0f;
+
+				const CachedManifold* cached = nullptr;
+
+				if (m_warmStarting)
+				{
+					auto found = m_cache.find(getKey(manifold.first, manifold.second));
+
+					if (found != m_cache.end())
+					{
+						cached = &found->second;
+					}
+				}
+
+				constraint.pointCount = manifold.pointCount;
+
+				for (std::uint32_t j = 0; j < manifold.pointCount; j++)
+				{
+					ConstraintPoint& point = constraint.points[j];
+
+					point.offset = manifold.points[j].position - positions[manifold.first];
+
+					float push = s_baumgarte / timestep
+						* glm::max(manifold.points[j].penetration - s_penetrationSlop, 0.0f);
+					point.bias = glm::max(push, bounce);
+
+					point.normalImpulse = 0.0f;
+					point.tangentImpulses[0] = 0.0f;
+					point.tangentImpulses[1] = 0.0f;
+
+					if (cached == nullptr)
+					{
+						continue;
+					}
+
+					for (std::uint32_t k = 0; k < cached->pointCount; k++)
+					{
+						const CachedPoint& cachedPoint = cached->points[k];
+						glm::vec3 moved = cachedPoint.offset - point.offset;
+
+						if (glm::dot(moved, moved) < s_matchDistance * s_matchDistance)
+						{
+							point.normalImpulse = cachedPoint.normalImpulse;
+							point.tangentImpulses[0] = glm::dot(cachedPoint.tangentImpulse, constraint.tangents[0]);
+							point.tangentImpulses[1] = glm::dot(cachedPoint.tangentImpulse, constraint.tangents[1]);
+
+							break;
+						}
+					}
+				}
+			}
+		});
+	}
+
+	void ContactSolver::warmStart(const ContactConstraint& constraint, std::vector<glm::vec3>& velocities)
+	{
+		for (std::uint32_t i = 0; i < constraint.pointCount; i++)
+		{
+			const ConstraintPoint& point = constraint.points[i];
+
+			applyImpulse(constraint,
+			             constraint.normal * point.normalImpulse
+			             + constraint.tangents[0] * point.tangentImpulses[0]
+			             + constraint.tangents[1] * point.tangentImpulses[1],
+			             velocities);
+		}
+	}
+
+	void ContactSolver::solveConstraint(ContactConstraint& constraint, std::vector<glm::vec3>& velocities)
+	{
+		for (std::uint32_t i = 0; i < constraint.pointCount; i++)
+		{
+			ConstraintPoint& point = constraint.points[i];
+
+			//Friction first, the non-penetration constraint matters more so
+			//it gets the last word
+			float maxFriction = constraint.friction * point.normalImpulse;
+
+			for (int j = 0; j < 2; j++)
+			{
+				const glm::vec3& tangent = constraint.tangents[j];
+				float tangentVelocity = glm::dot(velocities[constraint.second] - velocities[constraint.first],
+				                                 tangent);
+
+				float impulse = -tangentVelocity * constraint.effectiveMass;
+				float accumulated = glm::clamp(point.tangentImpulses[j] + impulse, -maxFriction, maxFriction);
+				impulse = accumulated - point.tangentImpulses[j];
+				point.tangentImpulses[j] = accumulated;
+
+				applyImpulse(constraint, tangent * impulse, velocities);
+			}
+
+			float normalVelocity = glm::dot(velocities[constraint.second] - velocities[constraint.first],
+			                                constraint.normal);
+
+			float impulse = (point.bias - normalVelocity) * constraint.effectiveMass;
+			float accumulated = glm::max(point.normalImpulse + impulse, 0.0f);
+			impulse = accumulated - point.normalImpulse;
+			point.normalImpulse = accumulated;
+
+			applyImpulse(constraint, constraint.normal * impulse, velocities);
+		}
+	}
+
+	void ContactSolver::solve(const IslandBuilder& islands,
+	                          std::vector<glm::vec3>& velocities,
+	                          JobSystem& jobSystem)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		const std::vector<IslandBuilder::Island>& islandList = islands.getIslands();
+		const std::vector<std::uint32_t>& islandConstraints = islands.getContacts();
+
+		//Batch up small islands, and give every large island a task of its
+		//own. This only depends on the sizes of the islands.
+		m_tasks.clear();
+		std::uint32_t batchSize = 0;
+
+		for (std::uint32_t i = 0; i < islandList.size(); i++)
+		{
+			std::uint32_t constraintCount = islandList[i].contactCount;
+
+			if (constraintCount == 0)
+			{
+				continue;
+			}
+
+			if (constraintCount > m_largeIslandSize)
+			{
+				m_tasks.push_back({i, 1, true});
+				batchSize = 0;
+
+				continue;
+			}
+
+			if (batchSize == 0 || batchSize >= s_batchSize)
+			{
+				m_tasks.push_back({i, 0, false});
+				batchSize = 0;
+			}
+
+			m_tasks.back().islandCount = i + 1 - m_tasks.back().islandStart;
+			batchSize += constraintCount;
+		}
+
+		m_bodyColors.resize(velocities.size(), 0);
+		m_coloredConstraints.resize(islandConstraints.size());
+		m_coloredIslands.resize(m_tasks.size());
+
+		jobSystem.parallelFor(m_tasks.size(), 1, [&](std::size_t start, std::size_t end) {
+			for (std::size_t i = start; i < end; i++)
+			{
+				const SolveTask& task = m_tasks[i];
+				const IslandBuilder::Island& first = islandList[task.islandStart];
+				const IslandBuilder::Island& last = islandList[task.islandStart + task.islandCount - 1];
+
+				//The constraints of consecutive islands are consecutive too
+				std::uint32_t constraintStart = first.contactStart;
+				std::uint32_t constraintCount = last.contactStart + last.contactCount - constraintStart;
+
+				if (task.isColored)
+				{
+					colorIsland(islandConstraints.data() + constraintStart,
+					            constraintCount,
+					            m_coloredConstraints.data() + constraintStart,
+					            m_coloredIslands[i]);
+					solveColored(m_coloredConstraints.data() + constraintStart,
+					             m_coloredIslands[i],
+					             velocities,
+					             jobSystem);
+				} else
+				{
+					//The islands are independent, so solving a batch of them
+					//together is the same as solving them one after another
+					solveSerial(islandConstraints.data() + constraintStart, constraintCount, velocities);
+				}
+			}
+		});
+	}
+
+	void ContactSolver::solveSerial(const std::uint32_t* constraints,
+	                                std::size_t count,
+	                                std::vector<glm::vec3>& velocities)
+	{
+		PHYSICC_ZONE_FINE;
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			warmStart(m_constraints[constraints[i]], velocities);
+		}
+
+		for (unsigned int iteration = 0; iteration < m_iterations; iteration++)
+		{
+			for (std::size_t i = 0; i < count; i++)
+			{
+				solveConstraint(m_constraints[constraints[i]], velocities);
+			}
+		}
+	}
+
+	void ContactSolver::colorIsland(const std::uint32_t* constraints,
+	                                std::size_t count,
+	                                std::uint32_t* coloredConstraints,
+	                                ColoredIsland& coloredIsland)
+	{
+		PHYSICC_ZONE_FINE;
+
+		//Greedy coloring: every constraint takes the lowest color neither of
+		//its dynamic bodies has yet
+		std::vector<std::uint32_t> colors(count);
+		coloredIsland.colorStarts.assign(s_maxColors + 2, 0);
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			const ContactConstraint& constraint = m_constraints[constraints[i]];
+			std::uint64_t used = 0;
+
+			if (constraint.inverseMassFirst != 0.0f)
+			{
+				used |= m_bodyColors[constraint.first];
+			}
+
+			if (constraint.inverseMassSecond != 0.0f)
+			{
+				used |= m_bodyColors[constraint.second];
+			}
+
+			std::uint32_t color = 0;
+
+			while (color < s_maxColors && (used & (std::uint64_t(1) << color)))
+			{
+				color++;
+			}
+
+			if (color < s_maxColors)
+			{
+				if (constraint.inverseMassFirst != 0.0f)
+				{
+					m_bodyColors[constraint.first] |= std::uint64_t(1) << color;
+				}
+
+				if (constraint.inverseMassSecond != 0.0f)
+				{
+					m_bodyColors[constraint.second] |= std::uint64_t(1) << color;
+				}
+			}
+
+			colors[i] = color;
+			coloredIsland.colorStarts[color + 1]++;
+		}
+
+		//Sort the constraints by color, keeping their order within a color
+		for (std::uint32_t color = 0; color <= s_maxColors; color++)
+		{
+			coloredIsland.colorStarts[color + 1] += coloredIsland.colorStarts[color];
+		}
+
+		std::vector<std::uint32_t> positions(coloredIsland.colorStarts.begin(), coloredIsland.colorStarts.end() - 1);
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			coloredConstraints[positions[colors[i]]++] = constraints[i];
+		}
+
+		//Leave the colors clean for the next island
+		for (std::size_t i = 0; i < count; i++)
+		{
+			const ContactConstraint& constraint = m_constraints[constraints[i]];
+
+			if (constraint.inverseMassFirst != 0.0f)
+			{
+				m_bodyColors[constraint.first] = 0;
+			}
+
+			if (constraint.inverseMassSecond != 0.0f)
+			{
+				m_bodyColors[constraint.second] = 0;
+			}
+		}
+	}
+
+	void ContactSolver::solveColored(const std::uint32_t* coloredConstraints,
+	                                 const ColoredIsland& coloredIsland,
+	                                 std::vector<glm::vec3>& velocities,
+	                                 JobSystem& jobSystem)
+	{
+		PHYSICC_ZONE_FINE;
+
+		const std::vector<std::uint32_t>& colorStarts = coloredIsland.colorStarts;
+
+		auto forEachColor = [&](auto&& function) {
+			for (std::uint32_t color = 0; color < s_maxColors; color++)
+			{
+				std::uint32_t colorStart = colorStarts[color];
+				std::uint32_t colorCount = colorStarts[color + 1] - colorStart;
+
+				jobSystem.parallelFor(colorCount, s_colorGrainSize, [&](std::size_t start, std::size_t end) {
+					for (std::size_t i = start; i < end; i++)
+					{
+						function(m_constraints[coloredConstraints[colorStart + i]]);
+					}
+				});
+			}
+
+			//Whatever did not fit in the colors goes last, on this thread
+			for (std::uint32_t i = colorStarts[s_maxColors]; i < colorStarts[s_maxColors + 1]; i++)
+			{
+				function(m_constraints[coloredConstraints[i]]);
+			}
+		};
+
+		forEachColor([&velocities](ContactConstraint& constraint) {
+			warmStart(constraint, velocities);
+		});
+
+		for (unsigned int iteration = 0; iteration < m_iterations; iteration++)
+		{
+			forEachColor([&velocities](ContactConstraint& constraint) {
+				solveConstraint(constraint, velocities);
+			});
+		}
+	}
+
+	void ContactSolver::storeImpulses()
+	{
+		PHYSICC_ZONE_COARSE;
+
+		m_cache.clear();
+
+		if (!m_warmStarting)
+		{
+			return;
+		}
+
+		for (const ContactConstraint& constraint : m_constraints)
+		{
+			CachedManifold& cached = m_cache[getKey(constraint.first, constraint.second)];
+			cached.pointCount = constraint.pointCount;
+
+			for (std::uint32_t i = 0; i < constraint.pointCount; i++)
+			{
+				const ConstraintPoint& point = constraint.points[i];
+
+				cached.points[i] = {point.offset,
+				                    point.normalImpulse,
+				                    constraint.tangents[0] * point.tangentImpulses[0]
+				                    + constraint.tangents[1] * point.tangentImpulses[1]};
+			}
+		}
+	}
+}
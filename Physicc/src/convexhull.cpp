@@ -0,0 +1,467 @@
+#include "profiling.hpp"
+/**
+ * @file convexhull.cpp
+ * @brief Builds the hull of a ConvexHullCollider.
+ *
+ * The hull is grown one point at a time, starting from a tetrahedron: a
+ * point outside the current hull sees some of its faces, which are replaced
+ * by a fan of triangles joining the point to the edges around them (the
+ * horizon). This is quadratic in the number of points, which is fine for
+ * the few dozen to few hundred points of a collision hull, and it only runs
+ * once per shape.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* collider header */
+
+#include "collider.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+namespace Physicc
+{
+	namespace
+	{
+		constexpr float s_relativeTolerance = 1e-4f;
+		//points closer than this times the size of the cloud to the hull
+		//count as being on it, which keeps nearly coplanar points from
+		//producing slivers
+
+		constexpr std::uint32_t s_unused = std::numeric_limits<std::uint32_t>::max();
+
+		/**
+		 * @brief A triangle of the hull, wound counter-clockwise as seen from
+		 * outside
+		 */
+		struct Face
+		{
+			std::array<std::uint32_t, 3> vertices;
+			glm::vec3 normal;
+			float offset;
+			//the face's plane is dot(normal, x) = offset
+		};
+
+		Face makeFace(const std::vector<glm::vec3>& points,
+		              std::uint32_t a,
+		              std::uint32_t b,
+		              std::uint32_t c)
+		{
+			glm::vec3 normal = glm::normalize(glm::cross(points[b] - points[a], points[c] - points[a]));
+
+			return {{a, b, c}, normal, glm::dot(normal, points[a])};
+		}
+
+		inline float distanceToFace(const Face& face, const glm::vec3& point)
+		{
+			return glm::dot(face.normal, point) - face.offset;
+		}
+
+		inline std::uint64_t edgeKey(std::uint32_t from, std::uint32_t to)
+		{
+			return (static_cast<std::uint64_t>(from) << 32) | to;
+		}
+
+		/**
+		 * @brief Find four points spanning a tetrahedron as large as is
+		 * cheaply possible
+		 *
+		 * @return false if the points do not span a volume
+		 */
+		bool findTetrahedron(const std::vector<glm::vec3>& points,
+		                     float tolerance,
+		                     std::array<std::uint32_t, 4>& tetrahedron)
+		{
+			//The two points furthest apart out of those extreme along an axis
+			std::array<std::uint32_t, 6> extremes{};
+
+			for (std::uint32_t i = 0; i < points.size(); i++)
+			{
+				for (int axis = 0; axis < 3; axis++)
+				{
+					if (points[i][axis] > points[extremes[2 * axis]][axis])
+					{
+						extremes[2 * axis] = i;
+					}
+
+					if (points[i][axis] < points[extremes[2 * axis + 1]][axis])
+					{
+						extremes[2 * axis + 1] = i;
+					}
+				}
+			}
+
+			float bestDistance = -1.0f;
+
+			for (std::uint32_t i : extremes)
+			{
+				for (std::uint32_t j : extremes)
+				{
+					float distance = glm::length(points[i] - points[j]);
+
+					if (distance > bestDistance)
+					{
+						bestDistance = distance;
+						tetrahedron[0] = i;
+						tetrahedron[1] = j;
+					}
+				}
+			}
+
+			if (bestDistance <= tolerance)
+			{
+				return false;
+			}
+
+			//The point furthest from the line through them
+			glm::vec3 lineDirection = glm::normalize(points[tetrahedron[1]] - points[tetrahedron[0]]);
+			bestDistance = -1.0f;
+
+			for (std::uint32_t i = 0; i < points.size(); i++)
+			{
+				float distance = glm::length(glm::cross(points[i] - points[tetrahedron[0]], lineDirection));
+
+				if (distance > bestDistance)
+				{
+					bestDistance = distance;
+					tetrahedron[2] = i;
+				}
+			}
+
+			if (bestDistance <= tolerance)
+			{
+				return false;
+			}
+
+			//The point furthest from the plane through all three
+			glm::vec3 normal = glm::normalize(glm::cross(points[tetrahedron[1]] - points[tetrahedron[0]],
+			                                             points[tetrahedron[2]] - points[tetrahedron[0]]));
+			bestDistance = -1.0f;
+
+			for (std::uint32_t i = 0; i < points.size(); i++)
+			{
+				float distance = glm::abs(glm::dot(points[i] - points[tetrahedron[0]], normal));
+
+				if (distance > bestDistance)
+				{
+					bestDistance = distance;
+					tetrahedron[3] = i;
+				}
+			}
+
+			return bestDistance > tolerance;
+		}
+
+		/**
+		 * @brief Compute the faces of the convex hull of a cloud of points
+		 *
+		 * @return The faces, or nothing if the points do not span a volume
+		 */
+		std::vector<Face> computeFaces(const std::vector<glm::vec3>& points)
+		{
+			if (points.size() < 4)
+			{
+				return {};
+			}
+
+			glm::vec3 lowerBound = points[0];
+			glm::vec3 upperBound = points[0];
+
+			for (const glm::vec3& point : points)
+			{
+				lowerBound = glm::min(lowerBound, point);
+				upperBound = glm::max(upperBound, point);
+			}
+
+			float tolerance = s_relativeTolerance * glm::length(upperBound - lowerBound);
+			std::array<std::uint32_t, 4> tetrahedron;
+
+			if (!findTetrahedron(points, tolerance, tetrahedron))
+			{
+				return {};
+			}
+
+			glm::vec3 inside = 0.25f * (points[tetrahedron[0]] + points[tetrahedron[1]]
+				+ points[tetrahedron[2]] + points[tetrahedron[3]]);
+
+			std::vector<Face> faces;
+
+			for (int skipped = 0; skipped < 4; skipped++)
+			{
+				std::array<std::uint32_t, 3> corners;
+				int count = 0;
+
+				for (int i = 0; i < 4; i++)
+				{
+					if (i != skipped)
+					{
+						corners[count++] = tetrahedron[i];
+					}
+				}
+
+				Face face = makeFace(points, corners[0], corners[1], corners[2]);
+
+				if (distanceToFace(face, inside) > 0.0f)
+				{
+					face = makeFace(points, corners[0], corners[2], corners[1]);
+				}
+
+				faces.push_back(face);
+			}
+
+			//Adding the points furthest out first leaves fewer points to
+			//add, as most of the rest end up inside
+			std::vector<std::uint32_t> order(points.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::sort(order.begin(), order.end(), [&points, &inside](std::uint32_t a, std::uint32_t b) {
+				return glm::dot(points[a] - inside, points[a] - inside)
+					> glm::dot(points[b] - inside, points[b] - inside);
+			});
+
+			std::vector<Face> keptFaces;
+			std::vector<float> distances;
+			std::vector<std::uint8_t> visible;
+			std::vector<std::pair<std::uint64_t, std::uint32_t>> edges;
+			std::vector<std::uint32_t> stack;
+
+			for (std::uint32_t point : order)
+			{
+				if (std::find(tetrahedron.begin(), tetrahedron.end(), point) != tetrahedron.end())
+				{
+					continue;
+				}
+
+				distances.resize(faces.size());
+				std::uint32_t furthest = 0;
+
+				for (std::uint32_t i = 0; i < faces.size(); i++)
+				{
+					distances[i] = distanceToFace(faces[i], points[point]);
+
+					if (distances[i] > distances[furthest])
+					{
+						furthest = i;
+					}
+				}
+
+				if (distances[furthest] <= tolerance)
+				{
+					continue;
+				}
+
+				//The faces the point sees are those reachable from the one
+				//it is furthest in front of. Rounding can make a stray face
+				//elsewhere look visible too, and replacing it would fold the
+				//hull over itself. Next to the furthest face, even faces the
+				//point is only barely in front of are replaced, as keeping
+				//them would leave a slightly concave edge for hill climbing
+				//to get stuck at.
+				edges.clear();
+
+				for (std::uint32_t i = 0; i < faces.size(); i++)
+				{
+					for (int j = 0; j < 3; j++)
+					{
+						edges.push_back({edgeKey(faces[i].vertices[j], faces[i].vertices[(j + 1) % 3]), i});
+					}
+				}
+
+				std::sort(edges.begin(), edges.end());
+
+				auto findFace = [&edges](std::uint32_t from, std::uint32_t to) {
+					auto found = std::lower_bound(edges.begin(), edges.end(), std::make_pair(edgeKey(from, to), 0u));
+
+					return found != edges.end() && found->first == edgeKey(from, to) ? found->second : s_unused;
+				};
+
+				visible.assign(faces.size(), 0);
+				visible[furthest] = 1;
+				stack.assign(1, furthest);
+
+				while (!stack.empty())
+				{
+					const Face& face = faces[stack.back()];
+					stack.pop_back();
+
+					for (int j = 0; j < 3; j++)
+					{
+						std::uint32_t neighbor = findFace(face.vertices[(j + 1) % 3], face.vertices[j]);
+
+						if (neighbor != s_unused && !visible[neighbor] && distances[neighbor] > 0.0f)
+						{
+							visible[neighbor] = 1;
+							stack.push_back(neighbor);
+						}
+					}
+				}
+
+				//The horizon is made of the edges of the visible faces whose
+				//other face is not visible
+				keptFaces.clear();
+
+				for (std::uint32_t i = 0; i < faces.size(); i++)
+				{
+					if (!visible[i])
+					{
+						keptFaces.push_back(faces[i]);
+					}
+				}
+
+				for (std::uint32_t i = 0; i < faces.size(); i++)
+				{
+					if (!visible[i])
+					{
+						continue;
+					}
+
+					for (int j = 0; j < 3; j++)
+					{
+						std::uint32_t from = faces[i].vertices[j];
+						std::uint32_t to = faces[i].vertices[(j + 1) % 3];
+						std::uint32_t neighbor = findFace(to, from);
+
+						if (neighbor == s_unused || !visible[neighbor])
+						{
+							keptFaces.push_back(makeFace(points, from, to, point));
+						}
+					}
+				}
+
+				std::swap(faces, keptFaces);
+
+				if (faces.size() > 2 * points.size())
+				{
+					//More faces than any closed hull of these points has:
+					//the points are too degenerate for the tolerance
+					return {};
+				}
+			}
+
+			return faces;
+		}
+
+		/**
+		 * @brief Check that every edge is shared by exactly two faces, wound
+		 * opposite ways
+		 *
+		 * Only a closed hull can be walked by hill climbing. Anything else
+		 * means the points were too degenerate for the tolerance.
+		 */
+		bool isClosed(const std::vector<Face>& faces)
+		{
+			std::vector<std::uint64_t> edges;
+			edges.reserve(3 * faces.size());
+
+			for (const Face& face : faces)
+			{
+				for (int i = 0; i < 3; i++)
+				{
+					edges.push_back(edgeKey(face.vertices[i], face.vertices[(i + 1) % 3]));
+				}
+			}
+
+			std::sort(edges.begin(), edges.end());
+
+			if (std::adjacent_find(edges.begin(), edges.end()) != edges.end())
+			{
+				return false;
+			}
+
+			for (std::uint64_t edge : edges)
+			{
+				std::uint32_t from = static_cast<std::uint32_t>(edge >> 32);
+				std::uint32_t to = static_cast<std::uint32_t>(edge);
+
+				if (!std::binary_search(edges.begin(), edges.end(), edgeKey(to, from)))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+	}
+
+	std::shared_ptr<const ConvexHullCollider::Hull> ConvexHullCollider::buildHull(const std::vector<glm::vec3>& points)
+	{
+		PHYSICC_ZONE_FINE;
+
+		auto hull = std::make_shared<Hull>();
+		std::vector<Face> faces = computeFaces(points);
+
+		if (faces.empty() || !isClosed(faces))
+		{
+			hull->vertices = points;
+		} else
+		{
+			//Keep only the points the faces use, and renumber them
+			std::vector<std::uint32_t> remap(points.size(), s_unused);
+
+			for (Face& face : faces)
+			{
+				for (std::uint32_t& vertex : face.vertices)
+				{
+					if (remap[vertex] == s_unused)
+					{
+						remap[vertex] = static_cast<std::uint32_t>(hull->vertices.size());
+						hull->vertices.push_back(points[vertex]);
+					}
+
+					vertex = remap[vertex];
+				}
+			}
+
+			//Every edge of a closed hull appears once either way round, so
+			//listing the end of every edge next to its start lists each
+			//neighbor exactly once
+			hull->neighborOffsets.assign(hull->vertices.size() + 1, 0);
+
+			for (const Face& face : faces)
+			{
+				for (std::uint32_t vertex : face.vertices)
+				{
+					hull->neighborOffsets[vertex + 1]++;
+				}
+			}
+
+			std::partial_sum(hull->neighborOffsets.begin(),
+			                 hull->neighborOffsets.end(),
+			                 hull->neighborOffsets.begin());
+
+			hull->neighbors.resize(hull->neighborOffsets.back());
+			std::vector<std::uint32_t> filled(hull->neighborOffsets.begin(), hull->neighborOffsets.end() - 1);
+
+			for (const Face& face : faces)
+			{
+				for (int i = 0; i < 3; i++)
+				{
+					hull->neighbors[filled[face.vertices[i]]++] = face.vertices[(i + 1) % 3];
+				}
+			}
+		}
+
+		hull->extremes.fill(0);
+
+		for (std::uint32_t i = 0; i < hull->vertices.size(); i++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (hull->vertices[i][axis] > hull->vertices[hull->extremes[2 * axis]][axis])
+				{
+					hull->extremes[2 * axis] = i;
+				}
+
+				if (hull->vertices[i][axis] < hull->vertices[hull->extremes[2 * axis + 1]][axis])
+				{
+					hull->extremes[2 * axis + 1] = i;
+				}
+			}
+		}
+
+		return hull;
+	}
+}
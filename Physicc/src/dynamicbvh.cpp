@@ -0,0 +1,381 @@
+#include "profiling.hpp"
+/**
+ * @file dynamicbvh.cpp
+ * @brief A BVH that is maintained incrementally as bodies are added, removed
+ * and moved around.
+ *
+ * Insertion picks the sibling that grows the tree's total surface area the
+ * least, and the tree is kept balanced with AVL-style rotations, along the
+ * lines of the dynamic AABB trees in Box2D and Bullet.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* dynamicbvh header */
+
+#include "dynamicbvh.hpp"
+
+#include <algorithm>
+
+namespace Physicc
+{
+	DynamicBVH::DynamicBVH(float margin)
+		:	m_root(s_nullNode),
+			m_freeList(s_nullNode),
+			m_margin(margin)
+	{
+	}
+
+	std::uint32_t DynamicBVH::allocateNode()
+	{
+		if (m_freeList == s_nullNode)
+		{
+			m_nodes.emplace_back();
+
+			return static_cast<std::uint32_t>(m_nodes.size() - 1);
+		}
+
+		std::uint32_t index = m_freeList;
+		m_freeList = m_nodes[index].parent;
+		m_nodes[index] = Node();
+
+		return index;
+	}
+
+	void DynamicBVH::freeNode(std::uint32_t index)
+	{
+		m_nodes[index].parent = m_freeList;
+		m_nodes[index].height = -1;
+		m_freeList = index;
+	}
+
+	std::uint32_t DynamicBVH::insert(const BoundingVolume::AABB& volume, std::uint32_t bodyIndex)
+	{
+		PHYSICC_ZONE_FINE;
+
+		std::uint32_t proxy = allocateNode();
+
+		m_nodes[proxy].volume = {volume.getLowerBound() - m_margin,
+		                         volume.getUpperBound() + m_margin};
+		m_nodes[proxy].bodyIndex = bodyIndex;
+
+		insertLeaf(proxy);
+
+		return proxy;
+	}
+
+	void DynamicBVH::remove(std::uint32_t proxy)
+	{
+		PHYSICC_ZONE_FINE;
+
+		removeLeaf(proxy);
+		freeNode(proxy);
+	}
+
+	bool DynamicBVH::update(std::uint32_t proxy,
+	                        const BoundingVolume::AABB& volume,
+	                        const glm::vec3& displacement)
+	{
+		PHYSICC_ZONE_FINE;
+
+		if (m_nodes[proxy].volume.contains(volume))
+		{
+			return false;
+		}
+
+		removeLeaf(proxy);
+
+		glm::vec3 lowerBound = volume.getLowerBound() - m_margin;
+		glm::vec3 upperBound = volume.getUpperBound() + m_margin;
+
+		glm::vec3 stretch = s_displacementMultiplier * displacement;
+		lowerBound += glm::min(stretch, glm::vec3(0));
+		upperBound += glm::max(stretch, glm::vec3(0));
+
+		m_nodes[proxy].volume = {lowerBound, upperBound};
+
+		insertLeaf(proxy);
+
+		return true;
+	}
+
+	void DynamicBVH::insertLeaf(std::uint32_t leaf)
+	{
+		PHYSICC_ZONE_FINE;
+
+		if (m_root == s_nullNode)
+		{
+			m_root = leaf;
+			m_nodes[leaf].parent = s_nullNode;
+
+			return;
+		}
+
+		//Find the best sibling for the new leaf: descend towards whichever
+		//child would grow the least by also enclosing the leaf, and stop
+		//once making the leaf a sibling of the current node is cheaper than
+		//pushing it further down.
+		BoundingVolume::AABB leafVolume = m_nodes[leaf].volume;
+		std::uint32_t index = m_root;
+
+		while (!m_nodes[index].isLeaf())
+		{
+			const Node& node = m_nodes[index];
+
+			float area = node.volume.getSurfaceArea();
+			float combinedArea = BoundingVolume::enclosingBV(node.volume, leafVolume).getSurfaceArea();
+
+			float cost = 2.0f * combinedArea;
+			//cost of creating a new parent for this node and the new leaf
+
+			float inheritanceCost = 2.0f * (combinedArea - area);
+			//minimum cost of pushing the leaf further down the tree
+
+			auto descentCost = [this, &leafVolume, inheritanceCost](std::uint32_t child) {
+				const BoundingVolume::AABB& childVolume = m_nodes[child].volume;
+				float enclosingArea = BoundingVolume::enclosingBV(leafVolume, childVolume).getSurfaceArea();
+
+				if (m_nodes[child].isLeaf())
+				{
+					return enclosingArea + inheritanceCost;
+				}
+
+				return enclosingArea - childVolume.getSurfaceArea() + inheritanceCost;
+			};
+
+			float cost1 = descentCost(node.child1);
+			float cost2 = descentCost(node.child2);
+
+			if (cost < cost1 && cost < cost2)
+			{
+				break;
+			}
+
+			index = cost1 < cost2 ? node.child1 : node.child2;
+		}
+
+		std::uint32_t sibling = index;
+
+		//Create a new parent for the sibling and the leaf
+		std::uint32_t oldParent = m_nodes[sibling].parent;
+		std::uint32_t newParent = allocateNode();
+
+		m_nodes[newParent].parent = oldParent;
+		m_nodes[newParent].volume = BoundingVolume::enclosingBV(leafVolume, m_nodes[sibling].volume);
+		m_nodes[newParent].height = m_nodes[sibling].height + 1;
+		m_nodes[newParent].child1 = sibling;
+		m_nodes[newParent].child2 = leaf;
+
+		if (oldParent != s_nullNode)
+		{
+			if (m_nodes[oldParent].child1 == sibling)
+			{
+				m_nodes[oldParent].child1 = newParent;
+			} else
+			{
+				m_nodes[oldParent].child2 = newParent;
+			}
+		} else
+		{
+			m_root = newParent;
+		}
+
+		m_nodes[sibling].parent = newParent;
+		m_nodes[leaf].parent = newParent;
+
+		refitAncestors(m_nodes[leaf].parent);
+	}
+
+	void DynamicBVH::removeLeaf(std::uint32_t leaf)
+	{
+		PHYSICC_ZONE_FINE;
+
+		if (leaf == m_root)
+		{
+			m_root = s_nullNode;
+
+			return;
+		}
+
+		//The leaf's parent goes away along with it, and the leaf's sibling
+		//takes the parent's place
+		std::uint32_t parent = m_nodes[leaf].parent;
+		std::uint32_t grandParent = m_nodes[parent].parent;
+		std::uint32_t sibling = m_nodes[parent].child1 == leaf
+			? m_nodes[parent].child2
+			: m_nodes[parent].child1;
+
+		freeNode(parent);
+
+		if (grandParent == s_nullNode)
+		{
+			m_root = sibling;
+			m_nodes[sibling].parent = s_nullNode;
+
+			return;
+		}
+
+		if (m_nodes[grandParent].child1 == parent)
+		{
+			m_nodes[grandParent].child1 = sibling;
+		} else
+		{
+			m_nodes[grandParent].child2 = sibling;
+		}
+
+		m_nodes[sibling].parent = grandParent;
+
+		refitAncestors(grandParent);
+	}
+
+	void DynamicBVH::refitAncestors(std::uint32_t index)
+	{
+		while (index != s_nullNode)
+		{
+			index = balance(index);
+
+			Node& node = m_nodes[index];
+			const Node& child1 = m_nodes[node.child1];
+			const Node& child2 = m_nodes[node.child2];
+
+			node.height = 1 + std::max(child1.height, child2.height);
+			node.volume = BoundingVolume::enclosingBV(child1.volume, child2.volume);
+
+			index = node.parent;
+		}
+	}
+
+	std::uint32_t DynamicBVH::balance(std::uint32_t iA)
+	{
+		//If one of A's subtrees is more than one level taller than the
+		//other, rotate the taller child up into A's place. Say C is the
+		//taller child, with children F and G: C becomes the parent of A,
+		//keeps its own taller child, and hands the shorter one over to A to
+		//replace C. The mirror image applies when B is the taller child.
+
+		Node& A = m_nodes[iA];
+
+		if (A.isLeaf() || A.height < 2)
+		{
+			return iA;
+		}
+
+		std::uint32_t iB = A.child1;
+		std::uint32_t iC = A.child2;
+		Node& B = m_nodes[iB];
+		Node& C = m_nodes[iC];
+
+		int difference = C.height - B.height;
+
+		if (difference > 1)
+		{
+			std::uint32_t iF = C.child1;
+			std::uint32_t iG = C.child2;
+			Node& F = m_nodes[iF];
+			Node& G = m_nodes[iG];
+
+			//Swap A and C
+			C.child1 = iA;
+			C.parent = A.parent;
+			A.parent = iC;
+
+			//A's old parent should now point to C
+			if (C.parent != s_nullNode)
+			{
+				if (m_nodes[C.parent].child1 == iA)
+				{
+					m_nodes[C.parent].child1 = iC;
+				} else
+				{
+					m_nodes[C.parent].child2 = iC;
+				}
+			} else
+			{
+				m_root = iC;
+			}
+
+			if (F.height > G.height)
+			{
+				C.child2 = iF;
+				A.child2 = iG;
+				G.parent = iA;
+
+				A.volume = BoundingVolume::enclosingBV(B.volume, G.volume);
+				C.volume = BoundingVolume::enclosingBV(A.volume, F.volume);
+
+				A.height = 1 + std::max(B.height, G.height);
+				C.height = 1 + std::max(A.height, F.height);
+			} else
+			{
+				C.child2 = iG;
+				A.child2 = iF;
+				F.parent = iA;
+
+				A.volume = BoundingVolume::enclosingBV(B.volume, F.volume);
+				C.volume = BoundingVolume::enclosingBV(A.volume, G.volume);
+
+				A.height = 1 + std::max(B.height, F.height);
+				C.height = 1 + std::max(A.height, G.height);
+			}
+
+			return iC;
+		}
+
+		if (difference < -1)
+		{
+			std::uint32_t iD = B.child1;
+			std::uint32_t iE = B.child2;
+			Node& D = m_nodes[iD];
+			Node& E = m_nodes[iE];
+
+			//Swap A and B
+			B.child1 = iA;
+			B.parent = A.parent;
+			A.parent = iB;
+
+			//A's old parent should now point to B
+			if (B.parent != s_nullNode)
+			{
+				if (m_nodes[B.parent].child1 == iA)
+				{
+					m_nodes[B.parent].child1 = iB;
+				} else
+				{
+					m_nodes[B.parent].child2 = iB;
+				}
+			} else
+			{
+				m_root = iB;
+			}
+
+			if (D.height > E.height)
+			{
+				B.child2 = iD;
+				A.child1 = iE;
+				E.parent = iA;
+
+				A.volume = BoundingVolume::enclosingBV(C.volume, E.volume);
+				B.volume = BoundingVolume::enclosingBV(A.volume, D.volume);
+
+				A.height = 1 + std::max(C.height, E.height);
+				B.height = 1 + std::max(A.height, D.height);
+			} else
+			{
+				B.child2 = iE;
+				A.child1 = iD;
+				D.parent = iA;
+
+				A.volume = BoundingVolume::enclosingBV(C.volume, D.volume);
+				B.volume = BoundingVolume::enclosingBV(A.volume, E.volume);
+
+				A.height = 1 + std::max(C.height, D.height);
+				B.height = 1 + std::max(A.height, E.height);
+			}
+
+			return iB;
+		}
+
+		return iA;
+	}
+}
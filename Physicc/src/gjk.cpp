@@ -0,0 +1,498 @@
+#include "profiling.hpp"
+/**
+ * @file gjk.cpp
+ * @brief Collision test between any two convex shapes, using GJK and EPA.
+ *
+ * Both algorithms work on the Minkowski difference of the two shapes (every
+ * point of the first minus every point of the second), which contains the
+ * origin exactly when the shapes overlap. Its support point in a direction
+ * is the first shape's support point in that direction minus the second
+ * shape's in the opposite one, so the shapes only need a support function.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* narrowphase header */
+
+#include "narrowphase.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace Physicc
+{
+	namespace Narrowphase
+	{
+		namespace
+		{
+			constexpr int s_maxIterations = 64;
+			//for GJK and EPA each, they usually take less than 20
+
+			constexpr float s_epaTolerance = 1e-4f;
+			//EPA stops once the closest face moves less than this
+
+			constexpr float s_planeTolerance = 1e-5f;
+			//cosine of the angle below which a point counts as lying on a
+			//plane
+
+			constexpr float s_epsilon = 1e-10f;
+
+			struct SupportPoint
+			{
+				glm::vec3 point;
+				//on the Minkowski difference
+
+				glm::vec3 onFirst;
+				glm::vec3 onSecond;
+				//the points of either shape it was made from
+			};
+
+			struct Simplex
+			{
+				std::array<SupportPoint, 4> points {};
+				//the most recently added point comes first
+
+				int size = 0;
+
+				void pushFront(const SupportPoint& point)
+				{
+					points = {point, points[0], points[1], points[2]};
+					size = std::min(size + 1, 4);
+				}
+
+				void set(std::initializer_list<SupportPoint> list)
+				{
+					size = 0;
+
+					for (const auto& point : list)
+					{
+						points[size++] = point;
+					}
+				}
+			};
+
+			struct Face
+			{
+				std::uint32_t vertices[3];
+				glm::vec3 normal;
+				//points out of the polytope
+
+				float distance;
+				//from the origin to the face's plane, negative if the origin
+				//is (numerically) outside it
+			};
+
+			template <typename First, typename Second>
+			SupportPoint getSupport(const First& first,
+			                        const Second& second,
+			                        const glm::vec3& direction)
+			{
+				glm::vec3 onFirst = first.getSupport(direction);
+				glm::vec3 onSecond = second.getSupport(-direction);
+
+				return {onFirst - onSecond, onFirst, onSecond};
+			}
+
+			inline bool sameDirection(const glm::vec3& a, const glm::vec3& b)
+			{
+				return glm::dot(a, b) > 0.0f;
+			}
+
+			inline bool isOutside(const glm::vec3& normal, const glm::vec3& point)
+			{
+				return glm::dot(normal, point) > s_planeTolerance * glm::length(normal) * glm::length(point);
+			}
+
+			/*
+			 * Each of the following reduces the simplex to its feature closest
+			 * to the origin, and points the search direction from that feature
+			 * towards the origin. Only the tetrahedron can contain the origin.
+			 */
+
+			void updateLine(Simplex& simplex, glm::vec3& direction)
+			{
+				SupportPoint a = simplex.points[0];
+				SupportPoint b = simplex.points[1];
+
+				glm::vec3 ab = b.point - a.point;
+				glm::vec3 ao = -a.point;
+
+				if (sameDirection(ab, ao))
+				{
+					direction = glm::cross(glm::cross(ab, ao), ab);
+
+					//The origin is on the line, which happens right away for
+					//two spheres. Any direction away from the line will do.
+					if (glm::dot(direction, direction) < s_epsilon)
+					{
+						direction = glm::cross(ab, std::abs(ab.x) < 0.5f * glm::length(ab)
+							? glm::vec3(1.0f, 0.0f, 0.0f)
+							: glm::vec3(0.0f, 1.0f, 0.0f));
+					}
+				} else
+				{
+					simplex.set({a});
+					direction = ao;
+				}
+			}
+
+			void updateTriangle(Simplex& simplex, glm::vec3& direction)
+			{
+				SupportPoint a = simplex.points[0];
+				SupportPoint b = simplex.points[1];
+				SupportPoint c = simplex.points[2];
+
+				glm::vec3 ab = b.point - a.point;
+				glm::vec3 ac = c.point - a.point;
+				glm::vec3 ao = -a.point;
+				glm::vec3 abc = glm::cross(ab, ac);
+
+				if (sameDirection(glm::cross(abc, ac), ao))
+				{
+					if (sameDirection(ac, ao))
+					{
+						simplex.set({a, c});
+						direction = glm::cross(glm::cross(ac, ao), ac);
+					} else
+					{
+						simplex.set({a, b});
+						updateLine(simplex, direction);
+					}
+				} else if (sameDirection(glm::cross(ab, abc), ao))
+				{
+					simplex.set({a, b});
+					updateLine(simplex, direction);
+				} else if (sameDirection(abc, ao))
+				{
+					direction = abc;
+				} else
+				{
+					simplex.set({a, c, b});
+					direction = -abc;
+				}
+			}
+
+			bool updateTetrahedron(Simplex& simplex, glm::vec3& direction)
+			{
+				SupportPoint a = simplex.points[0];
+				SupportPoint b = simplex.points[1];
+				SupportPoint c = simplex.points[2];
+				SupportPoint d = simplex.points[3];
+
+				glm::vec3 ab = b.point - a.point;
+				glm::vec3 ac = c.point - a.point;
+				glm::vec3 ad = d.point - a.point;
+				glm::vec3 ao = -a.point;
+
+				//The origin has to be clearly outside a face to leave the
+				//tetrahedron through it. Otherwise, when it lies on a face,
+				//rounding makes GJK flip back and forth between the points on
+				//either side of that face forever.
+				if (isOutside(glm::cross(ab, ac), ao))
+				{
+					simplex.set({a, b, c});
+				} else if (isOutside(glm::cross(ac, ad), ao))
+				{
+					simplex.set({a, c, d});
+				} else if (isOutside(glm::cross(ad, ab), ao))
+				{
+					simplex.set({a, d, b});
+				} else
+				{
+					return true;
+				}
+
+				updateTriangle(simplex, direction);
+
+				return false;
+			}
+
+			bool updateSimplex(Simplex& simplex, glm::vec3& direction)
+			{
+				switch (simplex.size)
+				{
+					case 2:
+						updateLine(simplex, direction);
+						return false;
+					case 3:
+						updateTriangle(simplex, direction);
+						return false;
+					default:
+						return updateTetrahedron(simplex, direction);
+				}
+			}
+
+			/**
+			 * @brief Make a face, with its normal pointing out of the polytope
+			 *
+			 * The vertices have to be given counterclockwise, seen from
+			 * outside. The normal is taken from their winding rather than
+			 * from which side of the face the origin is on, which is not
+			 * reliable for faces passing (almost) through the origin.
+			 *
+			 * @return false if the face is degenerate
+			 */
+			bool makeFace(const std::vector<SupportPoint>& vertices,
+			              std::uint32_t a,
+			              std::uint32_t b,
+			              std::uint32_t c,
+			              Face& face)
+			{
+				glm::vec3 normal = glm::cross(vertices[b].point - vertices[a].point,
+				                              vertices[c].point - vertices[a].point);
+				float length = glm::length(normal);
+
+				if (length < s_epsilon)
+				{
+					return false;
+				}
+
+				normal /= length;
+				face = {{a, b, c}, normal, glm::dot(normal, vertices[a].point)};
+
+				return true;
+			}
+
+			/**
+			 * @brief Barycentric coordinates of a point's projection onto a
+			 * triangle's plane
+			 */
+			glm::vec3 getBarycentric(const glm::vec3& point,
+			                         const glm::vec3& a,
+			                         const glm::vec3& b,
+			                         const glm::vec3& c)
+			{
+				glm::vec3 ab = b - a;
+				glm::vec3 ac = c - a;
+				glm::vec3 ap = point - a;
+
+				float d00 = glm::dot(ab, ab);
+				float d01 = glm::dot(ab, ac);
+				float d11 = glm::dot(ac, ac);
+				float d20 = glm::dot(ap, ab);
+				float d21 = glm::dot(ap, ac);
+				float denominator = d00 * d11 - d01 * d01;
+
+				if (std::abs(denominator) < s_epsilon)
+				{
+					return glm::vec3(1.0f, 0.0f, 0.0f);
+				}
+
+				float v = (d11 * d20 - d01 * d21) / denominator;
+				float w = (d00 * d21 - d01 * d20) / denominator;
+
+				return glm::vec3(1.0f - v - w, v, w);
+			}
+
+			/**
+			 * @brief Expand a tetrahedron containing the origin until its
+			 * closest face to the origin lies on the Minkowski difference's
+			 * surface
+			 */
+			template <typename First, typename Second>
+			bool expandPolytope(const First& first,
+			                    const Second& second,
+			                    const Simplex& simplex,
+			                    ContactManifold& manifold)
+			{
+				std::vector<SupportPoint> vertices(simplex.points.begin(), simplex.points.end());
+				std::vector<Face> faces;
+				faces.reserve(32);
+
+				//The faces below wind counterclockwise if the last vertex lies
+				//below the first three
+				glm::vec3 firstNormal = glm::cross(vertices[1].point - vertices[0].point,
+				                                   vertices[2].point - vertices[0].point);
+
+				if (glm::dot(firstNormal, vertices[3].point - vertices[0].point) > 0.0f)
+				{
+					std::swap(vertices[1], vertices[2]);
+				}
+
+				constexpr std::uint32_t initialFaces[4][3] = {{0, 1, 2}, {0, 3, 1}, {0, 2, 3}, {1, 3, 2}};
+
+				for (const auto& indices : initialFaces)
+				{
+					Face face;
+
+					//A flat tetrahedron means the origin is on its surface,
+					//so the shapes are only touching
+					if (!makeFace(vertices, indices[0], indices[1], indices[2], face))
+					{
+						return false;
+					}
+
+					faces.push_back(face);
+				}
+
+				std::vector<std::pair<std::uint32_t, std::uint32_t>> horizon;
+				Face closest = faces[0];
+
+				for (int iteration = 0; iteration < s_maxIterations; iteration++)
+				{
+					closest = faces[0];
+
+					for (const Face& face : faces)
+					{
+						if (face.distance < closest.distance)
+						{
+							closest = face;
+						}
+					}
+
+					SupportPoint support = getSupport(first, second, closest.normal);
+
+					if (glm::dot(support.point, closest.normal) - closest.distance < s_epaTolerance)
+					{
+						break;
+					}
+
+					//Remove the faces the new point can see, keeping track of
+					//the edges around the hole they leave
+					horizon.clear();
+
+					for (std::size_t i = 0; i < faces.size();)
+					{
+						const Face& face = faces[i];
+
+						if (!sameDirection(face.normal, support.point - vertices[face.vertices[0]].point))
+						{
+							i++;
+							continue;
+						}
+
+						for (int j = 0; j < 3; j++)
+						{
+							std::pair<std::uint32_t, std::uint32_t> edge = {face.vertices[j],
+							                                                face.vertices[(j + 1) % 3]};
+
+							//An edge shared with another visible face runs
+							//the other way round in it
+							auto shared = std::find(horizon.begin(),
+							                        horizon.end(),
+							                        std::make_pair(edge.second, edge.first));
+
+							if (shared != horizon.end())
+							{
+								*shared = horizon.back();
+								horizon.pop_back();
+							} else
+							{
+								horizon.push_back(edge);
+							}
+						}
+
+						faces[i] = faces.back();
+						faces.pop_back();
+					}
+
+					//Patch up the hole with faces fanning out of the new point
+					auto newVertex = static_cast<std::uint32_t>(vertices.size());
+					vertices.push_back(support);
+
+					for (const auto& edge : horizon)
+					{
+						Face face;
+
+						if (makeFace(vertices, edge.first, edge.second, newVertex, face))
+						{
+							faces.push_back(face);
+						}
+					}
+
+					if (faces.empty())
+					{
+						return false;
+					}
+				}
+
+				if (closest.distance < s_epsilon)
+				{
+					return false;
+				}
+
+				//The contact point is where the origin projects onto the
+				//closest face, carried back to either shape
+				const SupportPoint& a = vertices[closest.vertices[0]];
+				const SupportPoint& b = vertices[closest.vertices[1]];
+				const SupportPoint& c = vertices[closest.vertices[2]];
+
+				glm::vec3 weights = getBarycentric(closest.normal * closest.distance, a.point, b.point, c.point);
+				glm::vec3 onFirst = weights.x * a.onFirst + weights.y * b.onFirst + weights.z * c.onFirst;
+				glm::vec3 onSecond = weights.x * a.onSecond + weights.y * b.onSecond + weights.z * c.onSecond;
+
+				manifold.normal = closest.normal;
+				manifold.pointCount = 0;
+				manifold.addPoint(0.5f * (onFirst + onSecond), closest.distance);
+
+				return true;
+			}
+
+			/**
+			 * @brief GJK on anything with getSupport() and getCentroid(),
+			 * which lets a single triangle of a mesh stand in for a collider
+			 */
+			template <typename First, typename Second>
+			bool collideShapes(const First& first, const Second& second, ContactManifold& manifold)
+			{
+				glm::vec3 direction = second.getCentroid() - first.getCentroid();
+
+				if (glm::dot(direction, direction) < s_epsilon)
+				{
+					direction = glm::vec3(1.0f, 0.0f, 0.0f);
+				}
+
+				Simplex simplex;
+				simplex.pushFront(getSupport(first, second, direction));
+				direction = -simplex.points[0].point;
+
+				for (int iteration = 0; iteration < s_maxIterations; iteration++)
+				{
+					//The origin lies on the simplex, so the shapes are touching
+					if (glm::dot(direction, direction) < s_epsilon)
+					{
+						return false;
+					}
+
+					SupportPoint support = getSupport(first, second, direction);
+
+					//The furthest point towards the origin does not get past it,
+					//so the Minkowski difference cannot contain it
+					if (glm::dot(support.point, direction) <= 0.0f)
+					{
+						return false;
+					}
+
+					simplex.pushFront(support);
+
+					if (updateSimplex(simplex, direction))
+					{
+						return expandPolytope(first, second, simplex, manifold);
+					}
+				}
+
+				return false;
+			}
+		}
+
+		bool collideConvex(const Collider& first, const Collider& second, ContactManifold& manifold)
+		{
+			PHYSICC_ZONE_FINE;
+
+			return collideShapes(first, second, manifold);
+		}
+
+		bool collideConvexTriangle(const Triangle& triangle, const Collider& other, ContactManifold& manifold)
+		{
+			PHYSICC_ZONE_FINE;
+
+			return collideShapes(triangle, other, manifold);
+		}
+	}
+}
@@ -0,0 +1,126 @@
+#include "profiling.hpp"
+/**
+ * @file islandbuilder.cpp
+ * @brief Finds the islands of touching bodies with a union-find.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* islandbuilder header */
+
+#include "islandbuilder.hpp"
+
+namespace Physicc
+{
+	std::uint32_t IslandBuilder::findRoot(std::uint32_t body)
+	{
+		//Path halving: point every other body on the way at its grandparent
+		while (m_parents[body] != body)
+		{
+			m_parents[body] = m_parents[m_parents[body]];
+			body = m_parents[body];
+		}
+
+		return body;
+	}
+
+	void IslandBuilder::build(const std::vector<std::uint32_t>& bodies,
+	                          std::size_t bodyCount,
+	                          const std::vector<ContactManifold>& contacts,
+	                          const std::vector<float>& inverseMasses)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		m_parents.resize(bodyCount);
+		m_islandIndices.resize(bodyCount);
+
+		for (std::uint32_t body : bodies)
+		{
+			m_parents[body] = body;
+		}
+
+		//Join the bodies of every contact. The lower numbered root always
+		//wins, so every island ends up rooted at its lowest numbered body.
+		for (const ContactManifold& contact : contacts)
+		{
+			if (inverseMasses[contact.first] == 0.0f || inverseMasses[contact.second] == 0.0f)
+			{
+				continue;
+			}
+
+			std::uint32_t first = findRoot(contact.first);
+			std::uint32_t second = findRoot(contact.second);
+
+			if (first < second)
+			{
+				m_parents[second] = first;
+			} else if (second < first)
+			{
+				m_parents[first] = second;
+			}
+		}
+
+		//Count the bodies and contacts of every island...
+		m_islands.clear();
+
+		for (std::uint32_t body : bodies)
+		{
+			if (findRoot(body) == body)
+			{
+				m_islandIndices[body] = static_cast<std::uint32_t>(m_islands.size());
+				m_islands.push_back({0, 0, 0, 0});
+			}
+		}
+
+		for (std::uint32_t body : bodies)
+		{
+			m_islands[m_islandIndices[findRoot(body)]].bodyCount++;
+		}
+
+		//A contact belongs to the island of its dynamic body (or bodies)
+		auto getContactIsland = [this, &contacts, &inverseMasses](std::size_t contact) {
+			std::uint32_t body = inverseMasses[contacts[contact].first] != 0.0f
+				? contacts[contact].first
+				: contacts[contact].second;
+
+			return m_islandIndices[findRoot(body)];
+		};
+
+		for (std::size_t i = 0; i < contacts.size(); i++)
+		{
+			m_islands[getContactIsland(i)].contactCount++;
+		}
+
+		//...turn the counts into ranges...
+		std::uint32_t bodyStart = 0;
+		std::uint32_t contactStart = 0;
+
+		for (Island& island : m_islands)
+		{
+			island.bodyStart = bodyStart;
+			island.contactStart = contactStart;
+			bodyStart += island.bodyCount;
+			contactStart += island.contactCount;
+
+			island.bodyCount = 0;
+			island.contactCount = 0;
+		}
+
+		//...and fill them in
+		m_bodies.resize(bodyStart);
+		m_contacts.resize(contactStart);
+
+		for (std::uint32_t body : bodies)
+		{
+			Island& island = m_islands[m_islandIndices[findRoot(body)]];
+			m_bodies[island.bodyStart + island.bodyCount++] = body;
+		}
+
+		for (std::size_t i = 0; i < contacts.size(); i++)
+		{
+			Island& island = m_islands[getContactIsland(i)];
+			m_contacts[island.contactStart + island.contactCount++] = static_cast<std::uint32_t>(i);
+		}
+	}
+}
@@ -0,0 +1,178 @@
+#include "profiling.hpp"
+/**
+ * @file jobsystem.cpp
+ * @brief A work stealing thread pool for running parallel loops.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* jobsystem header */
+
+#include "jobsystem.hpp"
+
+namespace Physicc
+{
+	namespace
+	{
+		//The job system the current thread works for (if any), and the
+		//index of its queue there
+		thread_local const JobSystem* t_jobSystem = nullptr;
+		thread_local std::size_t t_queueIndex = 0;
+	}
+
+	unsigned int JobSystem::defaultWorkerCount()
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+
+		return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	JobSystem::JobSystem(unsigned int workerCount)
+		:	m_pendingJobs(0),
+			m_stop(false)
+	{
+		for (unsigned int i = 0; i <= workerCount; i++)
+		{
+			m_queues.push_back(std::make_unique<Queue>());
+		}
+
+		m_workers.reserve(workerCount);
+
+		for (unsigned int i = 0; i < workerCount; i++)
+		{
+			m_workers.emplace_back(&JobSystem::workerLoop, this, i + 1);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_stop = true;
+		}
+
+		m_wakeCondition.notify_all();
+
+		for (auto& worker : m_workers)
+		{
+			worker.join();
+		}
+	}
+
+	std::size_t JobSystem::getQueueIndex() const
+	{
+		return t_jobSystem == this ? t_queueIndex : 0;
+	}
+
+	void JobSystem::push(Job&& job)
+	{
+		Queue& queue = *m_queues[getQueueIndex()];
+
+		//Count the job first, so that the count never drops below the
+		//number of jobs actually queued
+		m_pendingJobs.fetch_add(1, std::memory_order_relaxed);
+
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+
+	void JobSystem::wake(std::size_t jobCount)
+	{
+		//Taking the lock makes sure that a worker that just found nothing to
+		//do is either already waiting (and gets notified), or has yet to
+		//check m_pendingJobs again (and sees the new jobs)
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+		}
+
+		if (jobCount >= m_workers.size())
+		{
+			m_wakeCondition.notify_all();
+		} else
+		{
+			for (std::size_t i = 0; i < jobCount; i++)
+			{
+				m_wakeCondition.notify_one();
+			}
+		}
+	}
+
+	bool JobSystem::runJob(std::size_t queueIndex)
+	{
+		Job job;
+
+		//Newest job from our own queue first, then the oldest job from
+		//anybody else's
+		for (std::size_t i = 0; i < m_queues.size() && !job; i++)
+		{
+			Queue& queue = *m_queues[(queueIndex + i) % m_queues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+
+			if (queue.jobs.empty())
+			{
+				continue;
+			}
+
+			if (i == 0)
+			{
+				job = std::move(queue.jobs.back());
+				queue.jobs.pop_back();
+			} else
+			{
+				job = std::move(queue.jobs.front());
+				queue.jobs.pop_front();
+			}
+		}
+
+		if (!job)
+		{
+			return false;
+		}
+
+		m_pendingJobs.fetch_sub(1, std::memory_order_relaxed);
+		job();
+
+		return true;
+	}
+
+	void JobSystem::wait(const std::atomic<std::size_t>& remaining)
+	{
+		PHYSICC_ZONE_FINE;
+
+		std::size_t queueIndex = getQueueIndex();
+
+		while (remaining.load(std::memory_order_acquire) != 0)
+		{
+			if (!runJob(queueIndex))
+			{
+				//Our jobs are all running on other threads
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void JobSystem::workerLoop(std::size_t queueIndex)
+	{
+		t_jobSystem = this;
+		t_queueIndex = queueIndex;
+
+		while (true)
+		{
+			if (runJob(queueIndex))
+			{
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_wakeCondition.wait(lock, [this]() {
+				return m_stop || m_pendingJobs.load(std::memory_order_acquire) != 0;
+			});
+
+			if (m_stop)
+			{
+				return;
+			}
+		}
+	}
+}
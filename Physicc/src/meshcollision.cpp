@@ -0,0 +1,242 @@
+#include "profiling.hpp"
+/**
+ * @file meshcollision.cpp
+ * @brief Collision test between a static triangle mesh and any other
+ * collider.
+ *
+ * The mesh's tree finds the triangles near the other collider, each of them
+ * is tested on its own, and their contacts are merged like a compound's
+ * children's.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* narrowphase header */
+
+#include "narrowphase.hpp"
+
+#include <array>
+
+namespace Physicc
+{
+	namespace Narrowphase
+	{
+		namespace
+		{
+			constexpr float s_axisTolerance = 1e-4f;
+			//how far from 1 the cosine between the separating axis and a
+			//face normal can be for the axis to count as that normal
+
+			constexpr float s_epsilon = 1e-12f;
+
+			bool collideSphereTriangle(const SphereCollider& sphere,
+			                           const Triangle& triangle,
+			                           ContactManifold& manifold)
+			{
+				glm::vec3 center = sphere.getCentroid();
+				float radius = sphere.getRadius();
+				glm::vec3 closest = triangle.getClosestPoint(center);
+				glm::vec3 offset = center - closest;
+				float distanceSquared = glm::dot(offset, offset);
+
+				if (distanceSquared > radius * radius)
+				{
+					return false;
+				}
+
+				float distance = glm::sqrt(distanceSquared);
+
+				if (distance > s_epsilon)
+				{
+					manifold.normal = offset / distance;
+				} else
+				{
+					//The center is on the triangle, so only its normal tells
+					//the sides apart
+					glm::vec3 normal = triangle.getNormal();
+					float length = glm::length(normal);
+
+					if (length < s_epsilon)
+					{
+						return false;
+					}
+
+					manifold.normal = normal / length;
+				}
+
+				manifold.pointCount = 0;
+				manifold.addPoint(0.5f * (closest + center - manifold.normal * radius), radius - distance);
+
+				return true;
+			}
+
+			/**
+			 * @brief Test an oriented box against a triangle
+			 *
+			 * The separating axis test gives the normal. When it is the
+			 * triangle's normal, the box's corners below the triangle and
+			 * above it are contact points; when it is a face normal of the
+			 * box, the triangle's corners inside the box are. An edge against
+			 * an edge is left to EPA, which finds the single point such a
+			 * contact has.
+			 */
+			bool collideBoxTriangle(const BoxCollider& box,
+			                        const Triangle& triangle,
+			                        ContactManifold& manifold)
+			{
+				glm::vec3 center = box.getCentroid();
+				glm::mat3 axes = box.getRotationMatrix();
+				glm::vec3 halfExtents = box.getHalfExtents();
+
+				glm::vec3 normal;
+				float depth;
+
+				if (!triangle.findBoxPenetration(center, axes, halfExtents, normal, depth))
+				{
+					return false;
+				}
+
+				glm::vec3 faceNormal = glm::normalize(triangle.getNormal());
+				bool onFace = glm::abs(glm::dot(normal, faceNormal)) > 1.0f - s_axisTolerance;
+				bool onBoxFace = false;
+
+				for (int i = 0; i < 3; i++)
+				{
+					onBoxFace = onBoxFace || glm::abs(glm::dot(normal, axes[i])) > 1.0f - s_axisTolerance;
+				}
+
+				if (!onFace && !onBoxFace)
+				{
+					return collideConvexTriangle(triangle, box, manifold);
+				}
+
+				//Collect every candidate point as a contact of its own, and
+				//let a merger pick the four that span the most area
+				ContactMerger points;
+				ContactManifold point;
+				point.normal = normal;
+
+				auto addPoint = [&](const glm::vec3& position, float penetration) {
+					point.pointCount = 0;
+					point.addPoint(position, penetration);
+					points.add(point);
+				};
+
+				float boxBottom = glm::dot(normal, center)
+					- halfExtents.x * glm::abs(glm::dot(normal, axes[0]))
+					- halfExtents.y * glm::abs(glm::dot(normal, axes[1]))
+					- halfExtents.z * glm::abs(glm::dot(normal, axes[2]));
+
+				for (const glm::vec3& vertex : triangle.vertices)
+				{
+					glm::vec3 local = glm::transpose(axes) * (vertex - center);
+					float penetration = glm::dot(normal, vertex) - boxBottom;
+
+					if (penetration > 0.0f && glm::all(glm::lessThanEqual(glm::abs(local), halfExtents)))
+					{
+						addPoint(vertex - 0.5f * penetration * normal, penetration);
+					}
+				}
+
+				if (onFace)
+				{
+					float plane = glm::dot(normal, triangle.vertices[0]);
+					glm::vec3 windingNormal = triangle.getNormal();
+
+					for (int i = 0; i < 8; i++)
+					{
+						glm::vec3 corner = center
+							+ axes[0] * ((i & 1) ? halfExtents.x : -halfExtents.x)
+							+ axes[1] * ((i & 2) ? halfExtents.y : -halfExtents.y)
+							+ axes[2] * ((i & 4) ? halfExtents.z : -halfExtents.z);
+						float penetration = plane - glm::dot(normal, corner);
+						bool inside = penetration > 0.0f;
+
+						//Inside the prism the triangle sweeps along its
+						//normal, if on the inner side of all three edges
+						for (int j = 0; inside && j < 3; j++)
+						{
+							glm::vec3 edge = triangle.vertices[(j + 1) % 3] - triangle.vertices[j];
+							inside = glm::dot(glm::cross(edge, windingNormal), corner - triangle.vertices[j]) <= 0.0f;
+						}
+
+						if (inside)
+						{
+							addPoint(corner + 0.5f * penetration * normal, penetration);
+						}
+					}
+				}
+
+				if (points.merge(manifold))
+				{
+					return true;
+				}
+
+				//The shapes overlap at a point covered by neither of the above,
+				//like an edge of the box crossing the triangle's edge. The
+				//deepest point of the shape opposite the axis's face will do.
+				glm::vec3 deepest = onFace
+					? box.getSupport(-normal)
+					: triangle.getSupport(normal);
+				glm::vec3 position = onFace
+					? deepest + 0.5f * depth * normal
+					: deepest - 0.5f * depth * normal;
+
+				manifold.normal = normal;
+				manifold.pointCount = 0;
+				manifold.addPoint(position, depth);
+
+				return true;
+			}
+		}
+
+		bool collideTriangleMesh(const TriangleMeshCollider& mesh,
+		                         const Collider& other,
+		                         ContactManifold& manifold)
+		{
+			PHYSICC_ZONE_FINE;
+
+			Collider::Type type = other.getType();
+
+			if (type == Collider::e_triangleMesh || type == Collider::e_compound)
+			{
+				return false;
+			}
+
+			ContactMerger merger;
+			ContactManifold triangleManifold;
+
+			mesh.queryTriangles(other.getAABB(), [&](std::uint32_t index) {
+				Triangle triangle = mesh.getTriangle(index);
+				bool touching;
+
+				switch (type)
+				{
+					case Collider::e_sphere:
+						touching = collideSphereTriangle(static_cast<const SphereCollider&>(other),
+						                                 triangle,
+						                                 triangleManifold);
+						break;
+					case Collider::e_box:
+						touching = collideBoxTriangle(static_cast<const BoxCollider&>(other),
+						                              triangle,
+						                              triangleManifold);
+						break;
+					default:
+						touching = collideConvexTriangle(triangle, other, triangleManifold);
+						break;
+				}
+
+				if (touching)
+				{
+					merger.add(triangleManifold);
+				}
+
+				return true;
+			});
+
+			return merger.merge(manifold);
+		}
+	}
+}
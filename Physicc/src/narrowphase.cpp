@@ -0,0 +1,591 @@
+#include "profiling.hpp"
+/**
+ * @file narrowphase.cpp
+ * @brief Analytic collision tests for spheres and boxes.
+ *
+ * GJK and EPA, which handle every other pair of convex shapes, live in
+ * gjk.cpp, compounds are taken apart in compound.cpp, and meshes in
+ * meshcollision.cpp.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* narrowphase header */
+
+#include "narrowphase.hpp"
+
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace Physicc
+{
+	namespace Narrowphase
+	{
+		namespace
+		{
+			constexpr float s_parallelTolerance = 1e-4f;
+			//edge pairs whose cross product is shorter than this are
+			//treated as parallel, their axis is covered by the face normals
+
+			constexpr float s_relativeTolerance = 0.95f;
+			constexpr float s_absoluteTolerance = 0.01f;
+			//an axis has to separate the boxes noticeably better than a
+			//face normal of the first box to be picked over it. This keeps
+			//the choice of axis (and so the contact points) from flipping
+			//back and forth between steps for boxes resting on each other.
+
+			struct OrientedBox
+			{
+				glm::vec3 center;
+				glm::mat3 axes;
+				glm::vec3 halfExtents;
+			};
+
+			struct Polygon
+			{
+				std::array<glm::vec3, 8> points;
+				//clipping a quad against 4 planes adds at most one point per
+				//plane
+
+				std::size_t count = 0;
+			};
+
+			OrientedBox toOrientedBox(const BoxCollider& box)
+			{
+				return {box.getCentroid(), box.getRotationMatrix(), box.getHalfExtents()};
+			}
+
+			/**
+			 * @brief Clip a polygon against a plane, keeping the part where
+			 * dot(normal, point) <= offset (Sutherland-Hodgman)
+			 */
+			Polygon clip(const Polygon& polygon, const glm::vec3& normal, float offset)
+			{
+				Polygon result;
+
+				for (std::size_t i = 0; i < polygon.count; i++)
+				{
+					const glm::vec3& a = polygon.points[i];
+					const glm::vec3& b = polygon.points[(i + 1) % polygon.count];
+
+					float distanceA = glm::dot(normal, a) - offset;
+					float distanceB = glm::dot(normal, b) - offset;
+
+					if (distanceA <= 0.0f)
+					{
+						result.points[result.count++] = a;
+					}
+
+					if ((distanceA < 0.0f && distanceB > 0.0f) || (distanceA > 0.0f && distanceB < 0.0f))
+					{
+						result.points[result.count++] = a + (b - a) * (distanceA / (distanceA - distanceB));
+					}
+				}
+
+				return result;
+			}
+
+			/**
+			 * @brief Contact points between a face of the reference box and
+			 * the face of the incident box that faces it the most
+			 *
+			 * @param normal The reference face's normal, pointing towards the
+			 * incident box
+			 */
+			void clipFaces(const OrientedBox& reference,
+			               int referenceAxis,
+			               const OrientedBox& incident,
+			               const glm::vec3& normal,
+			               ContactManifold& manifold)
+			{
+				//The incident face is the one whose normal points the most
+				//against the reference face's
+				int incidentAxis = 0;
+				float maxAlignment = -1.0f;
+
+				for (int i = 0; i < 3; i++)
+				{
+					float alignment = std::abs(glm::dot(incident.axes[i], normal));
+
+					if (alignment > maxAlignment)
+					{
+						maxAlignment = alignment;
+						incidentAxis = i;
+					}
+				}
+
+				glm::vec3 incidentNormal = incident.axes[incidentAxis];
+
+				if (glm::dot(incidentNormal, normal) > 0.0f)
+				{
+					incidentNormal = -incidentNormal;
+				}
+
+				glm::vec3 faceCenter = incident.center + incidentNormal * incident.halfExtents[incidentAxis];
+				glm::vec3 u = incident.axes[(incidentAxis + 1) % 3] * incident.halfExtents[(incidentAxis + 1) % 3];
+				glm::vec3 v = incident.axes[(incidentAxis + 2) % 3] * incident.halfExtents[(incidentAxis + 2) % 3];
+
+				Polygon polygon;
+				polygon.points[0] = faceCenter + u + v;
+				polygon.points[1] = faceCenter - u + v;
+				polygon.points[2] = faceCenter - u - v;
+				polygon.points[3] = faceCenter + u - v;
+				polygon.count = 4;
+
+				//Clip the incident face against the reference face's sides
+				for (int i = 1; i < 3 && polygon.count != 0; i++)
+				{
+					int axis = (referenceAxis + i) % 3;
+					const glm::vec3& side = reference.axes[axis];
+					float center = glm::dot(side, reference.center);
+
+					polygon = clip(polygon, side, center + reference.halfExtents[axis]);
+					polygon = clip(polygon, -side, -center + reference.halfExtents[axis]);
+				}
+
+				//Keep the points below the reference face
+				float faceOffset = glm::dot(normal, reference.center) + reference.halfExtents[referenceAxis];
+
+				std::array<glm::vec3, 8> positions;
+				std::array<float, 8> penetrations;
+				std::size_t count = 0;
+
+				for (std::size_t i = 0; i < polygon.count; i++)
+				{
+					float penetration = faceOffset - glm::dot(normal, polygon.points[i]);
+
+					if (penetration >= 0.0f)
+					{
+						positions[count] = polygon.points[i] + normal * (0.5f * penetration);
+						penetrations[count] = penetration;
+						count++;
+					}
+				}
+
+				if (count <= ContactManifold::s_maxPoints)
+				{
+					for (std::size_t i = 0; i < count; i++)
+					{
+						manifold.addPoint(positions[i], penetrations[i]);
+					}
+
+					return;
+				}
+
+				//Too many points: keep the deepest one, the one furthest from
+				//it, and the two that span the biggest area with those on
+				//either side
+				std::array<std::size_t, 4> kept = {0, 0, 0, 0};
+
+				for (std::size_t i = 1; i < count; i++)
+				{
+					if (penetrations[i] > penetrations[kept[0]])
+					{
+						kept[0] = i;
+					}
+				}
+
+				float maxDistance = -1.0f;
+
+				for (std::size_t i = 0; i < count; i++)
+				{
+					glm::vec3 offset = positions[i] - positions[kept[0]];
+					float distance = glm::dot(offset, offset);
+
+					if (distance > maxDistance)
+					{
+						maxDistance = distance;
+						kept[1] = i;
+					}
+				}
+
+				float maxArea = -std::numeric_limits<float>::infinity();
+				float minArea = std::numeric_limits<float>::infinity();
+				glm::vec3 edge = positions[kept[1]] - positions[kept[0]];
+
+				for (std::size_t i = 0; i < count; i++)
+				{
+					float area = glm::dot(glm::cross(edge, positions[i] - positions[kept[0]]), normal);
+
+					if (area > maxArea)
+					{
+						maxArea = area;
+						kept[2] = i;
+					}
+
+					if (area < minArea)
+					{
+						minArea = area;
+						kept[3] = i;
+					}
+				}
+
+				for (std::size_t i : kept)
+				{
+					manifold.addPoint(positions[i], penetrations[i]);
+				}
+			}
+
+			/**
+			 * @brief The contact point between the two edges whose cross
+			 * product separates the boxes the least
+			 */
+			void clipEdges(const OrientedBox& first,
+			               int firstAxis,
+			               const OrientedBox& second,
+			               int secondAxis,
+			               const glm::vec3& normal,
+			               float penetration,
+			               ContactManifold& manifold)
+			{
+				//The edges of either box that lie furthest towards the other
+				glm::vec3 firstPoint = first.center;
+				glm::vec3 secondPoint = second.center;
+
+				for (int i = 0; i < 3; i++)
+				{
+					if (i != firstAxis)
+					{
+						float sign = glm::dot(first.axes[i], normal) < 0.0f ? -1.0f : 1.0f;
+						firstPoint += first.axes[i] * (sign * first.halfExtents[i]);
+					}
+
+					if (i != secondAxis)
+					{
+						float sign = glm::dot(second.axes[i], normal) > 0.0f ? -1.0f : 1.0f;
+						secondPoint += second.axes[i] * (sign * second.halfExtents[i]);
+					}
+				}
+
+				//Closest points of the two edges
+				const glm::vec3& firstDirection = first.axes[firstAxis];
+				const glm::vec3& secondDirection = second.axes[secondAxis];
+				glm::vec3 offset = firstPoint - secondPoint;
+
+				float b = glm::dot(firstDirection, secondDirection);
+				float c = glm::dot(firstDirection, offset);
+				float f = glm::dot(secondDirection, offset);
+				float denominator = 1.0f - b * b;
+
+				float s = denominator > s_parallelTolerance ? (b * f - c) / denominator : 0.0f;
+				s = glm::clamp(s, -first.halfExtents[firstAxis], first.halfExtents[firstAxis]);
+
+				//If the closest point on the second line is off its edge,
+				//find the point on the first edge closest to the end of the
+				//second instead
+				float t = b * s + f;
+				float tClamped = glm::clamp(t, -second.halfExtents[secondAxis], second.halfExtents[secondAxis]);
+
+				if (t != tClamped)
+				{
+					t = tClamped;
+					s = glm::clamp(b * t - c, -first.halfExtents[firstAxis], first.halfExtents[firstAxis]);
+				}
+
+				glm::vec3 position = 0.5f * (firstPoint + firstDirection * s + secondPoint + secondDirection * t);
+				manifold.addPoint(position, penetration);
+			}
+		}
+
+		bool collide(const Collider& first, const Collider& second, ContactManifold& manifold)
+		{
+			PHYSICC_ZONE_FINE;
+
+			manifold.pointCount = 0;
+
+			Collider::Type firstType = first.getType();
+			Collider::Type secondType = second.getType();
+
+			if (firstType == Collider::e_compound)
+			{
+				return collideCompound(static_cast<const CompoundCollider&>(first), second, manifold);
+			}
+
+			if (secondType == Collider::e_compound)
+			{
+				bool touching = collideCompound(static_cast<const CompoundCollider&>(second), first, manifold);
+				manifold.normal = -manifold.normal;
+
+				return touching;
+			}
+
+			if (firstType == Collider::e_triangleMesh)
+			{
+				return collideTriangleMesh(static_cast<const TriangleMeshCollider&>(first), second, manifold);
+			}
+
+			if (secondType == Collider::e_triangleMesh)
+			{
+				bool touching = collideTriangleMesh(static_cast<const TriangleMeshCollider&>(second), first, manifold);
+				manifold.normal = -manifold.normal;
+
+				return touching;
+			}
+
+			if (firstType == Collider::e_sphere && secondType == Collider::e_sphere)
+			{
+				return collideSpheres(static_cast<const SphereCollider&>(first),
+				                      static_cast<const SphereCollider&>(second),
+				                      manifold);
+			}
+
+			if (firstType == Collider::e_sphere && secondType == Collider::e_box)
+			{
+				return collideSphereBox(static_cast<const SphereCollider&>(first),
+				                        static_cast<const BoxCollider&>(second),
+				                        manifold);
+			}
+
+			if (firstType == Collider::e_box && secondType == Collider::e_sphere)
+			{
+				bool touching = collideSphereBox(static_cast<const SphereCollider&>(second),
+				                                 static_cast<const BoxCollider&>(first),
+				                                 manifold);
+				manifold.normal = -manifold.normal;
+
+				return touching;
+			}
+
+			if (firstType == Collider::e_box && secondType == Collider::e_box)
+			{
+				return collideBoxes(static_cast<const BoxCollider&>(first),
+				                    static_cast<const BoxCollider&>(second),
+				                    manifold);
+			}
+
+			return collideConvex(first, second, manifold);
+		}
+
+		bool collideSpheres(const SphereCollider& first,
+		                    const SphereCollider& second,
+		                    ContactManifold& manifold)
+		{
+			glm::vec3 offset = second.getCentroid() - first.getCentroid();
+			float distanceSquared = glm::dot(offset, offset);
+			float radii = first.getRadius() + second.getRadius();
+
+			if (distanceSquared > radii * radii)
+			{
+				return false;
+			}
+
+			float distance = std::sqrt(distanceSquared);
+
+			//Concentric spheres can be pushed apart in any direction
+			manifold.normal = distance > 0.0f ? offset / distance : glm::vec3(0, 1, 0);
+			manifold.pointCount = 0;
+
+			glm::vec3 firstSurface = first.getCentroid() + manifold.normal * first.getRadius();
+			glm::vec3 secondSurface = second.getCentroid() - manifold.normal * second.getRadius();
+
+			manifold.addPoint(0.5f * (firstSurface + secondSurface), radii - distance);
+
+			return true;
+		}
+
+		bool collideSphereBox(const SphereCollider& sphere,
+		                      const BoxCollider& box,
+		                      ContactManifold& manifold)
+		{
+			const glm::mat3& rotation = box.getRotationMatrix();
+			glm::vec3 halfExtents = box.getHalfExtents();
+			float radius = sphere.getRadius();
+
+			//Work in the box's local space, where it is an AABB
+			glm::vec3 center = glm::transpose(rotation) * (sphere.getCentroid() - box.getCentroid());
+			glm::vec3 closest = glm::clamp(center, -halfExtents, halfExtents);
+
+			glm::vec3 localNormal;
+			float penetration;
+
+			if (closest != center)
+			{
+				glm::vec3 offset = center - closest;
+				float distanceSquared = glm::dot(offset, offset);
+
+				if (distanceSquared > radius * radius)
+				{
+					return false;
+				}
+
+				float distance = std::sqrt(distanceSquared);
+				localNormal = offset / distance;
+				penetration = radius - distance;
+			} else
+			{
+				//The center is inside the box, push it out through the
+				//nearest face
+				glm::vec3 depth = halfExtents - glm::abs(center);
+				int axis = depth.x < depth.y ? (depth.x < depth.z ? 0 : 2) : (depth.y < depth.z ? 1 : 2);
+
+				localNormal = glm::vec3(0);
+				localNormal[axis] = center[axis] < 0.0f ? -1.0f : 1.0f;
+				closest[axis] = localNormal[axis] * halfExtents[axis];
+				penetration = radius + depth[axis];
+			}
+
+			//localNormal points from the box to the sphere
+			manifold.normal = -(rotation * localNormal);
+			manifold.pointCount = 0;
+
+			glm::vec3 boxSurface = box.getCentroid() + rotation * closest;
+			glm::vec3 sphereSurface = sphere.getCentroid() + manifold.normal * radius;
+
+			manifold.addPoint(0.5f * (boxSurface + sphereSurface), penetration);
+
+			return true;
+		}
+
+		bool collideBoxes(const BoxCollider& first,
+		                  const BoxCollider& second,
+		                  ContactManifold& manifold)
+		{
+			PHYSICC_ZONE_FINE;
+
+			OrientedBox a = toOrientedBox(first);
+			OrientedBox b = toOrientedBox(second);
+			glm::vec3 offset = b.center - a.center;
+
+			float rotation[3][3];
+			float absRotation[3][3];
+			//b's axes in a's frame. The absolute values are padded, so that
+			//near parallel edges do not produce a bogus separating axis.
+
+			for (int i = 0; i < 3; i++)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					rotation[i][j] = glm::dot(a.axes[i], b.axes[j]);
+					absRotation[i][j] = std::abs(rotation[i][j]) + s_parallelTolerance;
+				}
+			}
+
+			//Separation along each candidate axis. Negative values are
+			//penetration depths, and the largest one wins.
+			float faceASeparation = -std::numeric_limits<float>::infinity();
+			int faceAAxis = 0;
+
+			for (int i = 0; i < 3; i++)
+			{
+				float radiusB = b.halfExtents.x * absRotation[i][0]
+					+ b.halfExtents.y * absRotation[i][1]
+					+ b.halfExtents.z * absRotation[i][2];
+				float separation = std::abs(glm::dot(offset, a.axes[i])) - (a.halfExtents[i] + radiusB);
+
+				if (separation > 0.0f)
+				{
+					return false;
+				}
+
+				if (separation > faceASeparation)
+				{
+					faceASeparation = separation;
+					faceAAxis = i;
+				}
+			}
+
+			float faceBSeparation = -std::numeric_limits<float>::infinity();
+			int faceBAxis = 0;
+
+			for (int j = 0; j < 3; j++)
+			{
+				float radiusA = a.halfExtents.x * absRotation[0][j]
+					+ a.halfExtents.y * absRotation[1][j]
+					+ a.halfExtents.z * absRotation[2][j];
+				float separation = std::abs(glm::dot(offset, b.axes[j])) - (b.halfExtents[j] + radiusA);
+
+				if (separation > 0.0f)
+				{
+					return false;
+				}
+
+				if (separation > faceBSeparation)
+				{
+					faceBSeparation = separation;
+					faceBAxis = j;
+				}
+			}
+
+			float edgeSeparation = -std::numeric_limits<float>::infinity();
+			int edgeAAxis = 0;
+			int edgeBAxis = 0;
+			glm::vec3 edgeNormal(0);
+
+			for (int i = 0; i < 3; i++)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					glm::vec3 axis = glm::cross(a.axes[i], b.axes[j]);
+					float length = glm::length(axis);
+
+					if (length < s_parallelTolerance)
+					{
+						continue;
+					}
+
+					axis /= length;
+
+					float radiusA = 0.0f;
+					float radiusB = 0.0f;
+
+					for (int k = 0; k < 3; k++)
+					{
+						radiusA += a.halfExtents[k] * std::abs(glm::dot(a.axes[k], axis));
+						radiusB += b.halfExtents[k] * std::abs(glm::dot(b.axes[k], axis));
+					}
+
+					float distance = glm::dot(offset, axis);
+					float separation = std::abs(distance) - (radiusA + radiusB);
+
+					if (separation > 0.0f)
+					{
+						return false;
+					}
+
+					if (separation > edgeSeparation)
+					{
+						edgeSeparation = separation;
+						edgeAAxis = i;
+						edgeBAxis = j;
+						edgeNormal = distance < 0.0f ? -axis : axis;
+					}
+				}
+			}
+
+			manifold.pointCount = 0;
+
+			float faceSeparation = glm::max(faceASeparation, faceBSeparation);
+
+			if (s_relativeTolerance * edgeSeparation > faceSeparation + s_absoluteTolerance)
+			{
+				manifold.normal = edgeNormal;
+				clipEdges(a, edgeAAxis, b, edgeBAxis, edgeNormal, -edgeSeparation, manifold);
+
+				return true;
+			}
+
+			if (s_relativeTolerance * faceBSeparation > faceASeparation + s_absoluteTolerance)
+			{
+				//b is the reference box, its face normal points towards a
+				glm::vec3 normal = glm::dot(offset, b.axes[faceBAxis]) > 0.0f
+					? -b.axes[faceBAxis]
+					: b.axes[faceBAxis];
+
+				manifold.normal = -normal;
+				clipFaces(b, faceBAxis, a, normal, manifold);
+			} else
+			{
+				glm::vec3 normal = glm::dot(offset, a.axes[faceAAxis]) < 0.0f
+					? -a.axes[faceAAxis]
+					: a.axes[faceAAxis];
+
+				manifold.normal = normal;
+				clipFaces(a, faceAAxis, b, normal, manifold);
+			}
+
+			return manifold.pointCount != 0;
+		}
+	}
+}
@@ -14,9 +14,12 @@
 /* -- Includes -- */
 /* physicsworld header */
 
-#include "tools/Tracy.hpp"
+#include "profiling.hpp"
 
 #include "physicsworld.hpp"
+#include "narrowphase.hpp"
+
+#include <algorithm>
 
 namespace Physicc
 {
@@ -25,21 +28,120 @@ namespace Physicc
 	 *
 	 * This initialises the Physics World with gravity, input from the ---?---.
 	 */
-	PhysicsWorld::PhysicsWorld(const glm::vec3& gravity)
-		: m_gravity(gravity)    
+	PhysicsWorld::PhysicsWorld(const glm::vec3& gravity, unsigned int workerCount)
+		:	m_gravity(gravity),
+			m_jobSystem(std::make_unique<JobSystem>(workerCount)),
+			m_broadphase(std::make_unique<DynamicBVHBroadphase>())
 	{
 	}
 
 	/**
-	 * @fn void PhysicsWorld::addRigidBody(const RigidBody& object)
-	 * @brief Add a new RigidBody to m_objects
+	 * @fn std::size_t PhysicsWorld::addRigidBody(const RigidBody& object)
+	 * @brief Add a new RigidBody to the world's body arrays
 	 * @param object: input, const RigidBody& type
 	 */
-	void PhysicsWorld::addRigidBody(const RigidBody& object)
+	std::size_t PhysicsWorld::addRigidBody(const RigidBody& object)
+	{
+		PHYSICC_ZONE_FINE;
+
+		float inverseMass = object.getInverseMass();
+
+		m_positions.push_back(object.getPosition());
+		m_previousPositions.push_back(object.getPosition());
+		m_velocities.push_back(object.getVelocity());
+		m_forces.push_back(object.getForce());
+		m_inverseMasses.push_back(inverseMass);
+		m_gravityScales.push_back(inverseMass > 0.0f ? object.getGravityScale() : 0.0f);
+		m_frictions.push_back(object.getFriction());
+		m_restitutions.push_back(object.getRestitution());
+		m_colliderHandles.push_back(std::visit([this](const auto& collider) {
+			return m_colliders.add(collider, static_cast<std::uint32_t>(m_positions.size() - 1));
+		}, object.m_collider));
+
+		m_volumes.push_back(object.getAABB());
+		m_broadphase->addBody(m_volumes.back(), inverseMass == 0.0f);
+
+		m_awake.push_back(1);
+		m_removed.push_back(0);
+		m_sleepTimes.push_back(0.0f);
+		m_sleepVelocities.push_back(m_sleepVelocity);
+		m_timesToSleep.push_back(m_timeToSleep);
+		m_islandSlots.push_back(0);
+		m_sweptBodySlots.push_back(s_notSwept);
+		m_awakeBodiesChanged = true;
+
+		return m_positions.size() - 1;
+	}
+
+	void PhysicsWorld::removeRigidBody(std::size_t index)
 	{
-		ZoneScoped;
+		PHYSICC_ZONE_FINE;
+
+		if (m_removed[index])
+		{
+			return;
+		}
 
-		m_objects.push_back(object);
+		//Wake up the island the body was part of, and the bodies that were
+		//resting on it if it is static (static bodies are not part of any
+		//island)
+		wakeBody(index);
+
+		for (const BodyPair& pair : m_pairs)
+		{
+			if (pair.first == index || pair.second == index)
+			{
+				std::uint32_t other = pair.first == index ? pair.second : pair.first;
+
+				if (m_inverseMasses[other] != 0.0f)
+				{
+					wakeBody(other);
+				}
+			}
+		}
+
+		//Asleep forever, which keeps it out of every stage but the
+		//broadphase, whose pairs with it are dropped in findPairs()
+		m_removed[index] = 1;
+		m_removedCount++;
+		m_awake[index] = 0;
+		m_velocities[index] = glm::vec3(0.0f);
+		m_forces[index] = glm::vec3(0.0f);
+		m_awakeBodiesChanged = true;
+	}
+
+	unsigned int PhysicsWorld::update(float frameTime)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		m_accumulator += frameTime;
+
+		unsigned int steps = static_cast<unsigned int>(m_accumulator / m_fixedTimestep + s_stepTolerance);
+
+		if (steps > m_maxSubsteps)
+		{
+			//Drop the time we cannot catch up on
+			steps = m_maxSubsteps;
+			m_accumulator = steps * static_cast<double>(m_fixedTimestep);
+		}
+
+		for (unsigned int i = 0; i < steps; i++)
+		{
+			if (i + 1 == steps)
+			{
+				//Only the positions before the last step are needed to
+				//interpolate
+				m_previousPositions = m_positions;
+			}
+
+			stepSimulation(m_fixedTimestep);
+			m_accumulator -= m_fixedTimestep;
+		}
+
+		m_accumulator = glm::max(m_accumulator, 0.0);
+		m_interpolationFactor = static_cast<float>(glm::clamp(m_accumulator / m_fixedTimestep, 0.0, 1.0));
+
+		return steps;
 	}
 
 	/**
@@ -47,13 +149,449 @@ namespace Physicc
 	 * @brief steps the simulation by time timestep
 	 * @param timestep: input, float type, time interval
 	 */
-	void PhysicsWorld::stepSimulation([[maybe_unused]] float timestep)
+	void PhysicsWorld::stepSimulation(float timestep)
 	{
-		ZoneScoped;
+		PHYSICC_ZONE_COARSE;
+
+		if (m_awakeBodiesChanged)
+		{
+			collectAwakeBodies();
+		}
+
+		updateBounds();
+		sweepFastBodies(timestep);
+		findPairs(timestep);
+		findContacts();
+		wakeTouchedIslands();
 
-		for(std::size_t i = 0; i < m_objects.size(); i++)
+		//The contacts of the bodies that just woke up with the rest of their
+		//island were skipped, as both bodies were asleep. Finding them again
+		//can wake up more islands, so repeat until nothing else wakes up.
+		while (m_awakeBodiesChanged)
 		{
+			collectAwakeBodies();
+			findContacts();
+			wakeTouchedIslands();
 		}
+
+		//Prepared before the velocities are integrated, so that bodies
+		//bounce off the velocity they hit each other with, and not with
+		//this step's gravity on top of it
+		prepareContacts(timestep);
+
+		m_jobSystem->parallelFor(m_awakeBodies.size(), s_integrateGrainSize,
+		                         [this, timestep](std::size_t start, std::size_t end) {
+			                         integrateVelocities(start, end, timestep);
+		                         });
+
+		solveContacts();
+		findImpacts(timestep);
+
+		m_jobSystem->parallelFor(m_awakeBodies.size(), s_integrateGrainSize,
+		                         [this, timestep](std::size_t start, std::size_t end) {
+			                         integratePositions(start, end, timestep);
+		                         });
+
+		stopAtImpacts();
+		updateSleep(timestep);
 	}
-}
 
+	void PhysicsWorld::setBroadphase(std::unique_ptr<Broadphase> broadphase)
+	{
+		m_broadphase = std::move(broadphase);
+
+		for (std::size_t i = 0; i < m_volumes.size(); i++)
+		{
+			m_broadphase->addBody(m_volumes[i], m_inverseMasses[i] == 0.0f);
+		}
+	}
+
+	void PhysicsWorld::integrateVelocities(std::size_t start, std::size_t end, float timestep)
+	{
+		PHYSICC_ZONE_FINE;
+
+		//Plain pointers and a local copy of the gravity keep the compiler
+		//from assuming the arrays alias each other or the world's members
+		const std::uint32_t* bodies = m_awakeBodies.data();
+		glm::vec3* velocities = m_velocities.data();
+		const glm::vec3* forces = m_forces.data();
+		const float* inverseMasses = m_inverseMasses.data();
+		const float* gravityScales = m_gravityScales.data();
+		const glm::vec3 gravity = m_gravity;
+
+		for (std::size_t k = start; k < end; k++)
+		{
+			std::uint32_t i = bodies[k];
+
+			velocities[i] += (gravity * gravityScales[i] + forces[i] * inverseMasses[i]) * timestep;
+		}
+	}
+
+	void PhysicsWorld::integratePositions(std::size_t start, std::size_t end, float timestep)
+	{
+		PHYSICC_ZONE_FINE;
+
+		const std::uint32_t* bodies = m_awakeBodies.data();
+		glm::vec3* positions = m_positions.data();
+		const glm::vec3* velocities = m_velocities.data();
+
+		if (m_integrator == Integrator::SemiImplicitEuler)
+		{
+			for (std::size_t k = start; k < end; k++)
+			{
+				std::uint32_t i = bodies[k];
+
+				positions[i] += velocities[i] * timestep;
+			}
+		} else
+		{
+			//The velocities already hold a whole step's worth of
+			//acceleration (and the solver's impulses). Taking half of the
+			//acceleration back out gives x += v * dt + a * dt^2 / 2 in terms
+			//of the velocities before the step.
+			const glm::vec3* forces = m_forces.data();
+			const float* inverseMasses = m_inverseMasses.data();
+			const float* gravityScales = m_gravityScales.data();
+			const glm::vec3 gravity = m_gravity;
+			const float halfStep = 0.5f * timestep;
+
+			for (std::size_t k = start; k < end; k++)
+			{
+				std::uint32_t i = bodies[k];
+				glm::vec3 acceleration = gravity * gravityScales[i] + forces[i] * inverseMasses[i];
+
+				positions[i] += (velocities[i] - acceleration * halfStep) * timestep;
+			}
+		}
+	}
+
+	void PhysicsWorld::updateBounds()
+	{
+		PHYSICC_ZONE_COARSE;
+
+		m_colliders.updateBounds(m_positions, m_awake, m_volumes, *m_jobSystem);
+	}
+
+	void PhysicsWorld::sweepFastBodies(float timestep)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		if (!m_continuousCollision)
+		{
+			return;
+		}
+
+		for (std::uint32_t i : m_awakeBodies)
+		{
+			if (m_inverseMasses[i] == 0.0f)
+			{
+				continue;
+			}
+
+			//Where the body would go if nothing stopped it
+			glm::vec3 acceleration = m_gravity * m_gravityScales[i] + m_forces[i] * m_inverseMasses[i];
+			glm::vec3 motion = (m_velocities[i] + acceleration * timestep) * timestep;
+
+			glm::vec3 lowerBound = m_volumes[i].getLowerBound();
+			glm::vec3 upperBound = m_volumes[i].getUpperBound();
+			glm::vec3 size = upperBound - lowerBound;
+			float threshold = m_sweepThreshold * glm::min(glm::min(size.x, size.y), size.z);
+
+			if (glm::dot(motion, motion) <= threshold * threshold)
+			{
+				continue;
+			}
+
+			m_volumes[i] = {glm::min(lowerBound, lowerBound + motion),
+			                glm::max(upperBound, upperBound + motion)};
+
+			m_sweptBodySlots[i] = static_cast<std::uint32_t>(m_sweptBodies.size());
+			m_sweptBodies.push_back({i, 1.0f, m_positions[i]});
+		}
+	}
+
+	void PhysicsWorld::findImpacts(float timestep)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		if (m_sweptBodies.empty())
+		{
+			return;
+		}
+
+		//The velocities are final now, so they may point somewhere else
+		//than they did when the bodies were swept, e.g. after a bounce. Only
+		//what was in the way of the swept AABB is tested.
+		for (const BodyPair& pair : m_pairs)
+		{
+			for (int side = 0; side < 2; side++)
+			{
+				std::uint32_t body = side == 0 ? pair.first : pair.second;
+				std::uint32_t other = side == 0 ? pair.second : pair.first;
+				std::uint32_t slot = m_sweptBodySlots[body];
+
+				if (slot == s_notSwept)
+				{
+					continue;
+				}
+
+				glm::vec3 motion = (m_velocities[body] - m_velocities[other]) * timestep;
+				float distance = glm::length(motion);
+
+				if (distance == 0.0f)
+				{
+					continue;
+				}
+
+				float time;
+				glm::vec3 normal;
+
+				//Bodies that already touch are left to the solver
+				if (Narrowphase::timeOfImpact(getCollider(body), getCollider(other), motion, time, normal)
+				    && time > 0.0f)
+				{
+					float stopTime = glm::min(time + s_impactOverlap / distance, 1.0f);
+					m_sweptBodies[slot].time = glm::min(m_sweptBodies[slot].time, stopTime);
+				}
+			}
+		}
+	}
+
+	void PhysicsWorld::stopAtImpacts()
+	{
+		PHYSICC_ZONE_FINE;
+
+		for (const SweptBody& swept : m_sweptBodies)
+		{
+			//Both integrators move a body in a straight line during a step
+			m_positions[swept.body] = glm::mix(swept.start, m_positions[swept.body], swept.time);
+			m_sweptBodySlots[swept.body] = s_notSwept;
+		}
+
+		m_sweptBodies.clear();
+	}
+
+	void PhysicsWorld::findPairs(float timestep)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		m_broadphase->update(m_volumes, m_velocities, timestep, *m_jobSystem);
+		m_broadphase->findPairs(m_volumes, m_pairs, *m_jobSystem);
+
+		if (m_removedCount != 0)
+		{
+			m_pairs.erase(std::remove_if(m_pairs.begin(), m_pairs.end(), [this](const BodyPair& pair) {
+				return m_removed[pair.first] || m_removed[pair.second];
+			}), m_pairs.end());
+		}
+	}
+
+	void PhysicsWorld::findContacts()
+	{
+		PHYSICC_ZONE_COARSE;
+
+		m_chunkContacts.resize(JobSystem::chunkCount(m_pairs.size(), s_narrowphaseGrainSize));
+
+		m_jobSystem->parallelFor(m_pairs.size(), s_narrowphaseGrainSize,
+		                         [this](std::size_t start, std::size_t end) {
+			std::vector<ContactManifold>& chunkContacts = m_chunkContacts[start / s_narrowphaseGrainSize];
+			chunkContacts.clear();
+
+			ContactManifold manifold;
+
+			for (std::size_t i = start; i < end; i++)
+			{
+				const BodyPair& pair = m_pairs[i];
+
+				if (!m_awake[pair.first] && !m_awake[pair.second])
+				{
+					continue;
+				}
+
+				if (Narrowphase::collide(m_colliders.get(m_colliderHandles[pair.first]),
+				                         m_colliders.get(m_colliderHandles[pair.second]),
+				                         manifold))
+				{
+					manifold.first = pair.first;
+					manifold.second = pair.second;
+					chunkContacts.push_back(manifold);
+				}
+			}
+		});
+
+		m_contacts.clear();
+
+		for (const auto& chunkContacts : m_chunkContacts)
+		{
+			m_contacts.insert(m_contacts.end(), chunkContacts.begin(), chunkContacts.end());
+		}
+	}
+
+	void PhysicsWorld::prepareContacts(float timestep)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		m_islandBuilder.build(m_awakeBodies, m_positions.size(), m_contacts, m_inverseMasses);
+
+		m_contactSolver.prepare(m_contacts,
+		                        m_positions,
+		                        m_velocities,
+		                        m_inverseMasses,
+		                        m_frictions,
+		                        m_restitutions,
+		                        timestep,
+		                        *m_jobSystem);
+	}
+
+	void PhysicsWorld::solveContacts()
+	{
+		PHYSICC_ZONE_COARSE;
+
+		m_contactSolver.solve(m_islandBuilder, m_velocities, *m_jobSystem);
+		m_contactSolver.storeImpulses();
+	}
+
+	void PhysicsWorld::wakeBody(std::size_t index)
+	{
+		if (m_awake[index] || m_removed[index])
+		{
+			return;
+		}
+
+		std::uint32_t slot = m_islandSlots[index];
+
+		for (std::uint32_t body : m_sleepingIslands[slot])
+		{
+			m_awake[body] = 1;
+			m_sleepTimes[body] = 0.0f;
+		}
+
+		m_sleepingIslands[slot].clear();
+		m_freeIslandSlots.push_back(slot);
+		m_awakeBodiesChanged = true;
+	}
+
+	void PhysicsWorld::setSleepingEnabled(bool enabled)
+	{
+		m_sleepingEnabled = enabled;
+
+		if (!enabled)
+		{
+			for (std::size_t i = 0; i < m_awake.size(); i++)
+			{
+				wakeBody(i);
+			}
+		}
+	}
+
+	void PhysicsWorld::setSleepThresholds(float velocity, float time)
+	{
+		m_sleepVelocity = velocity;
+		m_timeToSleep = time;
+
+		std::fill(m_sleepVelocities.begin(), m_sleepVelocities.end(), velocity);
+		std::fill(m_timesToSleep.begin(), m_timesToSleep.end(), time);
+	}
+
+	void PhysicsWorld::collectAwakeBodies()
+	{
+		PHYSICC_ZONE_FINE;
+
+		m_awakeBodies.clear();
+
+		for (std::size_t i = 0; i < m_awake.size(); i++)
+		{
+			if (m_awake[i])
+			{
+				m_awakeBodies.push_back(static_cast<std::uint32_t>(i));
+			}
+		}
+
+		m_awakeBodiesChanged = false;
+	}
+
+	void PhysicsWorld::wakeTouchedIslands()
+	{
+		PHYSICC_ZONE_COARSE;
+
+		//A contact between an awake body and a sleeping one wakes the
+		//sleeping one's island, unless the sleeping one is static: a static
+		//body only moves when it is told to. Contacts rather than pairs,
+		//since overlapping AABBs do not mean the bodies touch: two bodies
+		//resting next to each other (say a compound over a smaller body)
+		//would otherwise keep waking each other up. Every contact with a
+		//sleeping dynamic body has to wake it, as the islands and the solver
+		//only know about awake ones.
+		for (const ContactManifold& contact : m_contacts)
+		{
+			if (m_awake[contact.first] && !m_awake[contact.second] && m_inverseMasses[contact.second] != 0.0f)
+			{
+				wakeBody(contact.second);
+			} else if (m_awake[contact.second] && !m_awake[contact.first] && m_inverseMasses[contact.first] != 0.0f)
+			{
+				wakeBody(contact.first);
+			}
+		}
+	}
+
+	void PhysicsWorld::updateSleep(float timestep)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		if (!m_sleepingEnabled)
+		{
+			return;
+		}
+
+		for (std::uint32_t body : m_awakeBodies)
+		{
+			float sleepVelocity = m_sleepVelocities[body];
+			bool isResting = glm::dot(m_velocities[body], m_velocities[body]) <= sleepVelocity * sleepVelocity;
+			m_sleepTimes[body] = isResting ? m_sleepTimes[body] + timestep : 0.0f;
+		}
+
+		//The islands were built before solving, and nothing has woken up
+		//since
+		const std::vector<std::uint32_t>& islandBodies = m_islandBuilder.getBodies();
+
+		for (const IslandBuilder::Island& island : m_islandBuilder.getIslands())
+		{
+			auto begin = islandBodies.begin() + island.bodyStart;
+			auto end = begin + island.bodyCount;
+
+			//An island falls asleep as a whole, once all of its bodies have
+			//been resting for as long as each of them needs to
+			bool isResting = std::all_of(begin, end, [this](std::uint32_t body) {
+				return m_sleepTimes[body] >= m_timesToSleep[body];
+			});
+
+			if (!isResting)
+			{
+				continue;
+			}
+
+			std::uint32_t slot;
+
+			if (m_freeIslandSlots.empty())
+			{
+				slot = static_cast<std::uint32_t>(m_sleepingIslands.size());
+				m_sleepingIslands.emplace_back();
+			} else
+			{
+				slot = m_freeIslandSlots.back();
+				m_freeIslandSlots.pop_back();
+			}
+
+			m_sleepingIslands[slot].assign(begin, end);
+
+			for (auto body = begin; body != end; ++body)
+			{
+				m_awake[*body] = 0;
+				m_velocities[*body] = glm::vec3(0);
+				m_islandSlots[*body] = slot;
+			}
+
+			m_awakeBodiesChanged = true;
+		}
+	}
+}
@@ -19,7 +19,7 @@ namespace Physicc
 	 * the scale of the gravity is acting on the object.
 	 */
 	RigidBody::RigidBody(const float mass, const glm::vec3& velocity,
-						const float gravityScale = 1)
+						const float gravityScale)
 		:	m_force(glm::vec3(0)),
 			m_mass(mass),
 			m_velocity(velocity),
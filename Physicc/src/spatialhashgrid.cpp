@@ -0,0 +1,250 @@
+#include "profiling.hpp"
+/**
+ * @file spatialhashgrid.cpp
+ * @brief A broadphase over a hashed uniform grid.
+ *
+ * The grid is rebuilt every step like a counting sort: one pass over the
+ * bodies counts how many land in each cell (creating the cells in the hash
+ * table along the way), a prefix sum over the table turns the counts into
+ * positions, and a final pass drops the bodies into place.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* spatialhashgrid header */
+
+#include "spatialhashgrid.hpp"
+
+#include <algorithm>
+
+namespace Physicc
+{
+	namespace
+	{
+		constexpr float s_cellCoordinateLimit = 1 << 30;
+		//cell coordinates are clamped to this, so that they fit in an int
+	}
+
+	SpatialHashGrid::SpatialHashGrid(float cellSize)
+		:	m_cellSize(cellSize),
+			m_currentCellSize(cellSize > 0.0f ? cellSize : 1.0f)
+	{
+	}
+
+	void SpatialHashGrid::addBody(const BoundingVolume::AABB&, bool isStatic)
+	{
+		PHYSICC_ZONE_FINE;
+
+		m_isStatic.push_back(isStatic);
+	}
+
+	glm::ivec3 SpatialHashGrid::getCell(const glm::vec3& point) const
+	{
+		return glm::ivec3(glm::floor(glm::clamp(point / m_currentCellSize,
+		                                        -s_cellCoordinateLimit,
+		                                        s_cellCoordinateLimit)));
+	}
+
+	std::uint32_t SpatialHashGrid::findSlot(const glm::ivec3& cell) const
+	{
+		auto hash = static_cast<std::uint32_t>(cell.x) * 73856093u
+			^ static_cast<std::uint32_t>(cell.y) * 19349663u
+			^ static_cast<std::uint32_t>(cell.z) * 83492791u;
+
+		auto mask = static_cast<std::uint32_t>(m_slots.size() - 1);
+		std::uint32_t index = hash & mask;
+
+		while (m_slots[index].count != 0 && m_slots[index].cell != cell)
+		{
+			index = (index + 1) & mask;
+		}
+
+		return index;
+	}
+
+	template <typename Function>
+	void SpatialHashGrid::forEachCell(const CellRange& range, Function&& function)
+	{
+		for (int z = range.min.z; z <= range.max.z; z++)
+		{
+			for (int y = range.min.y; y <= range.max.y; y++)
+			{
+				for (int x = range.min.x; x <= range.max.x; x++)
+				{
+					function(glm::ivec3(x, y, z));
+				}
+			}
+		}
+	}
+
+	void SpatialHashGrid::update(const std::vector<BoundingVolume::AABB>& volumes,
+	                             const std::vector<glm::vec3>&,
+	                             float,
+	                             JobSystem&)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		std::size_t bodyCount = volumes.size();
+
+		if (m_cellSize > 0.0f)
+		{
+			m_currentCellSize = m_cellSize;
+		} else if (bodyCount != 0)
+		{
+			float totalSize = 0.0f;
+
+			for (const auto& volume : volumes)
+			{
+				glm::vec3 size = volume.getUpperBound() - volume.getLowerBound();
+				totalSize += glm::max(size.x, glm::max(size.y, size.z));
+			}
+
+			float cellSize = s_autoCellSizeFactor * totalSize / static_cast<float>(bodyCount);
+			m_currentCellSize = cellSize > 0.0f ? cellSize : 1.0f;
+		}
+
+		//Find the cells every body touches
+		m_ranges.resize(bodyCount);
+		m_oversized.clear();
+		std::size_t entryCount = 0;
+
+		for (std::size_t i = 0; i < bodyCount; i++)
+		{
+			CellRange& range = m_ranges[i];
+			range.min = getCell(volumes[i].getLowerBound());
+			range.max = getCell(volumes[i].getUpperBound());
+
+			//in floating point, since the number of cells may not fit in
+			//an int
+			glm::vec3 cells = glm::vec3(range.max) - glm::vec3(range.min) + 1.0f;
+
+			if (cells.x * cells.y * cells.z > s_maxCellsPerBody)
+			{
+				m_oversized.push_back(static_cast<std::uint32_t>(i));
+				range.max.x = range.min.x - 1;
+				//leave it out of the grid
+
+				continue;
+			}
+
+			entryCount += static_cast<std::size_t>(cells.x * cells.y * cells.z);
+		}
+
+		//At most half full, so that probe sequences stay short
+		std::size_t capacity = 16;
+
+		while (capacity < 2 * entryCount)
+		{
+			capacity *= 2;
+		}
+
+		m_slots.assign(capacity, {glm::ivec3(0), 0, 0});
+		m_entries.clear();
+		m_entries.reserve(entryCount);
+
+		//Count the bodies in each cell
+		for (std::size_t i = 0; i < bodyCount; i++)
+		{
+			forEachCell(m_ranges[i], [this, i](const glm::ivec3& cell) {
+				std::uint32_t slot = findSlot(cell);
+
+				m_slots[slot].cell = cell;
+				m_slots[slot].count++;
+				m_entries.push_back({slot, static_cast<std::uint32_t>(i)});
+			});
+		}
+
+		//Point every slot past the end of its cell's range...
+		std::uint32_t end = 0;
+
+		for (Slot& slot : m_slots)
+		{
+			end += slot.count;
+			slot.start = end;
+		}
+
+		//...and fill the ranges back to front, which leaves every slot
+		//pointing at the start of its range, and the bodies in each cell in
+		//body order
+		m_cellBodies.resize(entryCount);
+
+		for (auto entry = m_entries.rbegin(); entry != m_entries.rend(); ++entry)
+		{
+			m_cellBodies[--m_slots[entry->slot].start] = entry->body;
+		}
+	}
+
+	void SpatialHashGrid::findPairs(const std::vector<BoundingVolume::AABB>& volumes,
+	                                std::vector<BodyPair>& pairs,
+	                                JobSystem& jobSystem)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		m_chunkPairs.resize(JobSystem::chunkCount(m_slots.size(), s_grainSize));
+
+		jobSystem.parallelFor(m_slots.size(), s_grainSize, [&](std::size_t start, std::size_t end) {
+			std::vector<BodyPair>& chunkPairs = m_chunkPairs[start / s_grainSize];
+			chunkPairs.clear();
+
+			for (std::size_t i = start; i < end; i++)
+			{
+				const Slot& slot = m_slots[i];
+				const std::uint32_t* bodies = m_cellBodies.data() + slot.start;
+
+				for (std::uint32_t j = 0; j < slot.count; j++)
+				{
+					for (std::uint32_t k = j + 1; k < slot.count; k++)
+					{
+						std::uint32_t first = bodies[j];
+						std::uint32_t second = bodies[k];
+
+						if ((m_isStatic[first] && m_isStatic[second])
+						    || !volumes[first].overlapsWith(volumes[second]))
+						{
+							continue;
+						}
+
+						//Two bodies can share more than one cell. Only the
+						//cell holding the lower corner of their overlap
+						//reports them.
+						glm::vec3 overlapCorner = glm::max(volumes[first].getLowerBound(),
+						                                   volumes[second].getLowerBound());
+
+						if (getCell(overlapCorner) == slot.cell)
+						{
+							chunkPairs.push_back({first, second});
+						}
+					}
+				}
+			}
+		});
+
+		pairs.clear();
+
+		for (const auto& chunkPairs : m_chunkPairs)
+		{
+			pairs.insert(pairs.end(), chunkPairs.begin(), chunkPairs.end());
+		}
+
+		//Oversized bodies are tested against everything. There should only
+		//be a handful of them.
+		for (std::uint32_t body : m_oversized)
+		{
+			for (std::uint32_t other = 0; other < volumes.size(); other++)
+			{
+				bool otherIsOversized = m_ranges[other].max.x < m_ranges[other].min.x;
+
+				if (other == body
+				    || (otherIsOversized && other < body)
+				    || (m_isStatic[body] && m_isStatic[other])
+				    || !volumes[body].overlapsWith(volumes[other]))
+				{
+					continue;
+				}
+
+				pairs.push_back({std::min(body, other), std::max(body, other)});
+			}
+		}
+	}
+}
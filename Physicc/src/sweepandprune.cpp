@@ -0,0 +1,154 @@
+#include "profiling.hpp"
+/**
+ * @file sweepandprune.cpp
+ * @brief A sort and sweep broadphase that keeps its endpoint lists sorted
+ * across steps.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* sweepandprune header */
+
+#include "sweepandprune.hpp"
+
+#include <algorithm>
+
+namespace Physicc
+{
+	void SweepAndPrune::addBody(const BoundingVolume::AABB& volume, bool isStatic)
+	{
+		PHYSICC_ZONE_FINE;
+
+		auto body = static_cast<std::uint32_t>(m_isStatic.size());
+
+		//The new endpoints go at the end, and are sorted into place by the
+		//next update
+		for (int axis = 0; axis < 3; axis++)
+		{
+			m_endpoints[axis].push_back({volume.getLowerBound()[axis], body});
+			m_endpoints[axis].push_back({volume.getUpperBound()[axis], body | s_upperBit});
+		}
+
+		m_isStatic.push_back(isStatic);
+		m_openSlot.push_back(0);
+		m_needsFullSort = true;
+	}
+
+	void SweepAndPrune::insertionSort(std::vector<Endpoint>& endpoints)
+	{
+		PHYSICC_ZONE_FINE;
+
+		for (std::size_t i = 1; i < endpoints.size(); i++)
+		{
+			Endpoint endpoint = endpoints[i];
+			std::size_t j = i;
+
+			for (; j > 0 && endpoint < endpoints[j - 1]; j--)
+			{
+				endpoints[j] = endpoints[j - 1];
+			}
+
+			endpoints[j] = endpoint;
+		}
+	}
+
+	void SweepAndPrune::update(const std::vector<BoundingVolume::AABB>& volumes,
+	                           const std::vector<glm::vec3>&,
+	                           float,
+	                           JobSystem& jobSystem)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		//The axes are independent of each other, so they are sorted in
+		//parallel
+		jobSystem.parallelFor(3, 1, [&](std::size_t start, std::size_t end) {
+			for (std::size_t axis = start; axis < end; axis++)
+			{
+				for (Endpoint& endpoint : m_endpoints[axis])
+				{
+					const BoundingVolume::AABB& volume = volumes[endpoint.getBody()];
+
+					endpoint.value = endpoint.isUpper()
+						? volume.getUpperBound()[axis]
+						: volume.getLowerBound()[axis];
+				}
+
+				if (m_needsFullSort)
+				{
+					std::sort(m_endpoints[axis].begin(), m_endpoints[axis].end());
+				} else
+				{
+					insertionSort(m_endpoints[axis]);
+				}
+			}
+		});
+
+		m_needsFullSort = false;
+
+		//Sweep along the axis with the most spread out centroids, which
+		//leaves the fewest intervals open at the same time
+		glm::vec3 sum(0.0f);
+		glm::vec3 sumOfSquares(0.0f);
+
+		for (const auto& volume : volumes)
+		{
+			glm::vec3 centroid = 0.5f * (volume.getLowerBound() + volume.getUpperBound());
+			sum += centroid;
+			sumOfSquares += centroid * centroid;
+		}
+
+		glm::vec3 variance = sumOfSquares - sum * sum / static_cast<float>(std::max<std::size_t>(volumes.size(), 1));
+
+		m_sweepAxis = 0;
+
+		if (variance.y > variance[m_sweepAxis])
+		{
+			m_sweepAxis = 1;
+		}
+
+		if (variance.z > variance[m_sweepAxis])
+		{
+			m_sweepAxis = 2;
+		}
+	}
+
+	void SweepAndPrune::findPairs(const std::vector<BoundingVolume::AABB>& volumes,
+	                              std::vector<BodyPair>& pairs,
+	                              JobSystem&)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		pairs.clear();
+		m_open.clear();
+
+		for (const Endpoint& endpoint : m_endpoints[m_sweepAxis])
+		{
+			std::uint32_t body = endpoint.getBody();
+
+			if (endpoint.isUpper())
+			{
+				//Close the body's interval
+				std::uint32_t last = m_open.back();
+				m_open[m_openSlot[body]] = last;
+				m_openSlot[last] = m_openSlot[body];
+				m_open.pop_back();
+
+				continue;
+			}
+
+			//Every open interval overlaps this one along the sweep axis
+			for (std::uint32_t other : m_open)
+			{
+				if (!(m_isStatic[body] && m_isStatic[other])
+				    && volumes[body].overlapsWith(volumes[other]))
+				{
+					pairs.push_back({std::min(body, other), std::max(body, other)});
+				}
+			}
+
+			m_openSlot[body] = static_cast<std::uint32_t>(m_open.size());
+			m_open.push_back(body);
+		}
+	}
+}
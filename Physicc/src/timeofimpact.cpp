@@ -0,0 +1,455 @@
+#include "profiling.hpp"
+/**
+ * @file timeofimpact.cpp
+ * @brief Time of impact between two moving convex shapes, using a GJK ray
+ * cast.
+ *
+ * The first shape moved by t * motion touches the second one exactly when
+ * t * motion lies in the Minkowski difference D = second - first. The ray
+ * t * motion is advanced towards D one conservative step at a time: GJK
+ * keeps track of the point of D closest to the ray's current point x, and
+ * the plane through it that separates x from D tells how far the ray can
+ * move before it might enter D. See G. van den Bergen, "Ray Casting against
+ * General Convex Objects with Application to Continuous Collision
+ * Detection".
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* narrowphase header */
+
+#include "narrowphase.hpp"
+
+#include <array>
+#include <limits>
+
+namespace Physicc
+{
+	namespace Narrowphase
+	{
+		namespace
+		{
+			constexpr int s_maxIterations = 64;
+
+			constexpr float s_tolerance = 1e-4f;
+			//the ray stops once it is this close to the Minkowski
+			//difference
+
+			constexpr float s_epsilon = 1e-10f;
+
+			/**
+			 * @brief The point of the Minkowski difference furthest along
+			 * a direction
+			 */
+			template <typename First, typename Second>
+			inline glm::vec3 getSupport(const First& first,
+			                            const Second& second,
+			                            const glm::vec3& direction)
+			{
+				return second.getSupport(direction) - first.getSupport(-direction);
+			}
+
+			/**
+			 * @brief Find the point of the convex hull of up to 4 points
+			 * closest to the origin
+			 *
+			 * Every subset of the points is tried, keeping the closest
+			 * projection of the origin onto a subset's affine hull that lies
+			 * inside the subset. With at most 15 subsets, this is simpler
+			 * and sturdier than Johnson's recursive distance algorithm.
+			 *
+			 * @param points The points
+			 * @param count Number of points
+			 * @param subset Set to the bits of the points that the closest
+			 * point is a combination of
+			 * @return The closest point
+			 */
+			glm::vec3 closestToOrigin(const std::array<glm::vec3, 4>& points,
+			                          int count,
+			                          unsigned int& subset)
+			{
+				float bestDistance = std::numeric_limits<float>::infinity();
+				glm::vec3 best = points[0];
+				subset = 1;
+
+				for (unsigned int candidate = 1; candidate < (1u << count); candidate++)
+				{
+					std::array<glm::vec3, 4> vertices{};
+					int size = 0;
+
+					for (int i = 0; i < count; i++)
+					{
+						if (candidate & (1u << i))
+						{
+							vertices[size++] = points[i];
+						}
+					}
+
+					//The origin's projection is vertices[0] + sum of
+					//weights[i] * edges[i], with the weights solving the
+					//normal equations G * weights = rhs
+					glm::vec3 edges[3] = {glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f)};
+					glm::vec3 rhs(0.0f);
+					glm::mat3 gram(1.0f);
+
+					for (int i = 1; i < size; i++)
+					{
+						edges[i - 1] = vertices[i] - vertices[0];
+						rhs[i - 1] = -glm::dot(edges[i - 1], vertices[0]);
+					}
+
+					for (int i = 0; i < size - 1; i++)
+					{
+						for (int j = 0; j < size - 1; j++)
+						{
+							gram[i][j] = glm::dot(edges[i], edges[j]);
+						}
+					}
+
+					//The unused rows and columns are left as the identity,
+					//which makes the system solvable for any size
+					float determinant = glm::determinant(gram);
+
+					if (size > 1 && glm::abs(determinant) < s_epsilon)
+					{
+						continue;
+					}
+
+					glm::vec3 weights = size > 1 ? glm::inverse(gram) * rhs : glm::vec3(0.0f);
+					float firstWeight = 1.0f;
+					glm::vec3 point = vertices[0];
+					bool inside = true;
+
+					for (int i = 0; i < size - 1; i++)
+					{
+						inside = inside && weights[i] >= 0.0f;
+						firstWeight -= weights[i];
+						point += weights[i] * edges[i];
+					}
+
+					if (!inside || firstWeight < 0.0f)
+					{
+						continue;
+					}
+
+					float distance = glm::dot(point, point);
+
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						best = point;
+						subset = candidate;
+					}
+				}
+
+				return best;
+			}
+
+			/**
+			 * @brief The GJK ray cast, on anything with getSupport() and
+			 * getCentroid(), which lets a triangle of a mesh stand in for a
+			 * collider
+			 */
+			template <typename First, typename Second>
+			bool castShapes(const First& first,
+			                const Second& second,
+			                const glm::vec3& motion,
+			                float& time,
+			                glm::vec3& normal)
+			{
+				float t = 0.0f;
+				glm::vec3 x(0.0f);
+				glm::vec3 separatingNormal(0.0f);
+
+				std::array<glm::vec3, 4> supports;
+				//points of the Minkowski difference spanning the simplex
+
+				std::array<glm::vec3, 4> simplex;
+				//the same points, as seen from x
+
+				int count = 0;
+
+				glm::vec3 v = x - (second.getCentroid() - first.getCentroid());
+
+				for (int iteration = 0; iteration < s_maxIterations; iteration++)
+				{
+					if (glm::dot(v, v) < s_tolerance * s_tolerance)
+					{
+						break;
+					}
+
+					glm::vec3 support = getSupport(first, second, v);
+					glm::vec3 w = x - support;
+					float vw = glm::dot(v, w);
+
+					if (vw > 0.0f)
+					{
+						//The plane through the support point, facing along v,
+						//separates x from the Minkowski difference: advance x
+						//to it
+						float vr = glm::dot(v, motion);
+
+						if (vr >= 0.0f)
+						{
+							return false;
+						}
+
+						t -= vw / vr;
+
+						if (t > 1.0f)
+						{
+							return false;
+						}
+
+						x = t * motion;
+						separatingNormal = v;
+					}
+
+					if (count == 4)
+					{
+						break;
+					}
+
+					supports[count++] = support;
+
+					for (int i = 0; i < count; i++)
+					{
+						simplex[i] = x - supports[i];
+					}
+
+					unsigned int subset;
+					v = closestToOrigin(simplex, count, subset);
+
+					//Drop the points the closest point does not need
+					int size = 0;
+
+					for (int i = 0; i < count; i++)
+					{
+						if (subset & (1u << i))
+						{
+							supports[size++] = supports[i];
+						}
+					}
+
+					count = size;
+				}
+
+				time = t;
+
+				if (t > 0.0f && glm::dot(separatingNormal, separatingNormal) > s_epsilon)
+				{
+					//v points away from the Minkowski difference, which lies on
+					//the second shape's side
+					normal = -glm::normalize(separatingNormal);
+				}
+
+				return true;
+			}
+
+			/**
+			 * @brief Find the earliest time of impact between any triangle of
+			 * a mesh and another collider
+			 *
+			 * Works like compoundTimeOfImpact(), the mesh's tree finding the
+			 * triangles in the other collider's swept AABB.
+			 */
+			bool meshTimeOfImpact(const TriangleMeshCollider& mesh,
+			                      const Collider& other,
+			                      const glm::vec3& motion,
+			                      bool meshMoves,
+			                      float& time,
+			                      glm::vec3& normal)
+			{
+				if (other.getType() == Collider::e_triangleMesh)
+				{
+					return false;
+				}
+
+				glm::vec3 relativeMotion = meshMoves ? -motion : motion;
+				const BoundingVolume::AABB& bounds = other.getAABB();
+				BoundingVolume::AABB region = bounds.enclosingBV({bounds.getLowerBound() + relativeMotion,
+				                                                  bounds.getUpperBound() + relativeMotion});
+				bool hit = false;
+
+				mesh.queryTriangles(region, [&](std::uint32_t index) {
+					Triangle triangle = mesh.getTriangle(index);
+
+					float triangleTime;
+					glm::vec3 triangleNormal;
+					bool triangleHit = meshMoves
+						? castShapes(triangle, other, motion, triangleTime, triangleNormal)
+						: castShapes(other, triangle, motion, triangleTime, triangleNormal);
+
+					if (triangleHit && (!hit || triangleTime < time))
+					{
+						hit = true;
+						time = triangleTime;
+
+						if (triangleTime > 0.0f)
+						{
+							normal = triangleNormal;
+						}
+					}
+
+					return !(hit && time == 0.0f);
+				});
+
+				return hit;
+			}
+
+			bool sphereTimeOfImpact(const SphereCollider& first,
+			                        const SphereCollider& second,
+			                        const glm::vec3& motion,
+			                        float& time,
+			                        glm::vec3& normal)
+			{
+				//Solve |offset - t * motion| = radii for the smallest t
+				glm::vec3 offset = second.getCentroid() - first.getCentroid();
+				float radii = first.getRadius() + second.getRadius();
+				float c = glm::dot(offset, offset) - radii * radii;
+
+				if (c <= 0.0f)
+				{
+					time = 0.0f;
+
+					return true;
+				}
+
+				float a = glm::dot(motion, motion);
+				float b = glm::dot(offset, motion);
+				float discriminant = b * b - a * c;
+
+				if (b <= 0.0f || discriminant < 0.0f)
+				{
+					return false;
+				}
+
+				float t = (b - glm::sqrt(discriminant)) / a;
+
+				if (t > 1.0f)
+				{
+					return false;
+				}
+
+				time = t;
+				normal = glm::normalize(offset - t * motion);
+
+				return true;
+			}
+
+			/**
+			 * @brief Find the earliest time of impact between any child of a
+			 * compound and another collider
+			 *
+			 * Only the children whose AABB overlaps the other collider's,
+			 * swept back along the motion, can be hit.
+			 *
+			 * @param compoundMoves Whether the compound is the moving shape
+			 * (first) or the one standing still (second)
+			 */
+			bool compoundTimeOfImpact(const CompoundCollider& compound,
+			                          const Collider& other,
+			                          const glm::vec3& motion,
+			                          bool compoundMoves,
+			                          float& time,
+			                          glm::vec3& normal)
+			{
+				glm::vec3 relativeMotion = compoundMoves ? -motion : motion;
+				const BoundingVolume::AABB& bounds = other.getAABB();
+				BoundingVolume::AABB region = bounds.enclosingBV({bounds.getLowerBound() + relativeMotion,
+				                                                  bounds.getUpperBound() + relativeMotion});
+				bool hit = false;
+
+				compound.queryChildren(region, [&](std::uint32_t index) {
+					CompoundCollider::Child child = compound.getWorldChild(index);
+					const Collider& childCollider = std::visit([](const auto& collider) -> const Collider& {
+						return collider;
+					}, child);
+
+					float childTime;
+					glm::vec3 childNormal;
+					bool childHit = compoundMoves
+						? timeOfImpact(childCollider, other, motion, childTime, childNormal)
+						: timeOfImpact(other, childCollider, motion, childTime, childNormal);
+
+					if (childHit && (!hit || childTime < time))
+					{
+						hit = true;
+						time = childTime;
+
+						if (childTime > 0.0f)
+						{
+							normal = childNormal;
+						}
+					}
+
+					//Nothing comes before shapes that already touch
+					return !(hit && time == 0.0f);
+				});
+
+				return hit;
+			}
+		}
+
+		bool timeOfImpact(const Collider& first,
+		                  const Collider& second,
+		                  const glm::vec3& motion,
+		                  float& time,
+		                  glm::vec3& normal)
+		{
+			PHYSICC_ZONE_FINE;
+
+			if (first.getType() == Collider::e_compound)
+			{
+				return compoundTimeOfImpact(static_cast<const CompoundCollider&>(first),
+				                            second,
+				                            motion,
+				                            true,
+				                            time,
+				                            normal);
+			}
+
+			if (second.getType() == Collider::e_compound)
+			{
+				return compoundTimeOfImpact(static_cast<const CompoundCollider&>(second),
+				                            first,
+				                            motion,
+				                            false,
+				                            time,
+				                            normal);
+			}
+
+			if (first.getType() == Collider::e_triangleMesh)
+			{
+				return meshTimeOfImpact(static_cast<const TriangleMeshCollider&>(first),
+				                        second,
+				                        motion,
+				                        true,
+				                        time,
+				                        normal);
+			}
+
+			if (second.getType() == Collider::e_triangleMesh)
+			{
+				return meshTimeOfImpact(static_cast<const TriangleMeshCollider&>(second),
+				                        first,
+				                        motion,
+				                        false,
+				                        time,
+				                        normal);
+			}
+
+			if (first.getType() == Collider::e_sphere && second.getType() == Collider::e_sphere)
+			{
+				return sphereTimeOfImpact(static_cast<const SphereCollider&>(first),
+				                          static_cast<const SphereCollider&>(second),
+				                          motion,
+				                          time,
+				                          normal);
+			}
+
+			return castShapes(first, second, motion, time, normal);
+		}
+	}
+}
@@ -0,0 +1,841 @@
+#include "profiling.hpp"
+/**
+ * @file trianglemesh.cpp
+ * @brief Triangle mesh collider for static geometry, and its quantized BVH.
+ *
+ * The tree is built top-down with the binned Surface Area Heuristic, like
+ * BasicBVH's SAH builder, down to leaves of a few triangles. Node bounds are
+ * computed in floating point and only rounded onto the 16 bit grid when a
+ * node is stored.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* trianglemesh header */
+
+#include "trianglemesh.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace Physicc
+{
+	namespace
+	{
+		constexpr float s_quantizationSteps = 65535.0f;
+
+		constexpr float s_parallelTolerance = 1e-4f;
+		//cross products of a box axis and a triangle edge shorter than this
+		//(relative to the edge) are skipped, the face normals cover them
+
+		constexpr float s_relativeTolerance = 0.95f;
+		constexpr float s_absoluteTolerance = 0.01f;
+		//another axis has to separate a box from a triangle noticeably
+		//better than the triangle's normal to be picked over it, as for
+		//two boxes
+
+		constexpr float s_epsilon = 1e-12f;
+
+		constexpr std::uint32_t s_magic = 0x48534d50;
+		//"PMSH" in little endian
+
+		constexpr std::uint32_t s_version = 1;
+
+		/**
+		 * @brief What TriangleMeshCollider::save() writes before the arrays
+		 */
+		struct Header
+		{
+			std::uint32_t magic;
+			std::uint32_t version;
+			std::uint32_t vertexCount;
+			std::uint32_t indexCount;
+			std::uint32_t nodeCount;
+			float lowerBound[3];
+			float upperBound[3];
+			float quantizationScale[3];
+		};
+
+		static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "glm::vec3 is expected to be tightly packed");
+	}
+
+	glm::vec3 Triangle::getClosestPoint(const glm::vec3& point) const
+	{
+		//Find the Voronoi region of the triangle the point lies in, see
+		//C. Ericson, "Real-Time Collision Detection", 5.1.5
+		const glm::vec3& a = vertices[0];
+		const glm::vec3& b = vertices[1];
+		const glm::vec3& c = vertices[2];
+
+		glm::vec3 ab = b - a;
+		glm::vec3 ac = c - a;
+		glm::vec3 ap = point - a;
+
+		float d1 = glm::dot(ab, ap);
+		float d2 = glm::dot(ac, ap);
+
+		if (d1 <= 0.0f && d2 <= 0.0f)
+		{
+			return a;
+		}
+
+		glm::vec3 bp = point - b;
+		float d3 = glm::dot(ab, bp);
+		float d4 = glm::dot(ac, bp);
+
+		if (d3 >= 0.0f && d4 <= d3)
+		{
+			return b;
+		}
+
+		float vc = d1 * d4 - d3 * d2;
+
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		{
+			return a + ab * (d1 / (d1 - d3));
+		}
+
+		glm::vec3 cp = point - c;
+		float d5 = glm::dot(ab, cp);
+		float d6 = glm::dot(ac, cp);
+
+		if (d6 >= 0.0f && d5 <= d6)
+		{
+			return c;
+		}
+
+		float vb = d5 * d2 - d1 * d6;
+
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		{
+			return a + ac * (d2 / (d2 - d6));
+		}
+
+		float va = d3 * d6 - d5 * d4;
+
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		{
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+		}
+
+		float denominator = 1.0f / (va + vb + vc);
+
+		return a + ab * (vb * denominator) + ac * (vc * denominator);
+	}
+
+	bool Triangle::intersects(const Ray& ray, float tMax, float& t) const
+	{
+		//Möller-Trumbore: solve origin + t * direction = a + u * ab + v * ac
+		glm::vec3 ab = vertices[1] - vertices[0];
+		glm::vec3 ac = vertices[2] - vertices[0];
+		glm::vec3 p = glm::cross(ray.direction, ac);
+		float determinant = glm::dot(ab, p);
+
+		if (glm::abs(determinant) < s_epsilon)
+		{
+			return false;
+		}
+
+		float inverseDeterminant = 1.0f / determinant;
+		glm::vec3 s = ray.origin - vertices[0];
+		float u = glm::dot(s, p) * inverseDeterminant;
+
+		if (u < 0.0f || u > 1.0f)
+		{
+			return false;
+		}
+
+		glm::vec3 q = glm::cross(s, ab);
+		float v = glm::dot(ray.direction, q) * inverseDeterminant;
+
+		if (v < 0.0f || u + v > 1.0f)
+		{
+			return false;
+		}
+
+		float hit = glm::dot(ac, q) * inverseDeterminant;
+
+		if (hit < 0.0f || hit > tMax)
+		{
+			return false;
+		}
+
+		t = hit;
+
+		return true;
+	}
+
+	bool Triangle::findBoxPenetration(const glm::vec3& center,
+	                                  const glm::mat3& axes,
+	                                  const glm::vec3& halfExtents,
+	                                  glm::vec3& normal,
+	                                  float& depth) const
+	{
+		glm::vec3 centroid = getCentroid();
+		bool found = false;
+
+		//Returns false if the axis separates the shapes, and keeps track of
+		//the one they overlap the least along otherwise
+		auto testAxis = [&](const glm::vec3& axis) {
+			float tMin = glm::dot(axis, vertices[0]);
+			float tMax = tMin;
+
+			for (int i = 1; i < 3; i++)
+			{
+				float distance = glm::dot(axis, vertices[i]);
+				tMin = glm::min(tMin, distance);
+				tMax = glm::max(tMax, distance);
+			}
+
+			float radius = halfExtents.x * glm::abs(glm::dot(axis, axes[0]))
+				+ halfExtents.y * glm::abs(glm::dot(axis, axes[1]))
+				+ halfExtents.z * glm::abs(glm::dot(axis, axes[2]));
+			float boxCenter = glm::dot(axis, center);
+
+			if (tMax < boxCenter - radius || boxCenter + radius < tMin)
+			{
+				return false;
+			}
+
+			//The box is pushed out on the side its center is on
+			bool boxAbove = boxCenter >= glm::dot(axis, centroid);
+			float overlap = boxAbove ? tMax - (boxCenter - radius) : boxCenter + radius - tMin;
+
+			if (!found || overlap < s_relativeTolerance * depth - s_absoluteTolerance)
+			{
+				found = true;
+				depth = overlap;
+				normal = boxAbove ? axis : -axis;
+			}
+
+			return true;
+		};
+
+		glm::vec3 faceNormal = getNormal();
+		float faceNormalLength = glm::length(faceNormal);
+
+		if (faceNormalLength > s_epsilon && !testAxis(faceNormal / faceNormalLength))
+		{
+			return false;
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			if (!testAxis(axes[i]))
+			{
+				return false;
+			}
+		}
+
+		for (int j = 0; j < 3; j++)
+		{
+			glm::vec3 edge = vertices[(j + 1) % 3] - vertices[j];
+			float edgeLength = glm::length(edge);
+
+			for (int i = 0; i < 3; i++)
+			{
+				glm::vec3 axis = glm::cross(axes[i], edge);
+				float length = glm::length(axis);
+
+				if (length <= s_parallelTolerance * edgeLength)
+				{
+					continue;
+				}
+
+				if (!testAxis(axis / length))
+				{
+					return false;
+				}
+			}
+		}
+
+		return found;
+	}
+
+	/**
+	 * @brief Creates a TriangleMeshCollider object
+	 *
+	 * @param vertices Vertex positions in local space
+	 * @param indices Three indices into vertices per triangle
+	 * @param position Position of object in global space
+	 * @param rotation Rotation about each of the axis in local space
+	 *
+	 */
+	TriangleMeshCollider::TriangleMeshCollider(const std::vector<glm::vec3>& vertices,
+	                                           const std::vector<unsigned int>& indices,
+	                                           glm::vec3 position,
+	                                           glm::vec3 rotation)
+		: TriangleMeshCollider(buildMesh(vertices, indices), position, rotation)
+	{
+	}
+
+	TriangleMeshCollider::TriangleMeshCollider(std::shared_ptr<const Mesh> mesh,
+	                                           glm::vec3 position,
+	                                           glm::vec3 rotation)
+		: Collider(position, rotation), m_mesh(std::move(mesh))
+	{
+		PHYSICC_ZONE_FINE;
+
+		m_objectType = e_triangleMesh;
+		updateTransform();
+	}
+
+	std::shared_ptr<const TriangleMeshCollider::Mesh> TriangleMeshCollider::buildMesh(const std::vector<glm::vec3>& vertices,
+	                                                                                  const std::vector<unsigned int>& indices)
+	{
+		PHYSICC_ZONE_COARSE;
+
+		auto mesh = std::make_shared<Mesh>();
+		mesh->vertices = vertices;
+		mesh->bounds = {glm::vec3(0.0f), glm::vec3(0.0f)};
+		mesh->quantizationScale = glm::vec3(0.0f);
+
+		std::size_t triangleCount = indices.size() / 3;
+
+		if (vertices.empty() || triangleCount == 0)
+		{
+			return mesh;
+		}
+
+		glm::vec3 lowerBound = vertices[0];
+		glm::vec3 upperBound = vertices[0];
+
+		for (const glm::vec3& vertex : vertices)
+		{
+			lowerBound = glm::min(lowerBound, vertex);
+			upperBound = glm::max(upperBound, vertex);
+		}
+
+		mesh->bounds = {lowerBound, upperBound};
+
+		//A mesh flat along an axis gets a scale of 0 along it, which puts
+		//every bound on the grid's first step
+		glm::vec3 extent = upperBound - lowerBound;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			mesh->quantizationScale[axis] = extent[axis] > 0.0f ? s_quantizationSteps / extent[axis] : 0.0f;
+		}
+
+		std::vector<BoundingVolume::AABB> triangleBounds;
+		triangleBounds.reserve(triangleCount);
+
+		for (std::size_t i = 0; i < triangleCount; i++)
+		{
+			const glm::vec3& a = vertices[indices[3 * i]];
+			const glm::vec3& b = vertices[indices[3 * i + 1]];
+			const glm::vec3& c = vertices[indices[3 * i + 2]];
+
+			triangleBounds.emplace_back(glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c)));
+		}
+
+		std::vector<std::uint32_t> order(triangleCount);
+		std::iota(order.begin(), order.end(), 0);
+
+		mesh->nodes.reserve(2 * triangleCount / s_maxLeafSize + 1);
+		buildNode(*mesh, triangleBounds, order, 0, triangleCount);
+
+		//Store the triangles in the order the leaves refer to them in
+		mesh->indices.reserve(3 * triangleCount);
+
+		for (std::uint32_t triangle : order)
+		{
+			mesh->indices.insert(mesh->indices.end(),
+			                     indices.begin() + 3 * triangle,
+			                     indices.begin() + 3 * triangle + 3);
+		}
+
+		return mesh;
+	}
+
+	void TriangleMeshCollider::buildNode(Mesh& mesh,
+	                                     const std::vector<BoundingVolume::AABB>& triangleBounds,
+	                                     std::vector<std::uint32_t>& order,
+	                                     std::size_t start,
+	                                     std::size_t end)
+	{
+		std::size_t index = mesh.nodes.size();
+		mesh.nodes.emplace_back();
+
+		BoundingVolume::AABB bounds = triangleBounds[order[start]];
+		glm::vec3 minCentroid = bounds.getCenter();
+		glm::vec3 maxCentroid = minCentroid;
+
+		for (std::size_t i = start + 1; i < end; i++)
+		{
+			const BoundingVolume::AABB& triangle = triangleBounds[order[i]];
+
+			bounds = bounds.enclosingBV(triangle);
+			minCentroid = glm::min(minCentroid, triangle.getCenter());
+			maxCentroid = glm::max(maxCentroid, triangle.getCenter());
+		}
+
+		mesh.nodes[index].bounds = quantize(mesh, bounds);
+
+		std::size_t count = end - start;
+
+		if (count <= s_maxLeafSize)
+		{
+			mesh.nodes[index].data = Node::s_leafFlag
+				| (static_cast<std::uint32_t>(count - 1) << Node::s_countShift)
+				| static_cast<std::uint32_t>(start);
+
+			return;
+		}
+
+		glm::vec3 spread = maxCentroid - minCentroid;
+		int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+		std::size_t middle = start;
+
+		if (spread[axis] > 0.0f)
+		{
+			//Sort the centroids into bins along the axis, and split between
+			//the two bins that minimize the SAH cost
+			struct Bin
+			{
+				BoundingVolume::AABB bounds;
+				std::size_t count = 0;
+			};
+
+			std::array<Bin, s_binCount> bins;
+			float binScale = static_cast<float>(s_binCount) / spread[axis];
+
+			auto getBin = [&](std::uint32_t triangle) {
+				float offset = (triangleBounds[triangle].getCenter()[axis] - minCentroid[axis]) * binScale;
+
+				return std::min(static_cast<std::size_t>(offset), s_binCount - 1);
+			};
+
+			for (std::size_t i = start; i < end; i++)
+			{
+				Bin& bin = bins[getBin(order[i])];
+				const BoundingVolume::AABB& triangle = triangleBounds[order[i]];
+
+				bin.bounds = bin.count == 0 ? triangle : bin.bounds.enclosingBV(triangle);
+				bin.count++;
+			}
+
+			std::array<float, s_binCount - 1> leftCosts;
+			BoundingVolume::AABB leftBounds;
+			std::size_t leftCount = 0;
+
+			for (std::size_t i = 0; i < s_binCount - 1; i++)
+			{
+				if (bins[i].count != 0)
+				{
+					leftBounds = leftCount == 0 ? bins[i].bounds : leftBounds.enclosingBV(bins[i].bounds);
+					leftCount += bins[i].count;
+				}
+
+				leftCosts[i] = leftCount == 0 ? 0.0f : leftBounds.getSurfaceArea() * static_cast<float>(leftCount);
+			}
+
+			BoundingVolume::AABB rightBounds;
+			std::size_t rightCount = 0;
+			float bestCost = std::numeric_limits<float>::infinity();
+			std::size_t bestSplit = 0;
+
+			for (std::size_t i = s_binCount - 1; i > 0; i--)
+			{
+				if (bins[i].count != 0)
+				{
+					rightBounds = rightCount == 0 ? bins[i].bounds : rightBounds.enclosingBV(bins[i].bounds);
+					rightCount += bins[i].count;
+				}
+
+				if (rightCount == 0 || rightCount == count)
+				{
+					continue;
+				}
+
+				float cost = leftCosts[i - 1] + rightBounds.getSurfaceArea() * static_cast<float>(rightCount);
+
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestSplit = i;
+				}
+			}
+
+			auto split = std::partition(order.begin() + start, order.begin() + end, [&](std::uint32_t triangle) {
+				return getBin(triangle) < bestSplit;
+			});
+
+			middle = static_cast<std::size_t>(split - order.begin());
+		}
+
+		if (middle == start || middle == end)
+		{
+			//All the centroids are in the same place (or bin), so any split
+			//is as good as any other
+			middle = start + count / 2;
+		}
+
+		buildNode(mesh, triangleBounds, order, start, middle);
+		mesh.nodes[index].data = static_cast<std::uint32_t>(mesh.nodes.size());
+		buildNode(mesh, triangleBounds, order, middle, end);
+	}
+
+	TriangleMeshCollider::QuantizedBounds TriangleMeshCollider::quantize(const Mesh& mesh,
+	                                                                     const BoundingVolume::AABB& bounds)
+	{
+		glm::vec3 lowerBound = glm::floor((bounds.getLowerBound() - mesh.bounds.getLowerBound()) * mesh.quantizationScale);
+		glm::vec3 upperBound = glm::ceil((bounds.getUpperBound() - mesh.bounds.getLowerBound()) * mesh.quantizationScale);
+
+		lowerBound = glm::clamp(lowerBound, 0.0f, s_quantizationSteps);
+		upperBound = glm::clamp(upperBound, 0.0f, s_quantizationSteps);
+
+		QuantizedBounds quantized;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			quantized.lowerBound[axis] = static_cast<std::uint16_t>(lowerBound[axis]);
+			quantized.upperBound[axis] = static_cast<std::uint16_t>(upperBound[axis]);
+		}
+
+		return quantized;
+	}
+
+	BoundingVolume::AABB TriangleMeshCollider::dequantize(const Mesh& mesh, const QuantizedBounds& bounds)
+	{
+		glm::vec3 step = (mesh.bounds.getUpperBound() - mesh.bounds.getLowerBound()) / s_quantizationSteps;
+		glm::vec3 lowerBound(bounds.lowerBound[0], bounds.lowerBound[1], bounds.lowerBound[2]);
+		glm::vec3 upperBound(bounds.upperBound[0], bounds.upperBound[1], bounds.upperBound[2]);
+
+		return {mesh.bounds.getLowerBound() + lowerBound * step,
+		        mesh.bounds.getLowerBound() + upperBound * step};
+	}
+
+	void TriangleMeshCollider::save(std::vector<std::uint8_t>& data) const
+	{
+		PHYSICC_ZONE_FINE;
+
+		const Mesh& mesh = *m_mesh;
+
+		Header header;
+		header.magic = s_magic;
+		header.version = s_version;
+		header.vertexCount = static_cast<std::uint32_t>(mesh.vertices.size());
+		header.indexCount = static_cast<std::uint32_t>(mesh.indices.size());
+		header.nodeCount = static_cast<std::uint32_t>(mesh.nodes.size());
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			header.lowerBound[axis] = mesh.bounds.getLowerBound()[axis];
+			header.upperBound[axis] = mesh.bounds.getUpperBound()[axis];
+			header.quantizationScale[axis] = mesh.quantizationScale[axis];
+		}
+
+		std::size_t vertexBytes = mesh.vertices.size() * sizeof(glm::vec3);
+		std::size_t indexBytes = mesh.indices.size() * sizeof(std::uint32_t);
+		std::size_t nodeBytes = mesh.nodes.size() * sizeof(Node);
+
+		data.resize(sizeof(Header) + vertexBytes + indexBytes + nodeBytes);
+
+		std::uint8_t* out = data.data();
+		std::memcpy(out, &header, sizeof(Header));
+		out += sizeof(Header);
+		std::memcpy(out, mesh.vertices.data(), vertexBytes);
+		out += vertexBytes;
+		std::memcpy(out, mesh.indices.data(), indexBytes);
+		out += indexBytes;
+		std::memcpy(out, mesh.nodes.data(), nodeBytes);
+	}
+
+	std::optional<TriangleMeshCollider> TriangleMeshCollider::load(const std::uint8_t* data,
+	                                                               std::size_t size,
+	                                                               glm::vec3 position,
+	                                                               glm::vec3 rotation)
+	{
+		PHYSICC_ZONE_FINE;
+
+		Header header;
+
+		if (size < sizeof(Header))
+		{
+			return std::nullopt;
+		}
+
+		std::memcpy(&header, data, sizeof(Header));
+
+		std::size_t vertexBytes = static_cast<std::size_t>(header.vertexCount) * sizeof(glm::vec3);
+		std::size_t indexBytes = static_cast<std::size_t>(header.indexCount) * sizeof(std::uint32_t);
+		std::size_t nodeBytes = static_cast<std::size_t>(header.nodeCount) * sizeof(Node);
+
+		if (header.magic != s_magic
+		    || header.version != s_version
+		    || header.indexCount % 3 != 0
+		    || size != sizeof(Header) + vertexBytes + indexBytes + nodeBytes)
+		{
+			return std::nullopt;
+		}
+
+		auto mesh = std::make_shared<Mesh>();
+		mesh->bounds = {glm::vec3(header.lowerBound[0], header.lowerBound[1], header.lowerBound[2]),
+		                glm::vec3(header.upperBound[0], header.upperBound[1], header.upperBound[2])};
+		mesh->quantizationScale = glm::vec3(header.quantizationScale[0],
+		                                    header.quantizationScale[1],
+		                                    header.quantizationScale[2]);
+
+		mesh->vertices.resize(header.vertexCount);
+		mesh->indices.resize(header.indexCount);
+		mesh->nodes.resize(header.nodeCount);
+
+		data += sizeof(Header);
+		std::memcpy(mesh->vertices.data(), data, vertexBytes);
+		data += vertexBytes;
+		std::memcpy(mesh->indices.data(), data, indexBytes);
+		data += indexBytes;
+		std::memcpy(mesh->nodes.data(), data, nodeBytes);
+
+		//Make sure nothing points outside of the arrays, so that a damaged
+		//file cannot make a query read out of bounds
+		bool valid = std::all_of(mesh->indices.begin(), mesh->indices.end(), [&header](std::uint32_t index) {
+			return index < header.vertexCount;
+		});
+
+		std::size_t triangleCount = header.indexCount / 3;
+
+		for (std::size_t i = 0; valid && i < mesh->nodes.size(); i++)
+		{
+			const Node& node = mesh->nodes[i];
+
+			valid = node.isLeaf()
+				? static_cast<std::size_t>(node.getFirstTriangle()) + node.getTriangleCount() <= triangleCount
+				: node.getSecondChild() > i + 1 && node.getSecondChild() < mesh->nodes.size();
+		}
+
+		if (!valid)
+		{
+			return std::nullopt;
+		}
+
+		return TriangleMeshCollider(std::move(mesh), position, rotation);
+	}
+
+	void TriangleMeshCollider::querySphere(const glm::vec3& center,
+	                                       float radius,
+	                                       std::vector<std::uint32_t>& triangles) const
+	{
+		PHYSICC_ZONE_FINE;
+
+		triangles.clear();
+
+		BoundingVolume::AABB region(center - glm::vec3(radius), center + glm::vec3(radius));
+
+		queryTriangles(region, [&](std::uint32_t index) {
+			glm::vec3 offset = getTriangle(index).getClosestPoint(center) - center;
+
+			if (glm::dot(offset, offset) <= radius * radius)
+			{
+				triangles.push_back(index);
+			}
+
+			return true;
+		});
+	}
+
+	void TriangleMeshCollider::queryBox(const glm::vec3& center,
+	                                    const glm::mat3& axes,
+	                                    const glm::vec3& halfExtents,
+	                                    std::vector<std::uint32_t>& triangles) const
+	{
+		PHYSICC_ZONE_FINE;
+
+		triangles.clear();
+
+		glm::mat3 absAxes(glm::abs(axes[0]), glm::abs(axes[1]), glm::abs(axes[2]));
+		glm::vec3 extents = absAxes * halfExtents;
+		BoundingVolume::AABB region(center - extents, center + extents);
+
+		queryTriangles(region, [&](std::uint32_t index) {
+			glm::vec3 normal;
+			float depth;
+
+			if (getTriangle(index).findBoxPenetration(center, axes, halfExtents, normal, depth))
+			{
+				triangles.push_back(index);
+			}
+
+			return true;
+		});
+	}
+
+	std::optional<TriangleHit> TriangleMeshCollider::raycast(const Ray& ray, float tMax) const
+	{
+		PHYSICC_ZONE_FINE;
+
+		const Mesh& mesh = *m_mesh;
+
+		if (mesh.nodes.empty())
+		{
+			return std::nullopt;
+		}
+
+		//Cast the ray in the mesh's local space, which leaves t unchanged
+		glm::mat3 inverseRotation = glm::transpose(m_rotation);
+		Ray localRay(inverseRotation * (ray.origin - m_position), inverseRotation * ray.direction);
+
+		std::optional<TriangleHit> hit;
+		float tEntry;
+
+		if (!localRay.intersects(dequantize(mesh, mesh.nodes[0].bounds), tMax, tEntry))
+		{
+			return std::nullopt;
+		}
+
+		struct Entry
+		{
+			std::uint32_t node;
+			float tEntry;
+		};
+
+		TraversalStack<Entry> stack;
+		stack.push({0, tEntry});
+
+		while (!stack.empty())
+		{
+			Entry entry = stack.pop();
+
+			if (entry.tEntry > tMax)
+			{
+				continue;
+			}
+
+			const Node& node = mesh.nodes[entry.node];
+
+			if (node.isLeaf())
+			{
+				for (std::uint32_t i = node.getFirstTriangle(); i != node.getFirstTriangle() + node.getTriangleCount(); i++)
+				{
+					const std::uint32_t* indices = &mesh.indices[3 * i];
+					Triangle triangle{{mesh.vertices[indices[0]], mesh.vertices[indices[1]], mesh.vertices[indices[2]]}};
+					float t;
+
+					if (triangle.intersects(localRay, tMax, t))
+					{
+						tMax = t;
+						hit = TriangleHit{i, t, glm::normalize(m_rotation * triangle.getNormal())};
+					}
+				}
+
+				continue;
+			}
+
+			//Visit the nearer child first, so that a hit in it can cull the
+			//other one
+			std::uint32_t children[2] = {entry.node + 1, node.getSecondChild()};
+			float entries[2];
+			bool hits[2];
+
+			for (int i = 0; i < 2; i++)
+			{
+				hits[i] = localRay.intersects(dequantize(mesh, mesh.nodes[children[i]].bounds), tMax, entries[i]);
+			}
+
+			int nearer = hits[1] && (!hits[0] || entries[1] < entries[0]) ? 1 : 0;
+
+			if (hits[1 - nearer])
+			{
+				stack.push({children[1 - nearer], entries[1 - nearer]});
+			}
+
+			if (hits[nearer])
+			{
+				stack.push({children[nearer], entries[nearer]});
+			}
+		}
+
+		if (hit && glm::dot(hit->normal, ray.direction) > 0.0f)
+		{
+			hit->normal = -hit->normal;
+		}
+
+		return hit;
+	}
+
+	/**
+	 * @brief Returns the vertex of the mesh furthest along a direction
+	 *
+	 * This is the support function of the mesh's convex hull, and tries
+	 * every vertex. Only bounding volumes (like k-DOPs) need it: collisions
+	 * with a mesh are found triangle by triangle, see
+	 * Narrowphase::collideTriangleMesh().
+	 */
+	glm::vec3 TriangleMeshCollider::getSupport(const glm::vec3& direction) const
+	{
+		const std::vector<glm::vec3>& vertices = m_mesh->vertices;
+
+		if (vertices.empty())
+		{
+			return m_position;
+		}
+
+		glm::vec3 localDirection = glm::transpose(m_rotation) * direction;
+		std::size_t best = 0;
+		float bestDistance = glm::dot(vertices[0], localDirection);
+
+		for (std::size_t i = 1; i < vertices.size(); i++)
+		{
+			float distance = glm::dot(vertices[i], localDirection);
+
+			if (distance > bestDistance)
+			{
+				best = i;
+				bestDistance = distance;
+			}
+		}
+
+		return m_position + m_rotation * vertices[best];
+	}
+
+	/**
+	 * @brief Computes the half size of the Axis Aligned Bounding Box of a
+	 * mesh, from its bounds in local space, like
+	 * CompoundCollider::computeExtents()
+	 *
+	 * @return glm::vec3
+	 */
+	glm::vec3 TriangleMeshCollider::computeExtents() const
+	{
+		PHYSICC_ZONE_FINE;
+
+		const BoundingVolume::AABB& bounds = m_mesh->bounds;
+		glm::mat3 absRotation(glm::abs(m_rotation[0]),
+		                      glm::abs(m_rotation[1]),
+		                      glm::abs(m_rotation[2]));
+
+		return absRotation * (0.5f * (bounds.getUpperBound() - bounds.getLowerBound()));
+	}
+
+	/**
+	 * @brief Computes where the centre of the mesh's bounds ends up relative
+	 * to its position, since level geometry is rarely modelled around its
+	 * origin
+	 */
+	glm::vec3 TriangleMeshCollider::computeAABBOffset() const
+	{
+		return m_rotation * m_mesh->bounds.getCenter();
+	}
+
+	float TriangleMeshCollider::computeBoundingRadius() const
+	{
+		float radius = 0.0f;
+
+		for (const glm::vec3& vertex : m_mesh->vertices)
+		{
+			radius = glm::max(radius, glm::length(vertex));
+		}
+
+		return radius;
+	}
+
+	glm::vec3 TriangleMeshCollider::computeOrientedHalfExtents() const
+	{
+		const BoundingVolume::AABB& bounds = m_mesh->bounds;
+
+		return glm::max(glm::abs(bounds.getLowerBound()), glm::abs(bounds.getUpperBound()));
+	}
+}
@@ -0,0 +1,439 @@
+#include "profiling.hpp"
+/**
+ * @file widebvh.cpp
+ * @brief Collapses a binary BVH into a 4 or 8 wide one, and traverses it
+ * testing all children of a node at once.
+ *
+ * @bug No known bugs.
+ */
+
+/* -- Includes -- */
+/* widebvh header */
+
+#include "widebvh.hpp"
+
+#include "simd.hpp"
+#include "traversalstack.hpp"
+
+#include <algorithm>
+
+namespace Physicc
+{
+	namespace
+	{
+		/**
+		 * @brief Tests of a query against all children of a wide node
+		 *
+		 * Both return a bit mask with bit i set if child i passed the test.
+		 * The generic version is a plain loop (which compilers tend to
+		 * vectorize on their own anyway), and is specialized with
+		 * intrinsics below where the target supports them.
+		 */
+		template <std::size_t Width>
+		inline unsigned int rayChildLoop(const WideBVHNode<Width>& node,
+		                                 const Ray& ray,
+		                                 float tMax,
+		                                 float* tEntry)
+		{
+			unsigned int mask = 0;
+
+			for (std::size_t i = 0; i != Width; i++)
+			{
+				BoundingVolume::AABB box({node.minX[i], node.minY[i], node.minZ[i]},
+				                         {node.maxX[i], node.maxY[i], node.maxZ[i]});
+
+				mask |= static_cast<unsigned int>(ray.intersects(box, tMax, tEntry[i])) << i;
+			}
+
+			return mask;
+		}
+
+		template <std::size_t Width>
+		struct ChildTest
+		{
+			static inline unsigned int ray(const WideBVHNode<Width>& node,
+			                               const Ray& ray,
+			                               float tMax,
+			                               float* tEntry)
+			{
+				return rayChildLoop(node, ray, tMax, tEntry);
+			}
+
+			static inline unsigned int overlap(const WideBVHNode<Width>& node,
+			                                   const BoundingVolume::AABB& box)
+			{
+				const glm::vec3& lowerBound = box.getLowerBound();
+				const glm::vec3& upperBound = box.getUpperBound();
+				unsigned int mask = 0;
+
+				for (std::size_t i = 0; i != Width; i++)
+				{
+					bool overlaps = node.minX[i] <= upperBound.x && node.maxX[i] >= lowerBound.x
+						&& node.minY[i] <= upperBound.y && node.maxY[i] >= lowerBound.y
+						&& node.minZ[i] <= upperBound.z && node.maxZ[i] >= lowerBound.z;
+
+					mask |= static_cast<unsigned int>(overlaps) << i;
+				}
+
+				return mask;
+			}
+		};
+
+#ifdef PHYSICC_SSE2
+		template <>
+		struct ChildTest<4>
+		{
+			static inline unsigned int ray(const WideBVHNode<4>& node,
+			                               const Ray& ray,
+			                               float tMax,
+			                               float* tEntry)
+			{
+				//The slab test below gets NaNs for axis parallel rays
+				//starting on a child's plane, see Ray::intersects()
+				if (ray.isAxisParallel())
+				{
+					return rayChildLoop(node, ray, tMax, tEntry);
+				}
+
+				__m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), _mm_set1_ps(ray.origin.x)),
+				                        _mm_set1_ps(ray.inverseDirection.x));
+				__m128 t2x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), _mm_set1_ps(ray.origin.x)),
+				                        _mm_set1_ps(ray.inverseDirection.x));
+				__m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), _mm_set1_ps(ray.origin.y)),
+				                        _mm_set1_ps(ray.inverseDirection.y));
+				__m128 t2y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), _mm_set1_ps(ray.origin.y)),
+				                        _mm_set1_ps(ray.inverseDirection.y));
+				__m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), _mm_set1_ps(ray.origin.z)),
+				                        _mm_set1_ps(ray.inverseDirection.z));
+				__m128 t2z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), _mm_set1_ps(ray.origin.z)),
+				                        _mm_set1_ps(ray.inverseDirection.z));
+
+				__m128 entry = _mm_max_ps(_mm_max_ps(_mm_min_ps(t1x, t2x), _mm_min_ps(t1y, t2y)),
+				                          _mm_max_ps(_mm_min_ps(t1z, t2z), _mm_setzero_ps()));
+				__m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t1x, t2x), _mm_max_ps(t1y, t2y)),
+				                         _mm_min_ps(_mm_max_ps(t1z, t2z), _mm_set1_ps(tMax)));
+
+				_mm_storeu_ps(tEntry, entry);
+
+				return static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(entry, exit)));
+			}
+
+			static inline unsigned int overlap(const WideBVHNode<4>& node,
+			                                   const BoundingVolume::AABB& box)
+			{
+				const glm::vec3& lowerBound = box.getLowerBound();
+				const glm::vec3& upperBound = box.getUpperBound();
+
+				__m128 x = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minX), _mm_set1_ps(upperBound.x)),
+				                      _mm_cmpge_ps(_mm_load_ps(node.maxX), _mm_set1_ps(lowerBound.x)));
+				__m128 y = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minY), _mm_set1_ps(upperBound.y)),
+				                      _mm_cmpge_ps(_mm_load_ps(node.maxY), _mm_set1_ps(lowerBound.y)));
+				__m128 z = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minZ), _mm_set1_ps(upperBound.z)),
+				                      _mm_cmpge_ps(_mm_load_ps(node.maxZ), _mm_set1_ps(lowerBound.z)));
+
+				return static_cast<unsigned int>(_mm_movemask_ps(_mm_and_ps(_mm_and_ps(x, y), z)));
+			}
+		};
+#endif
+
+#ifdef PHYSICC_AVX
+		template <>
+		struct ChildTest<8>
+		{
+			static inline unsigned int ray(const WideBVHNode<8>& node,
+			                               const Ray& ray,
+			                               float tMax,
+			                               float* tEntry)
+			{
+				if (ray.isAxisParallel())
+				{
+					return rayChildLoop(node, ray, tMax, tEntry);
+				}
+
+				__m256 t1x = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.minX), _mm256_set1_ps(ray.origin.x)),
+				                           _mm256_set1_ps(ray.inverseDirection.x));
+				__m256 t2x = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.maxX), _mm256_set1_ps(ray.origin.x)),
+				                           _mm256_set1_ps(ray.inverseDirection.x));
+				__m256 t1y = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.minY), _mm256_set1_ps(ray.origin.y)),
+				                           _mm256_set1_ps(ray.inverseDirection.y));
+				__m256 t2y = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.maxY), _mm256_set1_ps(ray.origin.y)),
+				                           _mm256_set1_ps(ray.inverseDirection.y));
+				__m256 t1z = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.minZ), _mm256_set1_ps(ray.origin.z)),
+				                           _mm256_set1_ps(ray.inverseDirection.z));
+				__m256 t2z = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.maxZ), _mm256_set1_ps(ray.origin.z)),
+				                           _mm256_set1_ps(ray.inverseDirection.z));
+
+				__m256 entry = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(t1x, t2x), _mm256_min_ps(t1y, t2y)),
+				                             _mm256_max_ps(_mm256_min_ps(t1z, t2z), _mm256_setzero_ps()));
+				__m256 exit = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(t1x, t2x), _mm256_max_ps(t1y, t2y)),
+				                            _mm256_min_ps(_mm256_max_ps(t1z, t2z), _mm256_set1_ps(tMax)));
+
+				_mm256_storeu_ps(tEntry, entry);
+
+				return static_cast<unsigned int>(_mm256_movemask_ps(_mm256_cmp_ps(entry, exit, _CMP_LE_OQ)));
+			}
+
+			static inline unsigned int overlap(const WideBVHNode<8>& node,
+			                                   const BoundingVolume::AABB& box)
+			{
+				const glm::vec3& lowerBound = box.getLowerBound();
+				const glm::vec3& upperBound = box.getUpperBound();
+
+				__m256 x = _mm256_and_ps(_mm256_cmp_ps(_mm256_load_ps(node.minX), _mm256_set1_ps(upperBound.x), _CMP_LE_OQ),
+				                         _mm256_cmp_ps(_mm256_load_ps(node.maxX), _mm256_set1_ps(lowerBound.x), _CMP_GE_OQ));
+				__m256 y = _mm256_and_ps(_mm256_cmp_ps(_mm256_load_ps(node.minY), _mm256_set1_ps(upperBound.y), _CMP_LE_OQ),
+				                         _mm256_cmp_ps(_mm256_load_ps(node.maxY), _mm256_set1_ps(lowerBound.y), _CMP_GE_OQ));
+				__m256 z = _mm256_and_ps(_mm256_cmp_ps(_mm256_load_ps(node.minZ), _mm256_set1_ps(upperBound.z), _CMP_LE_OQ),
+				                         _mm256_cmp_ps(_mm256_load_ps(node.maxZ), _mm256_set1_ps(lowerBound.z), _CMP_GE_OQ));
+
+				return static_cast<unsigned int>(_mm256_movemask_ps(_mm256_and_ps(_mm256_and_ps(x, y), z)));
+			}
+		};
+#endif
+	}
+
+	template <std::size_t Width>
+	WideBVH<Width>::WideBVH(const BVH& bvh)
+		:	m_bodyIndices(bvh.getBodyIndices())
+	{
+		PHYSICC_ZONE_COARSE;
+
+		m_bodyVolumes.resize(m_bodyIndices.size());
+
+		for (std::size_t i = 0; i != m_bodyIndices.size(); i++)
+		{
+			m_bodyVolumes.set(i, bvh.getBodyVolume(m_bodyIndices[i]));
+		}
+
+		if (!bvh.getNodes().empty())
+		{
+			m_nodes.reserve(bvh.getNodes().size() / (Width - 1) + 1);
+			collapse(bvh.getNodes(), 0);
+		}
+	}
+
+	template <std::size_t Width>
+	std::uint32_t WideBVH<Width>::collapse(const std::vector<BVHNode>& nodes, std::uint32_t root)
+	{
+		//Start out with the binary node itself as the only child, and keep
+		//replacing the biggest interior child with its two children until
+		//the slots are full (or only leaves are left). The bigger a node,
+		//the more likely a query is to hit it, and so to have to go on to
+		//its children anyway.
+		std::uint32_t slots[Width] = {root};
+		std::size_t slotCount = 1;
+
+		while (slotCount < Width)
+		{
+			std::size_t biggest = Width;
+			float biggestArea = -1.0f;
+
+			for (std::size_t i = 0; i != slotCount; i++)
+			{
+				const BVHNode& node = nodes[slots[i]];
+
+				if (!node.isLeaf() && node.volume.getSurfaceArea() > biggestArea)
+				{
+					biggest = i;
+					biggestArea = node.volume.getSurfaceArea();
+				}
+			}
+
+			if (biggest == Width)
+			{
+				break;
+			}
+
+			std::uint32_t opened = slots[biggest];
+			slots[biggest] = opened + 1;
+			slots[slotCount++] = nodes[opened].offset;
+		}
+
+		auto index = static_cast<std::uint32_t>(m_nodes.size());
+		m_nodes.emplace_back();
+
+		WideBVHNode<Width> wideNode;
+		wideNode.childCount = static_cast<std::uint32_t>(slotCount);
+
+		for (std::size_t i = 0; i != Width; i++)
+		{
+			if (i >= slotCount)
+			{
+				//an inverted box never passes any test
+				wideNode.minX[i] = wideNode.minY[i] = wideNode.minZ[i] = std::numeric_limits<float>::infinity();
+				wideNode.maxX[i] = wideNode.maxY[i] = wideNode.maxZ[i] = -std::numeric_limits<float>::infinity();
+				wideNode.child[i] = 0;
+				wideNode.count[i] = 0;
+
+				continue;
+			}
+
+			const BVHNode& node = nodes[slots[i]];
+
+			wideNode.minX[i] = node.volume.getLowerBound().x;
+			wideNode.minY[i] = node.volume.getLowerBound().y;
+			wideNode.minZ[i] = node.volume.getLowerBound().z;
+			wideNode.maxX[i] = node.volume.getUpperBound().x;
+			wideNode.maxY[i] = node.volume.getUpperBound().y;
+			wideNode.maxZ[i] = node.volume.getUpperBound().z;
+
+			wideNode.child[i] = node.isLeaf() ? node.offset : collapse(nodes, slots[i]);
+			wideNode.count[i] = node.count;
+		}
+
+		m_nodes[index] = wideNode;
+		//assigned at the end, since m_nodes might have reallocated while
+		//collapsing the children
+
+		return index;
+	}
+
+	template <std::size_t Width>
+	template <typename Callback>
+	void WideBVH<Width>::raycast(const Ray& ray, float tMax, Callback&& callback) const
+	{
+		PHYSICC_ZONE_FINE;
+
+		if (m_nodes.empty())
+		{
+			return;
+		}
+
+		TraversalStack<std::uint32_t> stack;
+		stack.push(0);
+
+		while (!stack.empty())
+		{
+			const WideBVHNode<Width>& node = m_nodes[stack.pop()];
+
+			alignas(32) float tEntry[Width];
+			unsigned int mask = ChildTest<Width>::ray(node, ray, tMax, tEntry)
+				& ((1u << node.childCount) - 1);
+
+			//Interior children that were hit, nearest first
+			std::uint32_t hitChildren[Width];
+			std::size_t hitCount = 0;
+
+			for (std::size_t i = 0; i != Width; i++)
+			{
+				if ((mask & (1u << i)) == 0)
+				{
+					continue;
+				}
+
+				if (node.count[i] == 0)
+				{
+					std::size_t j = hitCount++;
+
+					for (; j != 0 && tEntry[hitChildren[j - 1]] > tEntry[i]; j--)
+					{
+						hitChildren[j] = hitChildren[j - 1];
+					}
+
+					hitChildren[j] = static_cast<std::uint32_t>(i);
+					continue;
+				}
+
+				for (std::uint32_t k = node.child[i]; k != node.child[i] + node.count[i]; k++)
+				{
+					float t;
+
+					if (ray.intersects(m_bodyVolumes[k], tMax, t))
+					{
+						tMax = std::min(tMax, callback(m_bodyIndices[k], t));
+
+						if (tMax < 0.0f)
+						{
+							return;
+						}
+					}
+				}
+			}
+
+			for (std::size_t j = hitCount; j-- != 0;)
+			{
+				stack.push(node.child[hitChildren[j]]);
+			}
+		}
+	}
+
+	template <std::size_t Width>
+	std::optional<RaycastHit> WideBVH<Width>::raycast(const Ray& ray, float tMax) const
+	{
+		PHYSICC_ZONE_COARSE;
+
+		std::optional<RaycastHit> hit;
+
+		raycast(ray, tMax, [&hit](std::uint32_t body, float t) {
+			hit = RaycastHit{body, t};
+			return t;
+		});
+
+		return hit;
+	}
+
+	template <std::size_t Width>
+	bool WideBVH<Width>::raycastAny(const Ray& ray, float tMax) const
+	{
+		PHYSICC_ZONE_COARSE;
+
+		bool hit = false;
+
+		raycast(ray, tMax, [&hit](std::uint32_t, float) {
+			hit = true;
+			return -1.0f;
+		});
+
+		return hit;
+	}
+
+	template <std::size_t Width>
+	void WideBVH<Width>::queryRegion(const BoundingVolume::AABB& region,
+	                                 std::vector<std::uint32_t>& bodies) const
+	{
+		PHYSICC_ZONE_COARSE;
+
+		bodies.clear();
+
+		if (m_nodes.empty())
+		{
+			return;
+		}
+
+		TraversalStack<std::uint32_t> stack;
+		stack.push(0);
+
+		while (!stack.empty())
+		{
+			const WideBVHNode<Width>& node = m_nodes[stack.pop()];
+
+			unsigned int mask = ChildTest<Width>::overlap(node, region)
+				& ((1u << node.childCount) - 1);
+
+			for (std::size_t i = 0; i != Width; i++)
+			{
+				if ((mask & (1u << i)) == 0)
+				{
+					continue;
+				}
+
+				if (node.count[i] == 0)
+				{
+					stack.push(node.child[i]);
+					continue;
+				}
+
+				m_bodyVolumes.queryOverlaps(region, bodies, node.child[i], node.child[i] + node.count[i]);
+			}
+		}
+
+		//Turn positions in the leaf ordered list into body indices
+		for (auto& body : bodies)
+		{
+			body = m_bodyIndices[body];
+		}
+	}
+
+	template class WideBVH<4>;
+	template class WideBVH<8>;
+}
@@ -0,0 +1,148 @@
+#include "gtest/gtest.h"
+
+#include "aabbarray.hpp"
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <random>
+
+using namespace Physicc;
+
+namespace
+{
+	//Boxes on a coarse grid, so that plenty of them only just touch, which
+	//the SIMD compares have to count as overlapping like the scalar ones do
+	std::vector<BoundingVolume::AABB> randomBoxes(std::size_t count, unsigned int seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_int_distribution<int> position(0, 30);
+		std::uniform_int_distribution<int> size(0, 3);
+		std::vector<BoundingVolume::AABB> boxes;
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			glm::vec3 lowerBound(position(random), position(random), position(random));
+			boxes.emplace_back(lowerBound, lowerBound + glm::vec3(size(random), size(random), size(random)));
+		}
+
+		return boxes;
+	}
+
+	bool lessThan(const BodyPair& first, const BodyPair& second)
+	{
+		return first.first < second.first || (first.first == second.first && first.second < second.second);
+	}
+}
+
+TEST(AABBArrayTest, StoresWhatItIsGiven)
+{
+	std::vector<BoundingVolume::AABB> boxes = randomBoxes(13, 3);
+	AABBArray array;
+
+	for (const auto& box : boxes)
+	{
+		array.push_back(box);
+	}
+
+	array.set(5, boxes[0]);
+	boxes[5] = boxes[0];
+
+	ASSERT_EQ(array.size(), boxes.size());
+
+	for (std::size_t i = 0; i < boxes.size(); i++)
+	{
+		EXPECT_EQ(array[i].getLowerBound(), boxes[i].getLowerBound());
+		EXPECT_EQ(array[i].getUpperBound(), boxes[i].getUpperBound());
+	}
+}
+
+TEST(AABBArrayTest, RegionQueriesMatchBinaryBVH)
+{
+	//Sizes on, just off and well off the block size
+	for (std::size_t count : {1u, 7u, 8u, 9u, 16u, 100u, 517u})
+	{
+		std::vector<BoundingVolume::AABB> boxes = randomBoxes(count, static_cast<unsigned int>(count));
+		AABBArray array(boxes);
+		BVH bvh(boxes);
+		bvh.buildTree();
+
+		std::vector<BoundingVolume::AABB> regions = randomBoxes(200, 41);
+		std::vector<std::uint32_t> expected, indices;
+
+		//A region around all of the padding past the end
+		regions.emplace_back(glm::vec3(-1000.0f), glm::vec3(1000.0f));
+
+		for (std::size_t i = 0; i < regions.size(); i++)
+		{
+			bvh.queryRegion(regions[i], expected);
+			std::sort(expected.begin(), expected.end());
+
+			indices.clear();
+			array.queryOverlaps(regions[i], indices);
+			EXPECT_EQ(indices, expected) << count << " boxes, region " << i;
+
+			//Ranges that start and end in the middle of a block
+			std::size_t start = i % count, end = start + (i * 7) % (count - start + 1);
+			std::vector<std::uint32_t> inRange;
+
+			std::copy_if(expected.begin(), expected.end(), std::back_inserter(inRange), [start, end](std::uint32_t index) {
+				return index >= start && index < end;
+			});
+
+			indices.clear();
+			array.queryOverlaps(regions[i], indices, start, end);
+			EXPECT_EQ(indices, inRange) << count << " boxes, region " << i << ", range " << start << " to " << end;
+		}
+	}
+}
+
+TEST(AABBArrayTest, PairsMatchBinaryBVH)
+{
+	for (std::size_t count : {2u, 8u, 9u, 300u, 1001u})
+	{
+		std::vector<BoundingVolume::AABB> boxes = randomBoxes(count, static_cast<unsigned int>(count));
+		AABBArray array(boxes);
+		BVH bvh(boxes);
+		bvh.buildTree();
+
+		std::vector<BodyPair> pairs, expected;
+
+		array.queryPairs(pairs);
+		bvh.queryPairs(expected);
+		std::sort(expected.begin(), expected.end(), lessThan);
+
+		//Already sorted, since each box is tested against the ones after it
+		EXPECT_EQ(pairs, expected) << count << " boxes";
+	}
+}
+
+TEST(AABBArrayTest, PairsBetweenListsMatchBruteForce)
+{
+	std::vector<BoundingVolume::AABB> boxes = randomBoxes(203, 43);
+	std::vector<BoundingVolume::AABB> otherBoxes = randomBoxes(61, 47);
+	AABBArray array(boxes), other(otherBoxes);
+	std::vector<BodyPair> pairs, expected;
+
+	for (std::uint32_t i = 0; i < boxes.size(); i++)
+	{
+		for (std::uint32_t j = 0; j < otherBoxes.size(); j++)
+		{
+			if (boxes[i].overlapsWith(otherBoxes[j]))
+			{
+				expected.push_back({i, j});
+			}
+		}
+	}
+
+	array.queryPairs(other, pairs);
+	EXPECT_EQ(pairs, expected);
+
+	//Shrinking leaves no stale boxes behind in the padding
+	other.resize(10);
+	array.queryPairs(other, pairs);
+	expected.erase(std::remove_if(expected.begin(), expected.end(), [](const BodyPair& pair) {
+		return pair.second >= 10;
+	}), expected.end());
+
+	EXPECT_EQ(pairs, expected);
+}
@@ -0,0 +1,133 @@
+#include "gtest/gtest.h"
+
+#include "broadphase.hpp"
+#include "spatialhashgrid.hpp"
+#include "sweepandprune.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+
+using namespace Physicc;
+
+namespace
+{
+	constexpr float s_timestep = 1.0f / 60.0f;
+
+	/**
+	 * @brief Small boxes moving around in every direction over a large
+	 * static floor, with a few small static boxes among them
+	 */
+	class BroadphaseTest : public ::testing::TestWithParam<std::function<std::unique_ptr<Broadphase>()>>
+	{
+		protected:
+			BroadphaseTest()
+			{
+				std::mt19937 random(11);
+				std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+				std::uniform_real_distribution<float> size(0.2f, 1.5f);
+				std::uniform_real_distribution<float> speed(-30.0f, 30.0f);
+
+				m_volumes.emplace_back(glm::vec3(-25.0f, -1.0f, -25.0f), glm::vec3(25.0f, 0.5f, 25.0f));
+				m_velocities.emplace_back(0.0f);
+				m_isStatic.push_back(true);
+
+				for (int i = 0; i < 600; i++)
+				{
+					glm::vec3 lowerBound(position(random), 0.5f * position(random), position(random));
+					m_volumes.emplace_back(lowerBound, lowerBound + glm::vec3(size(random), size(random), size(random)));
+					m_isStatic.push_back(i % 10 == 0);
+					m_velocities.push_back(m_isStatic.back()
+						? glm::vec3(0.0f)
+						: glm::vec3(speed(random), speed(random), speed(random)));
+				}
+			}
+
+			void move()
+			{
+				for (std::size_t i = 0; i < m_volumes.size(); i++)
+				{
+					glm::vec3 offset = m_velocities[i] * s_timestep;
+					m_volumes[i] = BoundingVolume::AABB(m_volumes[i].getLowerBound() + offset,
+					                                    m_volumes[i].getUpperBound() + offset);
+				}
+			}
+
+			std::vector<BodyPair> bruteForcePairs() const
+			{
+				std::vector<BodyPair> pairs;
+
+				for (std::uint32_t i = 0; i < m_volumes.size(); i++)
+				{
+					for (std::uint32_t j = i + 1; j < m_volumes.size(); j++)
+					{
+						if (!(m_isStatic[i] && m_isStatic[j]) && m_volumes[i].overlapsWith(m_volumes[j]))
+						{
+							pairs.push_back({i, j});
+						}
+					}
+				}
+
+				return pairs;
+			}
+
+			std::vector<BoundingVolume::AABB> m_volumes;
+			std::vector<glm::vec3> m_velocities;
+			std::vector<bool> m_isStatic;
+	};
+
+	bool lessThan(const BodyPair& first, const BodyPair& second)
+	{
+		return first.first < second.first || (first.first == second.first && first.second < second.second);
+	}
+}
+
+TEST_P(BroadphaseTest, FindsTheSamePairsAsBruteForce)
+{
+	JobSystem serial(0), parallel(3);
+	std::unique_ptr<Broadphase> broadphase = GetParam()();
+	std::unique_ptr<Broadphase> parallelBroadphase = GetParam()();
+
+	for (std::size_t i = 0; i < m_volumes.size(); i++)
+	{
+		broadphase->addBody(m_volumes[i], m_isStatic[i]);
+		parallelBroadphase->addBody(m_volumes[i], m_isStatic[i]);
+	}
+
+	std::vector<BodyPair> pairs, parallelPairs;
+
+	for (int step = 0; step < 40; step++)
+	{
+		broadphase->update(m_volumes, m_velocities, s_timestep, serial);
+		broadphase->findPairs(m_volumes, pairs, serial);
+		parallelBroadphase->update(m_volumes, m_velocities, s_timestep, parallel);
+		parallelBroadphase->findPairs(m_volumes, parallelPairs, parallel);
+
+		//The order is up to the broadphase, but not up to the number of
+		//threads
+		EXPECT_EQ(parallelPairs, pairs) << "step " << step;
+
+		for (const BodyPair& pair : pairs)
+		{
+			ASSERT_LT(pair.first, pair.second);
+		}
+
+		std::vector<BodyPair> sorted = pairs;
+		std::sort(sorted.begin(), sorted.end(), lessThan);
+
+		ASSERT_EQ(std::adjacent_find(sorted.begin(), sorted.end()), sorted.end()) << "duplicate pair in step " << step;
+		ASSERT_EQ(sorted, bruteForcePairs()) << "step " << step;
+
+		move();
+	}
+}
+
+INSTANTIATE_TEST_SUITE_P(Broadphases,
+                         BroadphaseTest,
+                         ::testing::Values([]() { return std::unique_ptr<Broadphase>(new DynamicBVHBroadphase()); },
+                                           []() { return std::unique_ptr<Broadphase>(new BVHBroadphase(BVH::SplitMethod::Morton, 5)); },
+                                           []() { return std::unique_ptr<Broadphase>(new BVHBroadphase(BVH::SplitMethod::SAH, 5)); },
+                                           []() { return std::unique_ptr<Broadphase>(new SweepAndPrune()); },
+                                           []() { return std::unique_ptr<Broadphase>(new SpatialHashGrid()); },
+                                           []() { return std::unique_ptr<Broadphase>(new SpatialHashGrid(2.0f)); }));
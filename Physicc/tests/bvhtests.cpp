@@ -0,0 +1,440 @@
+#include "gtest/gtest.h"
+
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+
+using namespace Physicc;
+
+namespace
+{
+	//A seeded scatter of boxes of different sizes, some of them overlapping
+	std::vector<BoundingVolume::AABB> randomBoxes(std::size_t count)
+	{
+		std::mt19937 random(5);
+		std::uniform_real_distribution<float> position(0.0f, 40.0f);
+		std::uniform_real_distribution<float> size(0.2f, 2.0f);
+		std::vector<BoundingVolume::AABB> boxes;
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			glm::vec3 lowerBound(position(random), position(random), position(random));
+			boxes.emplace_back(lowerBound, lowerBound + glm::vec3(size(random), size(random), size(random)));
+		}
+
+		return boxes;
+	}
+
+	bool lessThan(const BodyPair& first, const BodyPair& second)
+	{
+		return first.first < second.first || (first.first == second.first && first.second < second.second);
+	}
+
+	std::vector<BodyPair> bruteForcePairs(const std::vector<BoundingVolume::AABB>& boxes)
+	{
+		std::vector<BodyPair> pairs;
+
+		for (std::uint32_t i = 0; i < boxes.size(); i++)
+		{
+			for (std::uint32_t j = i + 1; j < boxes.size(); j++)
+			{
+				if (boxes[i].overlapsWith(boxes[j]))
+				{
+					pairs.push_back({i, j});
+				}
+			}
+		}
+
+		return pairs;
+	}
+
+	/**
+	 * @brief A tree over a seeded scatter of boxes, for every split method
+	 * and a few leaf sizes
+	 */
+	class BVHBuildTest : public ::testing::TestWithParam<std::tuple<BVH::SplitMethod, std::size_t>>
+	{
+		protected:
+			BVHBuildTest()
+				: m_boxes(randomBoxes(1500)),
+				  m_maxLeafSize(std::get<1>(GetParam())),
+				  m_bvh(m_boxes, std::get<0>(GetParam()), m_maxLeafSize)
+			{
+				m_bvh.buildTree();
+			}
+
+			std::vector<BoundingVolume::AABB> m_boxes;
+			std::size_t m_maxLeafSize;
+			BVH m_bvh;
+	};
+
+	bool encloses(const BoundingVolume::AABB& outer, const BoundingVolume::AABB& inner)
+	{
+		return glm::all(glm::lessThanEqual(outer.getLowerBound(), inner.getLowerBound()))
+			&& glm::all(glm::greaterThanEqual(outer.getUpperBound(), inner.getUpperBound()));
+	}
+
+	//Expected cost of a query against the tree, as the SAH estimates it:
+	//every node is visited, and every body of a leaf tested, with the
+	//probability that a random query hitting the root also hits the node
+	float surfaceAreaCost(const BVH& bvh)
+	{
+		const std::vector<BVHNode>& nodes = bvh.getNodes();
+		float rootArea = nodes.front().volume.getSurfaceArea();
+		float cost = 0.0f;
+
+		for (const BVHNode& node : nodes)
+		{
+			cost += node.volume.getSurfaceArea() / rootArea * (node.isLeaf() ? node.count : 1.0f);
+		}
+
+		return cost;
+	}
+}
+
+TEST_P(BVHBuildTest, NodesAreLaidOutDepthFirst)
+{
+	const std::vector<BVHNode>& nodes = m_bvh.getNodes();
+	const std::vector<std::uint32_t>& bodyIndices = m_bvh.getBodyIndices();
+	std::size_t leafCount = 0;
+	std::uint32_t nextBody = 0;
+
+	ASSERT_FALSE(nodes.empty());
+
+	for (std::size_t i = 0; i < nodes.size(); i++)
+	{
+		const BVHNode& node = nodes[i];
+
+		if (node.isLeaf())
+		{
+			//Leaves own consecutive ranges of the body list, in order
+			EXPECT_EQ(node.offset, nextBody) << "node " << i;
+			EXPECT_LE(node.count, m_maxLeafSize) << "node " << i;
+			nextBody = node.offset + node.count;
+			leafCount++;
+
+			for (std::uint32_t j = node.offset; j != node.offset + node.count; j++)
+			{
+				EXPECT_TRUE(encloses(node.volume, m_boxes[bodyIndices[j]])) << "node " << i;
+			}
+		} else
+		{
+			ASSERT_GT(node.offset, i + 1) << "node " << i;
+			ASSERT_LT(node.offset, nodes.size()) << "node " << i;
+			EXPECT_TRUE(encloses(node.volume, nodes[i + 1].volume)) << "node " << i;
+			EXPECT_TRUE(encloses(node.volume, nodes[node.offset].volume)) << "node " << i;
+		}
+	}
+
+	EXPECT_EQ(nextBody, m_boxes.size());
+	EXPECT_EQ(nodes.size(), 2 * leafCount - 1);
+
+	std::vector<std::uint32_t> sorted = bodyIndices;
+	std::sort(sorted.begin(), sorted.end());
+
+	for (std::uint32_t i = 0; i < sorted.size(); i++)
+	{
+		ASSERT_EQ(sorted[i], i);
+	}
+}
+
+TEST_P(BVHBuildTest, PairsMatchBruteForce)
+{
+	std::vector<BodyPair> pairs;
+	m_bvh.queryPairs(pairs);
+
+	for (const BodyPair& pair : pairs)
+	{
+		ASSERT_LT(pair.first, pair.second);
+	}
+
+	std::sort(pairs.begin(), pairs.end(), lessThan);
+
+	EXPECT_EQ(std::adjacent_find(pairs.begin(), pairs.end()), pairs.end());
+	EXPECT_EQ(pairs, bruteForcePairs(m_boxes));
+}
+
+TEST_P(BVHBuildTest, RayAndRegionQueriesMatchBruteForce)
+{
+	std::mt19937 random(9);
+	std::uniform_real_distribution<float> position(-5.0f, 45.0f);
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> size(0.0f, 3.0f);
+	std::vector<std::uint32_t> bodies;
+
+	for (int i = 0; i < 300; i++)
+	{
+		Ray ray(glm::vec3(position(random), position(random), position(random)),
+		        glm::vec3(direction(random), direction(random), direction(random)));
+		float tMax = i % 2 == 0 ? std::numeric_limits<float>::infinity() : 10.0f * size(random);
+
+		float nearest = std::numeric_limits<float>::infinity();
+		float t;
+
+		for (const BoundingVolume::AABB& box : m_boxes)
+		{
+			if (ray.intersects(box, tMax, t))
+			{
+				nearest = std::min(nearest, t);
+			}
+		}
+
+		std::optional<RaycastHit> hit = m_bvh.raycast(ray, tMax);
+
+		ASSERT_EQ(hit.has_value(), nearest != std::numeric_limits<float>::infinity()) << "ray " << i;
+		EXPECT_EQ(m_bvh.raycastAny(ray, tMax), hit.has_value()) << "ray " << i;
+
+		if (hit)
+		{
+			//Bodies can tie for the nearest hit, so only check that the
+			//reported one is hit where it says
+			EXPECT_FLOAT_EQ(hit->t, nearest) << "ray " << i;
+			ASSERT_TRUE(ray.intersects(m_boxes[hit->bodyIndex], tMax, t)) << "ray " << i;
+			EXPECT_FLOAT_EQ(t, nearest) << "ray " << i;
+		}
+
+		//A box swept from the ray's origin along part of it
+		glm::vec3 extent(size(random), size(random), size(random));
+		glm::vec3 displacement = 5.0f * ray.direction;
+		BoundingVolume::AABB box(ray.origin - extent, ray.origin + extent);
+		Ray sweepRay(0.5f * (box.getLowerBound() + box.getUpperBound()), displacement);
+		extent = 0.5f * (box.getUpperBound() - box.getLowerBound());
+		nearest = std::numeric_limits<float>::infinity();
+
+		for (const BoundingVolume::AABB& other : m_boxes)
+		{
+			if (sweepRay.intersects(other, 1.0f, t, extent))
+			{
+				nearest = std::min(nearest, t);
+			}
+		}
+
+		hit = m_bvh.sweep(box, displacement);
+
+		ASSERT_EQ(hit.has_value(), nearest != std::numeric_limits<float>::infinity()) << "sweep " << i;
+
+		if (hit)
+		{
+			EXPECT_FLOAT_EQ(hit->t, nearest) << "sweep " << i;
+		}
+
+		//The swept box's region
+		std::vector<std::uint32_t> expected;
+
+		for (std::uint32_t j = 0; j < m_boxes.size(); j++)
+		{
+			if (m_boxes[j].overlapsWith(box))
+			{
+				expected.push_back(j);
+			}
+		}
+
+		m_bvh.queryRegion(box, bodies);
+		std::sort(bodies.begin(), bodies.end());
+
+		EXPECT_EQ(bodies, expected) << "region " << i;
+	}
+}
+
+TEST_P(BVHBuildTest, RefitTreeMatchesBruteForce)
+{
+	std::mt19937 random(17);
+	std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+	std::vector<BodyPair> pairs;
+
+	for (int step = 0; step < 5; step++)
+	{
+		for (std::size_t i = 0; i < m_boxes.size(); i++)
+		{
+			glm::vec3 move(offset(random), offset(random), offset(random));
+			m_boxes[i] = BoundingVolume::AABB(m_boxes[i].getLowerBound() + move, m_boxes[i].getUpperBound() + move);
+			m_bvh.updateVolume(i, m_boxes[i]);
+		}
+
+		m_bvh.refit();
+
+		const std::vector<BVHNode>& nodes = m_bvh.getNodes();
+
+		for (std::size_t i = 0; i < nodes.size(); i++)
+		{
+			const BVHNode& node = nodes[i];
+
+			if (node.isLeaf())
+			{
+				for (std::uint32_t j = node.offset; j != node.offset + node.count; j++)
+				{
+					ASSERT_TRUE(encloses(node.volume, m_boxes[m_bvh.getBodyIndices()[j]])) << "node " << i;
+				}
+			} else
+			{
+				ASSERT_TRUE(encloses(node.volume, nodes[i + 1].volume)) << "node " << i;
+				ASSERT_TRUE(encloses(node.volume, nodes[node.offset].volume)) << "node " << i;
+			}
+		}
+
+		m_bvh.queryPairs(pairs);
+		std::sort(pairs.begin(), pairs.end(), lessThan);
+
+		EXPECT_EQ(pairs, bruteForcePairs(m_boxes)) << "step " << step;
+	}
+}
+
+TEST(BVHTest, SAHBuildsCheaperTreesThanMedianSplits)
+{
+	//Tight clusters of small boxes far apart, with a few large boxes
+	//across them. The median split cuts right through clusters.
+	std::mt19937 random(13);
+	std::uniform_real_distribution<float> cluster(0.0f, 200.0f);
+	std::normal_distribution<float> offset(0.0f, 2.0f);
+	std::vector<BoundingVolume::AABB> boxes;
+
+	for (int i = 0; i < 20; i++)
+	{
+		glm::vec3 center(cluster(random), cluster(random), cluster(random));
+
+		for (int j = 0; j < 100; j++)
+		{
+			glm::vec3 lowerBound = center + glm::vec3(offset(random), offset(random), offset(random));
+			boxes.emplace_back(lowerBound, lowerBound + glm::vec3(0.5f));
+		}
+	}
+
+	for (int i = 0; i < 20; i++)
+	{
+		glm::vec3 lowerBound(cluster(random), cluster(random), cluster(random));
+		boxes.emplace_back(lowerBound, lowerBound + glm::vec3(30.0f));
+	}
+
+	for (std::size_t maxLeafSize : {1, 4})
+	{
+		BVH median(boxes, BVH::SplitMethod::Median, maxLeafSize);
+		median.buildTree();
+		BVH sah(boxes, BVH::SplitMethod::SAH, maxLeafSize);
+		sah.buildTree();
+
+		EXPECT_LT(surfaceAreaCost(sah), surfaceAreaCost(median)) << "leaves of " << maxLeafSize;
+	}
+}
+
+TEST(BVHTest, MortonSplitsBodiesThatShareACode)
+{
+	//A hundred boxes in the very same place, so with the same code, among
+	//the rest
+	std::vector<BoundingVolume::AABB> boxes = randomBoxes(500);
+	boxes.insert(boxes.begin() + 100, 100, BoundingVolume::AABB(glm::vec3(20.0f), glm::vec3(21.0f)));
+
+	BVH bvh(boxes, BVH::SplitMethod::Morton, 4);
+	bvh.buildTree();
+
+	for (const BVHNode& node : bvh.getNodes())
+	{
+		EXPECT_LE(node.count, 4);
+	}
+
+	std::vector<BodyPair> pairs;
+	bvh.queryPairs(pairs);
+	std::sort(pairs.begin(), pairs.end(), lessThan);
+
+	EXPECT_EQ(pairs, bruteForcePairs(boxes));
+}
+
+TEST(BVHTest, MortonWithWideCodesMatchesMedianSplits)
+{
+	//Enough bodies for 63-bit codes, too many for a brute force, so the
+	//pairs are checked against a tree built another way
+	std::mt19937 random(23);
+	std::uniform_real_distribution<float> position(0.0f, 400.0f);
+	std::vector<BoundingVolume::AABB> boxes;
+
+	for (int i = 0; i < 70000; i++)
+	{
+		glm::vec3 lowerBound(position(random), position(random), position(random));
+		boxes.emplace_back(lowerBound, lowerBound + glm::vec3(2.0f));
+	}
+
+	BVH morton(boxes, BVH::SplitMethod::Morton, 4);
+	morton.buildTree();
+	BVH median(boxes, BVH::SplitMethod::Median, 4);
+	median.buildTree();
+
+	std::vector<BodyPair> pairs, expected;
+	morton.queryPairs(pairs);
+	median.queryPairs(expected);
+	std::sort(pairs.begin(), pairs.end(), lessThan);
+	std::sort(expected.begin(), expected.end(), lessThan);
+
+	ASSERT_FALSE(expected.empty());
+	EXPECT_EQ(pairs, expected);
+
+	std::vector<std::uint32_t> sorted = morton.getBodyIndices();
+	std::sort(sorted.begin(), sorted.end());
+
+	for (std::uint32_t i = 0; i < sorted.size(); i++)
+	{
+		ASSERT_EQ(sorted[i], i);
+	}
+}
+
+INSTANTIATE_TEST_SUITE_P(SplitMethods,
+                         BVHBuildTest,
+                         ::testing::Combine(::testing::Values(BVH::SplitMethod::Median,
+                                                              BVH::SplitMethod::SAH,
+                                                              BVH::SplitMethod::Morton),
+                                            ::testing::Values(std::size_t(1), std::size_t(4), std::size_t(8))));
+
+TEST(BVHTest, ParallelPairQueryMatchesSerial)
+{
+	std::vector<BoundingVolume::AABB> boxes = randomBoxes(3000);
+
+	for (BVH::SplitMethod splitMethod : {BVH::SplitMethod::Median, BVH::SplitMethod::SAH, BVH::SplitMethod::Morton})
+	{
+		BVH bvh(boxes, splitMethod, 4);
+		bvh.buildTree();
+
+		std::vector<BodyPair> expected;
+		bvh.queryPairs(expected);
+		ASSERT_FALSE(expected.empty());
+
+		for (unsigned int workerCount : {0u, 1u, 3u, 7u})
+		{
+			JobSystem jobSystem(workerCount);
+			std::vector<BodyPair> pairs;
+			bvh.queryPairsParallel(pairs, jobSystem);
+
+			//Same pairs in the same order
+			EXPECT_EQ(pairs, expected) << "with " << workerCount << " workers";
+		}
+	}
+}
+
+TEST(BVHTest, BuildOnJobSystemMatchesStandaloneBuild)
+{
+	//Enough bodies for the build to split into tasks
+	std::vector<BoundingVolume::AABB> boxes = randomBoxes(20000);
+	JobSystem jobSystem(3);
+
+	for (BVH::SplitMethod splitMethod : {BVH::SplitMethod::Median, BVH::SplitMethod::SAH, BVH::SplitMethod::Morton})
+	{
+		BVH expected(boxes, splitMethod, 4);
+		expected.buildTree();
+
+		BVH bvh(boxes, splitMethod, 4);
+		bvh.buildTree(jobSystem);
+
+		ASSERT_EQ(bvh.getNodes().size(), expected.getNodes().size());
+		EXPECT_EQ(bvh.getBodyIndices(), expected.getBodyIndices());
+
+		for (std::size_t i = 0; i < bvh.getNodes().size(); i++)
+		{
+			const BVHNode& node = bvh.getNodes()[i];
+			const BVHNode& expectedNode = expected.getNodes()[i];
+
+			EXPECT_EQ(node.volume.getLowerBound(), expectedNode.volume.getLowerBound()) << "node " << i;
+			EXPECT_EQ(node.volume.getUpperBound(), expectedNode.volume.getUpperBound()) << "node " << i;
+			EXPECT_EQ(node.offset, expectedNode.offset) << "node " << i;
+			EXPECT_EQ(node.count, expectedNode.count) << "node " << i;
+		}
+	}
+}
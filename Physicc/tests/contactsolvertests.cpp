@@ -0,0 +1,175 @@
+#include "gtest/gtest.h"
+
+#include "contactsolver.hpp"
+
+#include <limits>
+#include <random>
+
+using namespace Physicc;
+
+namespace
+{
+	constexpr float s_timestep = 1.0f / 60.0f;
+	constexpr int s_size = 8;
+
+	/**
+	 * @brief A cube of bodies packed on a static floor, each touching its
+	 * neighbors, all of them in one island with well over the default
+	 * number of constraints it takes to be colored
+	 */
+	class ContactSolverTest : public ::testing::Test
+	{
+		protected:
+			ContactSolverTest()
+			{
+				std::mt19937 random(59);
+				std::uniform_real_distribution<float> speed(-1.0f, 1.0f);
+
+				//The floor is body 0
+				addBody(glm::vec3(0.0f), 0.0f, glm::vec3(0.0f));
+
+				for (int i = 0; i < s_size * s_size * s_size; i++)
+				{
+					glm::vec3 position(i % s_size, 0.5f + static_cast<float>(i / s_size % s_size), i / (s_size * s_size));
+					glm::vec3 velocity(speed(random), speed(random) - 9.81f * s_timestep, speed(random));
+
+					addBody(position, 1.0f + 0.5f * static_cast<float>(i % 3), velocity);
+				}
+
+				for (std::uint32_t i = 1; i < m_positions.size(); i++)
+				{
+					glm::vec3 position = m_positions[i];
+
+					if (position.y == 0.5f)
+					{
+						addContact(0, i, glm::vec3(0.0f, 1.0f, 0.0f));
+					}
+
+					for (int axis = 0; axis < 3; axis++)
+					{
+						glm::vec3 normal(0.0f);
+						normal[axis] = 1.0f;
+
+						glm::vec3 neighbor = position + normal;
+
+						if (neighbor.x < s_size && neighbor.y < s_size && neighbor.z < s_size)
+						{
+							addContact(i, static_cast<std::uint32_t>(indexOf(neighbor)), normal);
+						}
+					}
+				}
+
+				std::vector<std::uint32_t> bodies;
+
+				for (std::uint32_t i = 0; i < m_positions.size(); i++)
+				{
+					bodies.push_back(i);
+				}
+
+				m_islands.build(bodies, m_positions.size(), m_contacts, m_inverseMasses);
+			}
+
+			/**
+			 * @brief Solve the scene with a fresh solver
+			 */
+			std::vector<glm::vec3> solve(std::uint32_t largeIslandSize,
+			                             unsigned int workerCount,
+			                             unsigned int iterations)
+			{
+				JobSystem jobSystem(workerCount);
+				ContactSolver solver;
+				solver.setLargeIslandSize(largeIslandSize);
+				solver.setIterations(iterations);
+
+				std::vector<glm::vec3> velocities = m_velocities;
+
+				solver.prepare(m_contacts,
+				               m_positions,
+				               velocities,
+				               m_inverseMasses,
+				               m_frictions,
+				               m_restitutions,
+				               s_timestep,
+				               jobSystem);
+				solver.solve(m_islands, velocities, jobSystem);
+
+				return velocities;
+			}
+
+			std::vector<ContactManifold> m_contacts;
+			std::vector<glm::vec3> m_positions;
+			std::vector<glm::vec3> m_velocities;
+			std::vector<float> m_inverseMasses;
+			std::vector<float> m_frictions;
+			std::vector<float> m_restitutions;
+			IslandBuilder m_islands;
+
+		private:
+			void addBody(const glm::vec3& position, float inverseMass, const glm::vec3& velocity)
+			{
+				m_positions.push_back(position);
+				m_velocities.push_back(velocity);
+				m_inverseMasses.push_back(inverseMass);
+				m_frictions.push_back(0.0f);
+				m_restitutions.push_back(0.0f);
+			}
+
+			void addContact(std::uint32_t first, std::uint32_t second, const glm::vec3& normal)
+			{
+				ContactManifold manifold;
+				manifold.first = first;
+				manifold.second = second;
+				manifold.normal = normal;
+
+				//Deep enough to be pushed apart a little
+				manifold.addPoint(m_positions[second] - 0.5f * normal, 0.02f);
+				m_contacts.push_back(manifold);
+			}
+
+			static std::size_t indexOf(const glm::vec3& position)
+			{
+				auto x = static_cast<std::size_t>(position.x);
+				auto y = static_cast<std::size_t>(position.y);
+				auto z = static_cast<std::size_t>(position.z);
+
+				return 1 + x + s_size * (y + s_size * z);
+			}
+	};
+}
+
+TEST_F(ContactSolverTest, ColoredSolveIsTheSameOnAnyNumberOfThreads)
+{
+	std::vector<glm::vec3> serial = solve(0, 0, 10);
+	std::vector<glm::vec3> parallel = solve(0, 3, 10);
+
+	for (std::size_t i = 0; i < serial.size(); i++)
+	{
+		EXPECT_EQ(serial[i], parallel[i]) << "body " << i;
+	}
+}
+
+TEST_F(ContactSolverTest, ColoredSolveConvergesToTheSerialSolution)
+{
+	//Without friction, the velocities that satisfy every constraint with
+	//the least change are unique, so both orders get there given enough
+	//iterations
+	std::vector<glm::vec3> serial = solve(std::numeric_limits<std::uint32_t>::max(), 0, 500);
+	std::vector<glm::vec3> colored = solve(0, 3, 500);
+
+	for (std::size_t i = 0; i < serial.size(); i++)
+	{
+		EXPECT_NEAR(colored[i].x, serial[i].x, 1e-3f) << "body " << i;
+		EXPECT_NEAR(colored[i].y, serial[i].y, 1e-3f) << "body " << i;
+		EXPECT_NEAR(colored[i].z, serial[i].z, 1e-3f) << "body " << i;
+	}
+
+	//And no contact is left approaching
+	for (const ContactManifold& contact : m_contacts)
+	{
+		float serialVelocity = glm::dot(serial[contact.second] - serial[contact.first], contact.normal);
+		float coloredVelocity = glm::dot(colored[contact.second] - colored[contact.first], contact.normal);
+
+		EXPECT_GT(serialVelocity, -1e-3f) << contact.first << " and " << contact.second;
+		EXPECT_GT(coloredVelocity, -1e-3f) << contact.first << " and " << contact.second;
+	}
+}
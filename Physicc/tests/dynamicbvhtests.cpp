@@ -0,0 +1,136 @@
+#include "gtest/gtest.h"
+
+#include "dynamicbvh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace Physicc;
+
+namespace
+{
+	bool encloses(const BoundingVolume::AABB& outer, const BoundingVolume::AABB& inner)
+	{
+		return glm::all(glm::lessThanEqual(outer.getLowerBound(), inner.getLowerBound()))
+			&& glm::all(glm::greaterThanEqual(outer.getUpperBound(), inner.getUpperBound()));
+	}
+}
+
+TEST(DynamicBVHTest, QueriesMatchBruteForceAsBodiesComeAndGo)
+{
+	std::mt19937 random(19);
+	std::uniform_real_distribution<float> position(0.0f, 50.0f);
+	std::uniform_real_distribution<float> size(0.2f, 2.0f);
+	std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+
+	DynamicBVH tree(0.1f);
+	std::vector<BoundingVolume::AABB> boxes;
+	std::vector<std::uint32_t> proxies;
+	std::vector<bool> alive;
+
+	auto randomBox = [&]() {
+		glm::vec3 lowerBound(position(random), position(random), position(random));
+		return BoundingVolume::AABB(lowerBound, lowerBound + glm::vec3(size(random), size(random), size(random)));
+	};
+
+	for (std::uint32_t i = 0; i < 1000; i++)
+	{
+		boxes.push_back(randomBox());
+		proxies.push_back(tree.insert(boxes.back(), i));
+		alive.push_back(true);
+	}
+
+	for (int step = 0; step < 10; step++)
+	{
+		for (std::size_t i = 0; i < boxes.size(); i++)
+		{
+			if (!alive[i])
+			{
+				continue;
+			}
+
+			if ((i + step) % 7 == 0)
+			{
+				tree.remove(proxies[i]);
+				alive[i] = false;
+				continue;
+			}
+
+			glm::vec3 move(offset(random), offset(random), offset(random));
+			boxes[i] = BoundingVolume::AABB(boxes[i].getLowerBound() + move, boxes[i].getUpperBound() + move);
+			tree.update(proxies[i], boxes[i], move);
+		}
+
+		//Some new bodies, which may reuse the removed ones' nodes
+		for (int i = 0; i < 50; i++)
+		{
+			boxes.push_back(randomBox());
+			proxies.push_back(tree.insert(boxes.back(), static_cast<std::uint32_t>(boxes.size() - 1)));
+			alive.push_back(true);
+		}
+
+		std::size_t aliveCount = static_cast<std::size_t>(std::count(alive.begin(), alive.end(), true));
+
+		//Rebalancing keeps the tree about as shallow as a complete one
+		EXPECT_LE(tree.getHeight(), 3 * static_cast<int>(std::ceil(std::log2(aliveCount)))) << "step " << step;
+
+		for (std::size_t i = 0; i < boxes.size(); i++)
+		{
+			if (alive[i])
+			{
+				ASSERT_EQ(tree.getBodyIndex(proxies[i]), i);
+				ASSERT_TRUE(encloses(tree.getFatVolume(proxies[i]), boxes[i])) << "body " << i;
+			}
+		}
+
+		for (int query = 0; query < 50; query++)
+		{
+			BoundingVolume::AABB region = randomBox();
+			std::vector<std::uint32_t> found, expected;
+
+			tree.query(region, [&](std::uint32_t proxy) {
+				found.push_back(tree.getBodyIndex(proxy));
+				return true;
+			});
+
+			//Exactly the live bodies whose fat AABB overlaps the region
+			for (std::uint32_t i = 0; i < boxes.size(); i++)
+			{
+				if (alive[i] && tree.getFatVolume(proxies[i]).overlapsWith(region))
+				{
+					expected.push_back(i);
+				}
+
+				if (alive[i] && boxes[i].overlapsWith(region))
+				{
+					EXPECT_TRUE(tree.getFatVolume(proxies[i]).overlapsWith(region));
+				}
+			}
+
+			std::sort(found.begin(), found.end());
+
+			ASSERT_EQ(found, expected) << "step " << step << ", query " << query;
+		}
+	}
+}
+
+TEST(DynamicBVHTest, RemovingTheLastBodyEmptiesTheTree)
+{
+	DynamicBVH tree;
+	EXPECT_EQ(tree.getHeight(), -1);
+
+	std::uint32_t proxy = tree.insert(BoundingVolume::AABB(glm::vec3(0.0f), glm::vec3(1.0f)), 0);
+	EXPECT_EQ(tree.getHeight(), 0);
+
+	tree.remove(proxy);
+	EXPECT_EQ(tree.getHeight(), -1);
+
+	bool called = false;
+	tree.query(BoundingVolume::AABB(glm::vec3(-10.0f), glm::vec3(10.0f)), [&](std::uint32_t) {
+		called = true;
+		return true;
+	});
+
+	EXPECT_FALSE(called);
+}
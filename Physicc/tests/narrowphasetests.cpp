@@ -0,0 +1,185 @@
+#include "gtest/gtest.h"
+
+#include "narrowphase.hpp"
+
+#include <cmath>
+#include <random>
+
+using namespace Physicc;
+
+namespace
+{
+	//The corners of a unit cube, to build a convex hull that GJK and EPA
+	//have to handle the way SAT handles a box
+	const std::vector<glm::vec3> s_cubeCorners = {
+		{-0.5f, -0.5f, -0.5f}, {0.5f, -0.5f, -0.5f}, {-0.5f, 0.5f, -0.5f}, {0.5f, 0.5f, -0.5f},
+		{-0.5f, -0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f}, {0.5f, 0.5f, 0.5f}};
+
+	float deepestPoint(const ContactManifold& manifold)
+	{
+		float depth = 0.0f;
+
+		for (std::uint32_t i = 0; i < manifold.pointCount; i++)
+		{
+			depth = glm::max(depth, manifold.points[i].penetration);
+		}
+
+		return depth;
+	}
+
+	void expectNear(const glm::vec3& value, const glm::vec3& expected, float tolerance)
+	{
+		EXPECT_NEAR(value.x, expected.x, tolerance);
+		EXPECT_NEAR(value.y, expected.y, tolerance);
+		EXPECT_NEAR(value.z, expected.z, tolerance);
+	}
+}
+
+TEST(NarrowphaseTest, Spheres)
+{
+	SphereCollider first(1.0f, glm::vec3(0.0f));
+	SphereCollider second(0.5f, glm::vec3(1.2f, 0.0f, 0.0f));
+	ContactManifold manifold;
+
+	ASSERT_TRUE(Narrowphase::collideSpheres(first, second, manifold));
+	ASSERT_EQ(manifold.pointCount, 1u);
+	expectNear(manifold.normal, glm::vec3(1.0f, 0.0f, 0.0f), 1e-5f);
+	EXPECT_NEAR(manifold.points[0].penetration, 0.3f, 1e-5f);
+
+	//Halfway between the two surfaces
+	expectNear(manifold.points[0].position, glm::vec3(0.85f, 0.0f, 0.0f), 1e-5f);
+
+	SphereCollider apart(0.5f, glm::vec3(0.0f, 1.6f, 0.0f));
+	EXPECT_FALSE(Narrowphase::collideSpheres(first, apart, manifold));
+}
+
+TEST(NarrowphaseTest, SphereAgainstBoxFaceAndCorner)
+{
+	BoxCollider box(glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(2.0f));
+	ContactManifold manifold;
+
+	SphereCollider aboveFace(1.0f, glm::vec3(0.3f, 1.8f, -0.2f));
+
+	ASSERT_TRUE(Narrowphase::collideSphereBox(aboveFace, box, manifold));
+	ASSERT_EQ(manifold.pointCount, 1u);
+	expectNear(manifold.normal, glm::vec3(0.0f, -1.0f, 0.0f), 1e-5f);
+	EXPECT_NEAR(manifold.points[0].penetration, 0.2f, 1e-5f);
+
+	//Off the corner the normal points from the corner to the center
+	glm::vec3 direction = glm::normalize(glm::vec3(1.0f));
+	SphereCollider offCorner(1.0f, glm::vec3(1.0f) + 0.75f * direction);
+
+	ASSERT_TRUE(Narrowphase::collideSphereBox(offCorner, box, manifold));
+	expectNear(manifold.normal, -direction, 1e-5f);
+	EXPECT_NEAR(manifold.points[0].penetration, 0.25f, 1e-5f);
+
+	SphereCollider apart(1.0f, glm::vec3(1.0f) + 1.1f * direction);
+	EXPECT_FALSE(Narrowphase::collideSphereBox(apart, box, manifold));
+}
+
+TEST(NarrowphaseTest, BoxRestingOnBoxGetsFourPoints)
+{
+	BoxCollider ground(glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f), glm::vec3(10.0f, 1.0f, 10.0f));
+	ContactManifold manifold;
+
+	//Turned about the normal, so the face clipped is not lined up with the
+	//ground's edges
+	BoxCollider box(glm::vec3(1.0f, 0.45f, 2.0f), glm::vec3(0.0f, 30.0f, 0.0f));
+
+	ASSERT_TRUE(Narrowphase::collideBoxes(ground, box, manifold));
+	expectNear(manifold.normal, glm::vec3(0.0f, 1.0f, 0.0f), 1e-5f);
+	ASSERT_EQ(manifold.pointCount, 4u);
+
+	for (std::uint32_t i = 0; i < manifold.pointCount; i++)
+	{
+		EXPECT_NEAR(manifold.points[i].penetration, 0.05f, 1e-4f);
+		EXPECT_NEAR(manifold.points[i].position.y, -0.025f, 1e-4f);
+	}
+
+	//The same boxes the other way around give the opposite normal
+	ASSERT_TRUE(Narrowphase::collideBoxes(box, ground, manifold));
+	expectNear(manifold.normal, glm::vec3(0.0f, -1.0f, 0.0f), 1e-5f);
+	EXPECT_NEAR(deepestPoint(manifold), 0.05f, 1e-4f);
+}
+
+TEST(NarrowphaseTest, CrossedEdgesGetOnePoint)
+{
+	//Two boxes standing on an edge each, one turned a quarter turn from the
+	//other, so that only their edges meet. The edges are 1 / sqrt(2) from
+	//the centers, so the boxes overlap by 0.1 along the vertical axis.
+	float edgeHeight = glm::sqrt(0.5f);
+	BoxCollider lower(glm::vec3(0.0f), glm::vec3(45.0f, 0.0f, 0.0f));
+	BoxCollider upper(glm::vec3(0.0f, 2.0f * edgeHeight - 0.1f, 0.0f), glm::vec3(0.0f, 0.0f, 45.0f));
+	ContactManifold manifold;
+
+	ASSERT_TRUE(Narrowphase::collideBoxes(lower, upper, manifold));
+	ASSERT_EQ(manifold.pointCount, 1u);
+	expectNear(manifold.normal, glm::vec3(0.0f, 1.0f, 0.0f), 1e-4f);
+	EXPECT_NEAR(manifold.points[0].penetration, 0.1f, 1e-4f);
+	expectNear(manifold.points[0].position, glm::vec3(0.0f, edgeHeight - 0.05f, 0.0f), 1e-4f);
+}
+
+TEST(NarrowphaseTest, SATAndGJKAgreeOnBoxes)
+{
+	std::mt19937 random(53);
+	std::uniform_real_distribution<float> offset(-1.2f, 1.2f);
+	std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+	std::uniform_real_distribution<float> size(0.5f, 1.5f);
+	int overlapping = 0, sameAxis = 0;
+
+	for (int i = 0; i < 500; i++)
+	{
+		glm::vec3 rotation(angle(random), angle(random), angle(random));
+		glm::vec3 scale(size(random), size(random), size(random));
+		BoxCollider first(glm::vec3(0.0f), glm::vec3(angle(random), angle(random), angle(random)));
+		BoxCollider second(glm::vec3(offset(random), offset(random), offset(random)), rotation, scale);
+		ConvexHullCollider hull(s_cubeCorners, second.getPosition(), rotation, scale);
+
+		ContactManifold sat, gjk, dispatched;
+		bool satOverlaps = Narrowphase::collideBoxes(first, second, sat);
+		bool gjkOverlaps = Narrowphase::collideConvex(first, second, gjk);
+
+		SCOPED_TRACE("pair " + std::to_string(i));
+
+		//GJK reports shapes that only just touch as apart
+		if (satOverlaps != gjkOverlaps)
+		{
+			EXPECT_LT(deepestPoint(sat), 1e-3f);
+
+			continue;
+		}
+
+		//A hull shaped like the box goes the GJK way too
+		ASSERT_EQ(Narrowphase::collide(first, hull, dispatched), gjkOverlaps);
+
+		if (!satOverlaps)
+		{
+			continue;
+		}
+
+		overlapping++;
+
+		//EPA finds the axis of least penetration. SAT picks a face normal
+		//over any axis that does not penetrate noticeably less, so it may
+		//go a little deeper, but no further than its tolerances allow.
+		ASSERT_EQ(gjk.pointCount, 1u);
+		float depth = gjk.points[0].penetration;
+
+		EXPECT_NEAR(dispatched.points[0].penetration, depth, 1e-3f);
+		EXPECT_GE(deepestPoint(sat), depth - 1e-3f);
+		EXPECT_LE(deepestPoint(sat), (depth + 0.01f) / 0.95f + 1e-3f);
+
+		//Where both pick the same axis, they agree on the normal too, up to
+		//the few degrees EPA stops short of it by
+		if (std::abs(deepestPoint(sat) - depth) < 1e-3f)
+		{
+			EXPECT_GT(glm::dot(gjk.normal, sat.normal), 0.99f);
+			EXPECT_GT(glm::dot(dispatched.normal, sat.normal), 0.99f);
+			sameAxis++;
+		}
+	}
+
+	//Enough of the pairs overlap for the test to mean something
+	EXPECT_GT(overlapping, 200);
+	EXPECT_GT(sameAxis, overlapping / 2);
+}
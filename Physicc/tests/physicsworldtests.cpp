@@ -0,0 +1,356 @@
+#include "gtest/gtest.h"
+
+#include "physicsworld.hpp"
+
+#include <limits>
+#include <memory>
+
+using namespace Physicc;
+
+namespace
+{
+	constexpr float s_timestep = 1.0f / 60.0f;
+
+	void step(PhysicsWorld& world, int steps)
+	{
+		for (int i = 0; i < steps; i++)
+		{
+			world.stepSimulation(s_timestep);
+		}
+	}
+
+	std::size_t addBox(PhysicsWorld& world, float mass, const glm::vec3& position)
+	{
+		RigidBody body(mass, glm::vec3(0.0f));
+		body.setCollider(BoxCollider(position));
+
+		return world.addRigidBody(body);
+	}
+
+	//Boxes dropped in a loose pile onto the ground, stepped for a while
+	//with the given broadphase and number of workers
+	std::vector<glm::vec3> simulatePile(std::unique_ptr<Broadphase> broadphase, unsigned int workerCount)
+	{
+		PhysicsWorld world(glm::vec3(0.0f, -9.81f, 0.0f), workerCount);
+		world.setBroadphase(std::move(broadphase));
+
+		RigidBody ground(0.0f, glm::vec3(0.0f));
+		ground.setCollider(BoxCollider(glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f), glm::vec3(40.0f, 1.0f, 40.0f)));
+		world.addRigidBody(ground);
+
+		for (int i = 0; i < 300; i++)
+		{
+			int x = i % 10, z = (i / 10) % 10, y = i / 100;
+			addBox(world, 1.0f, glm::vec3(1.1f * x + 0.05f * z, 0.6f + 1.2f * y, 1.1f * z + 0.05f * x));
+		}
+
+		step(world, 60);
+
+		std::vector<glm::vec3> positions;
+
+		for (std::size_t i = 0; i < world.getBodyCount(); i++)
+		{
+			positions.push_back(world.getPosition(i));
+		}
+
+		return positions;
+	}
+}
+
+TEST(PhysicsWorldTest, BodyAddedAtRestWakesSleepingBodyItTouches)
+{
+	PhysicsWorld world(glm::vec3(0.0f), 1);
+	std::size_t first = addBox(world, 1.0f, glm::vec3(0.0f));
+
+	step(world, 200);
+	ASSERT_FALSE(world.isAwake(first));
+
+	std::size_t second = addBox(world, 1.0f, glm::vec3(0.5f, 0.0f, 0.0f));
+
+	step(world, 5);
+
+	EXPECT_TRUE(world.isAwake(first));
+	EXPECT_TRUE(world.isAwake(second));
+	EXPECT_LT(world.getPosition(first).x, 0.0f);
+	EXPECT_GT(world.getPosition(second).x, 0.5f);
+}
+
+TEST(PhysicsWorldTest, WakingAStackKeepsItsContacts)
+{
+	PhysicsWorld world(glm::vec3(0.0f, -9.81f, 0.0f), 1);
+
+	RigidBody ground(0.0f, glm::vec3(0.0f));
+	ground.setCollider(BoxCollider(glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f), glm::vec3(20.0f, 1.0f, 20.0f)));
+	world.addRigidBody(ground);
+
+	std::size_t bottom = addBox(world, 1.0f, glm::vec3(0.0f, 0.5f, 0.0f));
+	std::size_t top = addBox(world, 1.0f, glm::vec3(0.0f, 1.5f, 0.0f));
+
+	step(world, 300);
+	ASSERT_FALSE(world.isAwake(bottom));
+	ASSERT_FALSE(world.isAwake(top));
+
+	//Dropped at rest onto the top of the stack, which wakes the whole
+	//stack in the middle of a step
+	std::size_t dropped = addBox(world, 1.0f, glm::vec3(0.0f, 2.49f, 0.0f));
+
+	step(world, 60);
+
+	EXPECT_NEAR(world.getPosition(bottom).y, 0.5f, 0.05f);
+	EXPECT_NEAR(world.getPosition(top).y, 1.5f, 0.05f);
+	EXPECT_NEAR(world.getPosition(dropped).y, 2.5f, 0.05f);
+}
+
+TEST(PhysicsWorldTest, RemovedBodyNoLongerCollides)
+{
+	PhysicsWorld world(glm::vec3(0.0f), 1);
+	std::size_t wall = addBox(world, 0.0f, glm::vec3(2.0f, 0.0f, 0.0f));
+	std::size_t mover = addBox(world, 1.0f, glm::vec3(0.0f));
+	world.setVelocity(mover, glm::vec3(3.0f, 0.0f, 0.0f));
+
+	world.removeRigidBody(wall);
+	step(world, 60);
+
+	EXPECT_TRUE(world.isRemoved(wall));
+	EXPECT_FALSE(world.isAwake(wall));
+	EXPECT_NEAR(world.getPosition(mover).x, 3.0f, 0.01f);
+	EXPECT_EQ(world.getPosition(wall), glm::vec3(2.0f, 0.0f, 0.0f));
+}
+
+TEST(PhysicsWorldTest, RemovingAStaticBodyWakesWhatRestsOnIt)
+{
+	PhysicsWorld world(glm::vec3(0.0f, -9.81f, 0.0f), 1);
+
+	RigidBody ground(0.0f, glm::vec3(0.0f));
+	ground.setCollider(BoxCollider(glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f), glm::vec3(20.0f, 1.0f, 20.0f)));
+	std::size_t floor = world.addRigidBody(ground);
+	std::size_t box = addBox(world, 1.0f, glm::vec3(0.0f, 0.5f, 0.0f));
+
+	step(world, 300);
+	ASSERT_FALSE(world.isAwake(box));
+
+	world.removeRigidBody(floor);
+	step(world, 30);
+
+	EXPECT_TRUE(world.isAwake(box));
+	EXPECT_LT(world.getPosition(box).y, 0.0f);
+}
+
+TEST(PhysicsWorldTest, StepsGiveTheSameResultsOnAnyNumberOfThreads)
+{
+	std::vector<glm::vec3> serial = simulatePile(std::make_unique<BVHBroadphase>(), 0);
+	std::vector<glm::vec3> parallel = simulatePile(std::make_unique<BVHBroadphase>(), 3);
+
+	ASSERT_EQ(serial.size(), parallel.size());
+
+	for (std::size_t i = 0; i < serial.size(); i++)
+	{
+		EXPECT_EQ(serial[i], parallel[i]) << "body " << i;
+	}
+
+	serial = simulatePile(std::make_unique<DynamicBVHBroadphase>(), 0);
+	parallel = simulatePile(std::make_unique<DynamicBVHBroadphase>(), 3);
+
+	for (std::size_t i = 0; i < serial.size(); i++)
+	{
+		EXPECT_EQ(serial[i], parallel[i]) << "body " << i;
+	}
+}
+
+TEST(PhysicsWorldTest, BouncyBoxBouncesBackToWhereItWasDropped)
+{
+	PhysicsWorld world(glm::vec3(0.0f, -9.81f, 0.0f), 1);
+
+	RigidBody ground(0.0f, glm::vec3(0.0f));
+	ground.setCollider(BoxCollider(glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f), glm::vec3(20.0f, 1.0f, 20.0f)));
+	world.addRigidBody(ground);
+
+	std::size_t box = addBox(world, 1.0f, glm::vec3(0.0f, 5.0f, 0.0f));
+	world.setRestitution(box, 1.0f);
+
+	//Fall, then rise for as long as the box is moving up
+	bool hasBounced = false;
+	float apex = 0.0f;
+
+	for (int i = 0; i < 300 && !(hasBounced && world.getVelocity(box).y <= 0.0f); i++)
+	{
+		world.stepSimulation(s_timestep);
+		hasBounced = hasBounced || world.getVelocity(box).y > 0.0f;
+		apex = glm::max(apex, world.getPosition(box).y);
+	}
+
+	ASSERT_TRUE(hasBounced);
+
+	//Bouncing off the step's gravity on top of the velocity of the impact
+	//would gain the height a step of that velocity covers, about 0.16
+	EXPECT_LE(apex, 5.0f + 0.01f);
+	EXPECT_GT(apex, 4.8f);
+}
+
+TEST(PhysicsWorldTest, StackSettlesWithHalfTheIterations)
+{
+	PhysicsWorld world(glm::vec3(0.0f, -9.81f, 0.0f), 1);
+	world.setSleepingEnabled(false);
+
+	//Warm starting carries the stack's weight over from step to step, so
+	//half the default iterations are enough to hold it up
+	world.getContactSolver().setIterations(5);
+
+	RigidBody ground(0.0f, glm::vec3(0.0f));
+	ground.setCollider(BoxCollider(glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f), glm::vec3(20.0f, 1.0f, 20.0f)));
+	world.addRigidBody(ground);
+
+	std::vector<std::size_t> stack;
+
+	for (int i = 0; i < 6; i++)
+	{
+		stack.push_back(addBox(world, 1.0f, glm::vec3(0.0f, 0.5f + static_cast<float>(i), 0.0f)));
+	}
+
+	step(world, 300);
+
+	for (std::size_t i = 0; i < stack.size(); i++)
+	{
+		glm::vec3 position = world.getPosition(stack[i]);
+
+		EXPECT_NEAR(position.y, 0.5f + static_cast<float>(i), 0.05f) << "box " << i;
+		EXPECT_NEAR(position.x, 0.0f, 0.01f) << "box " << i;
+		EXPECT_NEAR(position.z, 0.0f, 0.01f) << "box " << i;
+		EXPECT_LT(glm::length(world.getVelocity(stack[i])), 0.05f) << "box " << i;
+	}
+}
+
+TEST(PhysicsWorldTest, RestingBodyFallsAsleepAndWakesWhenMoved)
+{
+	PhysicsWorld world(glm::vec3(0.0f, -9.81f, 0.0f), 1);
+
+	RigidBody ground(0.0f, glm::vec3(0.0f));
+	ground.setCollider(BoxCollider(glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f), glm::vec3(20.0f, 1.0f, 20.0f)));
+	world.addRigidBody(ground);
+
+	std::size_t box = addBox(world, 1.0f, glm::vec3(0.0f, 0.5f, 0.0f));
+
+	//Not before it has rested for the default half a second
+	step(world, 20);
+	EXPECT_TRUE(world.isAwake(box));
+
+	step(world, 40);
+	ASSERT_FALSE(world.isAwake(box));
+
+	//Asleep, gravity no longer moves it
+	glm::vec3 position = world.getPosition(box);
+	step(world, 60);
+	EXPECT_EQ(world.getPosition(box), position);
+	EXPECT_EQ(world.getVelocity(box), glm::vec3(0.0f));
+
+	world.setVelocity(box, glm::vec3(2.0f, 0.0f, 0.0f));
+	EXPECT_TRUE(world.isAwake(box));
+
+	step(world, 10);
+	EXPECT_GT(world.getPosition(box).x, position.x);
+}
+
+TEST(PhysicsWorldTest, IslandSleepsByItsStrictestBody)
+{
+	PhysicsWorld world(glm::vec3(0.0f, -9.81f, 0.0f), 1);
+
+	RigidBody ground(0.0f, glm::vec3(0.0f));
+	ground.setCollider(BoxCollider(glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f), glm::vec3(20.0f, 1.0f, 20.0f)));
+	world.addRigidBody(ground);
+
+	//A box on its own, and a stack of two, each an island of its own as
+	//the ground is static
+	std::size_t single = addBox(world, 1.0f, glm::vec3(-3.0f, 0.5f, 0.0f));
+	std::size_t bottom = addBox(world, 1.0f, glm::vec3(3.0f, 0.5f, 0.0f));
+	std::size_t top = addBox(world, 1.0f, glm::vec3(3.0f, 1.5f, 0.0f));
+
+	world.setSleepThresholds(top, 0.05f, 2.0f);
+
+	step(world, 60);
+	EXPECT_FALSE(world.isAwake(single));
+	EXPECT_TRUE(world.isAwake(bottom));
+	EXPECT_TRUE(world.isAwake(top));
+
+	step(world, 90);
+	EXPECT_FALSE(world.isAwake(bottom));
+	EXPECT_FALSE(world.isAwake(top));
+
+	//A body that never sleeps keeps its island awake
+	world.setSleepThresholds(bottom, 0.05f, std::numeric_limits<float>::infinity());
+	world.wakeBody(bottom);
+	EXPECT_TRUE(world.isAwake(top));
+
+	step(world, 300);
+	EXPECT_TRUE(world.isAwake(bottom));
+	EXPECT_TRUE(world.isAwake(top));
+	EXPECT_NEAR(world.getPosition(top).y, 1.5f, 0.05f);
+}
+
+TEST(PhysicsWorldTest, SleepThresholdsApplyToEveryBody)
+{
+	PhysicsWorld world(glm::vec3(0.0f), 1);
+	std::size_t before = addBox(world, 1.0f, glm::vec3(0.0f));
+
+	world.setSleepThresholds(0.05f, 1.0f);
+	std::size_t after = addBox(world, 1.0f, glm::vec3(3.0f, 0.0f, 0.0f));
+
+	step(world, 45);
+	EXPECT_TRUE(world.isAwake(before));
+	EXPECT_TRUE(world.isAwake(after));
+
+	step(world, 30);
+	EXPECT_FALSE(world.isAwake(before));
+	EXPECT_FALSE(world.isAwake(after));
+}
+
+TEST(PhysicsWorldTest, UpdateTakesAStepPerFixedTimestep)
+{
+	PhysicsWorld world(glm::vec3(0.0f), 0);
+	addBox(world, 1.0f, glm::vec3(0.0f));
+
+	//A second at 100 frames per second is 60 steps, none lost to rounding
+	unsigned int steps = 0;
+
+	for (int i = 0; i < 100; i++)
+	{
+		steps += world.update(0.01f);
+	}
+
+	EXPECT_EQ(steps, 60u);
+	EXPECT_NEAR(world.getInterpolationFactor(), 0.0f, 1e-3f);
+
+	//And a minute at 144 frames per second
+	steps = 0;
+
+	for (int i = 0; i < 60 * 144; i++)
+	{
+		steps += world.update(1.0f / 144.0f);
+	}
+
+	EXPECT_EQ(steps, 60u * 60u);
+}
+
+TEST(PhysicsWorldTest, UpdateInterpolatesBetweenTheLastTwoSteps)
+{
+	PhysicsWorld world(glm::vec3(0.0f), 0);
+	std::size_t box = addBox(world, 1.0f, glm::vec3(0.0f));
+	world.setVelocity(box, glm::vec3(6.0f, 0.0f, 0.0f));
+
+	//One step, and half of the next one left over
+	EXPECT_EQ(world.update(1.5f * s_timestep), 1u);
+	EXPECT_NEAR(world.getInterpolationFactor(), 0.5f, 1e-4f);
+	EXPECT_NEAR(world.getPosition(box).x, 0.1f, 1e-5f);
+	EXPECT_NEAR(world.getInterpolatedPosition(box).x, 0.05f, 1e-5f);
+
+	//Which the next frame finishes
+	EXPECT_EQ(world.update(0.75f * s_timestep), 1u);
+	EXPECT_NEAR(world.getInterpolationFactor(), 0.25f, 1e-4f);
+	EXPECT_NEAR(world.getInterpolatedPosition(box).x, 0.125f, 1e-5f);
+
+	//A long frame takes no more than the maximum number of steps, and
+	//drops the rest
+	world.setMaxSubsteps(4);
+	EXPECT_EQ(world.update(1.0f), 4u);
+	EXPECT_NEAR(world.getInterpolationFactor(), 0.0f, 1e-4f);
+	EXPECT_NEAR(world.getPosition(box).x, 0.6f, 1e-5f);
+}
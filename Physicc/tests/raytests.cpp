@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+
+#include "ray.hpp"
+#include "widebvh.hpp"
+
+using namespace Physicc;
+
+TEST(RayTest, AxisParallelRayOnSlabPlaneHitsBox)
+{
+	BoundingVolume::AABB box(glm::vec3(0.0f), glm::vec3(1.0f));
+	float t;
+
+	//Touching counts as overlapping, on either side of the slab
+	EXPECT_TRUE(Ray(glm::vec3(-1.0f, 0.0f, 0.5f), glm::vec3(1.0f, 0.0f, 0.0f)).intersects(box, 10.0f, t));
+	EXPECT_FLOAT_EQ(t, 1.0f);
+	EXPECT_TRUE(Ray(glm::vec3(-1.0f, 1.0f, 0.5f), glm::vec3(1.0f, 0.0f, 0.0f)).intersects(box, 10.0f, t));
+	EXPECT_FLOAT_EQ(t, 1.0f);
+	EXPECT_TRUE(Ray(glm::vec3(-1.0f, 1.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f)).intersects(box, 10.0f, t));
+
+	EXPECT_FALSE(Ray(glm::vec3(-1.0f, 1.001f, 0.5f), glm::vec3(1.0f, 0.0f, 0.0f)).intersects(box, 10.0f, t));
+	EXPECT_FALSE(Ray(glm::vec3(-1.0f, -0.001f, 0.5f), glm::vec3(1.0f, 0.0f, 0.0f)).intersects(box, 10.0f, t));
+	EXPECT_FALSE(Ray(glm::vec3(-1.0f, 0.5f, 0.5f), glm::vec3(-1.0f, 0.0f, 0.0f)).intersects(box, 10.0f, t));
+	EXPECT_FALSE(Ray(glm::vec3(-1.0f, 0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 0.0f)).intersects(box, 0.5f, t));
+}
+
+TEST(RayTest, WideBVHsAgreeWithBVHForAxisParallelRays)
+{
+	//A grid of unit boxes, with rays running along the boxes' faces
+	std::vector<BoundingVolume::AABB> volumes;
+
+	for (int x = 0; x < 8; x++)
+	{
+		for (int y = 0; y < 8; y++)
+		{
+			glm::vec3 lowerBound(2.0f * x, 2.0f * y, 0.0f);
+			volumes.emplace_back(lowerBound, lowerBound + glm::vec3(1.0f));
+		}
+	}
+
+	BVH bvh(volumes);
+	bvh.buildTree();
+	QBVH qbvh(bvh);
+	OBVH obvh(bvh);
+
+	for (int y = 0; y < 16; y++)
+	{
+		for (float z : {0.0f, 0.5f, 1.0f, 1.5f})
+		{
+			Ray ray(glm::vec3(-1.0f, static_cast<float>(y), z), glm::vec3(1.0f, 0.0f, 0.0f));
+			std::optional<RaycastHit> expected = bvh.raycast(ray);
+
+			//Every row of boxes spans a whole unit along y, touching the rays
+			//on both of its faces
+			EXPECT_EQ(expected.has_value(), z <= 1.0f);
+
+			for (const std::optional<RaycastHit>& hit : {qbvh.raycast(ray), obvh.raycast(ray)})
+			{
+				ASSERT_EQ(hit.has_value(), expected.has_value());
+
+				if (hit)
+				{
+					EXPECT_EQ(hit->bodyIndex, expected->bodyIndex);
+					EXPECT_FLOAT_EQ(hit->t, expected->t);
+				}
+			}
+		}
+	}
+}
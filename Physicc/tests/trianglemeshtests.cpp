@@ -0,0 +1,282 @@
+#include "gtest/gtest.h"
+
+#include "trianglemesh.hpp"
+
+#include "glm/gtc/quaternion.hpp"
+
+#include <limits>
+#include <random>
+
+using namespace Physicc;
+
+namespace
+{
+	const glm::vec3 s_position(1.0f, 2.0f, 3.0f);
+	const glm::vec3 s_rotation(20.0f, 30.0f, 40.0f);
+
+	/**
+	 * @brief A seeded soup of small random triangles, rotated and moved
+	 * away from the origin
+	 */
+	class TriangleMeshTest : public ::testing::Test
+	{
+		protected:
+			TriangleMeshTest()
+				: m_mesh(makeMesh())
+			{
+			}
+
+			float random()
+			{
+				return m_distribution(m_random);
+			}
+
+			glm::vec3 randomVector()
+			{
+				return glm::vec3(random(), random(), random());
+			}
+
+			TriangleMeshCollider m_mesh;
+			std::mt19937 m_random {7};
+			std::uniform_real_distribution<float> m_distribution {-1.0f, 1.0f};
+
+		private:
+			static TriangleMeshCollider makeMesh()
+			{
+				std::mt19937 random(3);
+				std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+				std::vector<glm::vec3> vertices;
+				std::vector<unsigned int> indices;
+
+				for (int i = 0; i < 2000; i++)
+				{
+					glm::vec3 center = 10.0f * glm::vec3(distribution(random), distribution(random), distribution(random));
+
+					for (int j = 0; j < 3; j++)
+					{
+						glm::vec3 offset(distribution(random), distribution(random), distribution(random));
+						vertices.push_back(center + 0.5f * offset);
+						indices.push_back(static_cast<unsigned int>(vertices.size() - 1));
+					}
+				}
+
+				return TriangleMeshCollider(vertices, indices, s_position, s_rotation);
+			}
+	};
+}
+
+TEST_F(TriangleMeshTest, RaycastMatchesBruteForce)
+{
+	int hits = 0;
+
+	for (int i = 0; i < 500; i++)
+	{
+		Ray ray(15.0f * randomVector() + s_position, randomVector());
+		float tMax = 20.0f;
+
+		float closest = tMax;
+		bool expected = false;
+
+		for (std::size_t j = 0; j < m_mesh.getTriangleCount(); j++)
+		{
+			float t;
+
+			if (m_mesh.getTriangle(j).intersects(ray, closest, t))
+			{
+				closest = t;
+				expected = true;
+			}
+		}
+
+		std::optional<TriangleHit> hit = m_mesh.raycast(ray, tMax);
+
+		ASSERT_EQ(hit.has_value(), expected);
+
+		if (hit)
+		{
+			hits++;
+			EXPECT_NEAR(hit->t, closest, 1e-4f);
+			EXPECT_LE(glm::dot(hit->normal, ray.direction), 0.0f);
+		}
+	}
+
+	EXPECT_GT(hits, 0);
+}
+
+TEST_F(TriangleMeshTest, QueriesMatchBruteForce)
+{
+	std::vector<std::uint32_t> triangles;
+	std::size_t found = 0;
+
+	for (int i = 0; i < 200; i++)
+	{
+		glm::vec3 center = 8.0f * randomVector() + s_position;
+		float radius = 0.5f + 0.3f * random();
+
+		std::size_t expected = 0;
+
+		for (std::size_t j = 0; j < m_mesh.getTriangleCount(); j++)
+		{
+			glm::vec3 offset = m_mesh.getTriangle(j).getClosestPoint(center) - center;
+			expected += glm::dot(offset, offset) <= radius * radius ? 1 : 0;
+		}
+
+		m_mesh.querySphere(center, radius, triangles);
+		EXPECT_EQ(triangles.size(), expected);
+		found += expected;
+
+		glm::mat3 axes = glm::mat3_cast(glm::quat(randomVector()));
+		glm::vec3 halfExtents(0.5f, 0.3f, 0.8f);
+
+		expected = 0;
+
+		for (std::size_t j = 0; j < m_mesh.getTriangleCount(); j++)
+		{
+			glm::vec3 normal;
+			float depth;
+			expected += m_mesh.getTriangle(j).findBoxPenetration(center, axes, halfExtents, normal, depth) ? 1 : 0;
+		}
+
+		m_mesh.queryBox(center, axes, halfExtents, triangles);
+		EXPECT_EQ(triangles.size(), expected);
+		found += expected;
+	}
+
+	EXPECT_GT(found, 0u);
+}
+
+TEST_F(TriangleMeshTest, SaveLoadRoundTrip)
+{
+	std::vector<std::uint8_t> data;
+	m_mesh.save(data);
+
+	std::optional<TriangleMeshCollider> loaded = TriangleMeshCollider::load(data.data(), data.size(), s_position, s_rotation);
+	ASSERT_TRUE(loaded.has_value());
+	ASSERT_EQ(loaded->getTriangleCount(), m_mesh.getTriangleCount());
+
+	for (std::size_t i = 0; i < m_mesh.getTriangleCount(); i++)
+	{
+		EXPECT_EQ(loaded->getTriangle(i).vertices, m_mesh.getTriangle(i).vertices);
+	}
+
+	for (int i = 0; i < 200; i++)
+	{
+		Ray ray(15.0f * randomVector() + s_position, randomVector());
+		std::optional<TriangleHit> expected = m_mesh.raycast(ray);
+		std::optional<TriangleHit> hit = loaded->raycast(ray);
+
+		ASSERT_EQ(hit.has_value(), expected.has_value());
+
+		if (hit)
+		{
+			EXPECT_EQ(hit->triangle, expected->triangle);
+			EXPECT_EQ(hit->t, expected->t);
+		}
+	}
+
+	std::vector<std::uint8_t> saved;
+	loaded->save(saved);
+	EXPECT_EQ(saved, data);
+}
+
+TEST_F(TriangleMeshTest, LoadRejectsCorruptData)
+{
+	std::vector<std::uint8_t> data;
+	m_mesh.save(data);
+
+	//Too short for a header, or cut off
+	EXPECT_FALSE(TriangleMeshCollider::load(data.data(), 4).has_value());
+	EXPECT_FALSE(TriangleMeshCollider::load(data.data(), data.size() - 1).has_value());
+
+	//Wrong magic
+	std::vector<std::uint8_t> corrupt = data;
+	corrupt[0] ^= 0xff;
+	EXPECT_FALSE(TriangleMeshCollider::load(corrupt.data(), corrupt.size()).has_value());
+
+	//Wrong version
+	corrupt = data;
+	corrupt[4] ^= 0xff;
+	EXPECT_FALSE(TriangleMeshCollider::load(corrupt.data(), corrupt.size()).has_value());
+
+	//A node pointing past the end of the arrays (the last node is a leaf,
+	//and its highest byte holds its triangle count)
+	corrupt = data;
+	corrupt.back() = 0x8f;
+	corrupt[corrupt.size() - 2] = 0xff;
+	EXPECT_FALSE(TriangleMeshCollider::load(corrupt.data(), corrupt.size()).has_value());
+
+	//An index past the last vertex. The vertices follow a header of 5
+	//words and 9 floats.
+	corrupt = data;
+	std::size_t firstIndex = 14 * sizeof(std::uint32_t) + 3 * m_mesh.getTriangleCount() * sizeof(glm::vec3);
+	corrupt[firstIndex + 3] = 0xff;
+	EXPECT_FALSE(TriangleMeshCollider::load(corrupt.data(), corrupt.size()).has_value());
+}
+
+TEST(TriangleMeshColliderTest, FlatMeshIsQueryable)
+{
+	//A single quad, flat along y, gets a quantization scale of 0 along y
+	std::vector<glm::vec3> vertices = {{-1.0f, 0.0f, -1.0f}, {1.0f, 0.0f, -1.0f}, {-1.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 1.0f}};
+	std::vector<unsigned int> indices = {0, 2, 1, 1, 2, 3};
+	TriangleMeshCollider mesh(vertices, indices);
+
+	std::optional<TriangleHit> hit = mesh.raycast(Ray(glm::vec3(0.2f, 5.0f, 0.3f), glm::vec3(0.0f, -1.0f, 0.0f)));
+	ASSERT_TRUE(hit.has_value());
+	EXPECT_NEAR(hit->t, 5.0f, 1e-5f);
+	EXPECT_NEAR(hit->normal.y, 1.0f, 1e-5f);
+
+	std::vector<std::uint32_t> triangles;
+	mesh.querySphere(glm::vec3(0.0f, 0.2f, 0.0f), 0.25f, triangles);
+	EXPECT_EQ(triangles.size(), 2u);
+	mesh.querySphere(glm::vec3(0.0f, 0.3f, 0.0f), 0.25f, triangles);
+	EXPECT_TRUE(triangles.empty());
+}
+
+TEST(TriangleMeshColliderTest, AABBFitsMeshAwayFromItsOrigin)
+{
+	//A block of level geometry modelled far from the mesh's origin, whose
+	//bounds are the block's own corners
+	std::vector<glm::vec3> vertices;
+
+	for (int i = 0; i < 8; i++)
+	{
+		vertices.emplace_back(i & 1 ? 104.0f : 100.0f, i & 2 ? 1.0f : 0.0f, i & 4 ? 52.0f : 50.0f);
+	}
+
+	std::vector<unsigned int> indices = {0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6,
+	                                     0, 1, 4, 1, 5, 4, 2, 6, 3, 3, 6, 7,
+	                                     0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5};
+
+	for (const glm::vec3& rotation : {glm::vec3(0.0f), s_rotation})
+	{
+		TriangleMeshCollider mesh(vertices, indices, s_position, rotation);
+		glm::vec3 lowerBound(std::numeric_limits<float>::infinity());
+		glm::vec3 upperBound(-std::numeric_limits<float>::infinity());
+
+		for (std::size_t i = 0; i < mesh.getTriangleCount(); i++)
+		{
+			for (const glm::vec3& vertex : mesh.getTriangle(i).vertices)
+			{
+				lowerBound = glm::min(lowerBound, vertex);
+				upperBound = glm::max(upperBound, vertex);
+			}
+		}
+
+		//As tight as the rotated block allows, not grown by how far the
+		//block is from the origin
+		const BoundingVolume::AABB& aabb = mesh.getAABB();
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			EXPECT_NEAR(aabb.getLowerBound()[axis], lowerBound[axis], 1e-3f);
+			EXPECT_NEAR(aabb.getUpperBound()[axis], upperBound[axis], 1e-3f);
+		}
+
+		//And it follows the mesh around
+		mesh.setPosition(s_position + glm::vec3(5.0f, 0.0f, 0.0f));
+		mesh.updateTransform();
+
+		EXPECT_NEAR(mesh.getAABB().getLowerBound().x, lowerBound.x + 5.0f, 1e-3f);
+		EXPECT_NEAR(mesh.getAABB().getUpperBound().x, upperBound.x + 5.0f, 1e-3f);
+	}
+}
@@ -0,0 +1,196 @@
+#include "gtest/gtest.h"
+
+#include "widebvh.hpp"
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+
+using namespace Physicc;
+
+namespace
+{
+	/**
+	 * @brief A binary BVH over a seeded scatter of boxes and the two wide
+	 * BVHs collapsed from it, for every split method and a few leaf sizes
+	 *
+	 * The wide trees test their children with SSE (4 wide) and AVX (8 wide)
+	 * where the compiler targets them, and are checked against the scalar
+	 * traversal of the binary tree.
+	 */
+	class WideBVHTest : public ::testing::TestWithParam<std::tuple<BVH::SplitMethod, std::size_t>>
+	{
+		protected:
+			WideBVHTest()
+				: m_boxes(makeBoxes()),
+				  m_bvh(build(m_boxes)),
+				  m_qbvh(m_bvh),
+				  m_obvh(m_bvh)
+			{
+			}
+
+			std::vector<BoundingVolume::AABB> m_boxes;
+			BVH m_bvh;
+			QBVH m_qbvh;
+			OBVH m_obvh;
+
+		private:
+			static std::vector<BoundingVolume::AABB> makeBoxes()
+			{
+				std::mt19937 random(29);
+				std::uniform_real_distribution<float> position(0.0f, 40.0f);
+				std::uniform_real_distribution<float> size(0.1f, 3.0f);
+				std::vector<BoundingVolume::AABB> boxes;
+
+				//A count that fills neither 4 nor 8 wide nodes evenly
+				for (int i = 0; i < 1237; i++)
+				{
+					glm::vec3 lowerBound(position(random), position(random), position(random));
+					boxes.emplace_back(lowerBound, lowerBound + glm::vec3(size(random), size(random), size(random)));
+				}
+
+				return boxes;
+			}
+
+			static BVH build(const std::vector<BoundingVolume::AABB>& boxes)
+			{
+				BVH bvh(boxes, std::get<0>(GetParam()), std::get<1>(GetParam()));
+				bvh.buildTree();
+
+				return bvh;
+			}
+	};
+
+	void expectSameHit(const std::optional<RaycastHit>& hit,
+	                   const std::optional<RaycastHit>& expected,
+	                   const std::vector<BoundingVolume::AABB>& boxes,
+	                   const Ray& ray,
+	                   float tMax)
+	{
+		ASSERT_EQ(hit.has_value(), expected.has_value());
+
+		if (hit)
+		{
+			//Bodies can tie for the nearest hit, so only check that the
+			//reported one is hit where it says
+			float t;
+
+			EXPECT_FLOAT_EQ(hit->t, expected->t);
+			ASSERT_TRUE(ray.intersects(boxes[hit->bodyIndex], tMax, t));
+			EXPECT_FLOAT_EQ(t, expected->t);
+		}
+	}
+}
+
+TEST_P(WideBVHTest, RaycastsMatchBinaryBVH)
+{
+	std::mt19937 random(31);
+	std::uniform_real_distribution<float> position(-5.0f, 45.0f);
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> length(0.0f, 30.0f);
+
+	for (int i = 0; i < 500; i++)
+	{
+		glm::vec3 rayDirection(direction(random), direction(random), direction(random));
+
+		//Some rays along the axes and planes, whose inverse direction is
+		//infinite on some lanes
+		if (i % 5 == 1)
+		{
+			rayDirection[i % 3] = 0.0f;
+		} else if (i % 5 == 2)
+		{
+			rayDirection = glm::vec3(0.0f);
+			rayDirection[i % 3] = i % 2 == 0 ? 1.0f : -1.0f;
+		}
+
+		Ray ray(glm::vec3(position(random), position(random), position(random)), rayDirection);
+		float tMax = i % 3 == 0 ? std::numeric_limits<float>::infinity() : length(random);
+
+		std::optional<RaycastHit> expected = m_bvh.raycast(ray, tMax);
+
+		SCOPED_TRACE("ray " + std::to_string(i));
+		expectSameHit(m_qbvh.raycast(ray, tMax), expected, m_boxes, ray, tMax);
+		expectSameHit(m_obvh.raycast(ray, tMax), expected, m_boxes, ray, tMax);
+
+		bool any = m_bvh.raycastAny(ray, tMax);
+
+		EXPECT_EQ(any, expected.has_value());
+		EXPECT_EQ(m_qbvh.raycastAny(ray, tMax), any);
+		EXPECT_EQ(m_obvh.raycastAny(ray, tMax), any);
+	}
+}
+
+TEST_P(WideBVHTest, RegionQueriesMatchBinaryBVH)
+{
+	std::mt19937 random(37);
+	std::uniform_real_distribution<float> position(-5.0f, 45.0f);
+	std::uniform_real_distribution<float> size(0.0f, 8.0f);
+	std::vector<std::uint32_t> expected, bodies;
+
+	for (int i = 0; i < 300; i++)
+	{
+		glm::vec3 lowerBound(position(random), position(random), position(random));
+		BoundingVolume::AABB region(lowerBound, lowerBound + glm::vec3(size(random), size(random), size(random)));
+
+		m_bvh.queryRegion(region, expected);
+		std::sort(expected.begin(), expected.end());
+
+		m_qbvh.queryRegion(region, bodies);
+		std::sort(bodies.begin(), bodies.end());
+		EXPECT_EQ(bodies, expected) << "region " << i;
+
+		m_obvh.queryRegion(region, bodies);
+		std::sort(bodies.begin(), bodies.end());
+		EXPECT_EQ(bodies, expected) << "region " << i;
+	}
+
+	//A region around everything finds every body exactly once
+	m_obvh.queryRegion(BoundingVolume::AABB(glm::vec3(-100.0f), glm::vec3(100.0f)), bodies);
+	std::sort(bodies.begin(), bodies.end());
+
+	ASSERT_EQ(bodies.size(), m_boxes.size());
+
+	for (std::uint32_t i = 0; i < bodies.size(); i++)
+	{
+		ASSERT_EQ(bodies[i], i);
+	}
+}
+
+TEST(WideBVHTest, CollapsedNodesAreFull)
+{
+	std::vector<BoundingVolume::AABB> boxes;
+
+	//A 4 x 4 x 4 grid makes a complete binary tree 6 levels deep, which
+	//collapses into 3 levels of 4 wide nodes or 2 of 8 wide ones
+	for (int i = 0; i < 64; i++)
+	{
+		glm::vec3 lowerBound(static_cast<float>(i % 4), static_cast<float>(i / 4 % 4), static_cast<float>(i / 16));
+		boxes.emplace_back(lowerBound, lowerBound + glm::vec3(0.5f));
+	}
+
+	BVH bvh(boxes, BVH::SplitMethod::Median, 1);
+	bvh.buildTree();
+	QBVH qbvh(bvh);
+	OBVH obvh(bvh);
+
+	for (const auto& node : qbvh.getNodes())
+	{
+		EXPECT_EQ(node.childCount, 4u);
+	}
+
+	for (const auto& node : obvh.getNodes())
+	{
+		EXPECT_EQ(node.childCount, 8u);
+	}
+
+	EXPECT_EQ(qbvh.getNodes().size(), 1u + 4u + 16u);
+	EXPECT_EQ(obvh.getNodes().size(), 1u + 8u);
+}
+
+INSTANTIATE_TEST_SUITE_P(SplitMethods,
+                         WideBVHTest,
+                         ::testing::Combine(::testing::Values(BVH::SplitMethod::Median,
+                                                              BVH::SplitMethod::SAH,
+                                                              BVH::SplitMethod::Morton),
+                                            ::testing::Values(std::size_t(1), std::size_t(4))));